@@ -25,20 +25,51 @@
 #define buffer_size   YUV_SIZE+1920*4
 #define YUV_SIZE      (width1 * height1 * 3 / 2)  // NV12格式
 #define JPEG_QUALITY  80
+#define CAMERA_DEFAULT_BUFFERS  4
+#define CAMERA_MAX_BUFFERS      VIDEO_MAX_FRAME
+
+// 导入模式下由调用者提供的缓冲区
+typedef struct {
+    int fd;                         // dmabuf fd(DMABUF 方式)
+    void* ptr;                      // CPU 地址(USERPTR 方式及 CPU 访问)
+    unsigned int length;            // 缓冲区长度
+} camera_import_buf_t;
 
 typedef struct {
     int fd;                         // 摄像头文件描述符
+    uint32_t memory;                // V4L2_MEMORY_MMAP / DMABUF / USERPTR
     struct v4l2_format fmt;         // 视频格式
-    struct v4l2_buffer buf;         // 缓冲区信息
+    struct v4l2_buffer buf;         // 缓冲区信息(最近一次 DQBUF)
+    struct v4l2_plane planes[1];    // buf 使用的平面数组
     struct v4l2_requestbuffers req; // 缓冲区请求
-    void* buffers[4][2];                 // 映射的缓冲区指针数组
+    void** buffers;                 // 映射的缓冲区指针数组(n_buffers项)
+    unsigned int* buf_lengths;      // 每个缓冲区映射长度
+    int* dmabuf_fds;                // 导入模式下每个缓冲区的 dmabuf fd
     unsigned int n_buffers;        // 缓冲区数量
     unsigned int buf_size;          // 每个缓冲区大小
+    unsigned int n_queued;          // 当前在驱动队列中的缓冲区数量
+    uint64_t* queued_hist;          // DQBUF 后驱动中剩余缓冲数的分布(n_buffers+1项)
+    uint64_t* trace_frames;         // 每个缓冲区 DQBUF 时的跟踪帧号，QBUF 事件沿用
+    unsigned char* held;            // 每个缓冲区是否已 DQBUF 尚未归还，重启采集流时跳过
+    uint32_t last_sequence;         // 上一帧的驱动帧序号
+    uint64_t seq_gaps;              // 驱动帧序号跳变累计丢帧数
+    int has_sequence;
 } camera_t;
 
-int camera_init(camera_t* cam, const char* device, int width, int height, uint32_t pixelformat);
+int camera_init(camera_t* cam, const char* device, int width, int height, uint32_t pixelformat,
+                unsigned int buf_count);
+int camera_init_import(camera_t* cam, const char* device, int width, int height, uint32_t pixelformat,
+                       const camera_import_buf_t* bufs, unsigned int buf_count);
+int camera_set_fps(camera_t* cam, int fps);
 int camera_start_capture(camera_t* cam);
 void* capture_yuv_frame(camera_t* cam, int timeout_ms);
 int requeue_buffer(camera_t* cam);
+int camera_requeue_index(camera_t* cam, unsigned int index);
+int camera_flush(camera_t* cam);
+int camera_restart(camera_t* cam);
+int camera_set_format(camera_t* cam, int width, int height);
+void camera_set_verbose(int verbose);
+void camera_report(const camera_t* cam);
+void camera_close(camera_t* cam);
 int write_data_to_file(const char* filename, const void* data, size_t size);
 #endif
\ No newline at end of file
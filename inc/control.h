@@ -0,0 +1,68 @@
+#ifndef _CONTROL_H
+#define _CONTROL_H
+
+#include <stddef.h>
+#include "roi.h"
+
+/*
+ * 运行中调整编码参数。控制线程在 UNIX 套接字上每个连接接收一行命令：
+ *   quality <1-99>          JPEG 质量
+ *   crop <x,y,宽,高>|off    编码区域
+ *   size <宽>x<高>          采集/编码分辨率
+ *   status                  当前参数
+ * 命令放入单槽邮箱，由流水线线程在两帧之间取出执行(编码器和摄像头只在该线程上操作)，
+ * 执行结果以 "ok ..." 或 "error ..." 一行返回给客户端。
+ */
+
+#define CONTROL_REPLY_MAX   256
+#define CONTROL_TIMEOUT_MS  3000    // 流水线在该时间内没有取走命令则回复超时
+
+typedef enum {
+    CONTROL_QUALITY = 0,
+    CONTROL_CROP,
+    CONTROL_SIZE,
+    CONTROL_STATUS,
+} control_op_t;
+
+typedef struct {
+    control_op_t op;
+    int quality;
+    int has_crop;                   // crop: 0 表示恢复整帧
+    roi_rect_t crop;
+    int width;                      // size
+    int height;
+} control_cmd_t;
+
+/**
+ * @brief 执行一条命令，在流水线线程上调用
+ * @param arg control_poll 的 arg
+ * @param cmd 命令
+ * @param reply 输出：回复(不含换行)
+ * @param cap reply 容量
+ */
+typedef void (*control_apply_fn)(void* arg, const control_cmd_t* cmd, char* reply, size_t cap);
+
+/**
+ * @brief 解析一行命令
+ * @return 成功返回0，格式错误返回-1
+ */
+int control_parse(const char* line, control_cmd_t* cmd);
+
+/**
+ * @brief 在 UNIX 套接字上启动控制线程
+ * @return 成功返回0，失败返回-1
+ */
+int control_start(const char* path);
+
+/**
+ * @brief 流水线在两帧之间调用：有待执行的命令时调用 apply 并唤醒等待回复的控制线程
+ * @return 执行了命令返回1，否则返回0；没有命令时只有一次原子读
+ */
+int control_poll(control_apply_fn apply, void* arg);
+
+/**
+ * @brief 停止控制线程并删除套接字
+ */
+void control_stop(void);
+
+#endif
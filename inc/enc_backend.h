@@ -0,0 +1,88 @@
+#ifndef _ENC_BACKEND_H
+#define _ENC_BACKEND_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "roi.h"
+#include "enc_packet.h"
+
+/*
+ * JPEG 编码后端抽象：同一接口下可以是 MPP 硬件编码会话，也可以是软件编码器。
+ * 每个实例只在一个线程中使用；多个实例可以并行。
+ */
+
+typedef struct enc_backend enc_backend_t;
+
+typedef struct {
+    const char* name;
+    int (*open)(enc_backend_t* b);
+    /**
+     * 编码一帧连续存放的 NV12(行跨度等于宽度)，返回的数据在下一次 encode/close 前有效
+     */
+    const uint8_t* (*encode)(enc_backend_t* b, const uint8_t* nv12, size_t* length);
+    void (*close)(enc_backend_t* b);
+    // 只编码输入中的一个区域(整帧坐标)，NULL 恢复整帧
+    int (*set_crop)(enc_backend_t* b, const roi_rect_t* crop);
+    // 质量分区(整帧坐标)，不支持的后端为 NULL
+    int (*set_zone)(enc_backend_t* b, const roi_rect_t* zone, int bg_quality);
+} enc_backend_ops_t;
+
+struct enc_backend {
+    const enc_backend_ops_t* ops;
+    void* priv;
+    int width;
+    int height;
+    int quality;
+    // 分块输出(enc_backend_set_stream)，chunk_fn 为 NULL 时只返回整包
+    enc_chunk_fn chunk_fn;
+    void* chunk_arg;
+    int band_rows;
+};
+
+/**
+ * @brief 按名称创建编码后端
+ * @param b 后端
+ * @param name "sw" 或 "mpp"(编译时启用 MIPI_WITH_MPP)
+ * @param width 图像宽度
+ * @param height 图像高度
+ * @param quality JPEG质量
+ * @return 成功返回0，未知后端或初始化失败返回-1
+ */
+int enc_backend_open(enc_backend_t* b, const char* name, int width, int height, int quality);
+
+/**
+ * @brief 编码一帧
+ * @return 成功返回 JPEG 数据，失败返回NULL
+ */
+static inline const uint8_t* enc_backend_encode(enc_backend_t* b, const uint8_t* nv12, size_t* length) {
+    return b->ops->encode(b, nv12, length);
+}
+
+/**
+ * @brief 设置编码区域，输入仍是整帧
+ * @return 成功返回0，失败返回-1
+ */
+int enc_backend_set_crop(enc_backend_t* b, const roi_rect_t* crop);
+
+/**
+ * @brief 设置质量分区：区域内保持原质量，区域外按 bg_quality 压缩
+ * @return 成功返回0，后端不支持或区域无效返回-1
+ */
+int enc_backend_set_zone(enc_backend_t* b, const roi_rect_t* zone, int bg_quality);
+
+/**
+ * @brief 编码时边编码边分块交出码流：软件后端每 band_rows 行 MCU 交出一块，
+ *        MPP JPEG 编码器没有分片输出，编码完成后整包作为一块交出。encode 的返回值不变
+ * @param fn 分块回调，NULL 取消
+ * @param band_rows 每块的 MCU 行数
+ */
+void enc_backend_set_stream(enc_backend_t* b, enc_chunk_fn fn, void* arg, int band_rows);
+
+void enc_backend_close(enc_backend_t* b);
+
+/**
+ * @brief 可用后端名称，以空格分隔
+ */
+const char* enc_backend_names(void);
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef _ENC_PACKET_H
+#define _ENC_PACKET_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include "frame_stats.h"
+#include "mem_arena.h"
+
+/*
+ * 带引用计数的编码包。编码线程产生后可同时交给写文件、预览等多个消费者，
+ * 每个消费者持有一个引用，最后一个引用释放时调用 release 归还底层缓冲区。
+ */
+typedef struct enc_packet enc_packet_t;
+
+#define ENC_PACKET_FLAG_KEY     0x1     // 视频关键帧(IDR)，可从此处开始解码
+
+/**
+ * @brief 编码输出分块回调：一帧的码流按顺序分成若干块交出，last 为1时是本帧最后一块。
+ *        data 只在回调期间有效
+ */
+typedef void (*enc_chunk_fn)(void* arg, const uint8_t* data, size_t length, int last);
+
+struct enc_packet {
+    _Atomic int refs;
+    void* data;                             // 编码数据
+    size_t length;                          // 有效字节数
+    uint64_t seq;                           // 帧序号
+    uint64_t timestamp_us;                  // 采集时间(CLOCK_MONOTONIC)
+    uint32_t flags;                         // ENC_PACKET_FLAG_*
+    frame_stats_t stats;                    // 源帧的图像统计，stats.valid 为0表示未统计
+    void (*release)(enc_packet_t* pkt);     // 引用归零时调用
+    void* opaque;                           // release 使用的私有数据
+};
+
+/**
+ * @brief 分配一个堆内存包并拷贝数据，引用计数为1；计入堆分配次数
+ * @return 成功返回包指针，失败返回NULL
+ */
+enc_packet_t* enc_packet_alloc_copy(const void* data, size_t length);
+
+/**
+ * @brief 创建定长包池：每个对象是包头加 max_length 字节数据
+ * @param pool 对象池
+ * @param max_length 单个包的最大数据长度
+ * @param count 包数量，不少于消费者队列深度
+ * @param huge 是否尝试大页
+ * @return 成功返回0，失败返回-1
+ */
+int enc_packet_pool_init(mem_pool_t* pool, size_t max_length, uint32_t count, int huge);
+
+/**
+ * @brief 从包池分配并拷贝数据，引用计数为1，最后一次 unref 时归还包池；
+ *        数据超过包池容量或包池已空时退回 enc_packet_alloc_copy
+ * @return 成功返回包指针，失败返回NULL
+ */
+enc_packet_t* enc_packet_alloc_pool(mem_pool_t* pool, const void* data, size_t length);
+
+static inline enc_packet_t* enc_packet_ref(enc_packet_t* pkt) {
+    atomic_fetch_add_explicit(&pkt->refs, 1, memory_order_relaxed);
+    return pkt;
+}
+
+static inline void enc_packet_unref(enc_packet_t* pkt) {
+    if (pkt && atomic_fetch_sub_explicit(&pkt->refs, 1, memory_order_acq_rel) == 1) {
+        pkt->release(pkt);
+    }
+}
+
+#endif
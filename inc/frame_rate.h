@@ -0,0 +1,72 @@
+#ifndef _FRAME_RATE_H
+#define _FRAME_RATE_H
+
+#include <stdint.h>
+
+/*
+ * 输出帧率控制。驱动支持 VIDIOC_S_PARM 时由传感器直接降低帧率；不支持时(或自适应降速时)
+ * 在 DQBUF 之后立即按驱动时间戳抽帧，被抽掉的帧不拷贝、不编码，直接归还驱动。
+ * 配置字符串 "<帧率>[:auto[:<最低帧率>]]"，auto 表示编码或写盘队列积压时自动降低帧率，
+ * 负载回落后逐步恢复到 <帧率>。
+ */
+
+typedef struct {
+    int target_fps;                 // 请求的输出帧率，0 表示不控制
+    int min_fps;                    // 自适应下限
+    int adaptive;
+    int sensor_fps;                 // S_PARM 生效后的驱动帧率，0 表示驱动不支持
+    int fps;                        // 当前输出帧率
+    // 抽帧，时间戳均为驱动时间戳(微秒)
+    uint64_t next_us;               // 下一帧最早的保留时间
+    uint64_t last_ts_us;            // 上一帧(含被抽掉的)时间戳
+    uint64_t period_us;             // 实测驱动帧间隔(滑动平均)
+    // 自适应：按 1 秒窗口取平均负载
+    uint64_t window_start_us;
+    float window_load;              // 窗口内负载之和
+    int window_frames;
+    int calm_windows;               // 连续低负载窗口数
+    uint64_t kept;
+    uint64_t decimated;
+    uint64_t changes;               // 自适应调整次数
+} frame_rate_t;
+
+/**
+ * @brief 解析 "<帧率>[:auto[:<最低帧率>]]"
+ * @return 成功返回0，格式错误返回-1
+ */
+int frame_rate_parse(const char* spec, frame_rate_t* fr);
+
+/**
+ * @brief 开始控制，在 STREAMON 前调用
+ * @param fr 帧率控制
+ * @param sensor_fps camera_set_fps 的返回值，0 表示驱动不支持设置帧间隔
+ */
+void frame_rate_start(frame_rate_t* fr, int sensor_fps);
+
+/**
+ * @brief 判断刚 DQBUF 的一帧是否保留
+ * @param fr 帧率控制
+ * @param ts_us 该帧的驱动时间戳
+ * @return 保留返回1，应直接归还驱动返回0
+ */
+int frame_rate_keep(frame_rate_t* fr, uint64_t ts_us);
+
+/**
+ * @brief 上报一帧处理完成后的负载，自适应模式下按窗口调整帧率
+ * @param fr 帧率控制
+ * @param now_us 当前时间
+ * @param load 0 空闲 ~ 1 饱和：处理耗时占帧间隔的比例与各写队列占用率中的最大值
+ */
+void frame_rate_load(frame_rate_t* fr, uint64_t now_us, float load);
+
+/**
+ * @brief 当前帧间隔(微秒)，未控制时返回实测驱动帧间隔
+ */
+uint64_t frame_rate_interval_us(const frame_rate_t* fr);
+
+/**
+ * @brief 打印保留/抽掉的帧数和自适应调整次数
+ */
+void frame_rate_report(const frame_rate_t* fr);
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef _FRAME_STATS_H
+#define _FRAME_STATS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * 每帧图像统计：亮度直方图、平均亮度(曝光)和清晰度(对焦)。
+ * frame_stats_copy 在把 NV12 拷进编码输入缓冲的同一遍里统计，Y 平面每个字节只从内存读一次；
+ * 按编译目标选用 NEON、SSE2 或标量实现，结果一致。
+ * 平均亮度和清晰度用全部像素；直方图只统计每 FRAME_STATS_HIST_ROWS 行中隔列的像素，
+ * 逐像素查表是整遍里唯一没法向量化的部分，抽样后额外开销可以忽略。
+ */
+
+#define FRAME_STATS_BINS        32      // 直方图格数，每格 8 级灰度
+#define FRAME_STATS_HIST_ROWS   4       // 直方图行抽样间隔
+
+typedef struct {
+    uint32_t hist[FRAME_STATS_BINS];    // 亮度直方图(抽样)
+    uint32_t samples;                   // 直方图样本总数
+    float luma_mean;                    // 平均亮度 0-255
+    float sharpness;                    // 相邻像素(水平与垂直)亮度差绝对值的均值，越大越清晰
+    int valid;                          // 本帧是否做过统计
+} frame_stats_t;
+
+/**
+ * @brief 拷贝一帧连续存放的 NV12(行跨度等于宽度)，同时统计 Y 平面
+ * @param dst 目标缓冲
+ * @param src 源帧
+ * @param width 图像宽度
+ * @param height 图像高度
+ * @param length 拷贝字节数，不足整帧时只统计其中完整的 Y 行
+ * @param st 输出：统计结果
+ */
+void frame_stats_copy(void* dst, const void* src, int width, int height, size_t length, frame_stats_t* st);
+
+/**
+ * @brief 只统计不拷贝(零拷贝导入模式下单独读一遍 Y 平面)
+ */
+void frame_stats_scan(const void* src, int width, int height, frame_stats_t* st);
+
+/**
+ * @brief 直方图中亮度不低于 level 的样本占比，用于判断过曝
+ */
+float frame_stats_fraction_above(const frame_stats_t* st, int level);
+
+/**
+ * @brief 当前编译使用的实现 "neon"、"sse2" 或 "c"
+ */
+const char* frame_stats_impl(void);
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef _FRAME_WRITER_H
+#define _FRAME_WRITER_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include "enc_packet.h"
+#include "rt_sched.h"
+
+/*
+ * 写文件线程：编码线程通过单生产者单消费者无锁队列提交编码包，
+ * 队列满时直接丢弃，编码线程永远不会被存储写入阻塞。
+ */
+
+#define FRAME_WRITER_DEPTH  8   // 必须是2的幂
+
+typedef struct {
+    const char* path;                           // 输出文件
+    enc_packet_t* queue[FRAME_WRITER_DEPTH];
+    _Atomic uint32_t head;                      // 生产者写位置
+    _Atomic uint32_t tail;                      // 消费者读位置
+    sem_t items;
+    pthread_t thread;
+    _Atomic int running;
+    rt_sched_t sched;                           // 写线程的绑核与调度策略
+    _Atomic uint64_t first_write_us;            // 第一次写成功的完成时间，0表示尚未写过
+} frame_writer_t;
+
+/**
+ * @brief 启动写文件线程
+ * @param w 写线程结构体
+ * @param path 输出文件路径，每个包覆盖写入
+ * @param sched 写线程绑核与调度策略，NULL 不设置
+ * @return 成功返回0，失败返回-1
+ */
+int frame_writer_start(frame_writer_t* w, const char* path, const rt_sched_t* sched);
+
+/**
+ * @brief 提交一个编码包，接管调用者的一个引用
+ * @return 成功返回0，队列满返回-1(包已释放)
+ */
+int frame_writer_submit(frame_writer_t* w, enc_packet_t* pkt);
+
+/**
+ * @brief 写完队列中剩余的包后停止线程
+ */
+void frame_writer_stop(frame_writer_t* w);
+
+#endif
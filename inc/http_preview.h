@@ -0,0 +1,41 @@
+#ifndef _HTTP_PREVIEW_H
+#define _HTTP_PREVIEW_H
+
+#include "enc_packet.h"
+
+/*
+ * 内置 MJPEG over HTTP 预览服务：单线程 epoll，multipart/x-mixed-replace。
+ * 服务线程只持有“最新一帧”，每个客户端发完当前帧后直接跳到最新帧，
+ * 慢客户端丢帧而不是排队；每个客户端最多引用一个包，不额外拷贝数据。
+ *
+ *   GET /          连续 MJPEG 流
+ *   GET /snapshot  单张 JPEG
+ */
+
+typedef struct {
+    const char* bind_addr;      // 监听地址，默认 127.0.0.1
+    int port;                   // 监听端口
+    int max_clients;            // 最大客户端数，默认 4
+    int sndbuf_bytes;           // 每个客户端的内核发送缓冲上限，默认 256KB
+    int stall_timeout_ms;       // 客户端一帧发送无进展、或连接后未发完请求头超过该时间则断开，默认 5000
+} http_preview_cfg_t;
+
+/**
+ * @brief 启动预览服务线程
+ * @param cfg 配置，未设置的字段使用默认值
+ * @return 成功返回0，失败返回-1
+ */
+int http_preview_start(const http_preview_cfg_t* cfg);
+
+/**
+ * @brief 发布一个新编码包，服务内部增加引用，调用者仍保留自己的引用
+ *        帧路径上只有一次原子交换和一次 eventfd 写，不加锁
+ */
+void http_preview_publish(enc_packet_t* pkt);
+
+/**
+ * @brief 停止服务，断开所有客户端并释放持有的包
+ */
+void http_preview_stop(void);
+
+#endif
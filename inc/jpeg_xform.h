@@ -0,0 +1,82 @@
+#ifndef _JPEG_XFORM_H
+#define _JPEG_XFORM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "roi.h"
+#include "sw_jpeg.h"
+
+/*
+ * 压缩域 JPEG 变换：对编码器输出的基线 JPEG 做 90/180/270 度旋转、水平/垂直翻转和按 MCU 对齐的裁剪。
+ * 只做 Huffman 解码取出量化后的 DCT 系数，在系数上完成变换后重新熵编码，
+ * 不做 IDCT/DCT 和重新量化，画质与原图完全相同，耗时远低于解码、旋转像素再编码。
+ *  - 解码时块直接写到变换后的位置，块内系数转置并按频率乘以 ±1；旋转 90/270 度时量化表同样转置
+ *  - 右/下边缘不满一个 MCU 的部分含编码器的填充，翻转后会落到左/上边缘，与 jpegtran -trim 一样裁掉
+ *  - 裁剪先于旋转，坐标为原图坐标，起点向下对齐到 MCU(16 像素)；裁剪区域以下的 MCU 行不解码
+ *  - 只支持 3 分量 4:2:0 基线(本项目各编码器的输出)，可带复位间隔；
+ *    输出使用标准 Huffman 表，不带复位间隔，不保留原图的 APPn/COM 段
+ * 一个实例只能被一个线程使用，缓冲按最大图像分配后复用。
+ */
+
+typedef enum {
+    JPEG_XFORM_NONE = 0,            // 只裁剪
+    JPEG_XFORM_HFLIP,
+    JPEG_XFORM_VFLIP,
+    JPEG_XFORM_ROT90,               // 顺时针
+    JPEG_XFORM_ROT180,
+    JPEG_XFORM_ROT270,
+} jpeg_xform_op_t;
+
+typedef struct {
+    jpeg_xform_op_t op;
+    int crop_enabled;
+    roi_rect_t crop;                // 原图坐标
+} jpeg_xform_cfg_t;
+
+typedef struct {
+    jpeg_xform_cfg_t cfg;
+    int width;                      // 最近一次输出的图像尺寸
+    int height;
+    sw_jpeg_t enc;                  // 输出的尺寸和量化表
+    int16_t* coef;                  // 变换后的系数，只含裁剪区域内的 MCU
+    size_t coef_size;
+    uint8_t* out;
+    size_t out_capacity;
+    uint8_t* nv12;                  // jpeg_xform_decode 的输出
+    size_t nv12_size;
+} jpeg_xform_t;
+
+/**
+ * @brief 解析 "rot90|rot180|rot270|hflip|vflip|none[:x,y,宽,高]"
+ * @return 成功返回0，格式错误返回-1
+ */
+int jpeg_xform_parse(const char* spec, jpeg_xform_cfg_t* cfg);
+
+const char* jpeg_xform_op_name(jpeg_xform_op_t op);
+
+/**
+ * @brief 初始化变换，缓冲在第一次使用时分配
+ */
+void jpeg_xform_init(jpeg_xform_t* x, const jpeg_xform_cfg_t* cfg);
+
+/**
+ * @brief 变换一张 JPEG
+ * @param jpeg 输入
+ * @param length 输入字节数
+ * @param out_length 输出：变换后字节数
+ * @return 成功返回变换后的 JPEG(下一次调用前有效)，x->width/height 为输出尺寸；
+ *         格式不支持、数据损坏或裁剪区域为空时返回NULL
+ */
+const uint8_t* jpeg_xform_apply(jpeg_xform_t* x, const uint8_t* jpeg, size_t length, size_t* out_length);
+
+/**
+ * @brief 完整解码为 NV12(行跨度等于宽度)，用作比较基线和核对变换结果；忽略变换配置
+ * @param width 输出：图像宽度
+ * @param height 输出：图像高度
+ * @return 成功返回 NV12(下一次调用前有效)，格式不支持、数据损坏或宽高为奇数时返回NULL
+ */
+const uint8_t* jpeg_xform_decode(jpeg_xform_t* x, const uint8_t* jpeg, size_t length, int* width, int* height);
+
+void jpeg_xform_deinit(jpeg_xform_t* x);
+
+#endif
@@ -0,0 +1,144 @@
+#ifndef _MEM_ARENA_H
+#define _MEM_ARENA_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+/*
+ * 帧路径上的内存分配，稳定运行后不再调用 malloc/free：
+ *  - mem_map：大块软件缓冲(软件编码输出、录像桩编码输出等)，可选 2MB 大页，
+ *    先试 MAP_HUGETLB(需预留 /proc/sys/vm/nr_hugepages)，失败退回透明大页(MADV_HUGEPAGE)，再退回普通页
+ *  - mem_arena：线性分配区，放一帧之内的临时数据，帧结束时整体复位；目前只有 mipi_bench 的分配测试使用
+ *  - mem_pool：定长对象池(帧描述、包头)，带标签的无锁栈，可在一个线程取、另一个线程还
+ * 区域或池不够时退回堆分配，并计入 mipi_heap_allocs_total；稳定运行时该计数器应不再增长。
+ */
+
+#define MEM_ALIGN           64              // 区域内分配按 cache 行对齐
+#define MEM_HUGE_PAGE_SIZE  (2u << 20)
+
+typedef enum {
+    MEM_BACKING_NORMAL = 0,
+    MEM_BACKING_THP,                        // 透明大页(内核按需合并)
+    MEM_BACKING_HUGETLB,                    // 预留大页
+} mem_backing_t;
+
+typedef struct mem_overflow mem_overflow_t;
+
+typedef struct {
+    uint8_t* base;
+    size_t size;
+    size_t used;
+    size_t hwm;                             // 单帧用量高水位
+    int huge;                               // 映射时是否请求大页
+    mem_backing_t backing;
+    mem_overflow_t* overflow;               // 区域用尽后退回堆分配的块，复位时释放
+    size_t overflow_bytes;
+    uint64_t resets;
+} mem_arena_t;
+
+typedef struct {
+    uint8_t* base;
+    size_t map_size;
+    size_t obj_size;                        // 按 MEM_ALIGN 取整后的对象大小
+    uint32_t count;
+    int huge;
+    mem_backing_t backing;
+    _Atomic uint32_t* next;                 // 空闲链表(索引+1，0表示结束)
+    _Atomic uint64_t free_head;             // mem_stack 栈顶
+    _Atomic int in_use;
+    _Atomic int in_use_hwm;
+} mem_pool_t;
+
+/**
+ * @brief 设置 mem_map_default 是否使用大页，启动时在任何映射之前按命令行设置一次
+ */
+void mem_set_huge(int huge);
+
+/**
+ * @brief 映射一块匿名内存，huge 为1时尝试大页；大小按页(大页时按 2MB)取整
+ * @param backing 输出：实际使用的页类型，可为NULL
+ * @return 成功返回地址，失败返回NULL
+ */
+void* mem_map(size_t size, int huge, mem_backing_t* backing);
+
+/**
+ * @brief 按 mem_set_huge 的设置映射
+ */
+void* mem_map_default(size_t size);
+
+/**
+ * @brief 释放 mem_map 的内存，size 和 huge 与映射时相同
+ */
+void mem_unmap(void* ptr, size_t size, int huge);
+
+/**
+ * @brief 释放 mem_map_default 的内存
+ */
+void mem_unmap_default(void* ptr, size_t size);
+
+const char* mem_backing_name(mem_backing_t backing);
+
+/**
+ * @brief 创建线性分配区
+ * @param size 区域大小，一帧内所有临时分配之和的上限
+ * @param huge 是否尝试大页
+ * @return 成功返回0，失败返回-1
+ */
+int mem_arena_init(mem_arena_t* a, size_t size, int huge);
+
+/**
+ * @brief 从区域分配，按 MEM_ALIGN 对齐；区域用尽时退回堆分配并计数
+ * @return 成功返回地址，失败返回NULL
+ */
+void* mem_arena_alloc(mem_arena_t* a, size_t size);
+
+/**
+ * @brief 帧结束：释放本帧的全部分配
+ */
+void mem_arena_reset(mem_arena_t* a);
+
+void mem_arena_destroy(mem_arena_t* a);
+
+/**
+ * @brief 带标签的无锁索引栈：head 高32位标签(防 ABA)，低32位栈顶索引+1(0为空)；
+ *        每个元素的链接字段为 _Atomic uint32_t，第 i 个位于 links + i * stride 字节处
+ */
+void mem_stack_push(_Atomic uint64_t* head, void* links, size_t stride, uint32_t idx);
+
+/**
+ * @brief 弹出栈顶索引，可与 mem_stack_push 在不同线程并发调用
+ * @return 成功返回索引，栈空返回-1
+ */
+int mem_stack_pop(_Atomic uint64_t* head, void* links, size_t stride);
+
+/**
+ * @brief 创建定长对象池，对象一次性分配好
+ * @param obj_size 对象大小
+ * @param count 对象数量
+ * @param huge 是否尝试大页
+ * @return 成功返回0，失败返回-1
+ */
+int mem_pool_init(mem_pool_t* p, size_t obj_size, uint32_t count, int huge);
+
+/**
+ * @brief 取一个对象，可与 mem_pool_put 在不同线程并发调用
+ * @return 成功返回对象，池空返回NULL
+ */
+void* mem_pool_get(mem_pool_t* p);
+
+/**
+ * @brief 归还 mem_pool_get 取得的对象
+ */
+void mem_pool_put(mem_pool_t* p, void* obj);
+
+/**
+ * @brief 对象是否属于该池
+ */
+static inline int mem_pool_owns(const mem_pool_t* p, const void* obj) {
+    return (const uint8_t*)obj >= p->base && (const uint8_t*)obj < p->base + (size_t)p->obj_size * p->count;
+}
+
+void mem_pool_destroy(mem_pool_t* p);
+
+#endif
@@ -0,0 +1,216 @@
+#ifndef _METRICS_H
+#define _METRICS_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <sys/resource.h>
+
+/*
+ * 运行时指标：帧路径上只做 relaxed 原子加/存，不加锁；
+ * 导出线程周期性读取并以 Prometheus 文本格式输出到 tmpfs 文件或 UNIX 套接字。
+ */
+
+// 单调递增计数器
+typedef enum {
+    METRIC_FRAMES_CAPTURED = 0,     // DQBUF 成功的帧数
+    METRIC_FRAMES_ENCODED,          // 编码成功的帧数
+    METRIC_BYTES_WRITTEN,           // 写入存储的字节数
+    METRIC_FRAMES_DECIMATED,        // 按帧率控制在 DQBUF 后直接归还的帧数
+    METRIC_CAPTURE_RECOVERIES,      // 采集停顿后原地重启采集流的次数
+    METRIC_ENCODER_RESETS,          // 编码超时后复位编码器的次数
+    METRIC_HEAP_ALLOCS,             // 帧路径上退回堆分配的次数，稳定运行时应不再增长
+    METRIC_ARENA_ALLOCS,            // 从每线程分配区分配的次数
+    METRIC_POOL_ALLOCS,             // 从定长对象池取对象的次数
+    METRIC_STREAM_CHUNKS,           // 低延迟输出发送的块数(每个客户端分别计)
+    METRIC_STREAM_BYTES,            // 低延迟输出发送的字节数
+    METRIC_COUNTER_MAX
+} metrics_counter_t;
+
+// 瞬时值
+typedef enum {
+    METRIC_V4L2_QUEUED = 0,         // 当前在驱动队列中的缓冲区数量
+    METRIC_MPP_GROUP_USED_BYTES,    // MPP 缓冲组已使用字节数
+    METRIC_MPP_GROUP_UNUSED,        // MPP 缓冲组空闲缓冲区数量
+    METRIC_PACKET_POOL_BYTES,       // 包缓冲池已分配字节数
+    METRIC_PACKET_POOL_BYTES_HWM,   // 包缓冲池借出字节数高水位
+    METRIC_OUTPUT_FPS,              // 帧率控制的当前输出帧率，0 表示不控制
+    METRIC_FRAME_LUMA_MEAN,         // 最近一帧的平均亮度 0-255
+    METRIC_FRAME_LUMA_CLIPPED,      // 最近一帧亮度达到 FRAME_STATS 最高格(>=248)的像素千分比
+    METRIC_FRAME_SHARPNESS,         // 最近一帧的清晰度(相邻像素平均亮度差)x100
+    METRIC_ARENA_BYTES_HWM,         // 每线程分配区单帧用量高水位
+    METRIC_STREAM_CLIENTS,          // 低延迟输出当前连接的客户端数
+    METRIC_GAUGE_MAX
+} metrics_gauge_t;
+
+// 丢帧原因
+typedef enum {
+    METRIC_DROP_CAPTURE_TIMEOUT = 0,
+    METRIC_DROP_DQBUF_ERROR,
+    METRIC_DROP_ENCODE_ERROR,
+    METRIC_DROP_WRITE_ERROR,
+    METRIC_DROP_POOL_EXHAUSTED,     // 包缓冲池耗尽
+    METRIC_DROP_WRITER_FULL,        // 写文件队列已满
+    METRIC_DROP_DRIVER_SEQ_GAP,     // 驱动帧序号跳变(驱动无空闲缓冲而丢帧)
+    METRIC_DROP_RECORD_FULL,        // 原始录制队列已满或预分配空间用尽
+    METRIC_DROP_STALL,              // 采集停顿期间传感器应输出的帧数(按驱动帧间隔估算)
+    METRIC_DROP_STREAM_SLOW,        // 低延迟输出的客户端跟不上而跳过的帧(每个客户端分别计)
+    METRIC_DROP_SHM_OVERSIZE,       // 超过共享内存环槽位大小而没有发布的帧
+    METRIC_DROP_MAX
+} metrics_drop_t;
+
+// 各阶段耗时
+typedef enum {
+    METRIC_STAGE_CAPTURE = 0,       // select + DQBUF
+    METRIC_STAGE_COPY,              // 拷贝到 MPP 缓冲区（含 cache 同步）
+    METRIC_STAGE_ENCODE,            // encode_put_frame + encode_get_packet
+    METRIC_STAGE_WRITE,             // 写文件
+    METRIC_STAGE_VIDEO_ENCODE,      // H.264/H.265 编码
+    METRIC_STAGE_RECOVERY,          // 停顿恢复：采集为检测到停顿至重启后第一帧，编码为复位耗时
+    METRIC_STAGE_STREAM_FIRST,      // 采集完成到低延迟输出发出本帧第一块
+    METRIC_STAGE_STREAM_LAST,       // 采集完成到低延迟输出发出本帧最后一块
+    METRIC_STAGE_XFORM,             // JPEG 压缩域旋转/裁剪
+    METRIC_STAGE_MAX
+} metrics_stage_t;
+
+// 对数直方图：每个 2 的幂区间再细分 4 段，覆盖 1us ~ 2^24us
+#define METRICS_HIST_SUB_BITS   2
+#define METRICS_HIST_BUCKETS    (25 << METRICS_HIST_SUB_BITS)
+#define METRICS_MAX_QUEUE_DEPTH 32
+
+typedef struct {
+    _Atomic uint64_t buckets[METRICS_HIST_BUCKETS];
+    _Atomic uint64_t count;
+    _Atomic uint64_t sum_us;
+} metrics_hist_t;
+
+// 各阶段的非自愿上下文切换与缺页次数，getrusage(RUSAGE_THREAD) 前后差值累加
+typedef struct {
+    _Atomic uint64_t nivcsw;
+    _Atomic uint64_t minflt;
+    _Atomic uint64_t majflt;
+} metrics_rusage_t;
+
+// 线程上一次采样的 rusage，只由所属线程读写
+typedef struct {
+    long nivcsw;
+    long minflt;
+    long majflt;
+} metrics_rusage_mark_t;
+
+typedef struct {
+    _Atomic uint64_t counters[METRIC_COUNTER_MAX];
+    _Atomic int64_t  gauges[METRIC_GAUGE_MAX];
+    _Atomic uint64_t drops[METRIC_DROP_MAX];
+    metrics_hist_t   stages[METRIC_STAGE_MAX];
+    metrics_rusage_t rusage[METRIC_STAGE_MAX];
+    _Atomic uint64_t queue_depth[METRICS_MAX_QUEUE_DEPTH + 1];  // DQBUF 后驱动剩余缓冲数分布
+} metrics_t;
+
+extern metrics_t g_metrics;
+
+/**
+ * @brief 获取单调时钟微秒数，用于阶段计时
+ */
+static inline uint64_t metrics_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ull + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static inline void metrics_count(metrics_counter_t id, uint64_t n) {
+    atomic_fetch_add_explicit(&g_metrics.counters[id], n, memory_order_relaxed);
+}
+
+static inline void metrics_gauge_set(metrics_gauge_t id, int64_t v) {
+    atomic_store_explicit(&g_metrics.gauges[id], v, memory_order_relaxed);
+}
+
+static inline void metrics_gauge_add(metrics_gauge_t id, int64_t delta) {
+    atomic_fetch_add_explicit(&g_metrics.gauges[id], delta, memory_order_relaxed);
+}
+
+static inline void metrics_drop(metrics_drop_t cause) {
+    atomic_fetch_add_explicit(&g_metrics.drops[cause], 1, memory_order_relaxed);
+}
+
+static inline void metrics_drop_n(metrics_drop_t cause, uint64_t n) {
+    atomic_fetch_add_explicit(&g_metrics.drops[cause], n, memory_order_relaxed);
+}
+
+static inline void metrics_queue_depth(unsigned int depth) {
+    if (depth > METRICS_MAX_QUEUE_DEPTH) {
+        depth = METRICS_MAX_QUEUE_DEPTH;
+    }
+    atomic_fetch_add_explicit(&g_metrics.queue_depth[depth], 1, memory_order_relaxed);
+}
+
+/**
+ * @brief 计算耗时所在的直方图桶
+ */
+static inline int metrics_hist_bucket(uint64_t us) {
+    if (us < 1) {
+        return 0;
+    }
+    int msb = 63 - __builtin_clzll(us);
+    int sub = msb >= METRICS_HIST_SUB_BITS
+            ? (int)((us >> (msb - METRICS_HIST_SUB_BITS)) & ((1 << METRICS_HIST_SUB_BITS) - 1))
+            : (int)((us << (METRICS_HIST_SUB_BITS - msb)) & ((1 << METRICS_HIST_SUB_BITS) - 1));
+    int idx = (msb << METRICS_HIST_SUB_BITS) + sub;
+    return idx < METRICS_HIST_BUCKETS ? idx : METRICS_HIST_BUCKETS - 1;
+}
+
+static inline void metrics_observe_us(metrics_stage_t stage, uint64_t us) {
+    metrics_hist_t* h = &g_metrics.stages[stage];
+    atomic_fetch_add_explicit(&h->buckets[metrics_hist_bucket(us)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->sum_us, us, memory_order_relaxed);
+}
+
+/**
+ * @brief 记录调用线程当前的 rusage，作为下一阶段的起点(调用方需定义 _GNU_SOURCE)
+ */
+static inline void metrics_rusage_mark(metrics_rusage_mark_t* mark) {
+    struct rusage ru;
+    getrusage(RUSAGE_THREAD, &ru);
+    mark->nivcsw = ru.ru_nivcsw;
+    mark->minflt = ru.ru_minflt;
+    mark->majflt = ru.ru_majflt;
+}
+
+/**
+ * @brief 把自 mark 以来的上下文切换和缺页计入 stage，并把 mark 推进到当前
+ */
+static inline void metrics_rusage_stage(metrics_stage_t stage, metrics_rusage_mark_t* mark) {
+    metrics_rusage_mark_t now;
+    metrics_rusage_mark(&now);
+    metrics_rusage_t* r = &g_metrics.rusage[stage];
+    atomic_fetch_add_explicit(&r->nivcsw, (uint64_t)(now.nivcsw - mark->nivcsw), memory_order_relaxed);
+    atomic_fetch_add_explicit(&r->minflt, (uint64_t)(now.minflt - mark->minflt), memory_order_relaxed);
+    atomic_fetch_add_explicit(&r->majflt, (uint64_t)(now.majflt - mark->majflt), memory_order_relaxed);
+    *mark = now;
+}
+
+/**
+ * @brief 将当前指标渲染为 Prometheus 文本格式
+ * @param buf 输出缓冲区
+ * @param size 缓冲区大小
+ * @return 写入的字节数（不含结尾0），缓冲区不足时截断
+ */
+size_t metrics_render(char* buf, size_t size);
+
+/**
+ * @brief 启动指标导出线程
+ * @param file_path 周期性重写的文本文件路径（建议位于 tmpfs），NULL 表示不写文件
+ * @param socket_path UNIX 套接字路径，NULL 表示不监听
+ * @param interval_ms 刷新周期(毫秒)，同时作为 fps 的统计窗口
+ * @return 成功返回0，失败返回-1
+ */
+int metrics_start(const char* file_path, const char* socket_path, int interval_ms);
+
+/**
+ * @brief 停止导出线程并清理套接字文件
+ */
+void metrics_stop(void);
+
+#endif
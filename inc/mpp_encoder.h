@@ -0,0 +1,125 @@
+#ifndef _MPP_ENCODER_H
+#define _MPP_ENCODER_H
+
+#include <rockchip/rk_mpi.h>
+#include <rockchip/mpp_buffer.h>
+#include "packet_pool.h"
+#include "mpp_heap.h"
+#include "camera_init.h"
+#include "roi.h"
+#include "frame_stats.h"
+
+// MPP 编码输出距离缓冲末尾不足该余量时视为溢出
+#define MPP_ENCODER_OVERFLOW_MARGIN  4096
+// encode_get_packet 的等待上限，超时视为编码停顿并复位编码器
+#define MPP_ENCODER_OUTPUT_TIMEOUT_MS 1000
+
+// MPP JPEG 编码器
+typedef struct {
+    MppCtx ctx;                     // MPP上下文
+    MppApi* mpi;                    // MPP接口
+    MppEncCfg cfg;                  // 编码配置
+    MppBufferGroup group;           // 输入帧缓冲组
+    MppBuffer frame_buf;            // 输入帧缓冲
+    MppBuffer input;                // 下一次编码使用的输入缓冲(frame_buf 或导入缓冲)
+    MppBufferGroup import_group;    // 摄像头导入缓冲组
+    MppBuffer* import_bufs;         // 摄像头直接写入的缓冲，按 V4L2 index 排列
+    unsigned int n_import;
+    void* frame_ptr;                // 输入帧缓冲CPU地址
+    size_t frame_size;
+    int width;                      // 编码尺寸，设置裁剪后为区域大小
+    int height;
+    int hor_stride;                 // 输入缓冲的整帧尺寸
+    int ver_stride;
+    int crop_x;                     // 编码区域在输入缓冲中的偏移
+    int crop_y;
+    int quality;
+    mpp_heap_t heap;                // 输入帧缓冲的分配方式
+} mpp_encoder_t;
+
+/**
+ * @brief 创建并配置 MPP JPEG 编码器，分配输入帧缓冲
+ * @param enc 编码器结构体指针
+ * @param width 图像宽度
+ * @param height 图像高度
+ * @param quality JPEG质量(1-99)
+ * @param heap 输入帧缓冲类型与cache策略，NULL 使用 MPP_HEAP_DEFAULT
+ * @return 成功返回0，失败返回-1
+ */
+int mpp_encoder_init(mpp_encoder_t* enc, int width, int height, int quality, const mpp_heap_t* heap);
+
+/**
+ * @brief 将一帧数据拷贝进输入帧缓冲，只同步实际写入的字节范围
+ */
+void mpp_encoder_load_frame(mpp_encoder_t* enc, const void* src, size_t length);
+
+/**
+ * @brief 同 mpp_encoder_load_frame，拷贝的同一遍里统计 Y 平面(按当前输入帧尺寸)
+ * @param stats 输出：图像统计
+ */
+void mpp_encoder_load_frame_stats(mpp_encoder_t* enc, const void* src, size_t length, frame_stats_t* stats);
+
+/**
+ * @brief 分配供摄像头直接写入的缓冲(与输入帧缓冲同类型)，用于 camera_init_import
+ * @param enc 编码器
+ * @param count 缓冲数量
+ * @param length 每个缓冲的长度，不小于驱动的 sizeimage
+ * @param out 输出：各缓冲的 dmabuf fd、CPU 地址和长度
+ * @return 成功返回0，失败返回-1
+ */
+int mpp_encoder_alloc_import(mpp_encoder_t* enc, unsigned int count, size_t length, camera_import_buf_t* out);
+
+/**
+ * @brief 下一次编码直接使用第 index 个导入缓冲，无需拷贝
+ * @return 成功返回0，index 无效返回-1
+ */
+int mpp_encoder_use_import(mpp_encoder_t* enc, unsigned int index);
+
+/**
+ * @brief 只编码输入缓冲中的一个区域：由 MPP 预处理按偏移和跨度读取，不拷贝
+ * @param enc 编码器
+ * @param roi 区域(整帧坐标)，NULL 恢复整帧
+ * @return 成功返回0，区域无效或配置失败返回-1
+ */
+int mpp_encoder_set_crop(mpp_encoder_t* enc, const roi_rect_t* roi);
+
+/**
+ * @brief 运行中修改 JPEG 质量，在两帧之间通过 MPP_ENC_SET_CFG 生效
+ * @return 成功返回0，失败返回-1(保持原质量)
+ */
+int mpp_encoder_set_quality(mpp_encoder_t* enc, int quality);
+
+/**
+ * @brief 运行中修改输入帧尺寸(随摄像头分辨率切换)，沿用已分配的输入帧缓冲，裁剪恢复为整帧
+ * @return 成功返回0，新尺寸超出输入帧缓冲或配置失败返回-1
+ */
+int mpp_encoder_set_size(mpp_encoder_t* enc, int width, int height);
+
+/**
+ * @brief 将当前输入缓冲编码到指定输出缓冲
+ * @param enc 编码器
+ * @param output 输出缓冲
+ * @param eos 是否最后一帧
+ * @param length 输出：编码后字节数
+ * @return MPP_OK 成功，其它为 MPP 错误码
+ */
+MPP_RET mpp_encoder_encode(mpp_encoder_t* enc, MppBuffer output, int eos, size_t* length);
+
+/**
+ * @brief 从包缓冲池借出输出缓冲并编码，溢出时换更大的缓冲重编
+ * @return 成功返回编码包(引用计数1)，失败返回NULL
+ */
+enc_packet_t* mpp_encoder_encode_packet(mpp_encoder_t* enc, packet_pool_t* pool, int eos);
+
+/**
+ * @brief 编码停顿后复位编码器并重新下发当前配置，保留 MPP 会话、输入缓冲和缓冲组
+ * @return 成功返回0，失败返回-1
+ */
+int mpp_encoder_reset(mpp_encoder_t* enc);
+
+/**
+ * @brief 释放编码器、输入帧缓冲及导入缓冲，导入缓冲须在 camera_close 之后释放
+ */
+void mpp_encoder_deinit(mpp_encoder_t* enc);
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef _MPP_HEAP_H
+#define _MPP_HEAP_H
+
+#include <stddef.h>
+#include <rockchip/mpp_buffer.h>
+
+/*
+ * 编码器输入缓冲的分配方式与 cache 策略。
+ * 字符串格式 "<类型>[:cached|:uncached]"，类型为 ion/drm/dma_heap/normal，
+ * 例如 "drm:cached"。未指定 cache 策略时不加 CACHABLE 标志(与原先行为一致)。
+ */
+
+typedef struct {
+    MppBufferType type;
+    int cached;                     // 1 申请可缓存内存
+} mpp_heap_t;
+
+#define MPP_HEAP_DEFAULT { MPP_BUFFER_TYPE_ION, 0 }
+
+/**
+ * @brief 解析缓冲类型字符串
+ * @return 成功返回0，无法识别返回-1
+ */
+int mpp_heap_parse(const char* spec, mpp_heap_t* heap);
+
+/**
+ * @brief 组合出 mpp_buffer_group_get_internal 所需的类型参数
+ */
+unsigned int mpp_heap_group_type(const mpp_heap_t* heap);
+
+/**
+ * @brief 形如 "drm:cached" 的可读名称
+ */
+const char* mpp_heap_name(const mpp_heap_t* heap, char* buf, size_t size);
+
+/**
+ * @brief 只同步 [offset, offset+length) 范围，CPU 写入前/后调用
+ */
+void mpp_heap_sync_begin(MppBuffer buf, size_t offset, size_t length);
+void mpp_heap_sync_end(MppBuffer buf, size_t offset, size_t length);
+
+/**
+ * @brief 只读同步：CPU 读取设备(摄像头 DMA)写入的数据前/后调用，不回写 cache
+ */
+void mpp_heap_sync_read_begin(MppBuffer buf, size_t offset, size_t length);
+void mpp_heap_sync_read_end(MppBuffer buf, size_t offset, size_t length);
+
+/**
+ * @brief 对所有类型与 cache 组合测量 CPU 写带宽和编码耗时并打印
+ * @param width 图像宽度
+ * @param height 图像高度
+ * @param quality JPEG质量
+ * @param iterations 每种组合的迭代次数
+ * @return 0
+ */
+int mpp_heap_bench(int width, int height, int quality, int iterations);
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef _PACKET_POOL_H
+#define _PACKET_POOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <rockchip/mpp_buffer.h>
+#include "enc_packet.h"
+
+/*
+ * 编码输出包缓冲池。
+ * 按大小分级(基准, 2x, 4x, 整帧)，根据最近观测到的包大小选择级别；
+ * 各级空闲链表为带标签的无锁栈，编码线程取、写文件/预览线程还，互不加锁。
+ * 某级没有空闲时按需向 MPP 申请新缓冲(只在编码线程发生)，
+ * 编码溢出时抬高预期大小并换更大的级别重编。
+ */
+
+#define PACKET_POOL_CLASSES     4
+#define PACKET_POOL_MAX_ENTRIES 64
+#define PACKET_POOL_WINDOW      64      // 估算预期大小的观测窗口(包数)
+
+typedef struct packet_pool packet_pool_t;
+
+typedef struct {
+    enc_packet_t pkt;               // 对外暴露的引用计数包，必须是第一个成员
+    MppBuffer buf;
+    packet_pool_t* pool;
+    int cls;
+    _Atomic uint32_t next;          // 空闲链表下一项(索引+1，0表示结束)
+} packet_pool_entry_t;
+
+typedef struct {
+    size_t size;                            // 该级缓冲大小
+    _Atomic uint64_t free_head;             // mem_stack 栈顶，链接字段为 packet_pool_entry_t.next
+    _Atomic int allocated;                  // 已向 MPP 申请的缓冲数量
+    _Atomic int in_use;                     // 当前借出数量
+    _Atomic int in_use_hwm;                 // 借出数量高水位
+    _Atomic uint64_t acquires;              // 借出次数
+} packet_pool_class_t;
+
+struct packet_pool {
+    MppBufferGroup group;
+    packet_pool_class_t classes[PACKET_POOL_CLASSES];
+    packet_pool_entry_t entries[PACKET_POOL_MAX_ENTRIES];
+    _Atomic int n_entries;
+    _Atomic uint64_t bytes_allocated;
+    uint64_t bytes_hwm;                     // 借出字节数高水位
+    _Atomic uint64_t bytes_in_use;
+    // 以下只在编码线程读写
+    size_t window[PACKET_POOL_WINDOW];
+    int window_pos;
+    size_t expected;                        // 预期包大小(窗口最大值 * 1.25)
+    size_t observed_max;
+    uint64_t overflows;
+    int spare[PACKET_POOL_MAX_ENTRIES];     // 扩容失败后归还的描述符，下次扩容优先复用
+    int n_spare;
+};
+
+/**
+ * @brief 初始化包缓冲池
+ * @param pool 缓冲池
+ * @param type MPP 缓冲类型(MPP_BUFFER_TYPE_ION 等)
+ * @param base_size 最小级别的缓冲大小，建议为预估包大小
+ * @param max_size 最大级别的缓冲大小(整帧)
+ * @return 成功返回0，失败返回-1
+ */
+int packet_pool_init(packet_pool_t* pool, MppBufferType type, size_t base_size, size_t max_size);
+
+/**
+ * @brief 按当前预期大小借出一个包，引用计数为1，最后一次 unref 时自动归还
+ * @return 成功返回包，缓冲耗尽返回NULL
+ */
+enc_packet_t* packet_pool_acquire(packet_pool_t* pool);
+
+/**
+ * @brief 获取包对应的 MPP 缓冲，供编码器输出
+ */
+static inline MppBuffer packet_pool_buffer(enc_packet_t* pkt) {
+    return ((packet_pool_entry_t*)pkt)->buf;
+}
+
+static inline size_t packet_pool_capacity(enc_packet_t* pkt) {
+    packet_pool_entry_t* e = (packet_pool_entry_t*)pkt;
+    return e->pool->classes[e->cls].size;
+}
+
+/**
+ * @brief 记录一次编码完成的包大小，用于调整后续借出的级别
+ */
+void packet_pool_observe(packet_pool_t* pool, size_t length);
+
+/**
+ * @brief 记录一次输出溢出，预期大小提升到下一级
+ */
+void packet_pool_overflow(packet_pool_t* pool, enc_packet_t* pkt);
+
+/**
+ * @brief 打印各级高水位，用于确定每路摄像头所需的 ION/CMA 内存
+ */
+void packet_pool_report(const packet_pool_t* pool);
+
+/**
+ * @brief 释放所有缓冲，调用前所有包必须已归还
+ */
+void packet_pool_deinit(packet_pool_t* pool);
+
+#endif
@@ -0,0 +1,137 @@
+#ifndef _RAW_RECORD_H
+#define _RAW_RECORD_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+/*
+ * 原始帧录制：<base>.nv12 为预分配的数据文件，每帧占一个 4K 对齐的槽位；
+ * <base>.idx 为索引，文件头之后每帧一条 {序号, 时间戳, 偏移, 长度}，每帧写出后立即 pwrite，
+ * 程序异常退出时已落盘的帧仍可按索引读取。
+ * 写线程直接从 DQBUF 得到的缓冲区(页对齐)以 O_DIRECT 写入，写完后把缓冲区索引
+ * 交还采集线程 QBUF，全程没有拷贝；文件系统不支持 O_DIRECT 时退回普通写 + 回写/丢弃页缓存。
+ */
+
+#define RAW_RECORD_MAGIC    "MIPIRAW1"
+#define RAW_RECORD_ALIGN    4096
+#define RAW_RECORD_DEPTH    16      // 必须是2的幂
+
+typedef struct {
+    char magic[8];
+    uint32_t width;
+    uint32_t height;
+    uint32_t pixelformat;
+    uint32_t frame_size;            // 每帧有效字节数
+    uint32_t slot_size;             // 数据文件中每帧占用的字节数(4K对齐)
+    uint32_t reserved;
+} raw_record_header_t;
+
+typedef struct {
+    uint64_t seq;                   // 驱动帧序号
+    uint64_t timestamp_us;          // 采集时间(单调时钟)
+    uint64_t offset;                // 在数据文件中的偏移
+    uint32_t length;
+    uint32_t flags;
+} raw_record_entry_t;
+
+typedef struct {
+    const void* data;
+    unsigned int index;             // V4L2 缓冲区索引
+    uint64_t seq;
+    uint64_t timestamp_us;
+    uint64_t trace_frame;           // 提交线程的跟踪帧号
+} raw_record_item_t;
+
+typedef struct {
+    int fd;
+    int direct;                     // 是否以 O_DIRECT 打开
+    int idx_fd;                     // 索引文件，每帧一条 pwrite
+    size_t frame_size;
+    size_t slot_size;
+    uint64_t max_frames;
+    uint64_t n_written;
+    unsigned int max_inflight;
+    uint8_t* bounce;                // 缓冲区长度不足一个槽位时的对齐中转
+    size_t src_length;              // 采集缓冲区可读长度
+    // 采集线程 -> 写线程
+    raw_record_item_t queue[RAW_RECORD_DEPTH];
+    _Atomic uint32_t head;
+    _Atomic uint32_t tail;
+    // 写线程 -> 采集线程：已写完、可以 QBUF 的缓冲区索引
+    unsigned int done[RAW_RECORD_DEPTH];
+    _Atomic uint32_t done_head;
+    _Atomic uint32_t done_tail;
+    sem_t items;
+    pthread_t thread;
+    _Atomic int running;
+    uint64_t write_us_max;
+    uint64_t write_us_sum;
+    uint64_t dropped;
+} raw_record_t;
+
+/**
+ * @brief 创建录制文件并预分配空间，启动写线程
+ * @param r 录制器
+ * @param base 文件名前缀，生成 <base>.nv12 与 <base>.idx
+ * @param width 图像宽度
+ * @param height 图像高度
+ * @param pixelformat V4L2 像素格式
+ * @param frame_size 每帧字节数
+ * @param src_length 采集缓冲区可读长度(不小于槽位时可直接 O_DIRECT 写出)
+ * @param max_frames 预分配的帧数，写满后不再接收
+ * @param max_inflight 同时在写线程手里的缓冲区上限，应小于采集缓冲区数量
+ * @return 成功返回0，失败返回-1
+ */
+int raw_record_open(raw_record_t* r, const char* base, int width, int height, uint32_t pixelformat,
+                    size_t frame_size, size_t src_length, uint64_t max_frames, unsigned int max_inflight);
+
+/**
+ * @brief 提交一个采集缓冲区，写完之前调用者不能 QBUF
+ * @return 接收返回0；队列满或空间用尽返回-1，调用者应立即归还缓冲区
+ */
+int raw_record_submit(raw_record_t* r, unsigned int index, const void* data, uint64_t seq, uint64_t timestamp_us);
+
+/**
+ * @brief 取回一个已写完的缓冲区索引
+ * @return 取到返回1，没有返回0
+ */
+int raw_record_reap(raw_record_t* r, unsigned int* index);
+
+/**
+ * @brief 写完剩余帧，截断预分配的多余空间并关闭文件；之后仍需 reap 剩余索引
+ */
+void raw_record_close(raw_record_t* r);
+
+// mmap 只读回放
+typedef struct {
+    raw_record_header_t header;
+    const raw_record_entry_t* entries;
+    uint64_t count;
+    const uint8_t* data;
+    size_t data_size;
+    void* idx_map;
+    size_t idx_size;
+} raw_reader_t;
+
+/**
+ * @brief 映射 <base>.idx 与 <base>.nv12
+ * @return 成功返回0，文件缺失或格式错误返回-1
+ */
+int raw_reader_open(raw_reader_t* reader, const char* base);
+
+/**
+ * @brief 第 i 帧数据，索引越界或超出数据文件返回NULL
+ */
+static inline const uint8_t* raw_reader_frame(const raw_reader_t* reader, uint64_t i) {
+    if (i >= reader->count || reader->entries[i].offset + reader->entries[i].length > reader->data_size) {
+        return NULL;
+    }
+    return reader->data + reader->entries[i].offset;
+}
+
+void raw_reader_close(raw_reader_t* reader);
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef _ROI_H
+#define _ROI_H
+
+#include <stdio.h>
+
+/*
+ * 图像中的矩形区域(像素坐标)。NV12 色度按 2x2 采样，坐标和尺寸都对齐到偶数。
+ */
+typedef struct {
+    int x;
+    int y;
+    int width;
+    int height;
+} roi_rect_t;
+
+/**
+ * @brief 把区域对齐到偶数并裁剪到图像范围内
+ * @return 裁剪后非空返回0，否则返回-1
+ */
+static inline int roi_clip(roi_rect_t* r, int width, int height) {
+    int x1 = r->x + r->width;
+    int y1 = r->y + r->height;
+    r->x = r->x < 0 ? 0 : r->x & ~1;
+    r->y = r->y < 0 ? 0 : r->y & ~1;
+    x1 = x1 > width ? width : x1;
+    y1 = y1 > height ? height : y1;
+    r->width = (x1 - r->x) & ~1;
+    r->height = (y1 - r->y) & ~1;
+    return r->width > 0 && r->height > 0 ? 0 : -1;
+}
+
+/**
+ * @brief 解析 "x,y,宽,高"
+ * @return 成功返回0，格式错误返回-1
+ */
+static inline int roi_parse(const char* spec, roi_rect_t* r) {
+    char tail;
+    if (sscanf(spec, "%d,%d,%d,%d%c", &r->x, &r->y, &r->width, &r->height, &tail) != 4 ||
+        r->x < 0 || r->y < 0 || r->width <= 0 || r->height <= 0) {
+        return -1;
+    }
+    return 0;
+}
+
+#endif
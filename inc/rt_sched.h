@@ -0,0 +1,52 @@
+#ifndef _RT_SCHED_H
+#define _RT_SCHED_H
+
+#include <stddef.h>
+
+/*
+ * 流水线线程的绑核与实时调度，以及启动时锁定、预取内存。
+ * 配置字符串格式 "<cpu>[:<优先级>]"，例如 "3:50" 表示绑到 CPU3 并以 SCHED_FIFO 50 运行，
+ * "3" 只绑核不改调度策略。
+ */
+
+typedef struct {
+    int cpu;                        // 绑定的 CPU，<0 不绑核
+    int priority;                   // SCHED_FIFO 优先级(1-99)，0 保持 SCHED_OTHER
+} rt_sched_t;
+
+#define RT_SCHED_NONE { -1, 0 }
+
+/**
+ * @brief 解析 "<cpu>[:<优先级>]"
+ * @return 成功返回0，格式错误返回-1
+ */
+int rt_sched_parse(const char* spec, rt_sched_t* sched);
+
+/**
+ * @brief 对调用线程应用绑核与调度策略，并设置线程名
+ * @param name 线程名(最多15字节)，用于 top/perf 中区分
+ * @param sched 配置，NULL 或 RT_SCHED_NONE 时只设置线程名
+ * @return 成功返回0，任一步失败返回-1(已打印原因，其余设置仍生效)
+ */
+int rt_sched_apply(const char* name, const rt_sched_t* sched);
+
+/**
+ * @brief mlockall 当前及以后的映射，并禁止 malloc 归还/使用 mmap，避免热路径缺页
+ * @return 成功返回0，失败返回-1(通常是 RLIMIT_MEMLOCK 不足)
+ */
+int rt_sched_lock_memory(void);
+
+/**
+ * @brief 逐页访问一段内存，使其在启动阶段完成缺页
+ * @param addr 起始地址
+ * @param length 长度
+ * @param write 1 逐页写0(仅用于内容无意义的缓冲)，0 只读访问
+ */
+void rt_sched_prefault(void* addr, size_t length, int write);
+
+/**
+ * @brief 预取调用线程的栈空间
+ */
+void rt_sched_prefault_stack(size_t length);
+
+#endif
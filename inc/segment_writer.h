@@ -0,0 +1,80 @@
+#ifndef _SEGMENT_WRITER_H
+#define _SEGMENT_WRITER_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include "enc_packet.h"
+#include "rt_sched.h"
+
+/*
+ * 录像分段写线程：编码线程提交 Annex-B 编码包(带 ENC_PACKET_FLAG_KEY 标记)，
+ * 写线程在关键帧处按时长切分为 <前缀>_00000.h264、<前缀>_00001.h264 ...
+ * 队列满时丢包，并丢弃之后的非关键帧直到下一个关键帧，文件里不会出现无法解码的断档。
+ */
+
+#define SEGMENT_WRITER_DEPTH    64  // 必须是2的幂
+
+typedef struct {
+    char prefix[256];
+    const char* ext;                            // "h264" / "h265"
+    uint64_t segment_us;                        // 每段时长
+    enc_packet_t* queue[SEGMENT_WRITER_DEPTH];
+    _Atomic uint32_t head;
+    _Atomic uint32_t tail;
+    sem_t items;
+    pthread_t thread;
+    _Atomic int running;
+    rt_sched_t sched;
+    int need_key;                               // 生产者侧：丢包后等待关键帧
+    _Atomic int key_wanted;                     // 丢包后请求编码器尽快出关键帧
+    // 以下只由写线程访问
+    FILE* fp;
+    unsigned int index;                         // 当前段序号
+    uint64_t seg_start_us;
+    uint64_t seg_last_us;                       // 当前段最后一帧的时间戳
+    uint64_t seg_last_seq;                      // 当前段最后一帧的帧号
+    uint64_t seg_bytes;
+    uint64_t seg_frames;
+    uint64_t total_bytes;
+    uint64_t dropped;
+} segment_writer_t;
+
+/**
+ * @brief 启动录像写线程
+ * @param w 写线程结构体
+ * @param prefix 输出文件前缀，可以含目录
+ * @param ext 文件扩展名
+ * @param segment_sec 每段时长(秒)，到时后在下一个关键帧处切换文件
+ * @param sched 写线程绑核与调度策略，NULL 不设置
+ * @return 成功返回0，失败返回-1
+ */
+int segment_writer_start(segment_writer_t* w, const char* prefix, const char* ext, int segment_sec,
+                         const rt_sched_t* sched);
+
+/**
+ * @brief 提交一个编码包，接管调用者的一个引用
+ * @return 成功返回0，丢弃返回-1(包已释放)
+ */
+int segment_writer_submit(segment_writer_t* w, enc_packet_t* pkt);
+
+/**
+ * @brief 提交一个编码包，队列满时等待而不丢弃，供离线转码使用
+ */
+void segment_writer_submit_wait(segment_writer_t* w, enc_packet_t* pkt);
+
+/**
+ * @brief 是否因丢包需要编码器立即出关键帧，读取后清除
+ */
+static inline int segment_writer_want_key(segment_writer_t* w) {
+    return atomic_exchange_explicit(&w->key_wanted, 0, memory_order_relaxed);
+}
+
+/**
+ * @brief 写完队列中剩余的包，关闭当前段并停止线程
+ */
+void segment_writer_stop(segment_writer_t* w);
+
+#endif
@@ -0,0 +1,150 @@
+#ifndef _SHM_RING_H
+#define _SHM_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+/*
+ * 基于 memfd 的单写多读共享内存环形缓冲区。
+ * 写端（采集循环）从不等待读端：槽位按序号循环覆盖，每个槽位带 seqlock，
+ * 读端通过自己的游标发现被覆盖的帧并得到丢帧数。
+ * 读端只读 mmap 整个 memfd，拿到的是槽位内数据的直接指针，无需拷贝。
+ */
+
+#define SHM_RING_MAGIC      0x4D495052u  // "MIPR"
+#define SHM_RING_VERSION    1
+
+// 槽位内数据类型
+typedef enum {
+    SHM_RING_NV12 = 1,      // 原始NV12帧
+    SHM_RING_JPEG = 2,      // 编码后的JPEG包
+} shm_ring_kind_t;
+
+// 槽位描述，位于共享头部
+typedef struct {
+    _Atomic uint64_t seq;   // 2*帧序号+1 表示写入中，2*帧序号+2 表示写完
+    uint32_t kind;
+    uint32_t length;        // 有效数据字节数
+    uint32_t width;
+    uint32_t height;
+    uint64_t timestamp_us;  // 采集时间(CLOCK_MONOTONIC)
+    uint64_t payload_off;   // 数据相对 memfd 起始的偏移，按页对齐
+} shm_ring_slot_t;
+
+// 共享头部
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t slot_size;     // 每个槽位的最大数据字节数
+    uint64_t total_size;    // memfd 总大小
+    _Atomic uint64_t head;  // 下一个要写的帧序号
+    shm_ring_slot_t slots[];
+} shm_ring_hdr_t;
+
+// 写端
+typedef struct {
+    int fd;
+    size_t map_size;
+    shm_ring_hdr_t* hdr;
+    uint8_t* base;
+    uint64_t reserved_seq;  // shm_ring_reserve 返回、尚未提交的序号
+} shm_ring_t;
+
+// 读端：每个进程/线程一个游标
+typedef struct {
+    int fd;
+    size_t map_size;
+    const shm_ring_hdr_t* hdr;
+    const uint8_t* base;
+    uint64_t cursor;        // 下一个要读的帧序号
+    uint64_t lost;          // 累计丢失的帧数
+} shm_ring_reader_t;
+
+// 一次读取得到的视图，数据直接指向共享内存
+typedef struct {
+    uint64_t seq;
+    uint32_t kind;
+    uint32_t length;
+    uint32_t width;
+    uint32_t height;
+    uint64_t timestamp_us;
+    const void* data;
+} shm_ring_view_t;
+
+/**
+ * @brief 创建共享内存环
+ * @param ring 写端结构体指针
+ * @param name memfd 名称(调试用)
+ * @param slot_count 槽位数量
+ * @param slot_size 每个槽位的最大数据字节数
+ * @return 成功返回0，失败返回-1
+ */
+int shm_ring_create(shm_ring_t* ring, const char* name, uint32_t slot_count, uint32_t slot_size);
+void shm_ring_destroy(shm_ring_t* ring);
+
+/**
+ * @brief 预留下一个槽位，调用者直接写入返回的指针(最多 slot_size 字节)后调用 shm_ring_commit
+ * @return 槽位数据指针
+ */
+void* shm_ring_reserve(shm_ring_t* ring);
+
+/**
+ * @brief 发布 shm_ring_reserve 预留的槽位
+ * @param length 写入的字节数
+ * @return 成功返回0；length 超过槽位大小时不发布(该槽位原有的帧作废)，计入丢帧并返回-1
+ */
+int shm_ring_commit(shm_ring_t* ring, shm_ring_kind_t kind, uint32_t length,
+                    uint32_t width, uint32_t height, uint64_t timestamp_us);
+
+/**
+ * @brief 拷贝一份数据到下一个槽位并发布
+ * @return 成功返回0；超过槽位大小时不发布(读端不会拿到截断的帧)，计入
+ *         mipi_drops_total{cause="shm_oversize"} 并返回-1
+ */
+int shm_ring_publish(shm_ring_t* ring, shm_ring_kind_t kind, const void* data, size_t length,
+                     uint32_t width, uint32_t height, uint64_t timestamp_us);
+
+/**
+ * @brief 读端挂载 memfd（取得所有权），游标置于最新帧
+ * @return 成功返回0，失败返回-1
+ */
+int shm_ring_attach(shm_ring_reader_t* reader, int fd);
+void shm_ring_detach(shm_ring_reader_t* reader);
+
+/**
+ * @brief 读取下一帧
+ * @param reader 读端
+ * @param view 输出视图
+ * @param lost 输出：本次跳过的帧数，可为NULL
+ * @return 1 读到一帧，0 暂无新帧
+ */
+int shm_ring_read(shm_ring_reader_t* reader, shm_ring_view_t* view, uint64_t* lost);
+
+/**
+ * @brief 使用完视图后检查数据是否在读取期间被写端覆盖
+ * @return 1 数据完整，0 已被覆盖（应丢弃处理结果）
+ */
+int shm_ring_view_valid(const shm_ring_reader_t* reader, const shm_ring_view_t* view);
+
+/**
+ * @brief 在 UNIX 套接字上分发 memfd，客户端连接后通过 SCM_RIGHTS 收到全部环的 fd
+ * @param path 套接字路径
+ * @param rings 环数组
+ * @param count 环数量(最多4个)
+ * @return 成功返回0，失败返回-1
+ */
+int shm_ring_server_start(const char* path, shm_ring_t* rings, int count);
+void shm_ring_server_stop(void);
+
+/**
+ * @brief 客户端连接分发套接字并接收 fd
+ * @param path 套接字路径
+ * @param fds 输出fd数组
+ * @param max_fds 数组容量
+ * @return 收到的fd数量，失败返回-1
+ */
+int shm_ring_connect(const char* path, int* fds, int max_fds);
+
+#endif
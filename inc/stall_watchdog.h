@@ -0,0 +1,65 @@
+#ifndef _STALL_WATCHDOG_H
+#define _STALL_WATCHDOG_H
+
+#include <stdint.h>
+
+/*
+ * 采集停顿看门狗。MIPI 链路抖动时驱动不再出帧，以前 select 超时后进程直接退出，
+ * 重新启动要再走一遍摄像头和 MPP 初始化。看门狗按驱动帧间隔缩短等待时间，
+ * 超时(或 DQBUF 出错)后由调用者原地重启采集流(camera_restart)，MPP 会话和各缓冲池保持不动；
+ * 连续恢复失败达到上限才放弃。编码停顿由编码器自己的输出超时检测并复位，见 mpp_encoder.h。
+ * 配置字符串 "<毫秒>[:<次数>]"，毫秒为 0 时关闭。
+ */
+
+#define STALL_WATCHDOG_DEFAULT_MS       1000
+#define STALL_WATCHDOG_DEFAULT_ATTEMPTS 3
+#define STALL_WATCHDOG_INTERVALS        4   // 等待时间至少为驱动帧间隔的倍数，低帧率时不误判
+
+typedef struct {
+    int stall_ms;                   // 超过该时长没有新帧视为停顿，0 表示关闭
+    int max_attempts;               // 连续恢复的次数上限
+    int attempts;                   // 本次停顿已尝试的次数
+    uint64_t last_frame_us;         // 上一次 DQBUF 成功的时间，0 表示还没有出过帧
+    uint64_t detect_us;             // 本次停顿的检测时间，0 表示不在恢复中
+    uint64_t recoveries;            // 成功恢复的次数
+    uint64_t frames_lost;           // 停顿期间估算丢失的帧数
+    uint64_t max_recovery_us;
+} stall_watchdog_t;
+
+#define STALL_WATCHDOG_INIT { STALL_WATCHDOG_DEFAULT_MS, STALL_WATCHDOG_DEFAULT_ATTEMPTS, 0, 0, 0, 0, 0, 0 }
+
+/**
+ * @brief 解析 "<毫秒>[:<次数>]"
+ * @return 成功返回0，格式错误返回-1
+ */
+int stall_watchdog_parse(const char* spec, stall_watchdog_t* wd);
+
+/**
+ * @brief 本次 DQBUF 的等待时间
+ * @param wd 看门狗
+ * @param period_us 实测驱动帧间隔，未知时为0
+ * @param first_ms 还没有出过帧或看门狗关闭时的等待时间(传感器启动较慢)
+ * @return 等待毫秒数
+ */
+int stall_watchdog_timeout_ms(const stall_watchdog_t* wd, uint64_t period_us, int first_ms);
+
+/**
+ * @brief DQBUF 超时或出错后调用
+ * @return 应重启采集流返回1，看门狗关闭或已达到次数上限返回0
+ */
+int stall_watchdog_stalled(stall_watchdog_t* wd, uint64_t now_us);
+
+/**
+ * @brief DQBUF 成功后调用(含被抽掉的帧)，正在恢复时记录恢复耗时和估算的丢帧数
+ * @param wd 看门狗
+ * @param now_us 当前时间
+ * @param period_us 实测驱动帧间隔，未知时不估算丢帧
+ */
+void stall_watchdog_frame(stall_watchdog_t* wd, uint64_t now_us, uint64_t period_us);
+
+/**
+ * @brief 打印恢复次数、丢帧和最长恢复耗时
+ */
+void stall_watchdog_report(const stall_watchdog_t* wd);
+
+#endif
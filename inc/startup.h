@@ -0,0 +1,31 @@
+#ifndef _STARTUP_H
+#define _STARTUP_H
+
+#include <stdint.h>
+
+/*
+ * 启动阶段计时：各初始化步骤(可能在不同线程)记录起止时间，
+ * 结束时以进程 exec 为零点打印，得到从启动到第一张 JPEG 的完整时间线。
+ */
+
+#define STARTUP_MAX_PHASES  16
+
+/**
+ * @brief 记录一个阶段，线程安全；超过 STARTUP_MAX_PHASES 的记录被忽略
+ * @param name 阶段名(须为常量字符串)
+ * @param begin_us 开始时间(metrics_now_us)
+ * @param end_us 结束时间(metrics_now_us)
+ */
+void startup_phase(const char* name, uint64_t begin_us, uint64_t end_us);
+
+/**
+ * @brief 估算进程 exec 时刻的单调时钟微秒数(精度为一个时钟节拍，通常10ms)
+ */
+uint64_t startup_exec_us(void);
+
+/**
+ * @brief 按开始时间打印各阶段相对 exec 的偏移和耗时
+ */
+void startup_report(void);
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef _STREAM_OUT_H
+#define _STREAM_OUT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * 低延迟码流输出：在 UNIX 套接字上把编码数据分块推给本地消费者(远程操作画面的转发进程等)，
+ * 编码器每交出一块就立即发送，不等整包。每块前有一个定长块头，按帧序号和帧内偏移重组。
+ * 发送在编码线程上以非阻塞方式完成，消费者跟不上时不会拖住编码：
+ *  - 一块只写出一部分时，剩余部分暂存，之后先补发，块边界不会错乱
+ *  - 还有未补发的数据时，丢弃该客户端本帧剩下的块，补发完后从下一帧的第一块重新开始；
+ *    消费者看到新帧的 FIRST 块即可丢弃不完整的上一帧
+ * 新客户端在每帧开始时接入；录像码流的消费者需自行等待关键帧。
+ */
+
+#define STREAM_OUT_MAGIC        0x5350494du     // 小端内存中为 "MIPS"
+#define STREAM_OUT_MAX_CLIENTS  4
+#define STREAM_OUT_SNDBUF       (1 << 20)       // 每个客户端的发送缓冲，容纳一整帧 JPEG
+#define STREAM_OUT_BAND_ROWS    4               // 软件 JPEG 每块的 MCU 行数(64 像素)
+
+#define STREAM_OUT_FLAG_FIRST   0x1             // 本帧第一块
+#define STREAM_OUT_FLAG_LAST    0x2             // 本帧最后一块
+
+typedef enum {
+    STREAM_KIND_JPEG = 0,
+    STREAM_KIND_H264,
+    STREAM_KIND_H265,
+} stream_kind_t;
+
+// 块头，主机字节序，后跟 length 字节数据
+typedef struct {
+    uint32_t magic;
+    uint16_t kind;                  // stream_kind_t
+    uint16_t flags;                 // STREAM_OUT_FLAG_*
+    uint64_t seq;                   // 帧序号
+    uint64_t timestamp_us;          // 采集时间(CLOCK_MONOTONIC)
+    uint64_t send_us;               // 本块交给套接字的时间，消费者据此计算传输延迟
+    uint32_t offset;                // 本块在帧内的字节偏移
+    uint32_t length;
+} stream_out_hdr_t;
+
+/**
+ * @brief 在 UNIX 套接字上开始监听
+ * @param path 套接字路径
+ * @param kind 码流类型，写入每个块头
+ * @return 成功返回0，失败返回-1
+ */
+int stream_out_start(const char* path, stream_kind_t kind);
+
+/**
+ * @brief 一帧开始：接入等待中的客户端，恢复上一帧被丢弃的客户端
+ * @param seq 帧序号
+ * @param timestamp_us 采集时间
+ */
+void stream_out_begin(uint64_t seq, uint64_t timestamp_us);
+
+/**
+ * @brief 发送本帧的一块，签名与 enc_chunk_fn 相同，可直接作为编码器的分块回调
+ * @param arg 未使用
+ * @param data 数据
+ * @param length 字节数
+ * @param last 是否本帧最后一块
+ */
+void stream_out_chunk(void* arg, const uint8_t* data, size_t length, int last);
+
+/**
+ * @brief 尝试补发各客户端暂存的残块(非阻塞)，编码线程空闲时调用可以让残块早于下一帧送出
+ */
+void stream_out_flush(void);
+
+/**
+ * @brief 当前连接的客户端数
+ */
+int stream_out_clients(void);
+
+void stream_out_stop(void);
+
+/**
+ * @brief 消费者：连接输出套接字
+ * @return 成功返回fd，失败返回-1
+ */
+int stream_out_connect(const char* path);
+
+/**
+ * @brief 消费者：阻塞读取一块
+ * @param fd stream_out_connect 返回的fd
+ * @param hdr 输出：块头
+ * @param buf 数据缓冲，块超过 capacity 时多余部分被丢弃
+ * @param capacity 缓冲大小
+ * @return 成功返回0，连接关闭或块头无效返回-1
+ */
+int stream_out_read(int fd, stream_out_hdr_t* hdr, uint8_t* buf, size_t capacity);
+
+#endif
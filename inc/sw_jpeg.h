@@ -0,0 +1,115 @@
+#ifndef _SW_JPEG_H
+#define _SW_JPEG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "roi.h"
+
+/*
+ * 软件基线 JPEG 编码器：NV12 输入，4:2:0 输出，标准 Huffman 表，AAN 浮点 DCT。
+ * 不依赖 MPP，可在普通 Linux 主机上运行；一个实例只能被一个线程使用。
+ */
+
+typedef struct {
+    int width;
+    int height;
+    int quality;
+    uint8_t qt_luma[64];            // 量化表(自然顺序)
+    uint8_t qt_chroma[64];
+    float fdtbl_luma[64];           // 量化与 DCT 缩放合并后的倒数
+    float fdtbl_chroma[64];
+    // 质量分区：关注区域外的块按背景质量重新量化
+    int zone_enabled;
+    int zone_mx0, zone_my0;         // 关注区域覆盖的 MCU 范围(像素，16 对齐)
+    int zone_mx1, zone_my1;
+    int bg_quality;
+    float bg_fdtbl_luma[64];
+    float bg_fdtbl_chroma[64];
+    float bg_ratio_luma[64];        // 背景量化步长 / 文件中量化表步长
+    float bg_ratio_chroma[64];
+} sw_jpeg_t;
+
+// 一个块熵编码后的字节数上限：标准 Huffman 表下 DC 最多 11+11 位，每个 AC 最多 16 位码字 + 10 位数值，
+// 共 1660 位(208 字节)，再按每个字节都是 0xFF 需要填充翻倍
+#define SW_JPEG_BLOCK_MAX_BYTES     416
+#define SW_JPEG_HEADER_MAX_BYTES    1024    // SOI 到 SOS 的文件头和 EOI
+
+// zigzag 序号 -> 自然顺序下标
+extern const uint8_t sw_jpeg_zigzag_natural[64];
+
+// 分带输出回调，与 enc_chunk_fn 相同
+typedef void (*sw_jpeg_band_fn)(void* arg, const uint8_t* data, size_t length, int last);
+
+/**
+ * @brief 初始化编码器并按质量生成量化表
+ * @param j 编码器
+ * @param width 图像宽度
+ * @param height 图像高度
+ * @param quality JPEG质量(1-100)，与 IJG 定义一致
+ * @return 成功返回0，参数无效返回-1
+ */
+int sw_jpeg_init(sw_jpeg_t* j, int width, int height, int quality);
+
+/**
+ * @brief 编码一帧可能的最大输出，按它分配输出缓冲时任何输入(包括质量100的噪声)都不会失败
+ * @return 字节数，约为 NV12 原始数据的 6.5 倍；普通页按需分配，实际占用与输出大小相当
+ */
+size_t sw_jpeg_max_size(int width, int height);
+
+/**
+ * @brief 设置质量分区。基线 JPEG 每个分量只能有一张量化表，背景块先按背景质量量化，
+ *        再换算回文件中的量化表，高频系数大多归零，解码端不需要任何改动
+ * @param j 编码器
+ * @param zone 关注区域，NULL 取消分区；与之相交的 MCU 保持原质量
+ * @param bg_quality 背景质量，不低于编码器质量时等于取消分区
+ * @return 成功返回0，区域与图像不相交返回-1
+ */
+int sw_jpeg_set_zone(sw_jpeg_t* j, const roi_rect_t* zone, int bg_quality);
+
+/**
+ * @brief 格式转换：取一个 16x16 MCU 的 4 个 Y 块和 Cb/Cr 块(去交织并减 128)，图像边缘按最后一行/列复制。
+ *        编码内部使用，单独导出供基准测试测量这一阶段
+ * @param mx MCU 左上角 x(16 的倍数)
+ * @param my MCU 左上角 y(16 的倍数)
+ */
+void sw_jpeg_load_mcu(const sw_jpeg_t* j, const uint8_t* y, int y_stride, const uint8_t* uv, int uv_stride,
+                      int mx, int my, float yb[4][64], float cb[64], float cr[64]);
+
+/**
+ * @brief 编码一帧 NV12
+ * @param j 编码器
+ * @param y Y 平面
+ * @param y_stride Y 平面行跨度
+ * @param uv UV 交织平面
+ * @param uv_stride UV 平面行跨度
+ * @param out 输出缓冲
+ * @param capacity 输出缓冲大小
+ * @return 编码后字节数，输出缓冲不足返回0
+ */
+size_t sw_jpeg_encode_nv12(const sw_jpeg_t* j, const uint8_t* y, int y_stride,
+                           const uint8_t* uv, int uv_stride, uint8_t* out, size_t capacity);
+
+/**
+ * @brief 分带输出的 sw_jpeg_encode_nv12：每编完 band_rows 行 MCU，就把已经写完整的字节交给回调，
+ *        不等整帧结束；第一块含文件头，最后一块含 EOI。各块按顺序拼接即为完整 JPEG，同样写在 out 里
+ * @param band_rows 每块包含的 MCU 行数(16 像素一行)
+ * @param fn 分块回调，NULL 时等同 sw_jpeg_encode_nv12
+ * @param arg 回调参数
+ * @return 编码后字节数，输出缓冲不足返回0(此时已交出的块不完整，最后一块不会送出)
+ */
+size_t sw_jpeg_encode_nv12_bands(const sw_jpeg_t* j, const uint8_t* y, int y_stride,
+                                 const uint8_t* uv, int uv_stride, uint8_t* out, size_t capacity,
+                                 int band_rows, sw_jpeg_band_fn fn, void* arg);
+
+/**
+ * @brief 由已量化的 DCT 系数直接熵编码一帧，不做 DCT 和量化，供压缩域变换使用。
+ *        尺寸取 j->width/height，量化表取 j->qt_luma/qt_chroma(须与系数的量化一致)
+ * @param coef Y、Cb、Cr 的系数，每块 64 个(zigzag 顺序)，块按行排列；
+ *             Y 每行 2*MCU列数 块、共 2*MCU行数 行，Cb/Cr 每行 MCU列数 块、共 MCU行数 行
+ * @param out 输出缓冲
+ * @param capacity 输出缓冲大小
+ * @return 编码后字节数，输出缓冲不足返回0
+ */
+size_t sw_jpeg_encode_coefs(const sw_jpeg_t* j, const int16_t* const coef[3], uint8_t* out, size_t capacity);
+
+#endif
@@ -0,0 +1,105 @@
+#ifndef _TRACE_H
+#define _TRACE_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+
+/*
+ * 帧生命周期事件跟踪。每个线程第一次记录时分配自己的环形缓冲，之后只有本线程写入，
+ * 不加锁、不做系统调用(时间戳走 vDSO)；环满后覆盖最旧的事件，始终保留最近一段历史。
+ * 未启用时每个跟踪点只有一次原子读，可以常驻在生产环境。
+ * 收到 SIGUSR1 或停止时，把所有线程的环导出为 Chrome/Perfetto 可打开的 trace JSON。
+ *
+ * 帧号：流水线各阶段用本线程的当前帧号(trace_set_frame)，写线程用编码包的帧号；
+ * dqbuf/qbuf 另在 arg 中给出驱动帧序号，可与驱动丢帧对照。
+ */
+
+#define TRACE_RING_SIZE     8192    // 每线程事件数，必须是2的幂
+#define TRACE_MAX_THREADS   64
+
+typedef enum {
+    TRACE_DQBUF = 0,                // 瞬时：arg 为驱动帧序号
+    TRACE_QBUF,                     // 瞬时：arg 为缓冲区索引
+    TRACE_COPY,                     // 拷贝到编码输入并同步 cache
+    TRACE_ENCODE_PUT,               // encode_put_frame
+    TRACE_ENCODE_GET,               // encode_get_packet
+    TRACE_VIDEO_ENCODE,             // 录像编码
+    TRACE_WRITE_SUBMIT,             // 瞬时：提交到写线程，arg 为字节数，0 表示队列满被丢弃
+    TRACE_WRITE,                    // 写文件
+    TRACE_FSYNC,                    // 落盘
+    TRACE_EVENT_MAX
+} trace_event_t;
+
+typedef struct {
+    uint64_t ts_ns;                 // 开始时间(CLOCK_MONOTONIC)
+    uint64_t frame;
+    uint32_t dur_ns;                // 0 表示瞬时事件
+    uint32_t arg;
+    uint16_t event;
+} trace_record_t;
+
+extern _Atomic int g_trace_enabled;
+
+static inline uint64_t trace_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief 写入本线程的环(慢路径在首次调用时注册线程)
+ */
+void trace_emit(trace_event_t event, uint64_t frame, uint64_t ts_ns, uint64_t end_ns, uint32_t arg);
+
+/**
+ * @brief 设置/读取本线程的当前帧号
+ */
+void trace_set_frame(uint64_t frame);
+uint64_t trace_current_frame(void);
+
+/**
+ * @brief 区间开始，未启用时返回0且不读时钟
+ */
+static inline uint64_t trace_begin(void) {
+    return atomic_load_explicit(&g_trace_enabled, memory_order_relaxed) ? trace_now_ns() : 0;
+}
+
+/**
+ * @brief 区间结束，t0 为 trace_begin 的返回值
+ */
+static inline void trace_end(trace_event_t event, uint64_t frame, uint64_t t0, uint32_t arg) {
+    if (t0) {
+        trace_emit(event, frame, t0, trace_now_ns(), arg);
+    }
+}
+
+/**
+ * @brief 瞬时事件
+ */
+static inline void trace_instant(trace_event_t event, uint64_t frame, uint32_t arg) {
+    if (atomic_load_explicit(&g_trace_enabled, memory_order_relaxed)) {
+        uint64_t now = trace_now_ns();
+        trace_emit(event, frame, now, now, arg);
+    }
+}
+
+/**
+ * @brief 开始跟踪：在创建任何线程之前调用，屏蔽 SIGUSR1 并启动导出线程
+ * @param path 导出文件，每次导出覆盖
+ * @return 成功返回0，失败返回-1
+ */
+int trace_start(const char* path);
+
+/**
+ * @brief 立即把所有线程的环导出为 Chrome trace JSON
+ * @return 成功返回导出的事件数，失败返回-1
+ */
+int trace_export(const char* path);
+
+/**
+ * @brief 停止跟踪并最后导出一次(各线程的环随进程退出释放)
+ */
+void trace_stop(void);
+
+#endif
@@ -0,0 +1,171 @@
+#ifndef _VIDEO_ENCODER_H
+#define _VIDEO_ENCODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "roi.h"
+#include "enc_packet.h"
+
+#ifndef MIPI_WITH_MPP
+#define MIPI_WITH_MPP 1
+#endif
+
+#if MIPI_WITH_MPP
+#include <rockchip/rk_mpi.h>
+#include <rockchip/mpp_buffer.h>
+#endif
+
+/*
+ * H.264/H.265 连续录像编码器，输出 Annex-B 码流，每个 IDR 前都带参数集，
+ * 可以在任意关键帧处切分文件。
+ * 不启用 MIPI_WITH_MPP 时编译为桩编码器：不做真正的压缩，只按码率和 GOP
+ * 生成结构正确的 NAL 序列，用于在没有 VPU 的主机上验证封装与流水线逻辑。
+ */
+
+// encode_get_packet 的等待上限，超时视为编码停顿并复位编码器
+#define VIDEO_ENCODER_OUTPUT_TIMEOUT_MS 1000
+// 录像包池的对象按平均每帧字节数的倍数分配，容纳 IDR
+#define VIDEO_PACKET_SLOT_FRAMES    8
+#define VIDEO_PACKET_SLOT_MIN       (128 * 1024)
+
+typedef enum {
+    VIDEO_CODEC_H264 = 0,
+    VIDEO_CODEC_H265,
+} video_codec_t;
+
+typedef enum {
+    VIDEO_RC_CBR = 0,
+    VIDEO_RC_VBR,
+    VIDEO_RC_AVBR,
+    VIDEO_RC_FIXQP,
+} video_rc_t;
+
+typedef struct {
+    video_codec_t codec;
+    video_rc_t rc;
+    int bitrate_kbps;               // 目标码率，FIXQP 时忽略
+    int gop;                        // 关键帧间隔(帧)
+    int fps;                        // 输入帧率，码率控制按此分配每帧比特
+    int qp;                         // FIXQP 的 QP，其它模式下为初始 QP
+    int slice_rows;                 // >0 时每片 slice_rows 行 CTU，低延迟模式每片编完即输出；0 为整帧一片
+} video_cfg_t;
+
+#define VIDEO_CFG_DEFAULT   { VIDEO_CODEC_H264, VIDEO_RC_CBR, 4000, 60, 30, 26, 0 }
+
+typedef struct {
+#if MIPI_WITH_MPP
+    MppCtx ctx;
+    MppApi* mpi;
+    MppEncCfg cfg;
+    MppBufferGroup group;
+    MppBuffer frame_buf;            // video_encoder_encode 拷贝输入用
+    MppPacket packet;               // 上一次输出，下一次编码前释放
+    uint8_t* slices;                // 低延迟模式下逐片拼出的整帧
+    size_t slices_capacity;
+#else
+    uint8_t* out;                   // 桩编码器的输出缓冲
+    size_t out_capacity;
+    int force_idr;
+#endif
+    video_cfg_t cfg_v;
+    int width;                      // 编码尺寸，设置裁剪后为区域大小
+    int height;
+    int hor_stride;                 // 输入缓冲的整帧尺寸
+    int ver_stride;
+    int crop_x;
+    int crop_y;
+    size_t frame_size;
+    uint64_t frames;
+    uint64_t bytes;
+    uint64_t keyframes;
+    enc_chunk_fn chunk_fn;          // 分片输出回调(video_encoder_set_stream)
+    void* chunk_arg;
+} video_encoder_t;
+
+// 一个编码输出，数据在下一次编码或 deinit 前有效
+typedef struct {
+    const uint8_t* data;
+    size_t length;
+    int keyframe;
+} video_packet_t;
+
+/**
+ * @brief 解析录像参数 "h264|h265[:cbr|vbr|avbr|fixqp[:码率kbps[:GOP[:帧率]]]]"
+ * @param spec 参数字符串
+ * @param cfg 输出：未给出的字段保持原值
+ * @return 成功返回0，格式错误返回-1
+ */
+int video_cfg_parse(const char* spec, video_cfg_t* cfg);
+
+/**
+ * @brief 码流文件扩展名 "h264" 或 "h265"
+ */
+const char* video_codec_ext(video_codec_t codec);
+
+/**
+ * @brief 录像包池的单包容量：按码率和帧率估算，超过的包(桩编码器不压缩的包、特别大的 IDR)退回堆分配
+ */
+size_t video_cfg_packet_slot(const video_cfg_t* cfg);
+
+/**
+ * @brief 创建并配置编码器
+ * @param v 编码器
+ * @param width 图像宽度
+ * @param height 图像高度
+ * @param cfg 编码参数
+ * @return 成功返回0，失败返回-1
+ */
+int video_encoder_init(video_encoder_t* v, int width, int height, const video_cfg_t* cfg);
+
+/**
+ * @brief 编码一帧连续存放的 NV12(行跨度等于宽度)
+ * @param v 编码器
+ * @param nv12 输入帧
+ * @param pts_us 显示时间戳
+ * @param out 输出：编码数据
+ * @return 成功返回0，失败返回-1
+ */
+int video_encoder_encode(video_encoder_t* v, const uint8_t* nv12, uint64_t pts_us, video_packet_t* out);
+
+#if MIPI_WITH_MPP
+/**
+ * @brief 直接编码一个 MPP 缓冲(与 JPEG 编码器共用输入缓冲或摄像头导入缓冲)，不拷贝
+ */
+int video_encoder_encode_buffer(video_encoder_t* v, MppBuffer input, uint64_t pts_us, video_packet_t* out);
+#endif
+
+/**
+ * @brief 只编码输入中的一个区域(MPP 预处理偏移，不拷贝)，下一帧起生效并从 IDR 开始
+ * @param v 编码器
+ * @param roi 区域(整帧坐标)，NULL 恢复整帧
+ * @return 成功返回0，失败返回-1
+ */
+int video_encoder_set_crop(video_encoder_t* v, const roi_rect_t* roi);
+
+/**
+ * @brief 运行中修改输入帧尺寸(随摄像头分辨率切换)，不能超过初始化时的帧大小；裁剪恢复为整帧，下一帧为 IDR
+ * @return 成功返回0，失败返回-1
+ */
+int video_encoder_set_size(video_encoder_t* v, int width, int height);
+
+/**
+ * @brief 编码时把码流分块交给回调：配置了 slice_rows 的 MPP 编码器每输出一片交一块，
+ *        否则(含桩编码器)整帧作为一块。encode 输出的整帧数据不变；在 video_encoder_init 之后调用
+ * @param fn 分块回调，NULL 取消
+ */
+void video_encoder_set_stream(video_encoder_t* v, enc_chunk_fn fn, void* arg);
+
+/**
+ * @brief 编码停顿后复位编码器并重新下发配置，下一帧为 IDR
+ * @return 成功返回0，失败返回-1
+ */
+int video_encoder_reset(video_encoder_t* v);
+
+/**
+ * @brief 下一帧强制编码为 IDR
+ */
+void video_encoder_request_idr(video_encoder_t* v);
+
+void video_encoder_deinit(video_encoder_t* v);
+
+#endif
@@ -1,56 +1,28 @@
+#define _GNU_SOURCE
 #include "camera_init.h"
+#include "metrics.h"
+#include "trace.h"
+
+// 初始化和每帧的过程日志，错误与警告不受影响
+static int camera_verbose = 1;
+#define CAM_INFO(...) do { if (camera_verbose) printf(__VA_ARGS__); } while (0)
+
+void camera_set_verbose(int verbose) {
+    camera_verbose = verbose;
+}
+
+static unsigned int clamp_buf_count(unsigned int buf_count) {
+    if (buf_count < 2) {
+        return 2;
+    }
+    return buf_count > CAMERA_MAX_BUFFERS ? CAMERA_MAX_BUFFERS : buf_count;
+}
 
 /**
- * @brief 初始化摄像头并设置YUV格式
- * @param cam 摄像头结构体指针
- * @param device 摄像头设备路径
- * @param width 图像宽度
- * @param height 图像高度
- * @param pixelformat 像素格式(V4L2_PIX_FMT_YUYV等)
+ * @brief 设置并回读图像格式，buf_size 取驱动要求的 sizeimage；必须在没有申请缓冲时调用
  * @return 成功返回0，失败返回-1
  */
-int camera_init(camera_t* cam, const char* device, int width, int height, uint32_t pixelformat) {
-    struct v4l2_capability cap;
-    
-    printf("正在初始化摄像头: %s\n", device);
-    
-    // 1. 打开摄像头设备
-    cam->fd = open(device, O_RDWR | O_NONBLOCK);
-    if (cam->fd < 0) {
-        perror("无法打开摄像头设备");
-        return -1;
-    } else{
-        printf("打开成功！\n");
-    }
-    
-    // 2. 查询设备能力
-    if (ioctl(cam->fd, VIDIOC_QUERYCAP, &cap) < 0) {
-        perror("无法查询设备能力");
-        close(cam->fd);
-        return -1;
-    }else{
-        printf("查询设备能力成功！\n");
-    }
-    
-    if (!(cap.capabilities & V4L2_CAP_VIDEO_CAPTURE_MPLANE)) {
-        printf("错误: 设备不支持视频采集\n");
-        close(cam->fd);
-        return -1;
-    }else{
-        printf("设备支持多平面采集！\n");
-    }
-    
-    if (!(cap.capabilities & V4L2_CAP_STREAMING)) {
-        printf("错误: 设备不支持流式IO\n");
-        close(cam->fd);
-        return -1;
-    }else{
-        printf("设备支持流式IO！\n");
-    }
-    
-    printf("摄像头支持能力: 0x%x\n", cap.capabilities);
-    
-    // 3. 设置图像格式
+static int camera_apply_format(camera_t* cam, int width, int height, uint32_t pixelformat) {
     memset(&cam->fmt, 0, sizeof(cam->fmt));
     cam->fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
     cam->fmt.fmt.pix_mp.width = width;                    // 使用 pix_mp
@@ -64,10 +36,9 @@ int camera_init(camera_t* cam, const char* device, int width, int height, uint32
         
     if (ioctl(cam->fd, VIDIOC_S_FMT, &cam->fmt) < 0) {
         perror("无法设置视频格式");
-        close(cam->fd);
         return -1;
     }else{
-        printf("设置视频格式成功！\n");
+        CAM_INFO("设置视频格式成功！\n");
     }
 
     // 设置格式后，立即获取驱动实际设置的格式进行验证
@@ -76,13 +47,13 @@ int camera_init(camera_t* cam, const char* device, int width, int height, uint32
     actual_fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
 
     if (ioctl(cam->fd, VIDIOC_G_FMT, &actual_fmt) == 0) {
-        printf("驱动实际设置的格式信息：\n");
-        printf("  像素格式: 0x%x (预期: 0x%x)\n", actual_fmt.fmt.pix_mp.pixelformat, pixelformat);
-        printf("  分辨率: %dx%d (预期: %dx%d)\n", actual_fmt.fmt.pix_mp.width, actual_fmt.fmt.pix_mp.height, width, height);
-        printf("  平面数量: %d\n", actual_fmt.fmt.pix_mp.num_planes);
+        CAM_INFO("驱动实际设置的格式信息：\n");
+        CAM_INFO("  像素格式: 0x%x (预期: 0x%x)\n", actual_fmt.fmt.pix_mp.pixelformat, pixelformat);
+        CAM_INFO("  分辨率: %dx%d (预期: %dx%d)\n", actual_fmt.fmt.pix_mp.width, actual_fmt.fmt.pix_mp.height, width, height);
+        CAM_INFO("  平面数量: %d\n", actual_fmt.fmt.pix_mp.num_planes);
         
         for (int i = 0; i < actual_fmt.fmt.pix_mp.num_planes; i++) {
-            printf("  平面[%d] - 步长: %u, 图像大小: %u\n", 
+            CAM_INFO("  平面[%d] - 步长: %u, 图像大小: %u\n", 
                 i, 
                 actual_fmt.fmt.pix_mp.plane_fmt[i].bytesperline,
                 actual_fmt.fmt.pix_mp.plane_fmt[i].sizeimage);
@@ -95,36 +66,90 @@ int camera_init(camera_t* cam, const char* device, int width, int height, uint32
         if (actual_fmt.fmt.pix_mp.num_planes < cam->fmt.fmt.pix_mp.num_planes) {
             printf("严重警告：驱动返回的平面数量为 %d，可能不支持多平面NV12！\n", actual_fmt.fmt.pix_mp.num_planes);
         }
+        cam->buf_size = actual_fmt.fmt.pix_mp.plane_fmt[0].sizeimage;
     } else {
         perror("无法获取实际视频格式");
+        cam->buf_size = cam->fmt.fmt.pix_mp.plane_fmt[0].sizeimage;
     }
-    
+    return 0;
+}
 
-    // 4. 请求缓冲区
-    memset(&cam->req, 0, sizeof(cam->req));
-    cam->req.count = 4;  // 请求4个缓冲区
-    cam->req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
-    cam->req.memory = V4L2_MEMORY_MMAP;  // 内存映射方式
+/**
+ * @brief 打开设备、检查能力并设置格式（MMAP 与导入模式共用）
+ * @return 成功返回0，失败返回-1（设备已关闭）
+ */
+static int camera_open_device(camera_t* cam, const char* device, int width, int height, uint32_t pixelformat) {
+    struct v4l2_capability cap;
     
-    if (ioctl(cam->fd, VIDIOC_REQBUFS, &cam->req) < 0) {
-        perror("无法请求缓冲区");
+    CAM_INFO("正在初始化摄像头: %s\n", device);
+    
+    // 1. 打开摄像头设备
+    cam->fd = open(device, O_RDWR | O_NONBLOCK);
+    if (cam->fd < 0) {
+        perror("无法打开摄像头设备");
+        return -1;
+    } else{
+        CAM_INFO("打开成功！\n");
+    }
+    
+    // 2. 查询设备能力
+    if (ioctl(cam->fd, VIDIOC_QUERYCAP, &cap) < 0) {
+        perror("无法查询设备能力");
         close(cam->fd);
         return -1;
     }else{
-        printf("请求缓冲区成功！\n");
+        CAM_INFO("查询设备能力成功！\n");
     }
     
-    if (cam->req.count < 2) {
-        printf("错误: 缓冲区数量不足: %d\n", cam->req.count);
+    if (!(cap.capabilities & V4L2_CAP_VIDEO_CAPTURE_MPLANE)) {
+        printf("错误: 设备不支持视频采集\n");
         close(cam->fd);
         return -1;
     }else{
-        printf("请求四个缓冲区成功！\n");
+        CAM_INFO("设备支持多平面采集！\n");
     }
     
-    cam->n_buffers = cam->req.count;
-    // 5. 映射缓冲区到用户空间
+    if (!(cap.capabilities & V4L2_CAP_STREAMING)) {
+        printf("错误: 设备不支持流式IO\n");
+        close(cam->fd);
+        return -1;
+    }else{
+        CAM_INFO("设备支持流式IO！\n");
+    }
+    
+    CAM_INFO("摄像头支持能力: 0x%x\n", cap.capabilities);
+    
+    // 3. 设置图像格式
+    if (camera_apply_format(cam, width, height, pixelformat) != 0) {
+        close(cam->fd);
+        return -1;
+    }
+    return 0;
+}
 
+/**
+ * @brief 为已得到的缓冲数量分配记录数组
+ */
+static int camera_alloc_arrays(camera_t* cam) {
+    cam->buffers = calloc(cam->n_buffers, sizeof(void*));
+    cam->buf_lengths = calloc(cam->n_buffers, sizeof(unsigned int));
+    cam->dmabuf_fds = calloc(cam->n_buffers, sizeof(int));
+    cam->queued_hist = calloc(cam->n_buffers + 1, sizeof(uint64_t));
+    cam->trace_frames = calloc(cam->n_buffers, sizeof(uint64_t));
+    cam->held = calloc(cam->n_buffers, 1);
+    if (!cam->buffers || !cam->buf_lengths || !cam->dmabuf_fds || !cam->queued_hist || !cam->trace_frames ||
+        !cam->held) {
+        printf("错误: 缓冲区数组分配失败\n");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 查询并映射 MMAP 缓冲区，失败时已映射的由 camera_close/camera_unmap_buffers 释放
+ * @return 成功返回0，失败返回-1
+ */
+static int camera_map_buffers(camera_t* cam) {
     for (unsigned int i = 0; i < cam->n_buffers; i++) {
         struct v4l2_plane planes[1];  // 只分配一个平面
         memset(planes, 0, sizeof(planes)); // 关键：清空数组
@@ -136,15 +161,14 @@ int camera_init(camera_t* cam, const char* device, int width, int height, uint32
         cam->buf.m.planes = planes; // 指向平面数组
         if (ioctl(cam->fd, VIDIOC_QUERYBUF, &cam->buf) < 0) {
             perror("无法查询缓冲区信息");
-            close(cam->fd);
             return -1;
         }else{
-            printf("查询缓冲区信息成功...\n");
-            printf("  平面0: 偏移=%u, 长度=%u\n", 
+            CAM_INFO("查询缓冲区信息成功...\n");
+            CAM_INFO("  平面0: 偏移=%u, 长度=%u\n", 
                    cam->buf.m.planes[0].m.mem_offset, 
                    cam->buf.m.planes[0].length);
         }
-            cam->buffers[i][0] = mmap(
+            cam->buffers[i] = mmap(
                 NULL, // 让系统自动选择映射起始地址
                 cam->buf.m.planes[0].length, // 该平面的长度
                 PROT_READ | PROT_WRITE, // 映射区域可读可写
@@ -154,19 +178,209 @@ int camera_init(camera_t* cam, const char* device, int width, int height, uint32
             );
 
             // 正确的错误检查：判断返回值是否为 MAP_FAILED
-            if (cam->buffers[i][0] == MAP_FAILED) {
+            if (cam->buffers[i] == MAP_FAILED) {
+                cam->buffers[i] = NULL;
                 perror("无法映射缓冲区");
-                close(cam->fd);
                 return -1;
             } else {
-                printf("缓冲区[%d]  映射成功，地址：%p\n\n", i,  cam->buffers[i][0]);
+                cam->buf_lengths[i] = cam->buf.m.planes[0].length;
+                CAM_INFO("缓冲区[%d]  映射成功，地址：%p\n\n", i,  cam->buffers[i]);
             }
 
     }
+    return 0;
+}
+
+/**
+ * @brief 解除 MMAP 缓冲区映射，导入模式的缓冲区属于调用者，不做处理
+ */
+static void camera_unmap_buffers(camera_t* cam) {
+    if (!cam->buffers || cam->memory != V4L2_MEMORY_MMAP) {
+        return;
+    }
+    for (unsigned int i = 0; i < cam->n_buffers; i++) {
+        if (cam->buffers[i]) {
+            munmap(cam->buffers[i], cam->buf_lengths[i]);
+            cam->buffers[i] = NULL;
+        }
+    }
+}
+
+/**
+ * @brief 初始化摄像头并设置YUV格式
+ * @param cam 摄像头结构体指针
+ * @param device 摄像头设备路径
+ * @param width 图像宽度
+ * @param height 图像高度
+ * @param pixelformat 像素格式(V4L2_PIX_FMT_YUYV等)
+ * @param buf_count 请求的缓冲区数量，驱动可能调整，以 REQBUFS 返回为准
+ * @return 成功返回0，失败返回-1
+ */
+int camera_init(camera_t* cam, const char* device, int width, int height, uint32_t pixelformat,
+                unsigned int buf_count) {
+    memset(cam, 0, sizeof(*cam));
+    buf_count = clamp_buf_count(buf_count);
+    cam->memory = V4L2_MEMORY_MMAP;
+    if (camera_open_device(cam, device, width, height, pixelformat) != 0) {
+        return -1;
+    }
+
+
+    // 4. 请求缓冲区
+    memset(&cam->req, 0, sizeof(cam->req));
+    cam->req.count = buf_count;
+    cam->req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+    cam->req.memory = V4L2_MEMORY_MMAP;  // 内存映射方式
+    
+    if (ioctl(cam->fd, VIDIOC_REQBUFS, &cam->req) < 0) {
+        perror("无法请求缓冲区");
+        close(cam->fd);
+        return -1;
+    }else{
+        CAM_INFO("请求缓冲区成功！\n");
+    }
+    
+    if (cam->req.count < 2) {
+        printf("错误: 缓冲区数量不足: %d\n", cam->req.count);
+        close(cam->fd);
+        return -1;
+    }else{
+        CAM_INFO("请求%u个缓冲区，驱动分配%u个！\n", buf_count, cam->req.count);
+    }
     
-    printf("====摄像头初始化成功====\n\n\n");
+    cam->n_buffers = cam->req.count;
+    if (camera_alloc_arrays(cam) != 0) {
+        camera_close(cam);
+        return -1;
+    }
+    // 5. 映射缓冲区到用户空间
+    if (camera_map_buffers(cam) != 0) {
+        camera_close(cam);
+        return -1;
+    }
+    
+    CAM_INFO("====摄像头初始化成功====\n\n\n");
     return 0;
 }
+
+/**
+ * @brief 以导入方式初始化摄像头：缓冲区由调用者(MPP)分配，驱动直接写入
+ * @param cam 摄像头结构体指针
+ * @param device 摄像头设备路径
+ * @param width 图像宽度
+ * @param height 图像高度
+ * @param pixelformat 像素格式
+ * @param bufs 调用者分配的缓冲区(dmabuf fd、CPU地址、长度)
+ * @param buf_count 缓冲区数量
+ * @return 成功返回0，失败返回-1；先尝试 DMABUF，驱动不支持时退回 USERPTR
+ */
+int camera_init_import(camera_t* cam, const char* device, int width, int height, uint32_t pixelformat,
+                       const camera_import_buf_t* bufs, unsigned int buf_count) {
+    static const uint32_t modes[] = { V4L2_MEMORY_DMABUF, V4L2_MEMORY_USERPTR };
+
+    memset(cam, 0, sizeof(*cam));
+    if (buf_count < 2 || buf_count > CAMERA_MAX_BUFFERS) {
+        printf("错误: 导入缓冲区数量无效: %u\n", buf_count);
+        return -1;
+    }
+    if (camera_open_device(cam, device, width, height, pixelformat) != 0) {
+        return -1;
+    }
+    for (unsigned int i = 0; i < buf_count; i++) {
+        if (bufs[i].length < cam->buf_size) {
+            printf("错误: 导入缓冲区[%u]长度%u小于驱动要求的%u\n", i, bufs[i].length, cam->buf_size);
+            close(cam->fd);
+            return -1;
+        }
+    }
+
+    // 驱动可能只支持其中一种导入方式
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+        memset(&cam->req, 0, sizeof(cam->req));
+        cam->req.count = buf_count;
+        cam->req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+        cam->req.memory = modes[m];
+        if (ioctl(cam->fd, VIDIOC_REQBUFS, &cam->req) == 0 && cam->req.count >= 2) {
+            cam->memory = modes[m];
+            break;
+        }
+        printf("%s 导入方式不可用: %s\n", modes[m] == V4L2_MEMORY_DMABUF ? "DMABUF" : "USERPTR", strerror(errno));
+    }
+    if (!cam->memory) {
+        close(cam->fd);
+        return -1;
+    }
+
+    // 驱动可能少给，多余的导入缓冲不使用
+    cam->n_buffers = cam->req.count < buf_count ? cam->req.count : buf_count;
+    if (camera_alloc_arrays(cam) != 0) {
+        camera_close(cam);
+        return -1;
+    }
+    for (unsigned int i = 0; i < cam->n_buffers; i++) {
+        cam->buffers[i] = bufs[i].ptr;
+        cam->buf_lengths[i] = bufs[i].length;
+        cam->dmabuf_fds[i] = bufs[i].fd;
+    }
+    CAM_INFO("====摄像头初始化成功(%s导入, %u个缓冲)====\n\n\n",
+           cam->memory == V4L2_MEMORY_DMABUF ? "DMABUF" : "USERPTR", cam->n_buffers);
+    return 0;
+}
+
+/**
+ * @brief 按当前内存方式将指定缓冲区加入驱动队列
+ */
+static int camera_qbuf(camera_t* cam, unsigned int index) {
+    struct v4l2_buffer buf;
+    struct v4l2_plane planes[1]; // 只赋予一个平面
+    memset(&buf, 0, sizeof(buf));
+    memset(planes, 0, sizeof(planes)); // 清空平面数组
+    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+    buf.memory = cam->memory;
+    buf.index = index;
+    buf.length = 1; // 明确指定平面数量
+    buf.m.planes = planes; // 关联平面信息数组
+    if (cam->memory == V4L2_MEMORY_DMABUF) {
+        planes[0].m.fd = cam->dmabuf_fds[index];
+        planes[0].length = cam->buf_lengths[index];
+    } else if (cam->memory == V4L2_MEMORY_USERPTR) {
+        planes[0].m.userptr = (unsigned long)cam->buffers[index];
+        planes[0].length = cam->buf_lengths[index];
+    }
+    return ioctl(cam->fd, VIDIOC_QBUF, &buf);
+}
+
+/**
+ * @brief 通过 VIDIOC_S_PARM 设置帧间隔，需在 STREAMON 前调用
+ * @param cam 摄像头结构体指针
+ * @param fps 期望帧率
+ * @return 驱动实际采用的帧率；驱动不支持设置帧间隔或设置失败返回0
+ */
+int camera_set_fps(camera_t* cam, int fps) {
+    struct v4l2_streamparm parm;
+    memset(&parm, 0, sizeof(parm));
+    parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+    if (ioctl(cam->fd, VIDIOC_G_PARM, &parm) < 0 ||
+        !(parm.parm.capture.capability & V4L2_CAP_TIMEPERFRAME)) {
+        CAM_INFO("驱动不支持设置帧间隔，改为在DQBUF后抽帧\n");
+        return 0;
+    }
+    parm.parm.capture.timeperframe.numerator = 1;
+    parm.parm.capture.timeperframe.denominator = (uint32_t)fps;
+    if (ioctl(cam->fd, VIDIOC_S_PARM, &parm) < 0) {
+        perror("无法设置帧间隔");
+        return 0;
+    }
+    // 驱动会把帧间隔调整到传感器支持的最近值
+    struct v4l2_fract tpf = parm.parm.capture.timeperframe;
+    if (tpf.numerator == 0 || tpf.denominator == 0) {
+        return 0;
+    }
+    int actual = (int)((tpf.denominator + tpf.numerator / 2) / tpf.numerator);
+    CAM_INFO("帧间隔设置为 %u/%u 秒(%dfps)\n", tpf.numerator, tpf.denominator, actual);
+    return actual;
+}
+
 /**
  * @brief 开始摄像头采集
  * @param cam 摄像头结构体指针
@@ -174,31 +388,25 @@ int camera_init(camera_t* cam, const char* device, int width, int height, uint32
  */
 int camera_start_capture(camera_t* cam) {
     // 将所有缓冲区加入队列
-    printf("准备将缓冲区加入队列...\n");
+    CAM_INFO("准备将缓冲区加入队列...\n");
     for (unsigned int i = 0; i < cam->n_buffers; i++) {
-        struct v4l2_plane planes[1]; // 只赋予一个平面
-        memset(&cam->buf, 0, sizeof(cam->buf));
-        memset(planes, 0, sizeof(planes)); // 清空平面数组
-        cam->buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
-        cam->buf.memory = V4L2_MEMORY_MMAP;
-        cam->buf.index = i;
-        cam->buf.length = 1; // 明确指定平面数量
-        cam->buf.m.planes = planes; // 关联平面信息数组
-        if (ioctl(cam->fd, VIDIOC_QBUF, &cam->buf) < 0) {
+        if (camera_qbuf(cam, i) < 0) {
             perror("无法将缓冲区加入队列");
             return -1;
         }
     }
 
     // 开始采集
-    printf("缓冲区加入队列成功！\n准备开始采集流\n");
+    CAM_INFO("缓冲区加入队列成功！\n准备开始采集流\n");
     enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
     if (ioctl(cam->fd, VIDIOC_STREAMON, &type) < 0) {
         perror("无法开始采集流");
         return -1;
     }
+    cam->n_queued = cam->n_buffers;
+    metrics_gauge_set(METRIC_V4L2_QUEUED, cam->n_buffers);
     
-    printf("====摄像头采集已启动====\n\n\n");
+    CAM_INFO("====摄像头采集已启动====\n\n\n");
     return 0;
 }
 
@@ -224,34 +432,52 @@ void* capture_yuv_frame(camera_t* cam, int timeout_ms) {
     if (ret <= 0) {
         if (ret == 0) {
             printf("采集超时\n");
+            metrics_drop(METRIC_DROP_CAPTURE_TIMEOUT);
         } else {
             perror("select错误");
         }
         return NULL;
     }
     
-    // 从队列中取出缓冲区
-    struct v4l2_plane planes[1];
+    // 从队列中取出缓冲区，平面数组放在 cam 内，requeue 之前一直有效
     memset(&cam->buf, 0, sizeof(cam->buf));
-    memset(planes, 0, sizeof(planes)); // 清空平面数组
+    memset(cam->planes, 0, sizeof(cam->planes)); // 清空平面数组
     cam->buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
-    cam->buf.memory = V4L2_MEMORY_MMAP;
+    cam->buf.memory = cam->memory;
     cam->buf.length = 1; // 关键修正：明确告知驱动我们期望1个平面
-    cam->buf.m.planes = planes; // 关键修正：关联平面信息数组
+    cam->buf.m.planes = cam->planes; // 关键修正：关联平面信息数组
     if (ioctl(cam->fd, VIDIOC_DQBUF, &cam->buf) < 0) {
         perror("无法从队列取出缓冲区");
+        metrics_drop(METRIC_DROP_DQBUF_ERROR);
         return NULL;
     }
+    cam->n_queued--;
+    metrics_gauge_add(METRIC_V4L2_QUEUED, -1);
+    // 记录取出后驱动手里还剩几个缓冲，为0说明驱动已无处可写，下一帧会被丢弃
+    cam->queued_hist[cam->n_queued]++;
+    metrics_queue_depth(cam->n_queued);
+    if (cam->has_sequence && cam->buf.sequence > cam->last_sequence + 1) {
+        uint32_t gap = cam->buf.sequence - cam->last_sequence - 1;
+        cam->seq_gaps += gap;
+        metrics_drop_n(METRIC_DROP_DRIVER_SEQ_GAP, gap);
+    }
+    cam->last_sequence = cam->buf.sequence;
+    cam->has_sequence = 1;
     
     if (cam->buf.index >= cam->n_buffers) {
         printf("错误: 缓冲区索引越界: %d\n", cam->buf.index);
+        metrics_drop(METRIC_DROP_DQBUF_ERROR);
         return NULL;
     }
+    metrics_count(METRIC_FRAMES_CAPTURED, 1);
+    cam->held[cam->buf.index] = 1;
+    cam->trace_frames[cam->buf.index] = trace_current_frame();
+    trace_instant(TRACE_DQBUF, cam->trace_frames[cam->buf.index], cam->buf.sequence);
     
-    printf("捕获到一帧: 缓冲区索引=%d, 大小=%u\n", \
+    CAM_INFO("捕获到一帧: 缓冲区索引=%d, 大小=%u\n", \
             cam->buf.index, cam->buf.m.planes[0].bytesused);
-    printf("===YUV数据采集成功！！===\n\n");
-    return cam->buffers[cam->buf.index][0];
+    CAM_INFO("===YUV数据采集成功！！===\n\n");
+    return cam->buffers[cam->buf.index];
 }
 
 /**
@@ -260,19 +486,244 @@ void* capture_yuv_frame(camera_t* cam, int timeout_ms) {
  * @return 成功返回0，失败返回-1
  */
 int requeue_buffer(camera_t* cam) {
-    if (ioctl(cam->fd, VIDIOC_QBUF, &cam->buf) < 0) {
+    return camera_requeue_index(cam, cam->buf.index);
+}
+
+/**
+ * @brief 按索引将缓冲区重新加入队列(缓冲区被异步持有时使用)
+ * @param cam 摄像头结构体指针
+ * @param index 缓冲区索引
+ * @return 成功返回0，失败返回-1
+ */
+int camera_requeue_index(camera_t* cam, unsigned int index) {
+    if (camera_qbuf(cam, index) < 0) {
         perror("无法重新将缓冲区加入队列");
         return -1;
     }
+    trace_instant(TRACE_QBUF, cam->trace_frames[index], index);
+    cam->held[index] = 0;
+    cam->n_queued++;
+    metrics_gauge_add(METRIC_V4L2_QUEUED, 1);
     return 0;
 }
+
+/**
+ * @brief 丢弃驱动中已就绪的旧帧并立即归还，下一次 capture_yuv_frame 得到的是新帧
+ * @param cam 摄像头结构体指针
+ * @return 丢弃的帧数
+ */
+int camera_flush(camera_t* cam) {
+    int dropped = 0;
+    for (;;) {
+        fd_set fds;
+        struct timeval tv = { 0, 0 };
+        struct v4l2_buffer buf;
+        struct v4l2_plane planes[1];
+        FD_ZERO(&fds);
+        FD_SET(cam->fd, &fds);
+        if (select(cam->fd + 1, &fds, NULL, NULL, &tv) <= 0) {
+            break;
+        }
+        memset(&buf, 0, sizeof(buf));
+        memset(planes, 0, sizeof(planes));
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+        buf.memory = cam->memory;
+        buf.length = 1;
+        buf.m.planes = planes;
+        if (ioctl(cam->fd, VIDIOC_DQBUF, &buf) < 0) {
+            break;
+        }
+        // 主动丢弃的帧序号是连续的，不计入驱动丢帧
+        trace_instant(TRACE_DQBUF, trace_current_frame(), buf.sequence);
+        cam->last_sequence = buf.sequence;
+        cam->has_sequence = 1;
+        if (camera_qbuf(cam, buf.index) < 0) {
+            perror("无法重新将缓冲区加入队列");
+            cam->n_queued--;
+            metrics_gauge_add(METRIC_V4L2_QUEUED, -1);
+            break;
+        }
+        trace_instant(TRACE_QBUF, trace_current_frame(), buf.index);
+        dropped++;
+    }
+    return dropped;
+}
+
+/**
+ * @brief 原地重启采集流：STREAMOFF 后把驱动收回的缓冲重新入队再 STREAMON，
+ *        不重新打开设备，也不重新申请和映射缓冲。应用仍持有的缓冲之后照常 camera_requeue_index
+ * @param cam 摄像头结构体指针
+ * @return 成功返回0，失败返回-1
+ */
+int camera_restart(camera_t* cam) {
+    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+    if (ioctl(cam->fd, VIDIOC_STREAMOFF, &type) < 0) {
+        perror("无法停止采集流");
+        return -1;
+    }
+    // STREAMOFF 后驱动队列为空，包括已写完但未取出的缓冲
+    metrics_gauge_add(METRIC_V4L2_QUEUED, -(int64_t)cam->n_queued);
+    cam->n_queued = 0;
+    for (unsigned int i = 0; i < cam->n_buffers; i++) {
+        if (cam->held[i]) {
+            continue;
+        }
+        if (camera_qbuf(cam, i) < 0) {
+            perror("无法将缓冲区加入队列");
+            return -1;
+        }
+        cam->n_queued++;
+        metrics_gauge_add(METRIC_V4L2_QUEUED, 1);
+    }
+    if (ioctl(cam->fd, VIDIOC_STREAMON, &type) < 0) {
+        perror("无法开始采集流");
+        return -1;
+    }
+    // 重启后驱动帧序号可能从0开始，停顿期间的丢帧另行估算
+    cam->has_sequence = 0;
+    return 0;
+}
+
+/**
+ * @brief 停止采集、释放驱动缓冲并按新尺寸重新设置格式、申请缓冲和开始采集
+ */
+static int camera_reformat(camera_t* cam, int width, int height) {
+    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+    struct v4l2_requestbuffers req;
+    if (ioctl(cam->fd, VIDIOC_STREAMOFF, &type) < 0) {
+        perror("无法停止采集流");
+        return -1;
+    }
+    metrics_gauge_add(METRIC_V4L2_QUEUED, -(int64_t)cam->n_queued);
+    cam->n_queued = 0;
+    // 驱动还持有缓冲时不允许 S_FMT，先全部释放
+    camera_unmap_buffers(cam);
+    memset(&req, 0, sizeof(req));
+    req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+    req.memory = cam->memory;
+    if (ioctl(cam->fd, VIDIOC_REQBUFS, &req) < 0) {
+        perror("无法释放缓冲区");
+        return -1;
+    }
+    if (camera_apply_format(cam, width, height, cam->fmt.fmt.pix_mp.pixelformat) != 0) {
+        return -1;
+    }
+    if (cam->memory != V4L2_MEMORY_MMAP) {
+        for (unsigned int i = 0; i < cam->n_buffers; i++) {
+            if (cam->buf_lengths[i] < cam->buf_size) {
+                printf("错误: 导入缓冲区[%u]长度%u小于新格式要求的%u\n", i, cam->buf_lengths[i], cam->buf_size);
+                return -1;
+            }
+        }
+    }
+    req.count = cam->n_buffers;
+    if (ioctl(cam->fd, VIDIOC_REQBUFS, &req) < 0 || req.count < 2) {
+        perror("无法请求缓冲区");
+        return -1;
+    }
+    // 记录数组按原数量分配，驱动多给的缓冲不使用
+    if (req.count < cam->n_buffers) {
+        cam->n_buffers = req.count;
+    }
+    cam->req = req;
+    if (cam->memory == V4L2_MEMORY_MMAP && camera_map_buffers(cam) != 0) {
+        return -1;
+    }
+    if (camera_start_capture(cam) != 0) {
+        return -1;
+    }
+    cam->has_sequence = 0;
+    return 0;
+}
+
+/**
+ * @brief 采集中切换分辨率。MMAP 方式由驱动按新尺寸重新分配并映射缓冲；
+ *        导入方式沿用调用者的缓冲，新格式的 sizeimage 不能超过缓冲长度。
+ *        调用时应用不能持有任何缓冲；失败时恢复原分辨率
+ * @param cam 摄像头结构体指针
+ * @param width 新宽度
+ * @param height 新高度
+ * @return 成功返回0(实际尺寸以 cam->fmt 为准)，失败返回-1
+ */
+int camera_set_format(camera_t* cam, int width, int height) {
+    int old_width = (int)cam->fmt.fmt.pix_mp.width;
+    int old_height = (int)cam->fmt.fmt.pix_mp.height;
+    for (unsigned int i = 0; i < cam->n_buffers; i++) {
+        if (cam->held[i]) {
+            printf("错误: 缓冲区[%u]尚未归还，不能切换分辨率\n", i);
+            return -1;
+        }
+    }
+    if (camera_reformat(cam, width, height) == 0) {
+        return 0;
+    }
+    printf("   切换到%dx%d失败，恢复%dx%d\n", width, height, old_width, old_height);
+    if (camera_reformat(cam, old_width, old_height) != 0) {
+        printf("   无法恢复原分辨率，采集已停止\n");
+    }
+    return -1;
+}
+
+/**
+ * @brief 打印 DQBUF 时驱动队列深度分布，用于按数据确定缓冲区数量
+ * @param cam 摄像头结构体指针
+ */
+void camera_report(const camera_t* cam) {
+    uint64_t total = 0;
+    if (!cam->queued_hist) {
+        return;
+    }
+    for (unsigned int i = 0; i <= cam->n_buffers; i++) {
+        total += cam->queued_hist[i];
+    }
+    printf("   ===采集队列深度统计(DQBUF后驱动剩余缓冲数)===\n");
+    for (unsigned int i = 0; i <= cam->n_buffers; i++) {
+        if (cam->queued_hist[i]) {
+            printf("   剩余%2u个: %llu次 (%.1f%%)\n", i, (unsigned long long)cam->queued_hist[i],
+                   total ? 100.0 * cam->queued_hist[i] / total : 0.0);
+        }
+    }
+    printf("   驱动帧序号跳变丢帧: %llu\n", (unsigned long long)cam->seq_gaps);
+    if (cam->queued_hist[0]) {
+        printf("   ⚠️  出现过驱动队列为空，建议增加缓冲区数量(当前%u)\n", cam->n_buffers);
+    }
+}
+
+/**
+ * @brief 停止采集、解除映射并关闭设备
+ * @param cam 摄像头结构体指针
+ */
+void camera_close(camera_t* cam) {
+    if (cam->fd >= 0) {
+        enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+        ioctl(cam->fd, VIDIOC_STREAMOFF, &type);
+    }
+    // 导入模式的缓冲区属于调用者，这里只解除 MMAP 映射
+    camera_unmap_buffers(cam);
+    free(cam->buffers);
+    free(cam->buf_lengths);
+    free(cam->dmabuf_fds);
+    cam->dmabuf_fds = NULL;
+    free(cam->queued_hist);
+    free(cam->trace_frames);
+    cam->trace_frames = NULL;
+    free(cam->held);
+    cam->held = NULL;
+    cam->buffers = NULL;
+    cam->buf_lengths = NULL;
+    cam->queued_hist = NULL;
+    if (cam->fd >= 0) {
+        close(cam->fd);
+        cam->fd = -1;
+    }
+}
 /**
  * @brief 将数据写入文件
  * @param cam 摄像头结构体指针
  * @return 成功返回0，失败返回-1
  */
 int write_data_to_file(const char* filename, const void* data, size_t size) {
-    printf("   正在将JPEG格式写入文件...\n");
+    CAM_INFO("   正在将JPEG格式写入文件...\n");
     
     // 1. 检查输入参数
     if (!filename || !data || size == 0) {
@@ -282,11 +733,11 @@ int write_data_to_file(const char* filename, const void* data, size_t size) {
     }
     
     // 2. 检查数据有效性
-    printf("     检查数据有效性...\n");
+    CAM_INFO("     检查数据有效性...\n");
     if (size >= 2) {
         unsigned char* jpeg_data = (unsigned char*)data;
         if (jpeg_data[0] == 0xFF && jpeg_data[1] == 0xD8) {
-            printf("     ✅ 有效的JPEG文件头 (FF D8)\n");
+            CAM_INFO("     ✅ 有效的JPEG文件头 (FF D8)\n");
         } else {
             printf("     ❌ 无效的JPEG文件头: %02X %02X\n", jpeg_data[0], jpeg_data[1]);
             printf("     可能不是有效的JPEG数据\n");
@@ -294,17 +745,17 @@ int write_data_to_file(const char* filename, const void* data, size_t size) {
     }
     
     // 3. 打开文件 
-    printf("     打开文件: %s\n", filename);
+    CAM_INFO("     打开文件: %s\n", filename);
     FILE* file = fopen(filename, "wb");  // "wb" = 二进制写模式
     if (!file) {
         printf("     ❌ 无法创建文件: %s (errno: %d - %s)\n", 
                filename, errno, strerror(errno));
         return -1;
     }
-    printf("     ✅ 文件打开成功\n");
+    CAM_INFO("     ✅ 文件打开成功\n");
     
     // 4. 写入数据 (使用fwrite代替write)
-    printf("     准备写入: %zu 字节\n", size);
+    CAM_INFO("     准备写入: %zu 字节\n", size);
     size_t bytes_written = fwrite(data, 1, size, file);
     
     // 5. 检查写入结果
@@ -319,13 +770,13 @@ int write_data_to_file(const char* filename, const void* data, size_t size) {
         return -1;
     }
     
-    printf("     ✅ 数据写入成功: %zu 字节\n", bytes_written);
+    CAM_INFO("     ✅ 数据写入成功: %zu 字节\n", bytes_written);
     
     // 6. 刷新缓冲区确保数据写入磁盘
     if (fflush(file) != 0) {
         printf("     ⚠️  缓冲区刷新警告: %s\n", strerror(errno));
     } else {
-        printf("     ✅ 缓冲区刷新成功\n");
+        CAM_INFO("     ✅ 缓冲区刷新成功\n");
     }
     
     // 7. 关闭文件 (使用fclose代替close)
@@ -334,7 +785,7 @@ int write_data_to_file(const char* filename, const void* data, size_t size) {
         return -1;
     }
     
-    printf("     ✅ 文件关闭成功\n");
+    CAM_INFO("     ✅ 文件关闭成功\n");
     
     // 8. 验证文件实际大小
     FILE* verify_file = fopen(filename, "rb");
@@ -343,13 +794,13 @@ int write_data_to_file(const char* filename, const void* data, size_t size) {
         long file_size = ftell(verify_file);
         fclose(verify_file);
         
-        printf("     ✅ 文件验证成功: 实际大小 %ld 字节\n", file_size);
+        CAM_INFO("     ✅ 文件验证成功: 实际大小 %ld 字节\n", file_size);
         if (file_size != size) {
             printf("     ⚠️  大小不匹配: 期望 %zu, 实际 %ld\n", size, file_size);
             return -1;
         }
     }
     
-    printf("     ✅ 文件保存完成: %s\n", filename);
+    CAM_INFO("     ✅ 文件保存完成: %s\n", filename);
     return 0;
 }
@@ -0,0 +1,216 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "control.h"
+
+typedef enum {
+    MAILBOX_EMPTY = 0,
+    MAILBOX_PENDING,                // 等待流水线取走
+    MAILBOX_TAKEN,                  // 流水线正在执行
+    MAILBOX_DONE,
+} mailbox_state_t;
+
+static struct {
+    pthread_t thread;
+    _Atomic int running;
+    int listen_fd;
+    char path[108];
+    // 单槽邮箱，控制线程放入，流水线线程取出执行
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    _Atomic int pending;            // 流水线每帧只读这一个标志
+    mailbox_state_t state;
+    control_cmd_t cmd;
+    char reply[CONTROL_REPLY_MAX];
+} ctl = { .listen_fd = -1 };
+
+int control_parse(const char* line, control_cmd_t* cmd) {
+    char arg[64];
+    char tail;
+    memset(cmd, 0, sizeof(*cmd));
+    if (strcmp(line, "status") == 0) {
+        cmd->op = CONTROL_STATUS;
+        return 0;
+    }
+    if (sscanf(line, "quality %d%c", &cmd->quality, &tail) == 1) {
+        cmd->op = CONTROL_QUALITY;
+        return cmd->quality >= 1 && cmd->quality <= 99 ? 0 : -1;
+    }
+    if (sscanf(line, "crop %63s%c", arg, &tail) == 1) {
+        cmd->op = CONTROL_CROP;
+        if (strcmp(arg, "off") == 0) {
+            return 0;
+        }
+        cmd->has_crop = 1;
+        return roi_parse(arg, &cmd->crop);
+    }
+    if (sscanf(line, "size %dx%d%c", &cmd->width, &cmd->height, &tail) == 2) {
+        cmd->op = CONTROL_SIZE;
+        // NV12 色度 2x2 采样，尺寸必须为偶数
+        return cmd->width >= 16 && cmd->height >= 16 && !(cmd->width & 1) && !(cmd->height & 1) ? 0 : -1;
+    }
+    return -1;
+}
+
+/**
+ * @brief 把命令交给流水线并等待结果；超时未被取走时撤回
+ */
+static void control_submit(const control_cmd_t* cmd, char* reply, size_t cap) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += CONTROL_TIMEOUT_MS / 1000;
+    deadline.tv_nsec += (long)(CONTROL_TIMEOUT_MS % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    pthread_mutex_lock(&ctl.lock);
+    ctl.cmd = *cmd;
+    ctl.state = MAILBOX_PENDING;
+    atomic_store_explicit(&ctl.pending, 1, memory_order_release);
+    int rc = 0;
+    while (ctl.state == MAILBOX_PENDING && rc != ETIMEDOUT) {
+        rc = pthread_cond_timedwait(&ctl.cond, &ctl.lock, &deadline);
+    }
+    if (ctl.state == MAILBOX_PENDING) {
+        atomic_store_explicit(&ctl.pending, 0, memory_order_relaxed);
+        snprintf(reply, cap, "error 流水线%dms内未响应", CONTROL_TIMEOUT_MS);
+    } else {
+        // 已被取走，等执行完成(切换分辨率可能要几十毫秒)
+        while (ctl.state != MAILBOX_DONE) {
+            pthread_cond_wait(&ctl.cond, &ctl.lock);
+        }
+        snprintf(reply, cap, "%s", ctl.reply);
+    }
+    ctl.state = MAILBOX_EMPTY;
+    pthread_mutex_unlock(&ctl.lock);
+}
+
+static void control_serve_client(int cfd) {
+    char line[128];
+    char reply[CONTROL_REPLY_MAX + 1];
+    control_cmd_t cmd;
+    // 客户端迟迟不发命令时不能卡住控制线程
+    struct timeval tv = { 1, 0 };
+    setsockopt(cfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    ssize_t n = recv(cfd, line, sizeof(line) - 1, 0);
+    line[n > 0 ? n : 0] = '\0';
+    line[strcspn(line, "\r\n")] = '\0';
+    if (control_parse(line, &cmd) != 0) {
+        snprintf(reply, CONTROL_REPLY_MAX, "error 无法识别的命令: %s", line);
+    } else {
+        control_submit(&cmd, reply, CONTROL_REPLY_MAX);
+    }
+    printf("   控制命令: %s -> %s\n", line, reply);
+    strcat(reply, "\n");
+    send(cfd, reply, strlen(reply), MSG_NOSIGNAL);
+}
+
+static void* control_thread(void* arg) {
+    (void)arg;
+    pthread_setname_np(pthread_self(), "mipi_control");
+    while (atomic_load(&ctl.running)) {
+        // 限制单次等待时长，保证 control_stop 能及时退出
+        struct pollfd pfd = { .fd = ctl.listen_fd, .events = POLLIN };
+        if (poll(&pfd, 1, 200) <= 0 || !(pfd.revents & POLLIN)) {
+            continue;
+        }
+        int cfd = accept4(ctl.listen_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (cfd < 0) {
+            continue;
+        }
+        control_serve_client(cfd);
+        close(cfd);
+    }
+    return NULL;
+}
+
+int control_start(const char* path) {
+    struct sockaddr_un addr;
+    pthread_condattr_t attr;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        printf("   控制套接字路径过长: %s\n", path);
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (fd < 0) {
+        perror("无法创建控制套接字");
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    unlink(path);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, 4) < 0) {
+        perror("无法监听控制套接字");
+        close(fd);
+        return -1;
+    }
+    pthread_mutex_init(&ctl.lock, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&ctl.cond, &attr);
+    pthread_condattr_destroy(&attr);
+    ctl.listen_fd = fd;
+    snprintf(ctl.path, sizeof(ctl.path), "%s", path);
+    atomic_store(&ctl.running, 1);
+    if (pthread_create(&ctl.thread, NULL, control_thread, NULL) != 0) {
+        printf("   控制线程创建失败\n");
+        atomic_store(&ctl.running, 0);
+        close(fd);
+        ctl.listen_fd = -1;
+        unlink(path);
+        return -1;
+    }
+    printf("   控制套接字就绪: %s\n", path);
+    return 0;
+}
+
+int control_poll(control_apply_fn apply, void* arg) {
+    char reply[CONTROL_REPLY_MAX];
+    control_cmd_t cmd;
+    if (!atomic_load_explicit(&ctl.pending, memory_order_acquire)) {
+        return 0;
+    }
+    pthread_mutex_lock(&ctl.lock);
+    if (ctl.state != MAILBOX_PENDING) {
+        pthread_mutex_unlock(&ctl.lock);
+        return 0;
+    }
+    cmd = ctl.cmd;
+    ctl.state = MAILBOX_TAKEN;
+    atomic_store_explicit(&ctl.pending, 0, memory_order_relaxed);
+    pthread_mutex_unlock(&ctl.lock);
+
+    apply(arg, &cmd, reply, sizeof(reply));
+
+    pthread_mutex_lock(&ctl.lock);
+    memcpy(ctl.reply, reply, sizeof(reply));
+    ctl.state = MAILBOX_DONE;
+    pthread_cond_broadcast(&ctl.cond);
+    pthread_mutex_unlock(&ctl.lock);
+    return 1;
+}
+
+void control_stop(void) {
+    if (!atomic_load(&ctl.running)) {
+        return;
+    }
+    atomic_store(&ctl.running, 0);
+    pthread_join(ctl.thread, NULL);
+    close(ctl.listen_fd);
+    ctl.listen_fd = -1;
+    unlink(ctl.path);
+    pthread_cond_destroy(&ctl.cond);
+    pthread_mutex_destroy(&ctl.lock);
+}
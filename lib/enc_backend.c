@@ -0,0 +1,230 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "enc_backend.h"
+#include "sw_jpeg.h"
+#include "mem_arena.h"
+
+#ifndef MIPI_WITH_MPP
+#define MIPI_WITH_MPP 1
+#endif
+
+#if MIPI_WITH_MPP
+#include "mpp_encoder.h"
+#endif
+
+/* ---------- 软件后端 ---------- */
+
+typedef struct {
+    sw_jpeg_t jpeg;
+    uint8_t* out;
+    size_t capacity;
+    roi_rect_t crop;                // 编码区域，默认整帧
+    roi_rect_t zone;                // 质量分区(整帧坐标)
+    int bg_quality;                 // 0 表示没有分区
+} sw_backend_t;
+
+static int sw_open(enc_backend_t* b) {
+    sw_backend_t* s = calloc(1, sizeof(*s));
+    if (!s) {
+        return -1;
+    }
+    if (sw_jpeg_init(&s->jpeg, b->width, b->height, b->quality) != 0) {
+        free(s);
+        return -1;
+    }
+    s->crop.width = b->width;
+    s->crop.height = b->height;
+    // 按最坏情况分配，高质量编码噪声较多的画面时输出可以超过原始数据
+    s->capacity = sw_jpeg_max_size(b->width, b->height);
+    // 按 mem_set_huge 的设置可落在大页上
+    s->out = mem_map_default(s->capacity);
+    if (!s->out) {
+        free(s);
+        return -1;
+    }
+    b->priv = s;
+    return 0;
+}
+
+static const uint8_t* sw_encode(enc_backend_t* b, const uint8_t* nv12, size_t* length) {
+    sw_backend_t* s = b->priv;
+    // 裁剪只是移动起点，行跨度仍是整帧宽度
+    const uint8_t* y = nv12 + (size_t)s->crop.y * b->width + s->crop.x;
+    const uint8_t* uv = nv12 + (size_t)b->width * b->height + (size_t)(s->crop.y / 2) * b->width + s->crop.x;
+    *length = sw_jpeg_encode_nv12_bands(&s->jpeg, y, b->width, uv, b->width, s->out, s->capacity,
+                                        b->band_rows, b->chunk_fn, b->chunk_arg);
+    return *length ? s->out : NULL;
+}
+
+/**
+ * @brief 按当前裁剪重建编码器，分区坐标换算到裁剪后的图像
+ */
+static int sw_apply(sw_backend_t* s, int quality) {
+    if (sw_jpeg_init(&s->jpeg, s->crop.width, s->crop.height, quality) != 0) {
+        return -1;
+    }
+    if (s->bg_quality) {
+        roi_rect_t z = s->zone;
+        z.x -= s->crop.x;
+        z.y -= s->crop.y;
+        return sw_jpeg_set_zone(&s->jpeg, &z, s->bg_quality);
+    }
+    return 0;
+}
+
+static int sw_set_crop(enc_backend_t* b, const roi_rect_t* crop) {
+    sw_backend_t* s = b->priv;
+    roi_rect_t r = { 0, 0, b->width, b->height };
+    if (crop) {
+        r = *crop;
+        if (roi_clip(&r, b->width, b->height) != 0) {
+            return -1;
+        }
+    }
+    s->crop = r;
+    return sw_apply(s, b->quality);
+}
+
+static int sw_set_zone(enc_backend_t* b, const roi_rect_t* zone, int bg_quality) {
+    sw_backend_t* s = b->priv;
+    if (zone) {
+        s->zone = *zone;
+    }
+    s->bg_quality = zone ? bg_quality : 0;
+    return sw_apply(s, b->quality);
+}
+
+static void sw_close(enc_backend_t* b) {
+    sw_backend_t* s = b->priv;
+    if (s) {
+        mem_unmap_default(s->out, s->capacity);
+        free(s);
+        b->priv = NULL;
+    }
+}
+
+static const enc_backend_ops_t sw_ops = { "sw", sw_open, sw_encode, sw_close, sw_set_crop, sw_set_zone };
+
+#if MIPI_WITH_MPP
+/* ---------- MPP 后端：与主程序相同的 mpp_encoder 路径 ---------- */
+
+typedef struct {
+    mpp_encoder_t enc;
+    MppBufferGroup out_group;
+    MppBuffer out;
+} mpp_backend_t;
+
+static void mpp_close(enc_backend_t* b) {
+    mpp_backend_t* m = b->priv;
+    if (!m) {
+        return;
+    }
+    if (m->out) {
+        mpp_buffer_put(m->out);
+    }
+    if (m->out_group) {
+        mpp_buffer_group_put(m->out_group);
+    }
+    mpp_encoder_deinit(&m->enc);
+    free(m);
+    b->priv = NULL;
+}
+
+static int mpp_open(enc_backend_t* b) {
+    mpp_backend_t* m = calloc(1, sizeof(*m));
+    if (!m) {
+        return -1;
+    }
+    b->priv = m;
+    if (mpp_encoder_init(&m->enc, b->width, b->height, b->quality, NULL) != 0) {
+        mpp_close(b);
+        return -1;
+    }
+    if (mpp_buffer_group_get_internal(&m->out_group, MPP_BUFFER_TYPE_ION) != MPP_OK ||
+        mpp_buffer_get(m->out_group, &m->out, m->enc.frame_size) != MPP_OK) {
+        printf("   MPP输出缓冲分配失败\n");
+        mpp_close(b);
+        return -1;
+    }
+    return 0;
+}
+
+static const uint8_t* mpp_encode(enc_backend_t* b, const uint8_t* nv12, size_t* length) {
+    mpp_backend_t* m = b->priv;
+    mpp_encoder_load_frame(&m->enc, nv12, (size_t)b->width * b->height * 3 / 2);
+    if (mpp_encoder_encode(&m->enc, m->out, 0, length) != MPP_OK || *length == 0) {
+        return NULL;
+    }
+    const uint8_t* data = mpp_buffer_get_ptr(m->out);
+    if (b->chunk_fn) {
+        b->chunk_fn(b->chunk_arg, data, *length, 1);
+    }
+    return data;
+}
+
+static int mpp_set_crop(enc_backend_t* b, const roi_rect_t* crop) {
+    mpp_backend_t* m = b->priv;
+    return mpp_encoder_set_crop(&m->enc, crop);
+}
+
+static const enc_backend_ops_t mpp_ops = { "mpp", mpp_open, mpp_encode, mpp_close, mpp_set_crop, NULL };
+#endif
+
+static const enc_backend_ops_t* const backends[] = {
+    &sw_ops,
+#if MIPI_WITH_MPP
+    &mpp_ops,
+#endif
+};
+
+int enc_backend_open(enc_backend_t* b, const char* name, int width, int height, int quality) {
+    memset(b, 0, sizeof(*b));
+    for (size_t i = 0; i < sizeof(backends) / sizeof(backends[0]); i++) {
+        if (strcmp(backends[i]->name, name) == 0) {
+            b->ops = backends[i];
+        }
+    }
+    if (!b->ops) {
+        printf("   未知的编码后端: %s(可用: %s)\n", name, enc_backend_names());
+        return -1;
+    }
+    b->width = width;
+    b->height = height;
+    b->quality = quality;
+    return b->ops->open(b);
+}
+
+int enc_backend_set_crop(enc_backend_t* b, const roi_rect_t* crop) {
+    return b->ops->set_crop(b, crop);
+}
+
+int enc_backend_set_zone(enc_backend_t* b, const roi_rect_t* zone, int bg_quality) {
+    if (!b->ops->set_zone) {
+        printf("   编码后端%s不支持质量分区\n", b->ops->name);
+        return -1;
+    }
+    return b->ops->set_zone(b, zone, bg_quality);
+}
+
+void enc_backend_set_stream(enc_backend_t* b, enc_chunk_fn fn, void* arg, int band_rows) {
+    b->chunk_fn = fn;
+    b->chunk_arg = arg;
+    b->band_rows = band_rows;
+}
+
+void enc_backend_close(enc_backend_t* b) {
+    if (b->ops) {
+        b->ops->close(b);
+        b->ops = NULL;
+    }
+}
+
+const char* enc_backend_names(void) {
+#if MIPI_WITH_MPP
+    return "sw mpp";
+#else
+    return "sw";
+#endif
+}
@@ -0,0 +1,58 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include "enc_packet.h"
+#include "metrics.h"
+
+static void enc_packet_free(enc_packet_t* pkt) {
+    free(pkt);
+}
+
+static void enc_packet_pool_release(enc_packet_t* pkt) {
+    mem_pool_put(pkt->opaque, pkt);
+}
+
+static void enc_packet_fill(enc_packet_t* pkt, const void* data, size_t length) {
+    atomic_init(&pkt->refs, 1);
+    pkt->data = pkt + 1;
+    pkt->length = length;
+    pkt->seq = 0;
+    pkt->timestamp_us = 0;
+    pkt->flags = 0;
+    pkt->stats.valid = 0;
+    memcpy(pkt->data, data, length);
+}
+
+/**
+ * @brief 分配一个堆内存包并拷贝数据，数据紧跟在结构体之后
+ */
+enc_packet_t* enc_packet_alloc_copy(const void* data, size_t length) {
+    enc_packet_t* pkt = malloc(sizeof(*pkt) + length);
+    if (!pkt) {
+        return NULL;
+    }
+    metrics_count(METRIC_HEAP_ALLOCS, 1);
+    enc_packet_fill(pkt, data, length);
+    pkt->release = enc_packet_free;
+    pkt->opaque = NULL;
+    return pkt;
+}
+
+int enc_packet_pool_init(mem_pool_t* pool, size_t max_length, uint32_t count, int huge) {
+    return mem_pool_init(pool, sizeof(enc_packet_t) + max_length, count, huge);
+}
+
+enc_packet_t* enc_packet_alloc_pool(mem_pool_t* pool, const void* data, size_t length) {
+    enc_packet_t* pkt = NULL;
+    // 超长的包(如大码率下的 IDR)不占池对象，个别退回堆分配
+    if (sizeof(*pkt) + length <= pool->obj_size) {
+        pkt = mem_pool_get(pool);
+    }
+    if (!pkt) {
+        return enc_packet_alloc_copy(data, length);
+    }
+    enc_packet_fill(pkt, data, length);
+    pkt->release = enc_packet_pool_release;
+    pkt->opaque = pool;
+    return pkt;
+}
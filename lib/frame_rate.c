@@ -0,0 +1,149 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "frame_rate.h"
+#include "metrics.h"
+
+#define FRAME_RATE_WINDOW_US    1000000
+#define FRAME_RATE_HIGH_LOAD    0.75f   // 窗口平均负载超过该值时降速
+#define FRAME_RATE_RAISE_LOAD   0.6f    // 升速后的预计负载低于该值才升速
+#define FRAME_RATE_CALM_WINDOWS 3       // 连续多少个低负载窗口后升速
+
+int frame_rate_parse(const char* spec, frame_rate_t* fr) {
+    char* end;
+    memset(fr, 0, sizeof(*fr));
+    long fps = strtol(spec, &end, 10);
+    if (end == spec || fps < 1 || fps > 1000) {
+        return -1;
+    }
+    fr->target_fps = (int)fps;
+    fr->min_fps = 1;
+    if (strncmp(end, ":auto", 5) == 0) {
+        fr->adaptive = 1;
+        end += 5;
+        if (*end == ':') {
+            const char* p = end + 1;
+            long min = strtol(p, &end, 10);
+            if (end == p || min < 1 || min > fps) {
+                return -1;
+            }
+            fr->min_fps = (int)min;
+        }
+    }
+    return *end == '\0' ? 0 : -1;
+}
+
+void frame_rate_start(frame_rate_t* fr, int sensor_fps) {
+    fr->sensor_fps = sensor_fps;
+    fr->fps = fr->target_fps;
+    fr->next_us = 0;
+    fr->last_ts_us = 0;
+    fr->period_us = 0;
+    fr->window_start_us = 0;
+    fr->window_load = 0;
+    fr->window_frames = 0;
+    fr->calm_windows = 0;
+    metrics_gauge_set(METRIC_OUTPUT_FPS, fr->fps);
+}
+
+int frame_rate_keep(frame_rate_t* fr, uint64_t ts_us) {
+    if (fr->last_ts_us && ts_us > fr->last_ts_us) {
+        uint64_t delta = ts_us - fr->last_ts_us;
+        // 停顿或重启采集流造成的长间隔不计入平均
+        if (!fr->period_us) {
+            fr->period_us = delta;
+        } else if (delta < fr->period_us * 4) {
+            fr->period_us = (fr->period_us * 7 + delta) / 8;
+        }
+    }
+    fr->last_ts_us = ts_us;
+    if (fr->fps <= 0 || (fr->sensor_fps > 0 && fr->fps >= fr->sensor_fps)) {
+        // 传感器已经按目标帧率输出
+        fr->kept++;
+        return 1;
+    }
+    // 允许提前半个驱动帧间隔，时间戳抖动不会让本该保留的帧落到下一帧
+    uint64_t interval = 1000000 / (uint64_t)fr->fps;
+    if (ts_us + fr->period_us / 2 < fr->next_us) {
+        fr->decimated++;
+        metrics_count(METRIC_FRAMES_DECIMATED, 1);
+        return 0;
+    }
+    // 落后超过一个间隔(首帧、停顿或帧率刚调高)时重新对齐，不补帧
+    fr->next_us = fr->next_us + interval <= ts_us ? ts_us + interval : fr->next_us + interval;
+    fr->kept++;
+    return 1;
+}
+
+void frame_rate_load(frame_rate_t* fr, uint64_t now_us, float load) {
+    if (!fr->adaptive) {
+        return;
+    }
+    if (fr->window_start_us == 0) {
+        fr->window_start_us = now_us;
+    }
+    fr->window_load += load;
+    fr->window_frames++;
+    if (now_us - fr->window_start_us < FRAME_RATE_WINDOW_US) {
+        return;
+    }
+    float avg = fr->window_load / fr->window_frames;
+    int old = fr->fps;
+    if (avg >= FRAME_RATE_HIGH_LOAD) {
+        // 乘性降速，积压能在几个窗口内消化
+        fr->fps = fr->fps * 3 / 4;
+        if (fr->fps == old) {
+            fr->fps--;
+        }
+        if (fr->fps < fr->min_fps) {
+            fr->fps = fr->min_fps;
+        }
+        fr->calm_windows = 0;
+    } else if (fr->fps < fr->target_fps) {
+        // 加性升速，负载与帧率成正比，按升速后的预计负载判断
+        int step = fr->target_fps / 10 > 1 ? fr->target_fps / 10 : 1;
+        int next = fr->fps + step > fr->target_fps ? fr->target_fps : fr->fps + step;
+        if (avg * next / fr->fps < FRAME_RATE_RAISE_LOAD) {
+            if (++fr->calm_windows >= FRAME_RATE_CALM_WINDOWS) {
+                fr->fps = next;
+                fr->calm_windows = 0;
+            }
+        } else {
+            fr->calm_windows = 0;
+        }
+    }
+    fr->window_start_us = now_us;
+    fr->window_load = 0;
+    fr->window_frames = 0;
+    if (fr->fps != old) {
+        fr->changes++;
+        metrics_gauge_set(METRIC_OUTPUT_FPS, fr->fps);
+        printf("   帧率自适应: %d -> %d fps(窗口平均负载%.0f%%)\n", old, fr->fps, avg * 100);
+    }
+}
+
+uint64_t frame_rate_interval_us(const frame_rate_t* fr) {
+    if (fr->fps > 0 && (fr->sensor_fps <= 0 || fr->fps < fr->sensor_fps)) {
+        return 1000000 / (uint64_t)fr->fps;
+    }
+    if (fr->sensor_fps > 0) {
+        return 1000000 / (uint64_t)fr->sensor_fps;
+    }
+    return fr->period_us;
+}
+
+void frame_rate_report(const frame_rate_t* fr) {
+    if (fr->target_fps <= 0) {
+        return;
+    }
+    printf("   帧率控制: 目标%dfps, 驱动%s", fr->target_fps, fr->sensor_fps > 0 ? "" : "不支持设置帧间隔");
+    if (fr->sensor_fps > 0) {
+        printf("%dfps", fr->sensor_fps);
+    }
+    printf(", 保留%llu帧, 抽掉%llu帧", (unsigned long long)fr->kept, (unsigned long long)fr->decimated);
+    if (fr->adaptive) {
+        printf(", 自适应调整%llu次, 当前%dfps", (unsigned long long)fr->changes, fr->fps);
+    }
+    printf("\n");
+}
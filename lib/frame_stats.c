@@ -0,0 +1,155 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include "frame_stats.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define FRAME_STATS_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define FRAME_STATS_SSE2 1
+#endif
+
+// NEON 16位累加器每块最多加 1020，满这么多块就并入32位累加器
+#define FRAME_STATS_FLUSH_BLOCKS    64
+
+typedef struct {
+    uint64_t sum;                   // 亮度和
+    uint64_t grad;                  // 水平与垂直相邻差绝对值之和
+} row_acc_t;
+
+/**
+ * @brief 处理一行 Y：拷贝(dst 非 NULL 时)并累加亮度和梯度
+ * @param up 上一行，第一行传本行(垂直差为0)
+ * @return 向量部分处理到的列，其余由调用者按标量处理
+ */
+static int row_simd(uint8_t* dst, const uint8_t* row, const uint8_t* up, int width, row_acc_t* acc) {
+    int x = 0;
+#if defined(FRAME_STATS_NEON)
+    uint32x4_t sum32 = vdupq_n_u32(0);
+    uint32x4_t grad32 = vdupq_n_u32(0);
+    // 读 row + x + 1 的16字节，要求 x + 16 < width，不越过本行
+    while (x + 16 < width) {
+        uint16x8_t sum16 = vdupq_n_u16(0);
+        uint16x8_t grad16 = vdupq_n_u16(0);
+        for (int n = 0; n < FRAME_STATS_FLUSH_BLOCKS && x + 16 < width; n++, x += 16) {
+            uint8x16_t v = vld1q_u8(row + x);
+            if (dst) {
+                vst1q_u8(dst + x, v);
+            }
+            sum16 = vpadalq_u8(sum16, v);
+            grad16 = vpadalq_u8(grad16, vabdq_u8(v, vld1q_u8(row + x + 1)));
+            grad16 = vpadalq_u8(grad16, vabdq_u8(v, vld1q_u8(up + x)));
+        }
+        sum32 = vpadalq_u16(sum32, sum16);
+        grad32 = vpadalq_u16(grad32, grad16);
+    }
+    uint64x2_t s = vpaddlq_u32(sum32);
+    uint64x2_t g = vpaddlq_u32(grad32);
+    acc->sum += vgetq_lane_u64(s, 0) + vgetq_lane_u64(s, 1);
+    acc->grad += vgetq_lane_u64(g, 0) + vgetq_lane_u64(g, 1);
+#elif defined(FRAME_STATS_SSE2)
+    // psadbw 直接给出16字节绝对差之和，64位累加不会溢出
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sum = zero;
+    __m128i grad = zero;
+    for (; x + 16 < width; x += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(row + x));
+        if (dst) {
+            _mm_storeu_si128((__m128i*)(dst + x), v);
+        }
+        sum = _mm_add_epi64(sum, _mm_sad_epu8(v, zero));
+        grad = _mm_add_epi64(grad, _mm_sad_epu8(v, _mm_loadu_si128((const __m128i*)(row + x + 1))));
+        grad = _mm_add_epi64(grad, _mm_sad_epu8(v, _mm_loadu_si128((const __m128i*)(up + x))));
+    }
+    uint64_t lanes[4];
+    _mm_storeu_si128((__m128i*)lanes, sum);
+    _mm_storeu_si128((__m128i*)(lanes + 2), grad);
+    acc->sum += lanes[0] + lanes[1];
+    acc->grad += lanes[2] + lanes[3];
+#else
+    (void)dst;
+    (void)row;
+    (void)up;
+    (void)width;
+    (void)acc;
+#endif
+    return x;
+}
+
+/**
+ * @brief 统计(并拷贝) Y 平面的前 rows 行
+ */
+static void stats_plane(uint8_t* dst, const uint8_t* src, int width, int rows, frame_stats_t* st) {
+    row_acc_t acc = { 0, 0 };
+    memset(st, 0, sizeof(*st));
+    for (int y = 0; y < rows; y++) {
+        const uint8_t* row = src + (size_t)y * width;
+        const uint8_t* up = y > 0 ? row - width : row;
+        uint8_t* out = dst ? dst + (size_t)y * width : NULL;
+        int x = row_simd(out, row, up, width, &acc);
+        for (; x < width; x++) {
+            if (out) {
+                out[x] = row[x];
+            }
+            acc.sum += row[x];
+            acc.grad += (uint64_t)abs(row[x] - up[x]);
+            if (x + 1 < width) {
+                acc.grad += (uint64_t)abs(row[x] - row[x + 1]);
+            }
+        }
+        if (y % FRAME_STATS_HIST_ROWS == 0) {
+            // 刚读过的行还在 L1 里
+            for (x = 0; x < width; x += 2) {
+                st->hist[row[x] >> 3]++;
+            }
+            st->samples += (uint32_t)((width + 1) / 2);
+        }
+    }
+    if (rows > 0 && width > 0) {
+        uint64_t pairs = (uint64_t)(width - 1) * rows + (uint64_t)width * (rows - 1);
+        st->luma_mean = (float)acc.sum / ((float)width * rows);
+        st->sharpness = pairs ? (float)acc.grad / (float)pairs : 0.0f;
+    }
+    st->valid = 1;
+}
+
+void frame_stats_copy(void* dst, const void* src, int width, int height, size_t length, frame_stats_t* st) {
+    size_t luma_size = (size_t)width * height;
+    int rows = height;
+    if (length < luma_size) {
+        rows = (int)(length / (size_t)width);
+    }
+    size_t done = (size_t)rows * width;
+    stats_plane(dst, src, width, rows, st);
+    // UV 平面和不完整的行直接拷贝
+    if (length > done) {
+        memcpy((uint8_t*)dst + done, (const uint8_t*)src + done, length - done);
+    }
+}
+
+void frame_stats_scan(const void* src, int width, int height, frame_stats_t* st) {
+    stats_plane(NULL, src, width, height, st);
+}
+
+float frame_stats_fraction_above(const frame_stats_t* st, int level) {
+    uint32_t n = 0;
+    if (!st->samples) {
+        return 0.0f;
+    }
+    for (int i = level > 0 ? level >> 3 : 0; i < FRAME_STATS_BINS; i++) {
+        n += st->hist[i];
+    }
+    return (float)n / st->samples;
+}
+
+const char* frame_stats_impl(void) {
+#if defined(FRAME_STATS_NEON)
+    return "neon";
+#elif defined(FRAME_STATS_SSE2)
+    return "sse2";
+#else
+    return "c";
+#endif
+}
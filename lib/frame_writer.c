@@ -0,0 +1,92 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include "camera_init.h"
+#include "frame_writer.h"
+#include "metrics.h"
+#include "trace.h"
+
+static void frame_writer_write(frame_writer_t* w, enc_packet_t* pkt) {
+    metrics_rusage_mark_t mark;
+    metrics_rusage_mark(&mark);
+    uint64_t t0 = metrics_now_us();
+    uint64_t tt = trace_begin();
+    int ret = write_data_to_file(w->path, pkt->data, pkt->length);
+    trace_end(TRACE_WRITE, pkt->seq, tt, (uint32_t)pkt->length);
+    metrics_observe_us(METRIC_STAGE_WRITE, metrics_now_us() - t0);
+    metrics_rusage_stage(METRIC_STAGE_WRITE, &mark);
+    if (ret == 0) {
+        metrics_count(METRIC_BYTES_WRITTEN, pkt->length);
+        if (atomic_load_explicit(&w->first_write_us, memory_order_relaxed) == 0) {
+            atomic_store_explicit(&w->first_write_us, metrics_now_us(), memory_order_relaxed);
+        }
+    } else {
+        metrics_drop(METRIC_DROP_WRITE_ERROR);
+        printf("   ❌❌ 第%llu帧保存失败\n", (unsigned long long)pkt->seq);
+    }
+    enc_packet_unref(pkt);
+}
+
+static void* frame_writer_thread(void* arg) {
+    frame_writer_t* w = arg;
+    rt_sched_apply("mipi_writer", &w->sched);
+    for (;;) {
+        while (sem_wait(&w->items) != 0) {
+        }
+        uint32_t tail = atomic_load_explicit(&w->tail, memory_order_relaxed);
+        uint32_t head = atomic_load_explicit(&w->head, memory_order_acquire);
+        if (tail == head) {
+            // 没有数据的唤醒只来自 stop
+            if (!atomic_load(&w->running)) {
+                break;
+            }
+            continue;
+        }
+        enc_packet_t* pkt = w->queue[tail & (FRAME_WRITER_DEPTH - 1)];
+        atomic_store_explicit(&w->tail, tail + 1, memory_order_release);
+        frame_writer_write(w, pkt);
+    }
+    return NULL;
+}
+
+int frame_writer_start(frame_writer_t* w, const char* path, const rt_sched_t* sched) {
+    static const rt_sched_t none = RT_SCHED_NONE;
+    w->path = path;
+    w->sched = sched ? *sched : none;
+    atomic_init(&w->head, 0);
+    atomic_init(&w->tail, 0);
+    atomic_init(&w->running, 1);
+    atomic_init(&w->first_write_us, 0);
+    if (sem_init(&w->items, 0, 0) != 0) {
+        perror("写线程信号量初始化失败");
+        return -1;
+    }
+    if (pthread_create(&w->thread, NULL, frame_writer_thread, w) != 0) {
+        printf("   写文件线程创建失败\n");
+        sem_destroy(&w->items);
+        return -1;
+    }
+    return 0;
+}
+
+int frame_writer_submit(frame_writer_t* w, enc_packet_t* pkt) {
+    uint32_t head = atomic_load_explicit(&w->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&w->tail, memory_order_acquire);
+    if (head - tail >= FRAME_WRITER_DEPTH) {
+        trace_instant(TRACE_WRITE_SUBMIT, pkt->seq, 0);
+        metrics_drop(METRIC_DROP_WRITER_FULL);
+        enc_packet_unref(pkt);
+        return -1;
+    }
+    trace_instant(TRACE_WRITE_SUBMIT, pkt->seq, (uint32_t)pkt->length);
+    w->queue[head & (FRAME_WRITER_DEPTH - 1)] = pkt;
+    atomic_store_explicit(&w->head, head + 1, memory_order_release);
+    sem_post(&w->items);
+    return 0;
+}
+
+void frame_writer_stop(frame_writer_t* w) {
+    atomic_store(&w->running, 0);
+    sem_post(&w->items);
+    pthread_join(w->thread, NULL);
+    sem_destroy(&w->items);
+}
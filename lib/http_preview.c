@@ -0,0 +1,459 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include "http_preview.h"
+
+#define PREVIEW_BOUNDARY    "mipiframe"
+#define PREVIEW_EV_LISTEN   ((uint64_t)-1)
+#define PREVIEW_EV_WAKE     ((uint64_t)-2)
+
+typedef enum {
+    CLIENT_FREE = 0,
+    CLIENT_READING,         // 等待完整的请求头
+    CLIENT_STREAMING,       // MJPEG 流
+    CLIENT_SNAPSHOT,        // 单张 JPEG，发完即关闭
+} client_state_t;
+
+typedef struct {
+    int fd;
+    client_state_t state;
+    char req[1024];
+    size_t req_len;
+    char hdr[256];          // 响应头(首帧) + 分段头
+    size_t hdr_len;
+    int need_resp_hdr;      // 下一段前需要先发 HTTP 响应头
+    enc_packet_t* pkt;      // 正在发送的包，持有一个引用
+    size_t sent;            // 当前段已发送字节数(头+数据+结尾)
+    uint64_t last_seq;
+    int has_sent;           // 是否已发送过任意一帧
+    int out_armed;          // 是否注册了 EPOLLOUT
+    uint64_t last_progress_ms;
+} client_t;
+
+static struct {
+    pthread_t thread;
+    int running;
+    int epfd;
+    int listen_fd;
+    int wake_fd;
+    http_preview_cfg_t cfg;
+    client_t* clients;
+    enc_packet_t* current;              // 服务线程持有的最新包
+    _Atomic(enc_packet_t*) mailbox;     // 发布者与服务线程之间的单槽邮箱
+} srv = { .epfd = -1, .listen_fd = -1, .wake_fd = -1 };
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static void client_close(client_t* c) {
+    if (c->state == CLIENT_FREE) {
+        return;
+    }
+    epoll_ctl(srv.epfd, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    enc_packet_unref(c->pkt);
+    memset(c, 0, sizeof(*c));
+    c->fd = -1;
+}
+
+static void client_arm_out(client_t* c, int on) {
+    if (c->out_armed == on) {
+        return;
+    }
+    struct epoll_event ev = { .events = EPOLLIN | EPOLLRDHUP | (on ? EPOLLOUT : 0) };
+    ev.data.u64 = (uint64_t)(c - srv.clients);
+    epoll_ctl(srv.epfd, EPOLL_CTL_MOD, c->fd, &ev);
+    c->out_armed = on;
+}
+
+/**
+ * @brief 开始向客户端发送一个包：只准备头部，数据直接引用包内存
+ */
+static void client_begin_part(client_t* c, enc_packet_t* pkt) {
+    size_t n = 0;
+    if (c->need_resp_hdr) {
+        if (c->state == CLIENT_STREAMING) {
+            n += snprintf(c->hdr + n, sizeof(c->hdr) - n,
+                          "HTTP/1.0 200 OK\r\nCache-Control: no-cache\r\nPragma: no-cache\r\n"
+                          "Connection: close\r\n"
+                          "Content-Type: multipart/x-mixed-replace; boundary=" PREVIEW_BOUNDARY "\r\n\r\n");
+        } else {
+            n += snprintf(c->hdr + n, sizeof(c->hdr) - n,
+                          "HTTP/1.0 200 OK\r\nCache-Control: no-cache\r\nConnection: close\r\n"
+                          "Content-Type: image/jpeg\r\nContent-Length: %zu\r\n\r\n", pkt->length);
+        }
+        c->need_resp_hdr = 0;
+    }
+    if (c->state == CLIENT_STREAMING) {
+        n += snprintf(c->hdr + n, sizeof(c->hdr) - n,
+                      "--" PREVIEW_BOUNDARY "\r\nContent-Type: image/jpeg\r\nContent-Length: %zu\r\n\r\n",
+                      pkt->length);
+    }
+    c->hdr_len = n;
+    c->pkt = enc_packet_ref(pkt);
+    c->sent = 0;
+    c->last_seq = pkt->seq;
+    c->has_sent = 1;
+    c->last_progress_ms = now_ms();
+}
+
+static int client_has_new_frame(const client_t* c) {
+    return srv.current && (!c->has_sent || srv.current->seq != c->last_seq);
+}
+
+/**
+ * @brief 尽量发送当前段，发完后若有更新的帧则接着发最新帧
+ * @return 0 正常，-1 客户端需要关闭
+ */
+static int client_flush(client_t* c) {
+    static const char trailer[] = "\r\n";
+    for (;;) {
+        if (!c->pkt) {
+            if (c->state == CLIENT_STREAMING && client_has_new_frame(c)) {
+                client_begin_part(c, srv.current);
+            } else {
+                client_arm_out(c, 0);
+                return 0;
+            }
+        }
+
+        size_t tlen = c->state == CLIENT_STREAMING ? sizeof(trailer) - 1 : 0;
+        size_t total = c->hdr_len + c->pkt->length + tlen;
+        struct iovec iov[3];
+        int iovcnt = 0;
+        size_t off = c->sent;
+        if (off < c->hdr_len) {
+            iov[iovcnt].iov_base = c->hdr + off;
+            iov[iovcnt++].iov_len = c->hdr_len - off;
+            off = 0;
+        } else {
+            off -= c->hdr_len;
+        }
+        if (off < c->pkt->length) {
+            iov[iovcnt].iov_base = (char*)c->pkt->data + off;
+            iov[iovcnt++].iov_len = c->pkt->length - off;
+            off = 0;
+        } else {
+            off -= c->pkt->length;
+        }
+        if (off < tlen) {
+            iov[iovcnt].iov_base = (char*)trailer + off;
+            iov[iovcnt++].iov_len = tlen - off;
+        }
+
+        ssize_t n = writev(c->fd, iov, iovcnt);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                client_arm_out(c, 1);
+                return 0;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        c->sent += (size_t)n;
+        c->last_progress_ms = now_ms();
+        if (c->sent < total) {
+            continue;
+        }
+
+        enc_packet_unref(c->pkt);
+        c->pkt = NULL;
+        if (c->state == CLIENT_SNAPSHOT) {
+            return -1;
+        }
+    }
+}
+
+/**
+ * @brief 解析请求行，只支持 GET
+ */
+static int client_handle_request(client_t* c) {
+    static const char not_found[] = "HTTP/1.0 404 Not Found\r\nConnection: close\r\n\r\n";
+    char method[8], path[128];
+    if (sscanf(c->req, "%7s %127s", method, path) != 2 || strcmp(method, "GET") != 0) {
+        return -1;
+    }
+    if (strcmp(path, "/") == 0 || strcmp(path, "/stream") == 0) {
+        c->state = CLIENT_STREAMING;
+    } else if (strcmp(path, "/snapshot") == 0) {
+        c->state = CLIENT_SNAPSHOT;
+    } else {
+        ssize_t ignored = send(c->fd, not_found, sizeof(not_found) - 1, MSG_NOSIGNAL);
+        (void)ignored;
+        return -1;
+    }
+    c->need_resp_hdr = 1;
+    if (srv.current) {
+        client_begin_part(c, srv.current);
+        return client_flush(c);
+    }
+    return 0;
+}
+
+static void client_on_readable(client_t* c) {
+    char discard[512];
+    for (;;) {
+        char* dst = discard;
+        size_t cap = sizeof(discard);
+        if (c->state == CLIENT_READING) {
+            dst = c->req + c->req_len;
+            cap = sizeof(c->req) - 1 - c->req_len;
+            if (cap == 0) {
+                client_close(c);
+                return;
+            }
+        }
+        ssize_t n = recv(c->fd, dst, cap, 0);
+        if (n == 0) {
+            client_close(c);
+            return;
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                client_close(c);
+            }
+            return;
+        }
+        if (c->state == CLIENT_READING) {
+            c->req_len += (size_t)n;
+            c->req[c->req_len] = '\0';
+            if (strstr(c->req, "\r\n\r\n") || strstr(c->req, "\n\n")) {
+                if (client_handle_request(c) != 0) {
+                    client_close(c);
+                }
+                return;
+            }
+        }
+    }
+}
+
+static void server_accept(void) {
+    for (;;) {
+        int fd = accept4(srv.listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+        client_t* c = NULL;
+        for (int i = 0; i < srv.cfg.max_clients; i++) {
+            if (srv.clients[i].state == CLIENT_FREE) {
+                c = &srv.clients[i];
+                break;
+            }
+        }
+        if (!c) {
+            static const char busy[] = "HTTP/1.0 503 Service Unavailable\r\nConnection: close\r\n\r\n";
+            ssize_t ignored = send(fd, busy, sizeof(busy) - 1, MSG_NOSIGNAL);
+            (void)ignored;
+            close(fd);
+            continue;
+        }
+        // 限制内核为该客户端缓存的数据量
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &srv.cfg.sndbuf_bytes, sizeof(srv.cfg.sndbuf_bytes));
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        memset(c, 0, sizeof(*c));
+        c->fd = fd;
+        c->state = CLIENT_READING;
+        c->last_progress_ms = now_ms();
+        struct epoll_event ev = { .events = EPOLLIN | EPOLLRDHUP };
+        ev.data.u64 = (uint64_t)(c - srv.clients);
+        if (epoll_ctl(srv.epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            close(fd);
+            c->state = CLIENT_FREE;
+        }
+    }
+}
+
+static void server_on_wake(void) {
+    uint64_t v;
+    ssize_t ignored = read(srv.wake_fd, &v, sizeof(v));
+    (void)ignored;
+    enc_packet_t* pkt = atomic_exchange_explicit(&srv.mailbox, NULL, memory_order_acq_rel);
+    if (!pkt) {
+        return;
+    }
+    enc_packet_unref(srv.current);
+    srv.current = pkt;
+
+    for (int i = 0; i < srv.cfg.max_clients; i++) {
+        client_t* c = &srv.clients[i];
+        if (c->state == CLIENT_READING || c->state == CLIENT_FREE || c->pkt) {
+            continue;   // 正在发送旧帧的客户端发完后会直接取最新帧
+        }
+        if (c->state == CLIENT_SNAPSHOT || client_has_new_frame(c)) {
+            client_begin_part(c, srv.current);
+            if (client_flush(c) != 0) {
+                client_close(c);
+            }
+        }
+    }
+}
+
+static void server_reap_stalled(void) {
+    uint64_t now = now_ms();
+    for (int i = 0; i < srv.cfg.max_clients; i++) {
+        client_t* c = &srv.clients[i];
+        if (c->state == CLIENT_FREE || now - c->last_progress_ms <= (uint64_t)srv.cfg.stall_timeout_ms) {
+            continue;
+        }
+        // 请求头从连接建立起计时，收到部分数据不续期，空连接不能一直占着客户端名额
+        if (c->state == CLIENT_READING) {
+            printf("   预览客户端请求头超时，断开\n");
+            client_close(c);
+        } else if (c->pkt) {
+            printf("   预览客户端发送停滞，断开\n");
+            client_close(c);
+        }
+    }
+}
+
+static void* server_thread(void* arg) {
+    (void)arg;
+    struct epoll_event events[16];
+    while (__atomic_load_n(&srv.running, __ATOMIC_ACQUIRE)) {
+        int n = epoll_wait(srv.epfd, events, 16, 500);
+        for (int i = 0; i < n; i++) {
+            uint64_t id = events[i].data.u64;
+            if (id == PREVIEW_EV_LISTEN) {
+                server_accept();
+            } else if (id == PREVIEW_EV_WAKE) {
+                server_on_wake();
+            } else {
+                client_t* c = &srv.clients[id];
+                if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                    client_close(c);
+                    continue;
+                }
+                if (events[i].events & (EPOLLIN | EPOLLRDHUP)) {
+                    client_on_readable(c);
+                }
+                if (c->state != CLIENT_FREE && (events[i].events & EPOLLOUT)) {
+                    if (client_flush(c) != 0) {
+                        client_close(c);
+                    }
+                }
+            }
+        }
+        server_reap_stalled();
+    }
+    return NULL;
+}
+
+int http_preview_start(const http_preview_cfg_t* cfg) {
+    srv.cfg = *cfg;
+    if (!srv.cfg.bind_addr) {
+        srv.cfg.bind_addr = "127.0.0.1";
+    }
+    if (srv.cfg.max_clients <= 0) {
+        srv.cfg.max_clients = 4;
+    }
+    if (srv.cfg.sndbuf_bytes <= 0) {
+        srv.cfg.sndbuf_bytes = 256 * 1024;
+    }
+    if (srv.cfg.stall_timeout_ms <= 0) {
+        srv.cfg.stall_timeout_ms = 5000;
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)srv.cfg.port);
+    if (inet_pton(AF_INET, srv.cfg.bind_addr, &addr.sin_addr) != 1) {
+        printf("   预览服务监听地址无效: %s\n", srv.cfg.bind_addr);
+        return -1;
+    }
+
+    srv.clients = calloc((size_t)srv.cfg.max_clients, sizeof(client_t));
+    srv.listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    srv.wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    srv.epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (!srv.clients || srv.listen_fd < 0 || srv.wake_fd < 0 || srv.epfd < 0) {
+        perror("预览服务资源创建失败");
+        goto fail;
+    }
+    int one = 1;
+    setsockopt(srv.listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(srv.listen_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(srv.listen_fd, 8) < 0) {
+        perror("预览服务监听失败");
+        goto fail;
+    }
+
+    struct epoll_event ev = { .events = EPOLLIN };
+    ev.data.u64 = PREVIEW_EV_LISTEN;
+    epoll_ctl(srv.epfd, EPOLL_CTL_ADD, srv.listen_fd, &ev);
+    ev.data.u64 = PREVIEW_EV_WAKE;
+    epoll_ctl(srv.epfd, EPOLL_CTL_ADD, srv.wake_fd, &ev);
+
+    atomic_store(&srv.mailbox, NULL);
+    srv.current = NULL;
+    srv.running = 1;
+    if (pthread_create(&srv.thread, NULL, server_thread, NULL) != 0) {
+        printf("   预览服务线程创建失败\n");
+        srv.running = 0;
+        goto fail;
+    }
+    printf("   MJPEG预览服务已启动: http://%s:%d/\n", srv.cfg.bind_addr, srv.cfg.port);
+    return 0;
+
+fail:
+    if (srv.epfd >= 0) close(srv.epfd);
+    if (srv.wake_fd >= 0) close(srv.wake_fd);
+    if (srv.listen_fd >= 0) close(srv.listen_fd);
+    srv.epfd = srv.wake_fd = srv.listen_fd = -1;
+    free(srv.clients);
+    srv.clients = NULL;
+    return -1;
+}
+
+void http_preview_publish(enc_packet_t* pkt) {
+    if (!__atomic_load_n(&srv.running, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+    enc_packet_t* old = atomic_exchange_explicit(&srv.mailbox, enc_packet_ref(pkt), memory_order_acq_rel);
+    // 服务线程还没取走的旧帧直接丢弃
+    enc_packet_unref(old);
+    uint64_t one = 1;
+    ssize_t ignored = write(srv.wake_fd, &one, sizeof(one));
+    (void)ignored;
+}
+
+void http_preview_stop(void) {
+    if (!srv.running) {
+        return;
+    }
+    __atomic_store_n(&srv.running, 0, __ATOMIC_RELEASE);
+    pthread_join(srv.thread, NULL);
+    for (int i = 0; i < srv.cfg.max_clients; i++) {
+        client_close(&srv.clients[i]);
+    }
+    enc_packet_unref(atomic_exchange(&srv.mailbox, NULL));
+    enc_packet_unref(srv.current);
+    srv.current = NULL;
+    close(srv.epfd);
+    close(srv.wake_fd);
+    close(srv.listen_fd);
+    srv.epfd = srv.wake_fd = srv.listen_fd = -1;
+    free(srv.clients);
+    srv.clients = NULL;
+}
@@ -0,0 +1,692 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "jpeg_xform.h"
+#include "mem_arena.h"
+
+#define XFORM_MCU           16      // 4:2:0 的 MCU 边长(像素)
+#define XFORM_MCU_BLOCKS    6       // 每个 MCU 的块数：4 个 Y、Cb、Cr
+#define HUFF_LOOKUP_BITS    9       // 不超过该长度的码字查表解码
+#define XFORM_BLOCK_MAX     512     // 一个块熵编码后的字节数上限(含字节填充)，用于限制输出缓冲增长
+
+typedef struct {
+    uint16_t lookup[1 << HUFF_LOOKUP_BITS];     // 码长 << 8 | 符号，0 表示码字更长
+    int32_t maxcode[17];                        // 各码长的最大码字，-1 表示没有该长度
+    int32_t valoff[17];                         // 码字 + valoff 为符号下标
+    uint8_t vals[256];
+    int valid;
+} huff_dec_t;
+
+typedef struct {
+    int id;
+    int h;
+    int v;
+    int tq;                         // 量化表
+    int td;                         // DC Huffman 表
+    int ta;                         // AC Huffman 表
+} jpeg_comp_t;
+
+typedef struct {
+    int width;
+    int height;
+    int mcux;
+    int mcuy;
+    jpeg_comp_t comp[3];
+    uint8_t qt[4][64];              // 自然顺序
+    int qt_valid;                   // 已定义的量化表位图
+    huff_dec_t dc[4];
+    huff_dec_t ac[4];
+    int restart;                    // 复位间隔(MCU)，0 为没有
+    const uint8_t* scan;            // 熵编码数据
+    const uint8_t* end;
+} jpeg_src_t;
+
+typedef struct {
+    const uint8_t* p;
+    const uint8_t* end;
+    uint64_t acc;                   // 未读的位，高位对齐
+    int nbits;
+    int marker;                     // 已读到标记，之后补0
+} bit_reader_t;
+
+static const char* const op_names[] = { "none", "hflip", "vflip", "rot90", "rot180", "rot270" };
+
+// IDCT 的行/列缩放因子，与 AAN DCT 对应
+static const float aan_idct[8] = {
+    1.0f, 1.387039845f, 1.306562965f, 1.175875602f, 1.0f, 0.785694958f, 0.541196100f, 0.275899379f,
+};
+
+int jpeg_xform_parse(const char* spec, jpeg_xform_cfg_t* cfg) {
+    const char* colon = strchr(spec, ':');
+    size_t len = colon ? (size_t)(colon - spec) : strlen(spec);
+    memset(cfg, 0, sizeof(*cfg));
+    for (size_t i = 0; i < sizeof(op_names) / sizeof(op_names[0]); i++) {
+        if (strlen(op_names[i]) == len && strncmp(spec, op_names[i], len) == 0) {
+            cfg->op = (jpeg_xform_op_t)i;
+            if (!colon) {
+                return 0;
+            }
+            cfg->crop_enabled = 1;
+            return roi_parse(colon + 1, &cfg->crop);
+        }
+    }
+    return -1;
+}
+
+const char* jpeg_xform_op_name(jpeg_xform_op_t op) {
+    return (unsigned)op < sizeof(op_names) / sizeof(op_names[0]) ? op_names[op] : "unknown";
+}
+
+void jpeg_xform_init(jpeg_xform_t* x, const jpeg_xform_cfg_t* cfg) {
+    memset(x, 0, sizeof(*x));
+    x->cfg = *cfg;
+}
+
+void jpeg_xform_deinit(jpeg_xform_t* x) {
+    mem_unmap_default(x->coef, x->coef_size);
+    mem_unmap_default(x->out, x->out_capacity);
+    mem_unmap_default(x->nv12, x->nv12_size);
+    memset(x, 0, sizeof(*x));
+}
+
+/* ---------- 头部解析 ---------- */
+
+static int huff_dec_build(huff_dec_t* h, const uint8_t* bits, const uint8_t* vals, int n) {
+    int32_t code = 0;
+    int k = 0;
+    memset(h, 0, sizeof(*h));
+    memcpy(h->vals, vals, (size_t)n);
+    for (int len = 1; len <= 16; len++) {
+        h->valoff[len] = k - code;
+        for (int i = 0; i < bits[len - 1]; i++, k++, code++) {
+            // 这一长度的码字已经用完，再往下填会越过 lookup
+            if (code >= 1 << len) {
+                return -1;
+            }
+            if (len <= HUFF_LOOKUP_BITS) {
+                int shift = HUFF_LOOKUP_BITS - len;
+                for (int j = 0; j < 1 << shift; j++) {
+                    h->lookup[(code << shift) | j] = (uint16_t)(len << 8 | vals[k]);
+                }
+            }
+        }
+        h->maxcode[len] = bits[len - 1] ? code - 1 : -1;
+        if (code >= 1 << len) {
+            return -1;              // 码长分布不可能构成前缀码(全1码字保留不用)
+        }
+        code <<= 1;
+    }
+    h->valid = 1;
+    return 0;
+}
+
+static int parse_dqt(jpeg_src_t* s, const uint8_t* p, int len) {
+    while (len > 0) {
+        int tq = p[0] & 15;
+        // 只支持 8 位精度的量化表
+        if (p[0] >> 4 || tq > 3 || len < 65) {
+            return -1;
+        }
+        for (int i = 0; i < 64; i++) {
+            s->qt[tq][sw_jpeg_zigzag_natural[i]] = p[1 + i];
+        }
+        s->qt_valid |= 1 << tq;
+        p += 65;
+        len -= 65;
+    }
+    return 0;
+}
+
+static int parse_dht(jpeg_src_t* s, const uint8_t* p, int len) {
+    while (len > 0) {
+        int n = 0;
+        int tc = p[0] >> 4;
+        int th = p[0] & 15;
+        if (len < 17 || tc > 1 || th > 3) {
+            return -1;
+        }
+        for (int i = 0; i < 16; i++) {
+            n += p[1 + i];
+        }
+        if (n > 256 || len < 17 + n || huff_dec_build(tc ? &s->ac[th] : &s->dc[th], p + 1, p + 17, n) != 0) {
+            return -1;
+        }
+        p += 17 + n;
+        len -= 17 + n;
+    }
+    return 0;
+}
+
+static int parse_sof(jpeg_src_t* s, const uint8_t* p, int len) {
+    if (len < 6 + 3 * 3 || p[0] != 8 || p[5] != 3) {
+        return -1;
+    }
+    s->height = p[1] << 8 | p[2];
+    s->width = p[3] << 8 | p[4];
+    for (int i = 0; i < 3; i++) {
+        jpeg_comp_t* c = &s->comp[i];
+        c->id = p[6 + i * 3];
+        c->h = p[7 + i * 3] >> 4;
+        c->v = p[7 + i * 3] & 15;
+        c->tq = p[8 + i * 3];
+        if (c->tq > 3 || c->h != (i ? 1 : 2) || c->v != (i ? 1 : 2)) {
+            return -1;
+        }
+    }
+    // 输出每个分量只写一张表，Cb/Cr 须共用
+    if (s->width == 0 || s->height == 0 || s->comp[1].tq != s->comp[2].tq) {
+        return -1;
+    }
+    s->mcux = (s->width + XFORM_MCU - 1) / XFORM_MCU;
+    s->mcuy = (s->height + XFORM_MCU - 1) / XFORM_MCU;
+    return 0;
+}
+
+static int parse_sos(jpeg_src_t* s, const uint8_t* p, int len) {
+    if (len < 1 + 3 * 2 + 3 || p[0] != 3) {
+        return -1;
+    }
+    for (int i = 0; i < 3; i++) {
+        jpeg_comp_t* c = &s->comp[i];
+        c->td = p[2 + i * 2] >> 4;
+        c->ta = p[2 + i * 2] & 15;
+        if (p[1 + i * 2] != c->id || c->td > 3 || c->ta > 3 || !s->dc[c->td].valid || !s->ac[c->ta].valid ||
+            !(s->qt_valid & 1 << c->tq)) {
+            return -1;
+        }
+    }
+    // 基线：一次扫描包含全部 64 个系数，没有逐次逼近
+    return p[7] == 0 && p[8] == 63 && p[9] == 0 ? 0 : -1;
+}
+
+/**
+ * @brief 解析到 SOS 为止，APPn/COM 等段跳过
+ * @return 成功返回0，不是 3 分量 4:2:0 基线或数据不完整返回-1
+ */
+static int parse_headers(jpeg_src_t* s, const uint8_t* data, size_t length) {
+    const uint8_t* p = data + 2;
+    const uint8_t* end = data + length;
+    int have_sof = 0;
+    memset(s, 0, sizeof(*s));
+    if (length < 4 || data[0] != 0xff || data[1] != 0xd8) {
+        return -1;
+    }
+    while (p + 4 <= end) {
+        if (p[0] != 0xff) {
+            return -1;
+        }
+        int m = p[1];
+        if (m == 0xff) {
+            p++;                    // 标记前的填充字节
+            continue;
+        }
+        int len = (p[2] << 8 | p[3]) - 2;
+        const uint8_t* seg = p + 4;
+        if (len < 0 || len > end - seg) {
+            return -1;
+        }
+        int ret = 0;
+        switch (m) {
+            case 0xdb: ret = parse_dqt(s, seg, len); break;
+            case 0xc4: ret = parse_dht(s, seg, len); break;
+            case 0xc0:
+            case 0xc1:
+                ret = parse_sof(s, seg, len);
+                have_sof = ret == 0;
+                break;
+            case 0xdd:
+                if (len < 2) {
+                    return -1;
+                }
+                s->restart = seg[0] << 8 | seg[1];
+                break;
+            case 0xda:
+                if (!have_sof || parse_sos(s, seg, len) != 0) {
+                    return -1;
+                }
+                s->scan = seg + len;
+                s->end = end;
+                return 0;
+            default:
+                // 渐进、无损、算术编码等其他 SOF
+                if (m >= 0xc2 && m <= 0xcf && m != 0xc4 && m != 0xc8 && m != 0xcc) {
+                    return -1;
+                }
+                break;
+        }
+        if (ret != 0) {
+            return -1;
+        }
+        p = seg + len;
+    }
+    return -1;
+}
+
+/* ---------- 熵解码 ---------- */
+
+/**
+ * @brief 补足到 57 位以上；跳过填充的 0x00，遇到标记停在标记处并补0
+ */
+static void br_fill(bit_reader_t* br) {
+    while (br->nbits <= 56) {
+        uint32_t c = 0;
+        if (!br->marker && br->p < br->end) {
+            c = *br->p;
+            if (c != 0xff) {
+                br->p++;
+            } else if (br->p + 1 < br->end && br->p[1] == 0) {
+                br->p += 2;
+            } else {
+                br->marker = 1;
+                c = 0;
+            }
+        }
+        br->acc |= (uint64_t)c << (56 - br->nbits);
+        br->nbits += 8;
+    }
+}
+
+/**
+ * @brief 取 n(1-16) 位，调用前须保证位数足够
+ */
+static inline int br_get(bit_reader_t* br, int n) {
+    int v = (int)(br->acc >> (64 - n));
+    br->acc <<= n;
+    br->nbits -= n;
+    return v;
+}
+
+/**
+ * @brief 复位间隔结束：丢弃字节对齐的填充位，跳过 RSTn
+ */
+static int br_restart(bit_reader_t* br) {
+    br->acc = 0;
+    br->nbits = 0;
+    br->marker = 0;
+    while (br->p + 1 < br->end && br->p[0] == 0xff && br->p[1] == 0xff) {
+        br->p++;
+    }
+    if (br->p + 1 >= br->end || br->p[0] != 0xff || (br->p[1] & 0xf8) != 0xd0) {
+        return -1;
+    }
+    br->p += 2;
+    return 0;
+}
+
+static inline int huff_decode(bit_reader_t* br, const huff_dec_t* h) {
+    uint16_t e = h->lookup[br->acc >> (64 - HUFF_LOOKUP_BITS)];
+    if (e) {
+        br_get(br, e >> 8);
+        return e & 0xff;
+    }
+    int32_t code = (int32_t)(br->acc >> 48);
+    for (int len = HUFF_LOOKUP_BITS + 1; len <= 16; len++) {
+        int32_t c = code >> (16 - len);
+        if (c <= h->maxcode[len]) {
+            br_get(br, len);
+            return h->vals[(h->valoff[len] + c) & 0xff];
+        }
+    }
+    return -1;
+}
+
+static inline int extend(int v, int n) {
+    return v < 1 << (n - 1) ? v - (1 << n) + 1 : v;
+}
+
+/**
+ * @brief 解码一个块，DC 为绝对值。第 k 个(zigzag)系数写到 blk[pos[k]]，mask[k] 为 -1 时取反
+ */
+static int decode_block(bit_reader_t* br, const huff_dec_t* dc, const huff_dec_t* ac, int* pred, int16_t* blk,
+                        const uint8_t* pos, const int16_t* mask) {
+    memset(blk, 0, 64 * sizeof(*blk));
+    // 一个符号最多 16 位，后跟的数值最多 15 位
+    if (br->nbits < 32) {
+        br_fill(br);
+    }
+    int s = huff_decode(br, dc);
+    if (s < 0 || s > 15) {
+        return -1;
+    }
+    *pred += s ? extend(br_get(br, s), s) : 0;
+    blk[0] = (int16_t)*pred;
+    for (int k = 1; k < 64; k++) {
+        if (br->nbits < 32) {
+            br_fill(br);
+        }
+        int rs = huff_decode(br, ac);
+        if (rs < 0) {
+            return -1;
+        }
+        s = rs & 15;
+        if (!s) {
+            if (rs != 0xf0) {
+                break;              // EOB
+            }
+            k += 15;                // ZRL
+            continue;
+        }
+        k += rs >> 4;
+        if (k > 63) {
+            return -1;
+        }
+        blk[pos[k]] = (int16_t)((extend(br_get(br, s), s) ^ mask[k]) - mask[k]);
+    }
+    return 0;
+}
+
+/* ---------- 系数变换 ---------- */
+
+static int op_transposes(jpeg_xform_op_t op) {
+    return op == JPEG_XFORM_ROT90 || op == JPEG_XFORM_ROT270;
+}
+
+/**
+ * @brief 块内变换表：源块第 k 个(zigzag)系数放到输出块的第 pos[k] 个，mask[k] 为 -1 时取反。
+ *        水平翻转使第 v 列频率乘以 (-1)^v，垂直翻转同理作用于行；旋转 90/270 度先转置再翻转
+ */
+static void block_xform(jpeg_xform_op_t op, uint8_t pos[64], int16_t mask[64]) {
+    uint8_t natural_zigzag[64];
+    for (int i = 0; i < 64; i++) {
+        natural_zigzag[sw_jpeg_zigzag_natural[i]] = (uint8_t)i;
+    }
+    for (int i = 0; i < 64; i++) {
+        // 输出位置 (r, c) 取自源位置 (c, r)(转置时)或 (r, c)
+        int k = sw_jpeg_zigzag_natural[i];
+        int r = k >> 3;
+        int c = k & 7;
+        int neg = 0;
+        switch (op) {
+            case JPEG_XFORM_HFLIP:
+            case JPEG_XFORM_ROT90: neg = c & 1; break;
+            case JPEG_XFORM_VFLIP:
+            case JPEG_XFORM_ROT270: neg = r & 1; break;
+            case JPEG_XFORM_ROT180: neg = (r + c) & 1; break;
+            default: break;
+        }
+        int src = natural_zigzag[op_transposes(op) ? c * 8 + r : k];
+        pos[src] = (uint8_t)i;
+        mask[src] = (int16_t)(neg ? -1 : 0);
+    }
+}
+
+/**
+ * @brief 源块 (sx, sy) 在输出平面中的下标
+ * @param wb 源平面宽(块)
+ * @param hb 源平面高(块)，输出平面宽为转置时的 hb 或 wb
+ */
+static inline size_t dst_block(jpeg_xform_op_t op, int sx, int sy, int wb, int hb) {
+    switch (op) {
+        case JPEG_XFORM_HFLIP: return (size_t)sy * wb + (wb - 1 - sx);
+        case JPEG_XFORM_VFLIP: return (size_t)(hb - 1 - sy) * wb + sx;
+        case JPEG_XFORM_ROT180: return (size_t)(hb - 1 - sy) * wb + (wb - 1 - sx);
+        case JPEG_XFORM_ROT90: return (size_t)sx * hb + (hb - 1 - sy);
+        case JPEG_XFORM_ROT270: return (size_t)(wb - 1 - sx) * hb + sy;
+        default: return (size_t)sy * wb + sx;
+    }
+}
+
+/**
+ * @brief 解码熵编码数据，只保存 MCU 区域 [mx0, mx0+mw) x [my0, my0+mh) 内的块，区域以下的 MCU 行不解码。
+ *        块直接写到变换后的位置，系数按 block_xform 重排，不再有单独的变换遍历
+ * @param coef 输出：变换后的 Y、Cb、Cr 系数平面，布局同 sw_jpeg_encode_coefs
+ */
+static int decode_scan(const jpeg_src_t* s, int mx0, int my0, int mw, int mh, jpeg_xform_op_t op,
+                       int16_t* const coef[3]) {
+    bit_reader_t br = { s->scan, s->end, 0, 0, 0 };
+    int pred[3] = { 0, 0, 0 };
+    int16_t scratch[64];
+    uint8_t pos[64];
+    int16_t mask[64];
+    int n = 0;
+    block_xform(op, pos, mask);
+    for (int my = 0; my < my0 + mh; my++) {
+        for (int mx = 0; mx < s->mcux; mx++, n++) {
+            if (s->restart && n && n % s->restart == 0) {
+                if (br_restart(&br) != 0) {
+                    return -1;
+                }
+                pred[0] = pred[1] = pred[2] = 0;
+            }
+            int keep = my >= my0 && mx >= mx0 && mx < mx0 + mw;
+            for (int b = 0; b < XFORM_MCU_BLOCKS; b++) {
+                int ci = b < 4 ? 0 : b - 3;
+                const jpeg_comp_t* c = &s->comp[ci];
+                int16_t* blk = scratch;
+                if (keep && b < 4) {
+                    int sx = (mx - mx0) * 2 + (b & 1);
+                    int sy = (my - my0) * 2 + (b >> 1);
+                    blk = coef[0] + dst_block(op, sx, sy, mw * 2, mh * 2) * 64;
+                } else if (keep) {
+                    blk = coef[ci] + dst_block(op, mx - mx0, my - my0, mw, mh) * 64;
+                }
+                if (decode_block(&br, &s->dc[c->td], &s->ac[c->ta], &pred[ci], blk, pos, mask) != 0) {
+                    return -1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief 保证系数缓冲有 size 字节，只增不减
+ */
+static int xform_reserve(jpeg_xform_t* x, size_t size) {
+    if (size <= x->coef_size) {
+        return 0;
+    }
+    mem_unmap_default(x->coef, x->coef_size);
+    x->coef = mem_map_default(size);
+    x->coef_size = x->coef ? size : 0;
+    return x->coef ? 0 : -1;
+}
+
+const uint8_t* jpeg_xform_apply(jpeg_xform_t* x, const uint8_t* jpeg, size_t length, size_t* out_length) {
+    jpeg_src_t s;
+    jpeg_xform_op_t op = x->cfg.op;
+    if (parse_headers(&s, jpeg, length) != 0) {
+        printf("   JPEG变换: 无法解析输入(只支持3分量4:2:0基线JPEG)\n");
+        return NULL;
+    }
+    roi_rect_t r = { 0, 0, s.width, s.height };
+    if (x->cfg.crop_enabled) {
+        int x1 = x->cfg.crop.x + x->cfg.crop.width;
+        int y1 = x->cfg.crop.y + x->cfg.crop.height;
+        r.x = x->cfg.crop.x & ~(XFORM_MCU - 1);
+        r.y = x->cfg.crop.y & ~(XFORM_MCU - 1);
+        r.width = (x1 < s.width ? x1 : s.width) - r.x;
+        r.height = (y1 < s.height ? y1 : s.height) - r.y;
+    }
+    // 不满一个 MCU 的右/下边缘会被翻到左/上边缘，裁掉
+    if (op == JPEG_XFORM_HFLIP || op == JPEG_XFORM_ROT180 || op == JPEG_XFORM_ROT270) {
+        r.width &= ~(XFORM_MCU - 1);
+    }
+    if (op == JPEG_XFORM_VFLIP || op == JPEG_XFORM_ROT180 || op == JPEG_XFORM_ROT90) {
+        r.height &= ~(XFORM_MCU - 1);
+    }
+    if (r.width <= 0 || r.height <= 0) {
+        printf("   JPEG变换: %dx%d 图像中的裁剪区域为空\n", s.width, s.height);
+        return NULL;
+    }
+
+    int mw = (r.width + XFORM_MCU - 1) / XFORM_MCU;
+    int mh = (r.height + XFORM_MCU - 1) / XFORM_MCU;
+    size_t mcus = (size_t)mw * mh;
+    if (xform_reserve(x, mcus * XFORM_MCU_BLOCKS * 64 * sizeof(int16_t)) != 0) {
+        return NULL;
+    }
+    int16_t* out[3] = { x->coef, x->coef + mcus * 4 * 64, x->coef + mcus * 5 * 64 };
+    if (decode_scan(&s, r.x / XFORM_MCU, r.y / XFORM_MCU, mw, mh, op, out) != 0) {
+        printf("   JPEG变换: 熵编码数据损坏\n");
+        return NULL;
+    }
+
+    int t = op_transposes(op);
+    x->width = t ? r.height : r.width;
+    x->height = t ? r.width : r.height;
+    sw_jpeg_init(&x->enc, x->width, x->height, 50);
+    const uint8_t* ql = s.qt[s.comp[0].tq];
+    const uint8_t* qc = s.qt[s.comp[1].tq];
+    for (int k = 0; k < 64; k++) {
+        int src = t ? (k & 7) * 8 + (k >> 3) : k;
+        x->enc.qt_luma[k] = ql[src];
+        x->enc.qt_chroma[k] = qc[src];
+    }
+
+    // 原图若用了优化的 Huffman 表，换成标准表后可能变大，不够时加倍重编
+    const int16_t* planes[3] = { out[0], out[1], out[2] };
+    size_t limit = mcus * XFORM_MCU_BLOCKS * XFORM_BLOCK_MAX + 65536;
+    for (;;) {
+        if (!x->out) {
+            x->out_capacity = x->out_capacity ? x->out_capacity : length * 2 + 65536;
+            x->out = mem_map_default(x->out_capacity);
+            if (!x->out) {
+                x->out_capacity = 0;
+                return NULL;
+            }
+        }
+        size_t n = sw_jpeg_encode_coefs(&x->enc, planes, x->out, x->out_capacity);
+        if (n) {
+            *out_length = n;
+            return x->out;
+        }
+        if (x->out_capacity >= limit) {
+            return NULL;
+        }
+        mem_unmap_default(x->out, x->out_capacity);
+        x->out = NULL;
+        x->out_capacity *= 2;
+    }
+}
+
+/* ---------- 完整解码(比较基线) ---------- */
+
+/**
+ * @brief 一维 AAN 反向 DCT(与 IJG jidctflt 相同)，输入已乘反量化和缩放因子
+ */
+static void idct_1d(float* d, int stride) {
+    // 偶数部分
+    float tmp10 = d[0] + d[4 * stride];
+    float tmp11 = d[0] - d[4 * stride];
+    float tmp13 = d[2 * stride] + d[6 * stride];
+    float tmp12 = (d[2 * stride] - d[6 * stride]) * 1.414213562f - tmp13;
+    float tmp0 = tmp10 + tmp13;
+    float tmp3 = tmp10 - tmp13;
+    float tmp1 = tmp11 + tmp12;
+    float tmp2 = tmp11 - tmp12;
+
+    // 奇数部分
+    float z13 = d[5 * stride] + d[3 * stride];
+    float z10 = d[5 * stride] - d[3 * stride];
+    float z11 = d[stride] + d[7 * stride];
+    float z12 = d[stride] - d[7 * stride];
+    float tmp7 = z11 + z13;
+    tmp11 = (z11 - z13) * 1.414213562f;
+    float z5 = (z10 + z12) * 1.847759065f;
+    tmp10 = 1.082392200f * z12 - z5;
+    tmp12 = -2.613125930f * z10 + z5;
+    float tmp6 = tmp12 - tmp7;
+    float tmp5 = tmp11 - tmp6;
+    float tmp4 = tmp10 + tmp5;
+
+    d[0] = tmp0 + tmp7;
+    d[7 * stride] = tmp0 - tmp7;
+    d[stride] = tmp1 + tmp6;
+    d[6 * stride] = tmp1 - tmp6;
+    d[2 * stride] = tmp2 + tmp5;
+    d[5 * stride] = tmp2 - tmp5;
+    d[4 * stride] = tmp3 + tmp4;
+    d[3 * stride] = tmp3 - tmp4;
+}
+
+/**
+ * @brief 反量化、IDCT 一个块并写出可见的 cols x rows 像素
+ * @param mult 反量化与 IDCT 缩放合并后的乘数(自然顺序)
+ * @param step 同一行相邻像素的间隔，UV 交织平面为2
+ */
+static void idct_block(const int16_t* blk, const float* mult, uint8_t* dst, int stride, int step,
+                       int cols, int rows) {
+    float ws[64];
+    for (int i = 0; i < 64; i++) {
+        int k = sw_jpeg_zigzag_natural[i];
+        ws[k] = blk[i] * mult[k];
+    }
+    for (int c = 0; c < 8; c++) {
+        idct_1d(ws + c, 8);
+    }
+    for (int r = 0; r < 8; r++) {
+        idct_1d(ws + r * 8, 1);
+    }
+    for (int r = 0; r < rows; r++) {
+        for (int c = 0; c < cols; c++) {
+            float v = ws[r * 8 + c] + 128.5f;
+            dst[(size_t)r * stride + c * step] = (uint8_t)(v < 0 ? 0 : v > 255 ? 255 : (int)v);
+        }
+    }
+}
+
+const uint8_t* jpeg_xform_decode(jpeg_xform_t* x, const uint8_t* jpeg, size_t length, int* width, int* height) {
+    jpeg_src_t s;
+    if (parse_headers(&s, jpeg, length) != 0 || (s.width & 1) || (s.height & 1)) {
+        printf("   JPEG解码: 无法解析输入(只支持偶数宽高的3分量4:2:0基线JPEG)\n");
+        return NULL;
+    }
+    int w = s.width;
+    int h = s.height;
+    size_t mcus = (size_t)s.mcux * s.mcuy;
+    if (xform_reserve(x, mcus * XFORM_MCU_BLOCKS * 64 * sizeof(int16_t)) != 0) {
+        return NULL;
+    }
+    int16_t* coef[3] = { x->coef, x->coef + mcus * 4 * 64, x->coef + mcus * 5 * 64 };
+    if (decode_scan(&s, 0, 0, s.mcux, s.mcuy, JPEG_XFORM_NONE, coef) != 0) {
+        printf("   JPEG解码: 熵编码数据损坏\n");
+        return NULL;
+    }
+    size_t size = (size_t)w * h * 3 / 2;
+    if (size > x->nv12_size) {
+        mem_unmap_default(x->nv12, x->nv12_size);
+        x->nv12 = mem_map_default(size);
+        x->nv12_size = x->nv12 ? size : 0;
+        if (!x->nv12) {
+            return NULL;
+        }
+    }
+
+    float ml[64];
+    float mc[64];
+    const uint8_t* ql = s.qt[s.comp[0].tq];
+    const uint8_t* qc = s.qt[s.comp[1].tq];
+    for (int k = 0; k < 64; k++) {
+        float scale = aan_idct[k >> 3] * aan_idct[k & 7] / 8.0f;
+        ml[k] = ql[k] * scale;
+        mc[k] = qc[k] * scale;
+    }
+    uint8_t* yp = x->nv12;
+    uint8_t* uv = x->nv12 + (size_t)w * h;
+    int bw = s.mcux * 2;
+    for (int by = 0; by * 8 < h; by++) {
+        for (int bx = 0; bx * 8 < w; bx++) {
+            int cols = w - bx * 8 < 8 ? w - bx * 8 : 8;
+            int rows = h - by * 8 < 8 ? h - by * 8 : 8;
+            idct_block(coef[0] + ((size_t)by * bw + bx) * 64, ml, yp + (size_t)by * 8 * w + bx * 8, w, 1,
+                       cols, rows);
+        }
+    }
+    int cw = w / 2;
+    int ch = h / 2;
+    for (int by = 0; by * 8 < ch; by++) {
+        for (int bx = 0; bx * 8 < cw; bx++) {
+            int cols = cw - bx * 8 < 8 ? cw - bx * 8 : 8;
+            int rows = ch - by * 8 < 8 ? ch - by * 8 : 8;
+            size_t idx = ((size_t)by * s.mcux + bx) * 64;
+            uint8_t* dst = uv + (size_t)by * 8 * w + bx * 16;
+            idct_block(coef[1] + idx, mc, dst, w, 2, cols, rows);
+            idct_block(coef[2] + idx, mc, dst + 1, w, 2, cols, rows);
+        }
+    }
+    *width = w;
+    *height = h;
+    return x->nv12;
+}
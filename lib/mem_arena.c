@@ -0,0 +1,209 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "mem_arena.h"
+#include "metrics.h"
+
+#define STACK_IDX_MASK  0xffffffffull
+
+// 区域用尽后的堆分配块，头部按 MEM_ALIGN 对齐
+struct mem_overflow {
+    mem_overflow_t* next;
+    uint8_t pad[MEM_ALIGN - sizeof(void*)];
+};
+
+static int mem_huge_default;
+
+static size_t round_up(size_t v, size_t align) {
+    return (v + align - 1) & ~(align - 1);
+}
+
+/**
+ * @brief 实际映射长度：请求大页时按 2MB 取整(退回普通页时也一样)，映射和解除映射用同一规则
+ */
+static size_t map_length(size_t size, int huge) {
+    return round_up(size, huge ? MEM_HUGE_PAGE_SIZE : (size_t)sysconf(_SC_PAGESIZE));
+}
+
+void mem_set_huge(int huge) {
+    mem_huge_default = huge;
+}
+
+void* mem_map(size_t size, int huge, mem_backing_t* backing) {
+    void* p = MAP_FAILED;
+    mem_backing_t b = MEM_BACKING_NORMAL;
+    size = map_length(size, huge);
+    if (huge) {
+        p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        b = MEM_BACKING_HUGETLB;
+    }
+    if (p == MAP_FAILED) {
+        p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) {
+            perror("无法映射内存");
+            return NULL;
+        }
+        b = MEM_BACKING_NORMAL;
+        // 没有预留大页时交给透明大页，内核不支持时只是普通页
+        if (huge && madvise(p, size, MADV_HUGEPAGE) == 0) {
+            b = MEM_BACKING_THP;
+        }
+    }
+    if (backing) {
+        *backing = b;
+    }
+    return p;
+}
+
+void* mem_map_default(size_t size) {
+    return mem_map(size, mem_huge_default, NULL);
+}
+
+void mem_unmap(void* ptr, size_t size, int huge) {
+    if (ptr) {
+        munmap(ptr, map_length(size, huge));
+    }
+}
+
+void mem_unmap_default(void* ptr, size_t size) {
+    mem_unmap(ptr, size, mem_huge_default);
+}
+
+const char* mem_backing_name(mem_backing_t backing) {
+    switch (backing) {
+        case MEM_BACKING_HUGETLB: return "hugetlb";
+        case MEM_BACKING_THP: return "thp";
+        default: return "normal";
+    }
+}
+
+int mem_arena_init(mem_arena_t* a, size_t size, int huge) {
+    memset(a, 0, sizeof(*a));
+    a->size = round_up(size, MEM_ALIGN);
+    a->huge = huge;
+    a->base = mem_map(a->size, huge, &a->backing);
+    if (!a->base) {
+        return -1;
+    }
+    // 预先触碰，避免第一帧缺页
+    memset(a->base, 0, a->size);
+    return 0;
+}
+
+void* mem_arena_alloc(mem_arena_t* a, size_t size) {
+    size = round_up(size ? size : 1, MEM_ALIGN);
+    if (a->base && size <= a->size - a->used) {
+        void* p = a->base + a->used;
+        a->used += size;
+        metrics_count(METRIC_ARENA_ALLOCS, 1);
+        return p;
+    }
+    mem_overflow_t* o = malloc(sizeof(*o) + size);
+    if (!o) {
+        return NULL;
+    }
+    o->next = a->overflow;
+    a->overflow = o;
+    a->overflow_bytes += size;
+    metrics_count(METRIC_HEAP_ALLOCS, 1);
+    return o + 1;
+}
+
+void mem_arena_reset(mem_arena_t* a) {
+    if (a->used + a->overflow_bytes > a->hwm) {
+        a->hwm = a->used + a->overflow_bytes;
+        metrics_gauge_set(METRIC_ARENA_BYTES_HWM, (int64_t)a->hwm);
+    }
+    while (a->overflow) {
+        mem_overflow_t* o = a->overflow;
+        a->overflow = o->next;
+        free(o);
+    }
+    a->used = 0;
+    a->overflow_bytes = 0;
+    a->resets++;
+}
+
+void mem_arena_destroy(mem_arena_t* a) {
+    mem_arena_reset(a);
+    mem_unmap(a->base, a->size, a->huge);
+    a->base = NULL;
+}
+
+static _Atomic uint32_t* stack_link(void* links, size_t stride, uint32_t idx) {
+    return (_Atomic uint32_t*)((uint8_t*)links + (size_t)idx * stride);
+}
+
+void mem_stack_push(_Atomic uint64_t* head, void* links, size_t stride, uint32_t idx) {
+    uint64_t old = atomic_load_explicit(head, memory_order_relaxed);
+    uint64_t next;
+    do {
+        atomic_store_explicit(stack_link(links, stride, idx), (uint32_t)(old & STACK_IDX_MASK), memory_order_relaxed);
+        next = (((old >> 32) + 1) << 32) | (uint64_t)(idx + 1);
+    } while (!atomic_compare_exchange_weak_explicit(head, &old, next,
+                                                    memory_order_release, memory_order_relaxed));
+}
+
+int mem_stack_pop(_Atomic uint64_t* head, void* links, size_t stride) {
+    uint64_t old = atomic_load_explicit(head, memory_order_acquire);
+    while (old & STACK_IDX_MASK) {
+        uint32_t idx = (uint32_t)(old & STACK_IDX_MASK) - 1;
+        uint32_t link = atomic_load_explicit(stack_link(links, stride, idx), memory_order_relaxed);
+        uint64_t next = (((old >> 32) + 1) << 32) | link;
+        if (atomic_compare_exchange_weak_explicit(head, &old, next,
+                                                  memory_order_acquire, memory_order_acquire)) {
+            return (int)idx;
+        }
+    }
+    return -1;
+}
+
+int mem_pool_init(mem_pool_t* p, size_t obj_size, uint32_t count, int huge) {
+    memset(p, 0, sizeof(*p));
+    p->obj_size = round_up(obj_size, MEM_ALIGN);
+    p->count = count;
+    p->huge = huge;
+    // 对象在前，空闲链表接在后面，同一次映射
+    size_t objs = p->obj_size * count;
+    p->map_size = objs + sizeof(_Atomic uint32_t) * count;
+    p->base = mem_map(p->map_size, huge, &p->backing);
+    if (!p->base) {
+        return -1;
+    }
+    memset(p->base, 0, p->map_size);
+    p->next = (_Atomic uint32_t*)(p->base + objs);
+    atomic_init(&p->free_head, 0);
+    for (uint32_t i = count; i > 0; i--) {
+        mem_stack_push(&p->free_head, p->next, sizeof(*p->next), i - 1);
+    }
+    return 0;
+}
+
+void* mem_pool_get(mem_pool_t* p) {
+    int idx = mem_stack_pop(&p->free_head, p->next, sizeof(*p->next));
+    if (idx < 0) {
+        return NULL;
+    }
+    int used = atomic_fetch_add_explicit(&p->in_use, 1, memory_order_relaxed) + 1;
+    int hwm = atomic_load_explicit(&p->in_use_hwm, memory_order_relaxed);
+    while (used > hwm &&
+           !atomic_compare_exchange_weak_explicit(&p->in_use_hwm, &hwm, used,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+    }
+    metrics_count(METRIC_POOL_ALLOCS, 1);
+    return p->base + (size_t)idx * p->obj_size;
+}
+
+void mem_pool_put(mem_pool_t* p, void* obj) {
+    uint32_t idx = (uint32_t)(((uint8_t*)obj - p->base) / p->obj_size);
+    atomic_fetch_sub_explicit(&p->in_use, 1, memory_order_relaxed);
+    mem_stack_push(&p->free_head, p->next, sizeof(*p->next), idx);
+}
+
+void mem_pool_destroy(mem_pool_t* p) {
+    mem_unmap(p->base, p->map_size, p->huge);
+    p->base = NULL;
+}
@@ -0,0 +1,398 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "metrics.h"
+
+metrics_t g_metrics;
+
+static const char* counter_names[METRIC_COUNTER_MAX] = {
+    "mipi_frames_captured_total",
+    "mipi_frames_encoded_total",
+    "mipi_bytes_written_total",
+    "mipi_frames_decimated_total",
+    "mipi_capture_recoveries_total",
+    "mipi_encoder_resets_total",
+    "mipi_heap_allocs_total",
+    "mipi_arena_allocs_total",
+    "mipi_pool_allocs_total",
+    "mipi_stream_chunks_total",
+    "mipi_stream_bytes_total",
+};
+
+static const char* gauge_names[METRIC_GAUGE_MAX] = {
+    "mipi_v4l2_queued_buffers",
+    "mipi_mpp_group_used_bytes",
+    "mipi_mpp_group_unused_buffers",
+    "mipi_packet_pool_bytes",
+    "mipi_packet_pool_bytes_hwm",
+    "mipi_output_fps_target",
+    "mipi_frame_luma_mean",
+    "mipi_frame_luma_clipped_permille",
+    "mipi_frame_sharpness_x100",
+    "mipi_arena_bytes_hwm",
+    "mipi_stream_clients",
+};
+
+static const char* drop_names[METRIC_DROP_MAX] = {
+    "capture_timeout",
+    "dqbuf_error",
+    "encode_error",
+    "write_error",
+    "pool_exhausted",
+    "writer_queue_full",
+    "driver_seq_gap",
+    "record_queue_full",
+    "stall",
+    "stream_client_slow",
+    "shm_oversize",
+};
+
+static const char* stage_names[METRIC_STAGE_MAX] = {
+    "capture",
+    "copy",
+    "encode",
+    "write",
+    "video_encode",
+    "recovery",
+    "stream_first_chunk",
+    "stream_last_chunk",
+    "jpeg_xform",
+};
+
+// 导出线程状态
+static struct {
+    pthread_t thread;
+    int running;
+    int listen_fd;
+    int interval_ms;
+    char file_path[256];
+    char socket_path[108];
+    // fps 统计窗口
+    uint64_t last_us;
+    uint64_t last_captured;
+    uint64_t last_encoded;
+    _Atomic uint64_t capture_fps_milli;
+    _Atomic uint64_t encode_fps_milli;
+} exporter = { .listen_fd = -1 };
+
+/**
+ * @brief 直方图桶的下界(微秒)
+ */
+static double hist_bucket_lower(int idx) {
+    int msb = idx >> METRICS_HIST_SUB_BITS;
+    int sub = idx & ((1 << METRICS_HIST_SUB_BITS) - 1);
+    double base = (double)(1ull << msb);
+    return base + base * sub / (1 << METRICS_HIST_SUB_BITS);
+}
+
+/**
+ * @brief 从直方图快照估算分位数，在桶内线性插值
+ */
+static double hist_quantile(const uint64_t* snap, uint64_t total, double q) {
+    if (total == 0) {
+        return 0.0;
+    }
+    double rank = q * (double)total;
+    uint64_t seen = 0;
+    for (int i = 0; i < METRICS_HIST_BUCKETS; i++) {
+        if (snap[i] == 0) {
+            continue;
+        }
+        if ((double)(seen + snap[i]) >= rank) {
+            double lo = hist_bucket_lower(i);
+            double hi = hist_bucket_lower(i + 1);
+            return lo + (hi - lo) * (rank - (double)seen) / (double)snap[i];
+        }
+        seen += snap[i];
+    }
+    return hist_bucket_lower(METRICS_HIST_BUCKETS);
+}
+
+typedef struct {
+    char* buf;
+    size_t size;
+    size_t len;
+} out_t;
+
+static void out_printf(out_t* o, const char* fmt, ...) {
+    if (o->len >= o->size) {
+        return;
+    }
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(o->buf + o->len, o->size - o->len, fmt, ap);
+    va_end(ap);
+    if (n > 0) {
+        o->len += (size_t)n;
+        if (o->len >= o->size) {
+            o->len = o->size - 1;
+        }
+    }
+}
+
+size_t metrics_render(char* buf, size_t size) {
+    out_t o = { buf, size, 0 };
+    if (!buf || size == 0) {
+        return 0;
+    }
+    buf[0] = '\0';
+
+    for (int i = 0; i < METRIC_COUNTER_MAX; i++) {
+        out_printf(&o, "# TYPE %s counter\n%s %llu\n", counter_names[i], counter_names[i],
+                   (unsigned long long)atomic_load_explicit(&g_metrics.counters[i], memory_order_relaxed));
+    }
+    for (int i = 0; i < METRIC_GAUGE_MAX; i++) {
+        out_printf(&o, "# TYPE %s gauge\n%s %lld\n", gauge_names[i], gauge_names[i],
+                   (long long)atomic_load_explicit(&g_metrics.gauges[i], memory_order_relaxed));
+    }
+    out_printf(&o, "# TYPE mipi_capture_fps gauge\nmipi_capture_fps %.3f\n",
+               atomic_load_explicit(&exporter.capture_fps_milli, memory_order_relaxed) / 1000.0);
+    out_printf(&o, "# TYPE mipi_encode_fps gauge\nmipi_encode_fps %.3f\n",
+               atomic_load_explicit(&exporter.encode_fps_milli, memory_order_relaxed) / 1000.0);
+
+    out_printf(&o, "# TYPE mipi_drops_total counter\n");
+    for (int i = 0; i < METRIC_DROP_MAX; i++) {
+        out_printf(&o, "mipi_drops_total{cause=\"%s\"} %llu\n", drop_names[i],
+                   (unsigned long long)atomic_load_explicit(&g_metrics.drops[i], memory_order_relaxed));
+    }
+
+    out_printf(&o, "# TYPE mipi_v4l2_queued_at_dqbuf_total counter\n");
+    for (int i = 0; i <= METRICS_MAX_QUEUE_DEPTH; i++) {
+        uint64_t v = atomic_load_explicit(&g_metrics.queue_depth[i], memory_order_relaxed);
+        if (v) {
+            out_printf(&o, "mipi_v4l2_queued_at_dqbuf_total{depth=\"%d\"} %llu\n", i, (unsigned long long)v);
+        }
+    }
+
+    out_printf(&o, "# TYPE mipi_stage_involuntary_ctxsw_total counter\n");
+    for (int s = 0; s < METRIC_STAGE_MAX; s++) {
+        out_printf(&o, "mipi_stage_involuntary_ctxsw_total{stage=\"%s\"} %llu\n", stage_names[s],
+                   (unsigned long long)atomic_load_explicit(&g_metrics.rusage[s].nivcsw, memory_order_relaxed));
+    }
+    out_printf(&o, "# TYPE mipi_stage_page_faults_total counter\n");
+    for (int s = 0; s < METRIC_STAGE_MAX; s++) {
+        out_printf(&o, "mipi_stage_page_faults_total{stage=\"%s\",type=\"minor\"} %llu\n", stage_names[s],
+                   (unsigned long long)atomic_load_explicit(&g_metrics.rusage[s].minflt, memory_order_relaxed));
+        out_printf(&o, "mipi_stage_page_faults_total{stage=\"%s\",type=\"major\"} %llu\n", stage_names[s],
+                   (unsigned long long)atomic_load_explicit(&g_metrics.rusage[s].majflt, memory_order_relaxed));
+    }
+
+    static const double quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+    out_printf(&o, "# TYPE mipi_stage_latency_us summary\n");
+    for (int s = 0; s < METRIC_STAGE_MAX; s++) {
+        metrics_hist_t* h = &g_metrics.stages[s];
+        uint64_t snap[METRICS_HIST_BUCKETS];
+        uint64_t total = 0;
+        // 各桶独立读取，快照不是严格一致的，但对分位数估计足够
+        for (int i = 0; i < METRICS_HIST_BUCKETS; i++) {
+            snap[i] = atomic_load_explicit(&h->buckets[i], memory_order_relaxed);
+            total += snap[i];
+        }
+        for (size_t q = 0; q < sizeof(quantiles) / sizeof(quantiles[0]); q++) {
+            out_printf(&o, "mipi_stage_latency_us{stage=\"%s\",quantile=\"%g\"} %.1f\n",
+                       stage_names[s], quantiles[q], hist_quantile(snap, total, quantiles[q]));
+        }
+        out_printf(&o, "mipi_stage_latency_us_sum{stage=\"%s\"} %llu\n", stage_names[s],
+                   (unsigned long long)atomic_load_explicit(&h->sum_us, memory_order_relaxed));
+        out_printf(&o, "mipi_stage_latency_us_count{stage=\"%s\"} %llu\n", stage_names[s],
+                   (unsigned long long)atomic_load_explicit(&h->count, memory_order_relaxed));
+    }
+    return o.len;
+}
+
+/**
+ * @brief 根据计数器增量更新 fps
+ */
+static void exporter_update_rates(void) {
+    uint64_t now = metrics_now_us();
+    uint64_t captured = atomic_load_explicit(&g_metrics.counters[METRIC_FRAMES_CAPTURED], memory_order_relaxed);
+    uint64_t encoded = atomic_load_explicit(&g_metrics.counters[METRIC_FRAMES_ENCODED], memory_order_relaxed);
+    if (exporter.last_us != 0 && now > exporter.last_us) {
+        uint64_t dt = now - exporter.last_us;
+        atomic_store_explicit(&exporter.capture_fps_milli,
+                              (captured - exporter.last_captured) * 1000000000ull / dt, memory_order_relaxed);
+        atomic_store_explicit(&exporter.encode_fps_milli,
+                              (encoded - exporter.last_encoded) * 1000000000ull / dt, memory_order_relaxed);
+    }
+    exporter.last_us = now;
+    exporter.last_captured = captured;
+    exporter.last_encoded = encoded;
+}
+
+/**
+ * @brief 先写临时文件再 rename，读者永远看到完整的一份
+ */
+static void exporter_write_file(const char* text, size_t len) {
+    char tmp[sizeof(exporter.file_path) + 8];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", exporter.file_path);
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return;
+    }
+    size_t off = 0;
+    while (off < len) {
+        ssize_t n = write(fd, text + off, len - off);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        off += (size_t)n;
+    }
+    close(fd);
+    if (off == len) {
+        rename(tmp, exporter.file_path);
+    } else {
+        unlink(tmp);
+    }
+}
+
+static void exporter_serve_client(int listen_fd, char* text, size_t cap) {
+    int cfd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+    if (cfd < 0) {
+        return;
+    }
+    size_t len = metrics_render(text, cap);
+    size_t off = 0;
+    while (off < len) {
+        ssize_t n = send(cfd, text + off, len - off, MSG_NOSIGNAL);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        off += (size_t)n;
+    }
+    close(cfd);
+}
+
+static void* exporter_thread(void* arg) {
+    (void)arg;
+    size_t cap = 16 * 1024;
+    char* text = malloc(cap);
+    if (!text) {
+        return NULL;
+    }
+    uint64_t next_tick = metrics_now_us();
+
+    while (__atomic_load_n(&exporter.running, __ATOMIC_ACQUIRE)) {
+        uint64_t now = metrics_now_us();
+        if (now >= next_tick) {
+            exporter_update_rates();
+            if (exporter.file_path[0]) {
+                size_t len = metrics_render(text, cap);
+                exporter_write_file(text, len);
+            }
+            next_tick = now + (uint64_t)exporter.interval_ms * 1000;
+        }
+
+        int wait_ms = (int)((next_tick - metrics_now_us()) / 1000);
+        if (wait_ms < 0) {
+            wait_ms = 0;
+        }
+        // 限制单次等待时长，保证 metrics_stop 能及时退出
+        if (wait_ms > 200) {
+            wait_ms = 200;
+        }
+        if (exporter.listen_fd >= 0) {
+            struct pollfd pfd = { .fd = exporter.listen_fd, .events = POLLIN };
+            if (poll(&pfd, 1, wait_ms) > 0 && (pfd.revents & POLLIN)) {
+                exporter_serve_client(exporter.listen_fd, text, cap);
+            }
+        } else {
+            usleep((useconds_t)wait_ms * 1000);
+        }
+    }
+    free(text);
+    return NULL;
+}
+
+static int exporter_listen(const char* path) {
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        printf("   指标套接字路径过长: %s\n", path);
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (fd < 0) {
+        perror("无法创建指标套接字");
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    unlink(path);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, 4) < 0) {
+        perror("无法监听指标套接字");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int metrics_start(const char* file_path, const char* socket_path, int interval_ms) {
+    if (!file_path && !socket_path) {
+        return 0;
+    }
+    exporter.interval_ms = interval_ms > 0 ? interval_ms : 1000;
+    exporter.file_path[0] = '\0';
+    exporter.socket_path[0] = '\0';
+    if (file_path) {
+        snprintf(exporter.file_path, sizeof(exporter.file_path), "%s", file_path);
+    }
+    if (socket_path) {
+        exporter.listen_fd = exporter_listen(socket_path);
+        if (exporter.listen_fd < 0) {
+            return -1;
+        }
+        snprintf(exporter.socket_path, sizeof(exporter.socket_path), "%s", socket_path);
+    }
+
+    exporter.running = 1;
+    if (pthread_create(&exporter.thread, NULL, exporter_thread, NULL) != 0) {
+        printf("   指标导出线程创建失败\n");
+        exporter.running = 0;
+        if (exporter.listen_fd >= 0) {
+            close(exporter.listen_fd);
+            exporter.listen_fd = -1;
+            unlink(exporter.socket_path);
+        }
+        return -1;
+    }
+    printf("   指标导出已启动: 文件=%s, 套接字=%s, 周期=%dms\n",
+           file_path ? file_path : "-", socket_path ? socket_path : "-", exporter.interval_ms);
+    return 0;
+}
+
+void metrics_stop(void) {
+    if (!exporter.running) {
+        return;
+    }
+    __atomic_store_n(&exporter.running, 0, __ATOMIC_RELEASE);
+    pthread_join(exporter.thread, NULL);
+    // 退出前再刷新一次，保留最终统计
+    if (exporter.file_path[0]) {
+        char* text = malloc(16 * 1024);
+        if (text) {
+            exporter_update_rates();
+            exporter_write_file(text, metrics_render(text, 16 * 1024));
+            free(text);
+        }
+    }
+    if (exporter.listen_fd >= 0) {
+        close(exporter.listen_fd);
+        exporter.listen_fd = -1;
+        unlink(exporter.socket_path);
+    }
+}
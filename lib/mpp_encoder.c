@@ -0,0 +1,350 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "camera_init.h"
+#include "mpp_encoder.h"
+#include "metrics.h"
+#include "trace.h"
+
+/**
+ * @brief 创建并配置 MPP JPEG 编码器
+ */
+int mpp_encoder_init(mpp_encoder_t* enc, int width, int height, int quality, const mpp_heap_t* heap) {
+    static const mpp_heap_t default_heap = MPP_HEAP_DEFAULT;
+    char heap_name[32];
+    MPP_RET ret;
+    memset(enc, 0, sizeof(*enc));
+    enc->heap = heap ? *heap : default_heap;
+    enc->width = width;
+    enc->height = height;
+    enc->hor_stride = width;
+    enc->ver_stride = height;
+    enc->quality = quality;
+    enc->frame_size = (size_t)width * height * 3 / 2 + (size_t)width * 4;
+
+    ret = mpp_create(&enc->ctx, &enc->mpi);
+    if (ret != MPP_OK) {
+        printf("   MPP创建失败: %d\n", ret);
+        return -1;
+    }
+    printf("   MPP创建成功!   \n");
+
+    ret = mpp_init(enc->ctx, MPP_CTX_ENC, MPP_VIDEO_CodingMJPEG);
+    if (ret != MPP_OK) {
+        printf("   MPP初始化失败: %d\n", ret);
+        goto fail;
+    }
+    printf("   MPP初始化成功!   \n");
+
+    // 配置编码参数
+    ret = mpp_enc_cfg_init(&enc->cfg);
+    if (ret != MPP_OK) {
+        printf("   ❌ 编码配置初始化失败: %d\n", ret);
+        goto fail;
+    }
+    enc->mpi->control(enc->ctx, MPP_ENC_GET_CFG, enc->cfg);
+    mpp_enc_cfg_set_s32(enc->cfg, "prep:width", width);
+    mpp_enc_cfg_set_s32(enc->cfg, "prep:height", height);
+    mpp_enc_cfg_set_s32(enc->cfg, "prep:hor_stride", enc->hor_stride);
+    mpp_enc_cfg_set_s32(enc->cfg, "prep:ver_stride", enc->ver_stride);
+    mpp_enc_cfg_set_s32(enc->cfg, "prep:format", MPP_FMT_YUV420SP);  // NV12格式
+    mpp_enc_cfg_set_s32(enc->cfg, "jpeg:q_factor", quality);        // JPEG质量
+    mpp_enc_cfg_set_s32(enc->cfg, "jpeg:qf_max", 99);
+    mpp_enc_cfg_set_s32(enc->cfg, "jpeg:qf_min", 1);
+    mpp_enc_cfg_set_s32(enc->cfg, "rc:mode", MPP_ENC_RC_MODE_FIXQP);
+    ret = enc->mpi->control(enc->ctx, MPP_ENC_SET_CFG, enc->cfg);
+    if (ret != MPP_OK) {
+        printf("   ❌ 编码器配置失败: %d\n", ret);
+        goto fail;
+    }
+    // 默认阻塞等待输出，硬件卡住时采集线程会一直挂在 encode_get_packet 上
+    RK_S64 timeout = MPP_ENCODER_OUTPUT_TIMEOUT_MS;
+    enc->mpi->control(enc->ctx, MPP_SET_OUTPUT_TIMEOUT, &timeout);
+    printf("   ✅ 编码器配置成功!\n");
+
+    // 输入帧缓冲池，输出包由 packet_pool 单独管理
+    ret = mpp_buffer_group_get_internal(&enc->group, mpp_heap_group_type(&enc->heap));
+    if (ret != MPP_OK) {
+        printf("   MPP内存池创建失败(%s): %d\n", mpp_heap_name(&enc->heap, heap_name, sizeof(heap_name)), ret);
+        goto fail;
+    }
+    ret = mpp_buffer_group_limit_config(enc->group, enc->frame_size, 1);
+    if (ret != MPP_OK) {
+        printf("   MPP内存池限制失败，请重试！\n");
+    }
+    ret = mpp_buffer_get(enc->group, &enc->frame_buf, enc->frame_size);
+    if (ret != MPP_OK || !enc->frame_buf) {
+        printf("   MPP帧缓冲区分配失败: ret=%d\n", ret);
+        goto fail;
+    }
+    enc->input = enc->frame_buf;
+    enc->frame_ptr = mpp_buffer_get_ptr(enc->frame_buf);
+    if (!enc->frame_ptr) {
+        printf("   无法获取MPP缓冲区指针\n");
+        goto fail;
+    }
+    printf("   MPP帧缓冲区分配成功(%s): %p\n",
+           mpp_heap_name(&enc->heap, heap_name, sizeof(heap_name)), enc->frame_ptr);
+    return 0;
+
+fail:
+    mpp_encoder_deinit(enc);
+    return -1;
+}
+
+void mpp_encoder_load_frame(mpp_encoder_t* enc, const void* src, size_t length) {
+    if (length > enc->frame_size) {
+        length = enc->frame_size;
+    }
+    mpp_heap_sync_begin(enc->frame_buf, 0, length);
+    memcpy(enc->frame_ptr, src, length);
+    mpp_heap_sync_end(enc->frame_buf, 0, length);
+    enc->input = enc->frame_buf;
+}
+
+void mpp_encoder_load_frame_stats(mpp_encoder_t* enc, const void* src, size_t length, frame_stats_t* stats) {
+    if (length > enc->frame_size) {
+        length = enc->frame_size;
+    }
+    mpp_heap_sync_begin(enc->frame_buf, 0, length);
+    frame_stats_copy(enc->frame_ptr, src, enc->hor_stride, enc->ver_stride, length, stats);
+    mpp_heap_sync_end(enc->frame_buf, 0, length);
+    enc->input = enc->frame_buf;
+}
+
+int mpp_encoder_alloc_import(mpp_encoder_t* enc, unsigned int count, size_t length, camera_import_buf_t* out) {
+    char heap_name[32];
+    // 单独的缓冲组，输入帧缓冲组限制为1个
+    MPP_RET ret = mpp_buffer_group_get_internal(&enc->import_group, mpp_heap_group_type(&enc->heap));
+    if (ret != MPP_OK) {
+        printf("   导入缓冲组创建失败: %d\n", ret);
+        return -1;
+    }
+    enc->import_bufs = calloc(count, sizeof(MppBuffer));
+    if (!enc->import_bufs) {
+        return -1;
+    }
+    for (unsigned int i = 0; i < count; i++) {
+        ret = mpp_buffer_get(enc->import_group, &enc->import_bufs[i], length);
+        if (ret != MPP_OK || !enc->import_bufs[i]) {
+            printf("   导入缓冲[%u]分配失败: ret=%d\n", i, ret);
+            return -1;
+        }
+        enc->n_import = i + 1;
+        out[i].fd = mpp_buffer_get_fd(enc->import_bufs[i]);
+        out[i].ptr = mpp_buffer_get_ptr(enc->import_bufs[i]);
+        out[i].length = (unsigned int)length;
+    }
+    printf("   导入缓冲分配成功(%s): %u x %zu字节\n",
+           mpp_heap_name(&enc->heap, heap_name, sizeof(heap_name)), count, length);
+    return 0;
+}
+
+int mpp_encoder_use_import(mpp_encoder_t* enc, unsigned int index) {
+    if (index >= enc->n_import) {
+        return -1;
+    }
+    enc->input = enc->import_bufs[index];
+    return 0;
+}
+
+int mpp_encoder_set_crop(mpp_encoder_t* enc, const roi_rect_t* roi) {
+    roi_rect_t r = { 0, 0, enc->hor_stride, enc->ver_stride };
+    if (roi) {
+        r = *roi;
+        if (roi_clip(&r, enc->hor_stride, enc->ver_stride) != 0) {
+            printf("   裁剪区域超出图像范围\n");
+            return -1;
+        }
+    }
+    mpp_enc_cfg_set_s32(enc->cfg, "prep:width", r.width);
+    mpp_enc_cfg_set_s32(enc->cfg, "prep:height", r.height);
+    MPP_RET ret = enc->mpi->control(enc->ctx, MPP_ENC_SET_CFG, enc->cfg);
+    if (ret != MPP_OK) {
+        printf("   ❌ 裁剪配置失败: %d\n", ret);
+        return -1;
+    }
+    enc->crop_x = r.x;
+    enc->crop_y = r.y;
+    enc->width = r.width;
+    enc->height = r.height;
+    return 0;
+}
+
+int mpp_encoder_set_quality(mpp_encoder_t* enc, int quality) {
+    mpp_enc_cfg_set_s32(enc->cfg, "jpeg:q_factor", quality);
+    MPP_RET ret = enc->mpi->control(enc->ctx, MPP_ENC_SET_CFG, enc->cfg);
+    if (ret != MPP_OK) {
+        printf("   ❌ 质量配置失败: %d\n", ret);
+        mpp_enc_cfg_set_s32(enc->cfg, "jpeg:q_factor", enc->quality);
+        return -1;
+    }
+    enc->quality = quality;
+    return 0;
+}
+
+int mpp_encoder_set_size(mpp_encoder_t* enc, int width, int height) {
+    if (width <= 0 || height <= 0 || (size_t)width * height * 3 / 2 > enc->frame_size) {
+        printf("   %dx%d 超出输入帧缓冲(%zu字节)\n", width, height, enc->frame_size);
+        return -1;
+    }
+    mpp_enc_cfg_set_s32(enc->cfg, "prep:width", width);
+    mpp_enc_cfg_set_s32(enc->cfg, "prep:height", height);
+    mpp_enc_cfg_set_s32(enc->cfg, "prep:hor_stride", width);
+    mpp_enc_cfg_set_s32(enc->cfg, "prep:ver_stride", height);
+    MPP_RET ret = enc->mpi->control(enc->ctx, MPP_ENC_SET_CFG, enc->cfg);
+    if (ret != MPP_OK) {
+        printf("   ❌ 尺寸配置失败: %d\n", ret);
+        return -1;
+    }
+    // 新尺寸下原裁剪区域失去意义，恢复整帧
+    enc->hor_stride = width;
+    enc->ver_stride = height;
+    enc->width = width;
+    enc->height = height;
+    enc->crop_x = 0;
+    enc->crop_y = 0;
+    return 0;
+}
+
+MPP_RET mpp_encoder_encode(mpp_encoder_t* enc, MppBuffer output, int eos, size_t* length) {
+    MppFrame frame = NULL;
+    MppPacket packet = NULL;
+    MppPacket out_packet = NULL;
+    MPP_RET ret;
+
+    *length = 0;
+    ret = mpp_frame_init(&frame);
+    if (ret != MPP_OK) {
+        return ret;
+    }
+    mpp_frame_set_buffer(frame, enc->input);
+    mpp_frame_set_width(frame, enc->width);
+    mpp_frame_set_height(frame, enc->height);
+    mpp_frame_set_hor_stride(frame, enc->hor_stride);
+    mpp_frame_set_ver_stride(frame, enc->ver_stride);
+    mpp_frame_set_offset_x(frame, enc->crop_x);
+    mpp_frame_set_offset_y(frame, enc->crop_y);
+    mpp_frame_set_fmt(frame, MPP_FMT_YUV420SP);
+    mpp_frame_set_eos(frame, eos);
+
+    ret = mpp_packet_init_with_buffer(&packet, output);
+    if (ret != MPP_OK) {
+        printf("   ❌ 包初始化失败: %d\n", ret);
+        mpp_frame_deinit(&frame);
+        return ret;
+    }
+    mpp_packet_set_length(packet, 0);
+    mpp_meta_set_packet(mpp_frame_get_meta(frame), KEY_OUTPUT_PACKET, packet);
+
+    uint64_t frame_id = trace_current_frame();
+    uint64_t t0 = trace_begin();
+    ret = enc->mpi->encode_put_frame(enc->ctx, frame);
+    trace_end(TRACE_ENCODE_PUT, frame_id, t0, 0);
+    if (ret == MPP_OK) {
+        t0 = trace_begin();
+        ret = enc->mpi->encode_get_packet(enc->ctx, &out_packet);
+        trace_end(TRACE_ENCODE_GET, frame_id, t0, out_packet ? (uint32_t)mpp_packet_get_length(out_packet) : 0);
+    }
+    if (ret == MPP_OK && out_packet) {
+        *length = mpp_packet_get_length(out_packet);
+        if (out_packet != packet) {
+            mpp_packet_deinit(&out_packet);
+        }
+    } else if (ret == MPP_OK) {
+        ret = MPP_NOK;
+    }
+    mpp_packet_deinit(&packet);
+    mpp_frame_deinit(&frame);
+    return ret;
+}
+
+enc_packet_t* mpp_encoder_encode_packet(mpp_encoder_t* enc, packet_pool_t* pool, int eos) {
+    for (int attempt = 0; attempt < PACKET_POOL_CLASSES; attempt++) {
+        enc_packet_t* pkt = packet_pool_acquire(pool);
+        if (!pkt) {
+            printf("   包缓冲池耗尽\n");
+            metrics_drop(METRIC_DROP_POOL_EXHAUSTED);
+            return NULL;
+        }
+        size_t cap = packet_pool_capacity(pkt);
+        size_t len = 0;
+        MPP_RET ret = mpp_encoder_encode(enc, packet_pool_buffer(pkt), eos, &len);
+        if (ret == MPP_OK && len + MPP_ENCODER_OVERFLOW_MARGIN <= cap) {
+            pkt->length = len;
+            packet_pool_observe(pool, len);
+            return pkt;
+        }
+        if (ret == MPP_ERR_TIMEOUT) {
+            // 先复位，硬件不再写这个输出缓冲后才能还给缓冲池
+            printf("   编码超时(%dms)，复位编码器\n", MPP_ENCODER_OUTPUT_TIMEOUT_MS);
+            mpp_encoder_reset(enc);
+            enc_packet_unref(pkt);
+            break;
+        }
+        // 已是最大级别仍失败，说明不是缓冲不足
+        int largest = cap >= pool->classes[PACKET_POOL_CLASSES - 1].size;
+        if (!largest) {
+            packet_pool_overflow(pool, pkt);
+        }
+        enc_packet_unref(pkt);
+        if (largest) {
+            printf("   编码失败: %d\n", ret);
+            break;
+        }
+    }
+    metrics_drop(METRIC_DROP_ENCODE_ERROR);
+    return NULL;
+}
+
+int mpp_encoder_reset(mpp_encoder_t* enc) {
+    uint64_t t0 = metrics_now_us();
+    MPP_RET ret = enc->mpi->reset(enc->ctx);
+    if (ret == MPP_OK) {
+        ret = enc->mpi->control(enc->ctx, MPP_ENC_SET_CFG, enc->cfg);
+    }
+    metrics_count(METRIC_ENCODER_RESETS, 1);
+    metrics_observe_us(METRIC_STAGE_RECOVERY, metrics_now_us() - t0);
+    if (ret != MPP_OK) {
+        printf("   编码器复位失败: %d\n", ret);
+        return -1;
+    }
+    return 0;
+}
+
+void mpp_encoder_deinit(mpp_encoder_t* enc) {
+    if (enc->frame_buf) {
+        mpp_buffer_put(enc->frame_buf);
+        enc->frame_buf = NULL;
+    }
+    for (unsigned int i = 0; i < enc->n_import; i++) {
+        mpp_buffer_put(enc->import_bufs[i]);
+    }
+    free(enc->import_bufs);
+    enc->import_bufs = NULL;
+    enc->n_import = 0;
+    if (enc->import_group) {
+        mpp_buffer_group_put(enc->import_group);
+        enc->import_group = NULL;
+    }
+    enc->input = NULL;
+    if (enc->cfg) {
+        if (mpp_enc_cfg_deinit(enc->cfg) != MPP_OK) {
+            printf("   编码配置释放失败\n");
+        }
+        enc->cfg = NULL;
+    }
+    if (enc->group) {
+        if (mpp_buffer_group_put(enc->group) != MPP_OK) {
+            printf("   缓冲组释放失败\n");
+        }
+        enc->group = NULL;
+    }
+    if (enc->ctx) {
+        if (mpp_destroy(enc->ctx) != MPP_OK) {
+            printf("   MPP释放失败\n");
+        }
+        enc->ctx = NULL;
+    }
+}
@@ -0,0 +1,184 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include "packet_pool.h"
+#include "metrics.h"
+#include "mem_arena.h"
+
+static size_t align_4k(size_t v) {
+    return (v + 4095) & ~(size_t)4095;
+}
+
+static void free_push(packet_pool_t* pool, packet_pool_class_t* cls, uint32_t idx) {
+    mem_stack_push(&cls->free_head, &pool->entries[0].next, sizeof(pool->entries[0]), idx);
+}
+
+static int free_pop(packet_pool_t* pool, packet_pool_class_t* cls) {
+    return mem_stack_pop(&cls->free_head, &pool->entries[0].next, sizeof(pool->entries[0]));
+}
+
+/**
+ * @brief 最后一个引用释放时归还到所属级别
+ */
+static void packet_pool_release(enc_packet_t* pkt) {
+    packet_pool_entry_t* e = (packet_pool_entry_t*)pkt;
+    packet_pool_t* pool = e->pool;
+    packet_pool_class_t* cls = &pool->classes[e->cls];
+    atomic_fetch_sub_explicit(&cls->in_use, 1, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&pool->bytes_in_use, cls->size, memory_order_relaxed);
+    free_push(pool, cls, (uint32_t)(e - pool->entries));
+}
+
+/**
+ * @brief 向 MPP 申请一个缓冲，只在编码线程调用
+ */
+static int pool_grow(packet_pool_t* pool, int c) {
+    packet_pool_class_t* cls = &pool->classes[c];
+    int idx;
+    if (pool->n_spare > 0) {
+        idx = pool->spare[--pool->n_spare];
+    } else {
+        idx = atomic_fetch_add(&pool->n_entries, 1);
+        if (idx >= PACKET_POOL_MAX_ENTRIES) {
+            atomic_fetch_sub(&pool->n_entries, 1);
+            return -1;
+        }
+    }
+    packet_pool_entry_t* e = &pool->entries[idx];
+    MPP_RET ret = mpp_buffer_get(pool->group, &e->buf, cls->size);
+    if (ret != MPP_OK || !e->buf) {
+        printf("   包缓冲池扩容失败: 级别%d, 大小=%zu, ret=%d\n", c, cls->size, ret);
+        // 一时的内存紧张不应永久占掉描述符：留待下次扩容复用；n_entries 保持单调，deinit 跳过空缓冲
+        e->buf = NULL;
+        pool->spare[pool->n_spare++] = idx;
+        return -1;
+    }
+    e->pool = pool;
+    e->cls = c;
+    e->pkt.data = mpp_buffer_get_ptr(e->buf);
+    e->pkt.release = packet_pool_release;
+    e->pkt.opaque = e;
+    atomic_fetch_add(&cls->allocated, 1);
+    uint64_t total = atomic_fetch_add(&pool->bytes_allocated, cls->size) + cls->size;
+    metrics_gauge_set(METRIC_PACKET_POOL_BYTES, (int64_t)total);
+    return idx;
+}
+
+int packet_pool_init(packet_pool_t* pool, MppBufferType type, size_t base_size, size_t max_size) {
+    memset(pool, 0, sizeof(*pool));
+    MPP_RET ret = mpp_buffer_group_get_internal(&pool->group, type);
+    if (ret != MPP_OK) {
+        printf("   包缓冲池创建失败: %d\n", ret);
+        return -1;
+    }
+    max_size = align_4k(max_size);
+    size_t size = align_4k(base_size ? base_size : max_size / 8);
+    for (int c = 0; c < PACKET_POOL_CLASSES; c++) {
+        if (c == PACKET_POOL_CLASSES - 1 || size > max_size) {
+            size = max_size;
+        }
+        pool->classes[c].size = size;
+        size *= 2;
+    }
+    pool->expected = pool->classes[0].size;
+    printf("   包缓冲池创建成功: 级别大小 %zu/%zu/%zu/%zu\n",
+           pool->classes[0].size, pool->classes[1].size, pool->classes[2].size, pool->classes[3].size);
+    return 0;
+}
+
+enc_packet_t* packet_pool_acquire(packet_pool_t* pool) {
+    int start = PACKET_POOL_CLASSES - 1;
+    for (int c = 0; c < PACKET_POOL_CLASSES; c++) {
+        if (pool->classes[c].size >= pool->expected) {
+            start = c;
+            break;
+        }
+    }
+
+    int idx = -1;
+    int c = start;
+    // 先取合适级别的空闲缓冲，没有则扩容，再不行退到更大的级别
+    idx = free_pop(pool, &pool->classes[c]);
+    if (idx < 0) {
+        idx = pool_grow(pool, c);
+    }
+    for (c = start + 1; idx < 0 && c < PACKET_POOL_CLASSES; c++) {
+        idx = free_pop(pool, &pool->classes[c]);
+    }
+    if (idx < 0) {
+        return NULL;
+    }
+
+    packet_pool_entry_t* e = &pool->entries[idx];
+    packet_pool_class_t* cls = &pool->classes[e->cls];
+    int in_use = atomic_fetch_add_explicit(&cls->in_use, 1, memory_order_relaxed) + 1;
+    if (in_use > atomic_load_explicit(&cls->in_use_hwm, memory_order_relaxed)) {
+        atomic_store_explicit(&cls->in_use_hwm, in_use, memory_order_relaxed);
+    }
+    atomic_fetch_add_explicit(&cls->acquires, 1, memory_order_relaxed);
+    uint64_t bytes = atomic_fetch_add_explicit(&pool->bytes_in_use, cls->size, memory_order_relaxed) + cls->size;
+    if (bytes > pool->bytes_hwm) {
+        pool->bytes_hwm = bytes;
+        metrics_gauge_set(METRIC_PACKET_POOL_BYTES_HWM, (int64_t)bytes);
+    }
+
+    atomic_init(&e->pkt.refs, 1);
+    e->pkt.length = 0;
+    e->pkt.seq = 0;
+    e->pkt.timestamp_us = 0;
+    e->pkt.flags = 0;
+    e->pkt.stats.valid = 0;
+    return &e->pkt;
+}
+
+void packet_pool_observe(packet_pool_t* pool, size_t length) {
+    pool->window[pool->window_pos++ % PACKET_POOL_WINDOW] = length;
+    if (length > pool->observed_max) {
+        pool->observed_max = length;
+    }
+    size_t max = 0;
+    for (int i = 0; i < PACKET_POOL_WINDOW; i++) {
+        if (pool->window[i] > max) {
+            max = pool->window[i];
+        }
+    }
+    // 留25%余量，场景变复杂时不至于立刻溢出
+    pool->expected = max + max / 4;
+}
+
+void packet_pool_overflow(packet_pool_t* pool, enc_packet_t* pkt) {
+    packet_pool_entry_t* e = (packet_pool_entry_t*)pkt;
+    pool->overflows++;
+    pool->expected = pool->classes[e->cls].size + 1;
+    printf("   包缓冲溢出: 级别%d(%zu字节)，提升到下一级\n", e->cls, pool->classes[e->cls].size);
+}
+
+void packet_pool_report(const packet_pool_t* pool) {
+    printf("   ===包缓冲池统计===\n");
+    for (int c = 0; c < PACKET_POOL_CLASSES; c++) {
+        const packet_pool_class_t* cls = &pool->classes[c];
+        printf("   级别%d: 大小=%zu, 已分配=%d, 借出高水位=%d, 借出次数=%llu\n",
+               c, cls->size, atomic_load(&cls->allocated), atomic_load(&cls->in_use_hwm),
+               (unsigned long long)atomic_load(&cls->acquires));
+    }
+    printf("   已分配总量=%llu字节, 借出高水位=%llu字节, 最大包=%zu字节, 溢出重编=%llu次\n",
+           (unsigned long long)atomic_load(&pool->bytes_allocated), (unsigned long long)pool->bytes_hwm,
+           pool->observed_max, (unsigned long long)pool->overflows);
+}
+
+void packet_pool_deinit(packet_pool_t* pool) {
+    int n = atomic_load(&pool->n_entries);
+    if (n > PACKET_POOL_MAX_ENTRIES) {
+        n = PACKET_POOL_MAX_ENTRIES;
+    }
+    for (int i = 0; i < n; i++) {
+        if (pool->entries[i].buf) {
+            mpp_buffer_put(pool->entries[i].buf);
+            pool->entries[i].buf = NULL;
+        }
+    }
+    if (pool->group) {
+        mpp_buffer_group_put(pool->group);
+        pool->group = NULL;
+    }
+}
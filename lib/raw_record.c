@@ -0,0 +1,305 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "raw_record.h"
+#include "metrics.h"
+#include "trace.h"
+
+static size_t align_up(size_t v, size_t a) {
+    return (v + a - 1) & ~(a - 1);
+}
+
+static int pwrite_all(raw_record_t* r, const void* data, size_t len, off_t off) {
+    const uint8_t* p = data;
+    while (len > 0) {
+        ssize_t n = pwrite(r->fd, p, len, off);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && errno == EINVAL && r->direct) {
+            // 打开时接受了 O_DIRECT，写入时才发现不支持
+            int flags = fcntl(r->fd, F_GETFL);
+            fcntl(r->fd, F_SETFL, flags & ~O_DIRECT);
+            r->direct = 0;
+            printf("   录制文件不支持O_DIRECT，改为普通写入\n");
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+        off += n;
+    }
+    return 0;
+}
+
+static void record_write(raw_record_t* r, const raw_record_item_t* it) {
+    const void* src = it->data;
+    off_t off = (off_t)(r->n_written * r->slot_size);
+    if (r->bounce) {
+        memcpy(r->bounce, it->data, r->frame_size);
+        src = r->bounce;
+    }
+
+    uint64_t t0 = metrics_now_us();
+    uint64_t tt = trace_begin();
+    int ret = pwrite_all(r, src, r->slot_size, off);
+    if (ret == 0 && !r->direct) {
+        // 普通写入：发起本帧回写，等上一帧落盘后丢弃其页缓存，避免录制把内存挤满
+        sync_file_range(r->fd, off, (off_t)r->slot_size, SYNC_FILE_RANGE_WRITE);
+        if (off > 0) {
+            off_t prev = off - (off_t)r->slot_size;
+            sync_file_range(r->fd, prev, (off_t)r->slot_size,
+                            SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+            posix_fadvise(r->fd, prev, (off_t)r->slot_size, POSIX_FADV_DONTNEED);
+        }
+    }
+    trace_end(TRACE_WRITE, it->trace_frame, tt, (uint32_t)r->slot_size);
+    uint64_t us = metrics_now_us() - t0;
+    metrics_observe_us(METRIC_STAGE_WRITE, us);
+
+    // 数据已写出(或已拷到中转缓冲)，缓冲区可以交还驱动
+    uint32_t dh = atomic_load_explicit(&r->done_head, memory_order_relaxed);
+    r->done[dh & (RAW_RECORD_DEPTH - 1)] = it->index;
+    atomic_store_explicit(&r->done_head, dh + 1, memory_order_release);
+
+    if (ret != 0) {
+        printf("   ❌ 录制写入失败: %s\n", strerror(errno));
+        metrics_drop(METRIC_DROP_WRITE_ERROR);
+        return;
+    }
+    // 索引逐条 pwrite，进程崩溃时已写出的帧仍能从索引找到
+    raw_record_entry_t e = { it->seq, it->timestamp_us, (uint64_t)off, (uint32_t)r->frame_size, 0 };
+    off_t idx_off = (off_t)(sizeof(raw_record_header_t) + r->n_written * sizeof(e));
+    if (pwrite(r->idx_fd, &e, sizeof(e), idx_off) != (ssize_t)sizeof(e)) {
+        printf("   ❌ 索引写入失败: %s\n", strerror(errno));
+        metrics_drop(METRIC_DROP_WRITE_ERROR);
+        return;
+    }
+    r->n_written++;
+    r->write_us_sum += us;
+    if (us > r->write_us_max) {
+        r->write_us_max = us;
+    }
+    metrics_count(METRIC_BYTES_WRITTEN, r->slot_size);
+}
+
+static void* record_thread(void* arg) {
+    raw_record_t* r = arg;
+    for (;;) {
+        while (sem_wait(&r->items) != 0) {
+        }
+        uint32_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+        uint32_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+        if (tail == head) {
+            if (!atomic_load(&r->running)) {
+                break;
+            }
+            continue;
+        }
+        raw_record_item_t it = r->queue[tail & (RAW_RECORD_DEPTH - 1)];
+        atomic_store_explicit(&r->tail, tail + 1, memory_order_release);
+        record_write(r, &it);
+    }
+    return NULL;
+}
+
+int raw_record_open(raw_record_t* r, const char* base, int width, int height, uint32_t pixelformat,
+                    size_t frame_size, size_t src_length, uint64_t max_frames, unsigned int max_inflight) {
+    char path[4096];
+    memset(r, 0, sizeof(*r));
+    r->frame_size = frame_size;
+    r->slot_size = align_up(frame_size, RAW_RECORD_ALIGN);
+    r->src_length = src_length;
+    r->max_frames = max_frames;
+    r->max_inflight = max_inflight < 1 ? 1 : max_inflight > RAW_RECORD_DEPTH ? RAW_RECORD_DEPTH : max_inflight;
+
+    snprintf(path, sizeof(path), "%s.nv12", base);
+    r->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_DIRECT, 0644);
+    r->direct = r->fd >= 0;
+    if (r->fd < 0 && errno == EINVAL) {
+        r->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    }
+    if (r->fd < 0) {
+        printf("   无法创建录制文件: %s (%s)\n", path, strerror(errno));
+        return -1;
+    }
+    // 预分配，录制过程中不再分配块
+    if (fallocate(r->fd, 0, 0, (off_t)(max_frames * r->slot_size)) != 0) {
+        printf("   录制文件预分配失败(%s)，继续录制\n", strerror(errno));
+    }
+    // 缓冲区不足一个槽位时必须经中转写出，否则会从缓冲区末尾之后读
+    if (src_length < r->slot_size) {
+        if (posix_memalign((void**)&r->bounce, RAW_RECORD_ALIGN, r->slot_size) != 0) {
+            printf("   录制中转缓冲分配失败\n");
+            r->bounce = NULL;
+            close(r->fd);
+            return -1;
+        }
+        memset(r->bounce, 0, r->slot_size);
+    }
+
+    snprintf(path, sizeof(path), "%s.idx", base);
+    r->idx_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (r->idx_fd < 0) {
+        printf("   无法创建索引文件: %s (%s)\n", path, strerror(errno));
+        close(r->fd);
+        free(r->bounce);
+        return -1;
+    }
+    raw_record_header_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, RAW_RECORD_MAGIC, sizeof(hdr.magic));
+    hdr.width = (uint32_t)width;
+    hdr.height = (uint32_t)height;
+    hdr.pixelformat = pixelformat;
+    hdr.frame_size = (uint32_t)frame_size;
+    hdr.slot_size = (uint32_t)r->slot_size;
+    if (pwrite(r->idx_fd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr)) {
+        printf("   索引文件写入失败: %s\n", strerror(errno));
+        close(r->idx_fd);
+        close(r->fd);
+        free(r->bounce);
+        return -1;
+    }
+
+    atomic_init(&r->running, 1);
+    if (sem_init(&r->items, 0, 0) != 0 || pthread_create(&r->thread, NULL, record_thread, r) != 0) {
+        printf("   录制线程创建失败\n");
+        close(r->idx_fd);
+        close(r->fd);
+        free(r->bounce);
+        return -1;
+    }
+    printf("   原始录制: %s.nv12, 每帧%zu字节(槽位%zu), 预分配%llu帧, %s\n", base, frame_size, r->slot_size,
+           (unsigned long long)max_frames, r->direct ? "O_DIRECT" : "普通写入");
+    return 0;
+}
+
+int raw_record_submit(raw_record_t* r, unsigned int index, const void* data, uint64_t seq, uint64_t timestamp_us) {
+    uint32_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    uint32_t reaped = atomic_load_explicit(&r->done_tail, memory_order_relaxed);
+    if (head - reaped >= r->max_inflight || head >= r->max_frames) {
+        r->dropped++;
+        trace_instant(TRACE_WRITE_SUBMIT, trace_current_frame(), 0);
+        metrics_drop(METRIC_DROP_RECORD_FULL);
+        return -1;
+    }
+    raw_record_item_t* it = &r->queue[head & (RAW_RECORD_DEPTH - 1)];
+    it->data = data;
+    it->index = index;
+    it->seq = seq;
+    it->timestamp_us = timestamp_us;
+    it->trace_frame = trace_current_frame();
+    trace_instant(TRACE_WRITE_SUBMIT, it->trace_frame, (uint32_t)r->frame_size);
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+    sem_post(&r->items);
+    return 0;
+}
+
+int raw_record_reap(raw_record_t* r, unsigned int* index) {
+    uint32_t tail = atomic_load_explicit(&r->done_tail, memory_order_relaxed);
+    if (tail == atomic_load_explicit(&r->done_head, memory_order_acquire)) {
+        return 0;
+    }
+    *index = r->done[tail & (RAW_RECORD_DEPTH - 1)];
+    atomic_store_explicit(&r->done_tail, tail + 1, memory_order_release);
+    return 1;
+}
+
+void raw_record_close(raw_record_t* r) {
+    atomic_store(&r->running, 0);
+    sem_post(&r->items);
+    pthread_join(r->thread, NULL);
+    sem_destroy(&r->items);
+
+    fsync(r->idx_fd);
+    close(r->idx_fd);
+    if (ftruncate(r->fd, (off_t)(r->n_written * r->slot_size)) != 0) {
+        perror("录制文件截断失败");
+    }
+    fsync(r->fd);
+    close(r->fd);
+    free(r->bounce);
+    r->bounce = NULL;
+
+    printf("   ===原始录制统计===\n");
+    printf("   写入%llu帧(%.1fMB), 队列满丢弃%llu帧, 平均写入%.2fms, 最长%.2fms\n",
+           (unsigned long long)r->n_written, r->n_written * (double)r->slot_size / 1e6,
+           (unsigned long long)r->dropped,
+           r->n_written ? r->write_us_sum / 1000.0 / r->n_written : 0.0, r->write_us_max / 1000.0);
+}
+
+int raw_reader_open(raw_reader_t* reader, const char* base) {
+    char path[4096];
+    struct stat st;
+    memset(reader, 0, sizeof(*reader));
+
+    snprintf(path, sizeof(path), "%s.idx", base);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0 || fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(raw_record_header_t)) {
+        printf("无法读取索引: %s\n", path);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    reader->idx_size = (size_t)st.st_size;
+    reader->idx_map = mmap(NULL, reader->idx_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (reader->idx_map == MAP_FAILED) {
+        reader->idx_map = NULL;
+        return -1;
+    }
+    memcpy(&reader->header, reader->idx_map, sizeof(reader->header));
+    if (memcmp(reader->header.magic, RAW_RECORD_MAGIC, sizeof(reader->header.magic)) != 0) {
+        printf("索引格式错误: %s\n", path);
+        raw_reader_close(reader);
+        return -1;
+    }
+    reader->entries = (const raw_record_entry_t*)((const uint8_t*)reader->idx_map + sizeof(raw_record_header_t));
+    reader->count = (reader->idx_size - sizeof(raw_record_header_t)) / sizeof(raw_record_entry_t);
+
+    snprintf(path, sizeof(path), "%s.nv12", base);
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        printf("无法读取录制数据: %s\n", path);
+        if (fd >= 0) {
+            close(fd);
+        }
+        raw_reader_close(reader);
+        return -1;
+    }
+    reader->data_size = (size_t)st.st_size;
+    if (reader->data_size > 0) {
+        void* map = mmap(NULL, reader->data_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (map == MAP_FAILED) {
+            close(fd);
+            raw_reader_close(reader);
+            return -1;
+        }
+        madvise(map, reader->data_size, MADV_SEQUENTIAL);
+        reader->data = map;
+    }
+    close(fd);
+    return 0;
+}
+
+void raw_reader_close(raw_reader_t* reader) {
+    if (reader->data) {
+        munmap((void*)reader->data, reader->data_size);
+        reader->data = NULL;
+    }
+    if (reader->idx_map) {
+        munmap(reader->idx_map, reader->idx_size);
+        reader->idx_map = NULL;
+    }
+    reader->count = 0;
+}
@@ -0,0 +1,100 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <alloca.h>
+#include <sys/mman.h>
+#include "rt_sched.h"
+
+int rt_sched_parse(const char* spec, rt_sched_t* sched) {
+    char* end;
+    long cpu = strtol(spec, &end, 10);
+    if (end == spec || cpu < 0 || cpu >= CPU_SETSIZE) {
+        return -1;
+    }
+    sched->cpu = (int)cpu;
+    sched->priority = 0;
+    if (*end == ':') {
+        const char* p = end + 1;
+        long prio = strtol(p, &end, 10);
+        if (end == p || prio < 0 || prio > 99) {
+            return -1;
+        }
+        sched->priority = (int)prio;
+    }
+    return *end == '\0' ? 0 : -1;
+}
+
+int rt_sched_apply(const char* name, const rt_sched_t* sched) {
+    int ret = 0;
+    pthread_t self = pthread_self();
+    if (name) {
+        pthread_setname_np(self, name);
+    }
+    if (!sched || (sched->cpu < 0 && sched->priority <= 0)) {
+        return 0;
+    }
+    if (sched->cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(sched->cpu, &set);
+        int err = pthread_setaffinity_np(self, sizeof(set), &set);
+        if (err != 0) {
+            printf("   线程%s绑定CPU%d失败: %s\n", name ? name : "", sched->cpu, strerror(err));
+            ret = -1;
+        }
+    }
+    if (sched->priority > 0) {
+        struct sched_param param = { .sched_priority = sched->priority };
+        int err = pthread_setschedparam(self, SCHED_FIFO, &param);
+        if (err != 0) {
+            // 常见原因：没有 CAP_SYS_NICE 或 RLIMIT_RTPRIO 为0
+            printf("   线程%s设置SCHED_FIFO %d失败: %s\n", name ? name : "", sched->priority, strerror(err));
+            ret = -1;
+        }
+    }
+    if (ret == 0) {
+        printf("   线程%s: CPU%d, %s %d\n", name ? name : "", sched->cpu,
+               sched->priority > 0 ? "SCHED_FIFO" : "SCHED_OTHER", sched->priority);
+    }
+    return ret;
+}
+
+int rt_sched_lock_memory(void) {
+    // 释放的堆内存不再归还内核，大块分配也不走 mmap，锁定后的页一直保留
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        perror("mlockall失败");
+        return -1;
+    }
+    return 0;
+}
+
+void rt_sched_prefault(void* addr, size_t length, int write) {
+    long page = sysconf(_SC_PAGESIZE);
+    volatile uint8_t* p = addr;
+    if (!addr || page <= 0) {
+        return;
+    }
+    for (size_t off = 0; off < length; off += (size_t)page) {
+        if (write) {
+            p[off] = 0;
+        } else {
+            (void)p[off];
+        }
+    }
+}
+
+void rt_sched_prefault_stack(size_t length) {
+    uint8_t* buf = alloca(length);
+    rt_sched_prefault(buf, length, 1);
+    // 防止编译器把访问优化掉
+    __asm__ __volatile__("" : : "r"(buf) : "memory");
+}
@@ -0,0 +1,167 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include "segment_writer.h"
+#include "metrics.h"
+#include "trace.h"
+
+static void segment_close(segment_writer_t* w) {
+    if (!w->fp) {
+        return;
+    }
+    // 段切换时落盘，掉电最多丢失当前段
+    uint64_t t0 = trace_begin();
+    fflush(w->fp);
+    fdatasync(fileno(w->fp));
+    trace_end(TRACE_FSYNC, w->seg_last_seq, t0, 0);
+    fclose(w->fp);
+    w->fp = NULL;
+    printf("   录像段%05u: %llu帧, %.1fs, %.2fMB\n", w->index, (unsigned long long)w->seg_frames,
+           (w->seg_last_us - w->seg_start_us) / 1e6, w->seg_bytes / 1e6);
+    w->index++;
+}
+
+static int segment_open(segment_writer_t* w, uint64_t start_us) {
+    char path[320];
+    snprintf(path, sizeof(path), "%s_%05u.%s", w->prefix, w->index, w->ext);
+    w->fp = fopen(path, "wb");
+    if (!w->fp) {
+        printf("   无法创建录像文件: %s (%s)\n", path, strerror(errno));
+        return -1;
+    }
+    setvbuf(w->fp, NULL, _IOFBF, 256 * 1024);
+    w->seg_start_us = start_us;
+    w->seg_last_us = start_us;
+    w->seg_bytes = 0;
+    w->seg_frames = 0;
+    return 0;
+}
+
+static void segment_write(segment_writer_t* w, enc_packet_t* pkt) {
+    if (pkt->flags & ENC_PACKET_FLAG_KEY) {
+        if (!w->fp || pkt->timestamp_us - w->seg_start_us >= w->segment_us) {
+            segment_close(w);
+            segment_open(w, pkt->timestamp_us);
+        }
+    }
+    if (!w->fp) {
+        // 还没有可以开始解码的段
+        enc_packet_unref(pkt);
+        return;
+    }
+    metrics_rusage_mark_t mark;
+    metrics_rusage_mark(&mark);
+    uint64_t t0 = metrics_now_us();
+    uint64_t tt = trace_begin();
+    size_t n = fwrite(pkt->data, 1, pkt->length, w->fp);
+    trace_end(TRACE_WRITE, pkt->seq, tt, (uint32_t)pkt->length);
+    metrics_observe_us(METRIC_STAGE_WRITE, metrics_now_us() - t0);
+    metrics_rusage_stage(METRIC_STAGE_WRITE, &mark);
+    if (n != pkt->length) {
+        metrics_drop(METRIC_DROP_WRITE_ERROR);
+        printf("   ❌ 录像写入失败: %s\n", strerror(errno));
+        // 本段已损坏，等下一个关键帧开新段
+        fclose(w->fp);
+        w->fp = NULL;
+        w->index++;
+    } else {
+        metrics_count(METRIC_BYTES_WRITTEN, pkt->length);
+        w->seg_bytes += pkt->length;
+        w->seg_frames++;
+        w->seg_last_us = pkt->timestamp_us;
+        w->seg_last_seq = pkt->seq;
+        w->total_bytes += pkt->length;
+    }
+    enc_packet_unref(pkt);
+}
+
+static void* segment_writer_thread(void* arg) {
+    segment_writer_t* w = arg;
+    rt_sched_apply("mipi_segment", &w->sched);
+    for (;;) {
+        while (sem_wait(&w->items) != 0) {
+        }
+        uint32_t tail = atomic_load_explicit(&w->tail, memory_order_relaxed);
+        uint32_t head = atomic_load_explicit(&w->head, memory_order_acquire);
+        if (tail == head) {
+            if (!atomic_load(&w->running)) {
+                break;
+            }
+            continue;
+        }
+        enc_packet_t* pkt = w->queue[tail & (SEGMENT_WRITER_DEPTH - 1)];
+        atomic_store_explicit(&w->tail, tail + 1, memory_order_release);
+        segment_write(w, pkt);
+    }
+    return NULL;
+}
+
+int segment_writer_start(segment_writer_t* w, const char* prefix, const char* ext, int segment_sec,
+                         const rt_sched_t* sched) {
+    static const rt_sched_t none = RT_SCHED_NONE;
+    memset(w, 0, sizeof(*w));
+    snprintf(w->prefix, sizeof(w->prefix), "%s", prefix);
+    w->ext = ext;
+    w->segment_us = (uint64_t)(segment_sec > 0 ? segment_sec : 60) * 1000000;
+    w->sched = sched ? *sched : none;
+    w->need_key = 1;
+    atomic_init(&w->head, 0);
+    atomic_init(&w->tail, 0);
+    atomic_init(&w->running, 1);
+    atomic_init(&w->key_wanted, 0);
+    if (sem_init(&w->items, 0, 0) != 0) {
+        perror("录像写线程信号量初始化失败");
+        return -1;
+    }
+    if (pthread_create(&w->thread, NULL, segment_writer_thread, w) != 0) {
+        printf("   录像写线程创建失败\n");
+        sem_destroy(&w->items);
+        return -1;
+    }
+    return 0;
+}
+
+int segment_writer_submit(segment_writer_t* w, enc_packet_t* pkt) {
+    uint32_t head = atomic_load_explicit(&w->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&w->tail, memory_order_acquire);
+    if (pkt->flags & ENC_PACKET_FLAG_KEY) {
+        w->need_key = 0;
+    }
+    if (w->need_key || head - tail >= SEGMENT_WRITER_DEPTH) {
+        // 丢掉一个参考帧后，直到下一个关键帧之前的帧都无法解码
+        if (!w->need_key) {
+            w->need_key = 1;
+            atomic_store_explicit(&w->key_wanted, 1, memory_order_relaxed);
+        }
+        w->dropped++;
+        trace_instant(TRACE_WRITE_SUBMIT, pkt->seq, 0);
+        metrics_drop(METRIC_DROP_WRITER_FULL);
+        enc_packet_unref(pkt);
+        return -1;
+    }
+    trace_instant(TRACE_WRITE_SUBMIT, pkt->seq, (uint32_t)pkt->length);
+    w->queue[head & (SEGMENT_WRITER_DEPTH - 1)] = pkt;
+    atomic_store_explicit(&w->head, head + 1, memory_order_release);
+    sem_post(&w->items);
+    return 0;
+}
+
+void segment_writer_submit_wait(segment_writer_t* w, enc_packet_t* pkt) {
+    uint32_t head = atomic_load_explicit(&w->head, memory_order_relaxed);
+    while (head - atomic_load_explicit(&w->tail, memory_order_acquire) >= SEGMENT_WRITER_DEPTH) {
+        usleep(1000);
+    }
+    segment_writer_submit(w, pkt);
+}
+
+void segment_writer_stop(segment_writer_t* w) {
+    atomic_store(&w->running, 0);
+    sem_post(&w->items);
+    pthread_join(w->thread, NULL);
+    sem_destroy(&w->items);
+    segment_close(w);
+    printf("   录像共%u段, %.2fMB, 丢弃%llu帧\n", w->index, w->total_bytes / 1e6,
+           (unsigned long long)w->dropped);
+}
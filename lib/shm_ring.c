@@ -0,0 +1,381 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "shm_ring.h"
+#include "metrics.h"
+
+#define SHM_RING_PAGE       4096u
+#define SHM_RING_MAX_FDS    4
+
+static size_t align_page(size_t v) {
+    return (v + SHM_RING_PAGE - 1) & ~(size_t)(SHM_RING_PAGE - 1);
+}
+
+/**
+ * @brief 创建共享内存环
+ */
+int shm_ring_create(shm_ring_t* ring, const char* name, uint32_t slot_count, uint32_t slot_size) {
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+    if (slot_count < 2 || slot_size == 0) {
+        printf("   共享内存环参数无效: slots=%u, size=%u\n", slot_count, slot_size);
+        return -1;
+    }
+
+    size_t hdr_size = align_page(sizeof(shm_ring_hdr_t) + slot_count * sizeof(shm_ring_slot_t));
+    size_t stride = align_page(slot_size);
+    size_t total = hdr_size + stride * slot_count;
+
+    ring->fd = memfd_create(name, MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (ring->fd < 0) {
+        perror("memfd_create失败");
+        return -1;
+    }
+    if (ftruncate(ring->fd, (off_t)total) < 0) {
+        perror("memfd设置大小失败");
+        close(ring->fd);
+        ring->fd = -1;
+        return -1;
+    }
+    // 固定大小，读端映射后不会因为截断而 SIGBUS
+    fcntl(ring->fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL);
+
+    void* p = mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, 0);
+    if (p == MAP_FAILED) {
+        perror("memfd映射失败");
+        close(ring->fd);
+        ring->fd = -1;
+        return -1;
+    }
+
+    ring->map_size = total;
+    ring->base = p;
+    ring->hdr = p;
+    ring->hdr->magic = SHM_RING_MAGIC;
+    ring->hdr->version = SHM_RING_VERSION;
+    ring->hdr->slot_count = slot_count;
+    ring->hdr->slot_size = slot_size;
+    ring->hdr->total_size = total;
+    atomic_store_explicit(&ring->hdr->head, 0, memory_order_relaxed);
+    for (uint32_t i = 0; i < slot_count; i++) {
+        atomic_store_explicit(&ring->hdr->slots[i].seq, 0, memory_order_relaxed);
+        ring->hdr->slots[i].payload_off = hdr_size + (uint64_t)stride * i;
+    }
+    atomic_thread_fence(memory_order_release);
+    printf("   共享内存环[%s]创建成功: %u个槽位 x %u字节\n", name, slot_count, slot_size);
+    return 0;
+}
+
+void shm_ring_destroy(shm_ring_t* ring) {
+    if (ring->hdr) {
+        munmap(ring->hdr, ring->map_size);
+        ring->hdr = NULL;
+        ring->base = NULL;
+    }
+    if (ring->fd >= 0) {
+        close(ring->fd);
+        ring->fd = -1;
+    }
+}
+
+void* shm_ring_reserve(shm_ring_t* ring) {
+    uint64_t seq = atomic_load_explicit(&ring->hdr->head, memory_order_relaxed);
+    shm_ring_slot_t* slot = &ring->hdr->slots[seq % ring->hdr->slot_count];
+    // 先标记为写入中，读端看到奇数序号即知道数据不可用
+    atomic_store_explicit(&slot->seq, 2 * seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    ring->reserved_seq = seq;
+    return ring->base + slot->payload_off;
+}
+
+int shm_ring_commit(shm_ring_t* ring, shm_ring_kind_t kind, uint32_t length,
+                    uint32_t width, uint32_t height, uint64_t timestamp_us) {
+    uint64_t seq = ring->reserved_seq;
+    shm_ring_slot_t* slot = &ring->hdr->slots[seq % ring->hdr->slot_count];
+    if (length > ring->hdr->slot_size) {
+        // 槽位保持写入中，head 不前进，下一次预留重用这个序号；读端不会看到这一帧
+        metrics_drop(METRIC_DROP_SHM_OVERSIZE);
+        return -1;
+    }
+    slot->kind = kind;
+    slot->length = length;
+    slot->width = width;
+    slot->height = height;
+    slot->timestamp_us = timestamp_us;
+    atomic_store_explicit(&slot->seq, 2 * seq + 2, memory_order_release);
+    atomic_store_explicit(&ring->hdr->head, seq + 1, memory_order_release);
+    return 0;
+}
+
+int shm_ring_publish(shm_ring_t* ring, shm_ring_kind_t kind, const void* data, size_t length,
+                     uint32_t width, uint32_t height, uint64_t timestamp_us) {
+    // 截断的 JPEG 读端无从分辨，宁可丢弃；在预留之前检查，槽位里原有的帧仍然有效
+    if (length > ring->hdr->slot_size) {
+        metrics_drop(METRIC_DROP_SHM_OVERSIZE);
+        return -1;
+    }
+    void* dst = shm_ring_reserve(ring);
+    memcpy(dst, data, length);
+    return shm_ring_commit(ring, kind, (uint32_t)length, width, height, timestamp_us);
+}
+
+/**
+ * @brief 读端挂载 memfd
+ */
+int shm_ring_attach(shm_ring_reader_t* reader, int fd) {
+    struct stat st;
+    memset(reader, 0, sizeof(*reader));
+    reader->fd = -1;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(shm_ring_hdr_t)) {
+        printf("   共享内存环fd无效\n");
+        return -1;
+    }
+    void* p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        perror("共享内存环映射失败");
+        return -1;
+    }
+    const shm_ring_hdr_t* hdr = p;
+    if (hdr->magic != SHM_RING_MAGIC || hdr->version != SHM_RING_VERSION ||
+        hdr->total_size != (uint64_t)st.st_size) {
+        printf("   共享内存环头部不匹配: magic=0x%x, version=%u\n", hdr->magic, hdr->version);
+        munmap(p, (size_t)st.st_size);
+        return -1;
+    }
+    reader->fd = fd;
+    reader->map_size = (size_t)st.st_size;
+    reader->hdr = hdr;
+    reader->base = p;
+    reader->cursor = atomic_load_explicit(&hdr->head, memory_order_acquire);
+    return 0;
+}
+
+void shm_ring_detach(shm_ring_reader_t* reader) {
+    if (reader->hdr) {
+        munmap((void*)reader->hdr, reader->map_size);
+        reader->hdr = NULL;
+    }
+    if (reader->fd >= 0) {
+        close(reader->fd);
+        reader->fd = -1;
+    }
+}
+
+int shm_ring_read(shm_ring_reader_t* reader, shm_ring_view_t* view, uint64_t* lost) {
+    const shm_ring_hdr_t* hdr = reader->hdr;
+    uint64_t skipped = 0;
+    int got = 0;
+
+    for (;;) {
+        uint64_t head = atomic_load_explicit(&hdr->head, memory_order_acquire);
+        if (reader->cursor >= head) {
+            break;
+        }
+        // 落后超过一圈，最旧的帧已经被覆盖
+        if (head - reader->cursor > hdr->slot_count) {
+            skipped += head - hdr->slot_count - reader->cursor;
+            reader->cursor = head - hdr->slot_count;
+        }
+
+        uint64_t seq = reader->cursor;
+        const shm_ring_slot_t* slot = &hdr->slots[seq % hdr->slot_count];
+        uint64_t s1 = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        if (s1 == 2 * seq + 2) {
+            view->seq = seq;
+            view->kind = slot->kind;
+            view->length = slot->length;
+            view->width = slot->width;
+            view->height = slot->height;
+            view->timestamp_us = slot->timestamp_us;
+            view->data = reader->base + slot->payload_off;
+            atomic_thread_fence(memory_order_acquire);
+            if (atomic_load_explicit(&slot->seq, memory_order_relaxed) == s1) {
+                reader->cursor++;
+                got = 1;
+                break;
+            }
+        }
+        // 读取期间被写端追上
+        skipped++;
+        reader->cursor++;
+    }
+
+    reader->lost += skipped;
+    if (lost) {
+        *lost = skipped;
+    }
+    return got;
+}
+
+int shm_ring_view_valid(const shm_ring_reader_t* reader, const shm_ring_view_t* view) {
+    const shm_ring_slot_t* slot = &reader->hdr->slots[view->seq % reader->hdr->slot_count];
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&slot->seq, memory_order_relaxed) == 2 * view->seq + 2;
+}
+
+// fd 分发线程
+static struct {
+    pthread_t thread;
+    int running;
+    int listen_fd;
+    int fds[SHM_RING_MAX_FDS];
+    int count;
+    char path[108];
+} server = { .listen_fd = -1 };
+
+static void server_send_fds(int cfd) {
+    char payload = (char)server.count;
+    struct iovec iov = { .iov_base = &payload, .iov_len = 1 };
+    union {
+        char buf[CMSG_SPACE(sizeof(int) * SHM_RING_MAX_FDS)];
+        struct cmsghdr align;
+    } ctrl;
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    memset(&ctrl, 0, sizeof(ctrl));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctrl.buf;
+    msg.msg_controllen = CMSG_SPACE(sizeof(int) * server.count);
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * server.count);
+    memcpy(CMSG_DATA(cmsg), server.fds, sizeof(int) * server.count);
+    if (sendmsg(cfd, &msg, MSG_NOSIGNAL) < 0) {
+        perror("共享内存环fd发送失败");
+    }
+}
+
+static void* server_thread(void* arg) {
+    (void)arg;
+    while (__atomic_load_n(&server.running, __ATOMIC_ACQUIRE)) {
+        struct pollfd pfd = { .fd = server.listen_fd, .events = POLLIN };
+        if (poll(&pfd, 1, 200) <= 0 || !(pfd.revents & POLLIN)) {
+            continue;
+        }
+        int cfd = accept4(server.listen_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (cfd < 0) {
+            continue;
+        }
+        server_send_fds(cfd);
+        close(cfd);
+    }
+    return NULL;
+}
+
+int shm_ring_server_start(const char* path, shm_ring_t* rings, int count) {
+    struct sockaddr_un addr;
+    if (count < 1 || count > SHM_RING_MAX_FDS || strlen(path) >= sizeof(addr.sun_path)) {
+        printf("   共享内存环分发参数无效\n");
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (fd < 0) {
+        perror("无法创建分发套接字");
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    unlink(path);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, 4) < 0) {
+        perror("无法监听分发套接字");
+        close(fd);
+        return -1;
+    }
+
+    server.listen_fd = fd;
+    server.count = count;
+    for (int i = 0; i < count; i++) {
+        server.fds[i] = rings[i].fd;
+    }
+    snprintf(server.path, sizeof(server.path), "%s", path);
+    server.running = 1;
+    if (pthread_create(&server.thread, NULL, server_thread, NULL) != 0) {
+        printf("   分发线程创建失败\n");
+        server.running = 0;
+        close(fd);
+        server.listen_fd = -1;
+        unlink(path);
+        return -1;
+    }
+    printf("   共享内存环分发已启动: %s\n", path);
+    return 0;
+}
+
+void shm_ring_server_stop(void) {
+    if (!server.running) {
+        return;
+    }
+    __atomic_store_n(&server.running, 0, __ATOMIC_RELEASE);
+    pthread_join(server.thread, NULL);
+    close(server.listen_fd);
+    server.listen_fd = -1;
+    unlink(server.path);
+}
+
+int shm_ring_connect(const char* path, int* fds, int max_fds) {
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path) || max_fds < 1) {
+        return -1;
+    }
+    int sfd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sfd < 0) {
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    if (connect(sfd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        perror("无法连接分发套接字");
+        close(sfd);
+        return -1;
+    }
+
+    char payload;
+    struct iovec iov = { .iov_base = &payload, .iov_len = 1 };
+    union {
+        char buf[CMSG_SPACE(sizeof(int) * SHM_RING_MAX_FDS)];
+        struct cmsghdr align;
+    } ctrl;
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctrl.buf;
+    msg.msg_controllen = sizeof(ctrl.buf);
+    ssize_t n = recvmsg(sfd, &msg, MSG_CMSG_CLOEXEC);
+    close(sfd);
+    if (n <= 0) {
+        return -1;
+    }
+
+    int got = 0;
+    for (struct cmsghdr* c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+        if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_RIGHTS) {
+            continue;
+        }
+        int nfds = (int)((c->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+        int tmp[SHM_RING_MAX_FDS];
+        memcpy(tmp, CMSG_DATA(c), sizeof(int) * nfds);
+        for (int i = 0; i < nfds; i++) {
+            if (got < max_fds) {
+                fds[got++] = tmp[i];
+            } else {
+                close(tmp[i]);
+            }
+        }
+    }
+    return got;
+}
@@ -0,0 +1,81 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stall_watchdog.h"
+#include "metrics.h"
+
+int stall_watchdog_parse(const char* spec, stall_watchdog_t* wd) {
+    static const stall_watchdog_t defaults = STALL_WATCHDOG_INIT;
+    char* end;
+    *wd = defaults;
+    long ms = strtol(spec, &end, 10);
+    if (end == spec || ms < 0 || ms > 600000) {
+        return -1;
+    }
+    wd->stall_ms = (int)ms;
+    if (*end == ':') {
+        const char* p = end + 1;
+        long n = strtol(p, &end, 10);
+        if (end == p || n < 1 || n > 1000) {
+            return -1;
+        }
+        wd->max_attempts = (int)n;
+    }
+    return *end == '\0' ? 0 : -1;
+}
+
+int stall_watchdog_timeout_ms(const stall_watchdog_t* wd, uint64_t period_us, int first_ms) {
+    if (wd->stall_ms <= 0 || wd->last_frame_us == 0) {
+        return first_ms;
+    }
+    uint64_t ms = period_us * STALL_WATCHDOG_INTERVALS / 1000;
+    return ms > (uint64_t)wd->stall_ms ? (int)ms : wd->stall_ms;
+}
+
+int stall_watchdog_stalled(stall_watchdog_t* wd, uint64_t now_us) {
+    if (wd->stall_ms <= 0 || wd->last_frame_us == 0) {
+        // 一帧都没出过说明配置或硬件有问题，重启采集流无济于事
+        return 0;
+    }
+    if (wd->detect_us == 0) {
+        wd->detect_us = now_us;
+    }
+    if (wd->attempts >= wd->max_attempts) {
+        printf("   采集停顿%.1f秒，已重启采集流%d次仍无帧，放弃\n",
+               (now_us - wd->last_frame_us) / 1e6, wd->attempts);
+        return 0;
+    }
+    wd->attempts++;
+    metrics_count(METRIC_CAPTURE_RECOVERIES, 1);
+    printf("   采集停顿%.1fms，原地重启采集流(第%d次)\n", (now_us - wd->last_frame_us) / 1e3, wd->attempts);
+    return 1;
+}
+
+void stall_watchdog_frame(stall_watchdog_t* wd, uint64_t now_us, uint64_t period_us) {
+    if (wd->detect_us) {
+        uint64_t recovery_us = now_us - wd->detect_us;
+        // 两次成功 DQBUF 之间传感器应输出的帧数减去本帧
+        uint64_t lost = period_us ? (now_us - wd->last_frame_us + period_us / 2) / period_us : 0;
+        lost = lost > 0 ? lost - 1 : 0;
+        wd->recoveries++;
+        wd->frames_lost += lost;
+        if (recovery_us > wd->max_recovery_us) {
+            wd->max_recovery_us = recovery_us;
+        }
+        metrics_observe_us(METRIC_STAGE_RECOVERY, recovery_us);
+        metrics_drop_n(METRIC_DROP_STALL, lost);
+        printf("   采集流已恢复: 耗时%.1fms, 丢失约%llu帧\n", recovery_us / 1e3, (unsigned long long)lost);
+        wd->detect_us = 0;
+        wd->attempts = 0;
+    }
+    wd->last_frame_us = now_us;
+}
+
+void stall_watchdog_report(const stall_watchdog_t* wd) {
+    if (wd->stall_ms <= 0 || (wd->recoveries == 0 && wd->detect_us == 0)) {
+        return;
+    }
+    printf("   停顿恢复: %llu次, 丢失约%llu帧, 最长恢复%.1fms\n", (unsigned long long)wd->recoveries,
+           (unsigned long long)wd->frames_lost, wd->max_recovery_us / 1e3);
+}
@@ -0,0 +1,94 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include "startup.h"
+#include "metrics.h"
+
+typedef struct {
+    const char* name;
+    uint64_t begin_us;
+    uint64_t end_us;
+} startup_rec_t;
+
+static startup_rec_t phases[STARTUP_MAX_PHASES];
+static _Atomic int n_phases;
+static _Atomic int n_done;
+
+void startup_phase(const char* name, uint64_t begin_us, uint64_t end_us) {
+    int idx = atomic_fetch_add(&n_phases, 1);
+    if (idx >= STARTUP_MAX_PHASES) {
+        return;
+    }
+    phases[idx].name = name;
+    phases[idx].begin_us = begin_us;
+    phases[idx].end_us = end_us;
+    atomic_fetch_add_explicit(&n_done, 1, memory_order_release);
+}
+
+uint64_t startup_exec_us(void) {
+    char buf[1024];
+    FILE* fp = fopen("/proc/self/stat", "r");
+    if (!fp) {
+        return 0;
+    }
+    size_t len = fread(buf, 1, sizeof(buf) - 1, fp);
+    fclose(fp);
+    buf[len] = '\0';
+    // comm 字段可能含空格，从最后一个 ')' 之后数：state 为第3个字段，starttime 为第22个
+    char* p = strrchr(buf, ')');
+    if (!p) {
+        return 0;
+    }
+    p += 2;
+    for (int field = 3; field < 22 && p; field++) {
+        p = strchr(p, ' ');
+        if (p) {
+            p++;
+        }
+    }
+    if (!p) {
+        return 0;
+    }
+    unsigned long long start_ticks = strtoull(p, NULL, 10);
+    long hz = sysconf(_SC_CLK_TCK);
+    struct timespec boot;
+    clock_gettime(CLOCK_BOOTTIME, &boot);
+    uint64_t boot_us = (uint64_t)boot.tv_sec * 1000000ull + (uint64_t)boot.tv_nsec / 1000;
+    uint64_t start_boot_us = start_ticks * 1000000ull / (uint64_t)(hz > 0 ? hz : 100);
+    uint64_t age_us = boot_us > start_boot_us ? boot_us - start_boot_us : 0;
+    uint64_t now = metrics_now_us();
+    return now > age_us ? now - age_us : 0;
+}
+
+static int phase_cmp(const void* a, const void* b) {
+    const startup_rec_t* x = a;
+    const startup_rec_t* y = b;
+    return x->begin_us < y->begin_us ? -1 : x->begin_us > y->begin_us;
+}
+
+void startup_report(void) {
+    int n = atomic_load_explicit(&n_done, memory_order_acquire);
+    if (n > STARTUP_MAX_PHASES) {
+        n = STARTUP_MAX_PHASES;
+    }
+    if (n == 0) {
+        return;
+    }
+    startup_rec_t sorted[STARTUP_MAX_PHASES];
+    memcpy(sorted, phases, sizeof(startup_rec_t) * (size_t)n);
+    qsort(sorted, (size_t)n, sizeof(sorted[0]), phase_cmp);
+
+    uint64_t zero = startup_exec_us();
+    if (zero == 0 || zero > sorted[0].begin_us) {
+        zero = sorted[0].begin_us;
+    }
+    printf("   ===启动阶段耗时(相对进程启动, 毫秒)===\n");
+    for (int i = 0; i < n; i++) {
+        printf("   %-24s 开始 %8.1f  耗时 %8.1f  结束 %8.1f\n", sorted[i].name,
+               (sorted[i].begin_us - zero) / 1000.0, (sorted[i].end_us - sorted[i].begin_us) / 1000.0,
+               (sorted[i].end_us - zero) / 1000.0);
+    }
+}
@@ -0,0 +1,288 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include "stream_out.h"
+#include "metrics.h"
+
+typedef struct {
+    int fd;
+    int skip;                       // 跳过本帧剩下的块
+    uint8_t* pend;                  // 上一块未写出的部分，接入时按发送缓冲大小分配
+    size_t pend_len;
+    size_t pend_cap;
+} stream_client_t;
+
+// 只由编码线程访问，不加锁
+static struct {
+    int listen_fd;
+    char path[108];
+    stream_kind_t kind;
+    stream_client_t clients[STREAM_OUT_MAX_CLIENTS];
+    int n_clients;
+    uint64_t seq;
+    uint64_t timestamp_us;
+    uint32_t offset;
+} so = { .listen_fd = -1 };
+
+static void client_close(int i) {
+    stream_client_t* c = &so.clients[i];
+    close(c->fd);
+    free(c->pend);
+    so.clients[i] = so.clients[--so.n_clients];
+    memset(&so.clients[so.n_clients], 0, sizeof(so.clients[0]));
+    metrics_gauge_set(METRIC_STREAM_CLIENTS, so.n_clients);
+}
+
+/**
+ * @brief 补发上一块的剩余部分
+ * @return 已补发完返回0，仍有剩余返回1，连接出错返回-1
+ */
+static int client_flush(stream_client_t* c) {
+    if (!c->pend_len) {
+        return 0;
+    }
+    ssize_t n = send(c->fd, c->pend, c->pend_len, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (n < 0) {
+        return errno == EAGAIN || errno == EWOULDBLOCK ? 1 : -1;
+    }
+    c->pend_len -= (size_t)n;
+    memmove(c->pend, c->pend + n, c->pend_len);
+    return c->pend_len ? 1 : 0;
+}
+
+/**
+ * @brief 暂存一块中没有写出的部分
+ * @param sent 已写出的字节数(含块头)
+ */
+static int client_keep(stream_client_t* c, const struct iovec* iov, size_t sent) {
+    size_t need = iov[0].iov_len + iov[1].iov_len - sent;
+    if (need > c->pend_cap) {
+        // 只有整包发送且单包超过发送缓冲时才会走到这里
+        uint8_t* p = realloc(c->pend, need);
+        if (!p) {
+            return -1;
+        }
+        metrics_count(METRIC_HEAP_ALLOCS, 1);
+        c->pend = p;
+        c->pend_cap = need;
+    }
+    c->pend_len = 0;
+    for (int k = 0; k < 2; k++) {
+        size_t skip = sent < iov[k].iov_len ? sent : iov[k].iov_len;
+        memcpy(c->pend + c->pend_len, (const uint8_t*)iov[k].iov_base + skip, iov[k].iov_len - skip);
+        c->pend_len += iov[k].iov_len - skip;
+        sent -= skip;
+    }
+    return 0;
+}
+
+int stream_out_start(const char* path, stream_kind_t kind) {
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        printf("   码流输出套接字路径过长: %s\n", path);
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (fd < 0) {
+        perror("无法创建码流输出套接字");
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    unlink(path);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, STREAM_OUT_MAX_CLIENTS) < 0) {
+        perror("无法监听码流输出套接字");
+        close(fd);
+        return -1;
+    }
+    so.listen_fd = fd;
+    so.kind = kind;
+    so.n_clients = 0;
+    snprintf(so.path, sizeof(so.path), "%s", path);
+    printf("   低延迟码流输出就绪: %s\n", path);
+    return 0;
+}
+
+void stream_out_begin(uint64_t seq, uint64_t timestamp_us) {
+    if (so.listen_fd < 0) {
+        return;
+    }
+    int cfd;
+    while ((cfd = accept4(so.listen_fd, NULL, NULL, SOCK_CLOEXEC | SOCK_NONBLOCK)) >= 0) {
+        if (so.n_clients == STREAM_OUT_MAX_CLIENTS) {
+            printf("   码流输出客户端已满(%d)，拒绝新连接\n", STREAM_OUT_MAX_CLIENTS);
+            close(cfd);
+            continue;
+        }
+        // 残块不超过一块的大小，分块发送时一块远小于发送缓冲，补发时不再分配
+        stream_client_t* c = &so.clients[so.n_clients];
+        memset(c, 0, sizeof(*c));
+        c->pend_cap = STREAM_OUT_SNDBUF + sizeof(stream_out_hdr_t);
+        c->pend = malloc(c->pend_cap);
+        if (!c->pend) {
+            close(cfd);
+            continue;
+        }
+        int sndbuf = STREAM_OUT_SNDBUF;
+        setsockopt(cfd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+        c->fd = cfd;
+        so.n_clients++;
+        metrics_gauge_set(METRIC_STREAM_CLIENTS, so.n_clients);
+    }
+    for (int i = so.n_clients - 1; i >= 0; i--) {
+        int ret = client_flush(&so.clients[i]);
+        if (ret < 0) {
+            client_close(i);
+        } else {
+            // 上一帧的残块没补发完，这一帧也只能跳过
+            so.clients[i].skip = ret;
+            if (ret) {
+                metrics_drop(METRIC_DROP_STREAM_SLOW);
+            }
+        }
+    }
+    so.seq = seq;
+    so.timestamp_us = timestamp_us;
+    so.offset = 0;
+}
+
+void stream_out_chunk(void* arg, const uint8_t* data, size_t length, int last) {
+    (void)arg;
+    if (so.listen_fd < 0) {
+        return;
+    }
+    uint64_t now = metrics_now_us();
+    stream_out_hdr_t hdr = {
+        .magic = STREAM_OUT_MAGIC,
+        .kind = (uint16_t)so.kind,
+        .flags = (uint16_t)((so.offset == 0 ? STREAM_OUT_FLAG_FIRST : 0) | (last ? STREAM_OUT_FLAG_LAST : 0)),
+        .seq = so.seq,
+        .timestamp_us = so.timestamp_us,
+        .send_us = now,
+        .offset = so.offset,
+        .length = (uint32_t)length,
+    };
+    struct iovec iov[2] = { { &hdr, sizeof(hdr) }, { (void*)data, length } };
+    struct msghdr msg = { .msg_iov = iov, .msg_iovlen = 2 };
+    size_t total = sizeof(hdr) + length;
+
+    if (so.timestamp_us && hdr.flags & STREAM_OUT_FLAG_FIRST) {
+        metrics_observe_us(METRIC_STAGE_STREAM_FIRST, now - so.timestamp_us);
+    }
+    if (so.timestamp_us && last) {
+        metrics_observe_us(METRIC_STAGE_STREAM_LAST, now - so.timestamp_us);
+    }
+    for (int i = so.n_clients - 1; i >= 0; i--) {
+        stream_client_t* c = &so.clients[i];
+        if (c->skip) {
+            continue;
+        }
+        int ret = client_flush(c);
+        if (ret == 0) {
+            ssize_t n = sendmsg(c->fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+            if (n < 0) {
+                ret = errno == EAGAIN || errno == EWOULDBLOCK ? 1 : -1;
+            } else if (n < (ssize_t)total) {
+                // 块的前一部分已经发出，剩余部分暂存，下一块之前先补发
+                ret = client_keep(c, iov, (size_t)n);
+            }
+            if (ret == 0) {
+                metrics_count(METRIC_STREAM_CHUNKS, 1);
+                metrics_count(METRIC_STREAM_BYTES, length);
+                continue;
+            }
+        }
+        if (ret < 0) {
+            printf("   码流输出客户端断开\n");
+            client_close(i);
+            continue;
+        }
+        c->skip = 1;
+        metrics_drop(METRIC_DROP_STREAM_SLOW);
+    }
+    so.offset += (uint32_t)length;
+}
+
+void stream_out_flush(void) {
+    for (int i = so.n_clients - 1; i >= 0; i--) {
+        if (client_flush(&so.clients[i]) < 0) {
+            printf("   码流输出客户端断开\n");
+            client_close(i);
+        }
+    }
+}
+
+int stream_out_clients(void) {
+    return so.n_clients;
+}
+
+void stream_out_stop(void) {
+    if (so.listen_fd < 0) {
+        return;
+    }
+    while (so.n_clients > 0) {
+        client_close(so.n_clients - 1);
+    }
+    close(so.listen_fd);
+    so.listen_fd = -1;
+    unlink(so.path);
+}
+
+int stream_out_connect(const char* path) {
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief 读满 len 字节，buf 为 NULL 时读出丢弃
+ */
+static int read_full(int fd, uint8_t* buf, size_t len) {
+    uint8_t scratch[4096];
+    while (len > 0) {
+        size_t want = buf ? len : (len < sizeof(scratch) ? len : sizeof(scratch));
+        ssize_t n = recv(fd, buf ? buf : scratch, want, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        if (buf) {
+            buf += n;
+        }
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+int stream_out_read(int fd, stream_out_hdr_t* hdr, uint8_t* buf, size_t capacity) {
+    if (read_full(fd, (uint8_t*)hdr, sizeof(*hdr)) != 0 || hdr->magic != STREAM_OUT_MAGIC) {
+        return -1;
+    }
+    size_t keep = hdr->length < capacity ? hdr->length : capacity;
+    if (read_full(fd, buf, keep) != 0) {
+        return -1;
+    }
+    return read_full(fd, NULL, hdr->length - keep);
+}
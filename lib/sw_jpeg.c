@@ -0,0 +1,531 @@
+#define _GNU_SOURCE
+#include <string.h>
+#include <pthread.h>
+#include "sw_jpeg.h"
+
+// zigzag 序号 -> 自然顺序下标
+const uint8_t sw_jpeg_zigzag_natural[64] = {
+     0,  1,  8, 16,  9,  2,  3, 10, 17, 24, 32, 25, 18, 11,  4,  5,
+    12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13,  6,  7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+};
+
+// ITU-T T.81 Annex K 的标准量化表(自然顺序)
+static const uint8_t std_qt_luma[64] = {
+    16, 11, 10, 16,  24,  40,  51,  61,
+    12, 12, 14, 19,  26,  58,  60,  55,
+    14, 13, 16, 24,  40,  57,  69,  56,
+    14, 17, 22, 29,  51,  87,  80,  62,
+    18, 22, 37, 56,  68, 109, 103,  77,
+    24, 35, 55, 64,  81, 104, 113,  92,
+    49, 64, 78, 87, 103, 121, 120, 101,
+    72, 92, 95, 98, 112, 100, 103,  99,
+};
+
+static const uint8_t std_qt_chroma[64] = {
+    17, 18, 24, 47, 99, 99, 99, 99,
+    18, 21, 26, 66, 99, 99, 99, 99,
+    24, 26, 56, 99, 99, 99, 99, 99,
+    47, 66, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+};
+
+// Annex K.3 标准 Huffman 表：每种码长的码字数 + 符号
+static const uint8_t dc_luma_bits[16] = { 0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0 };
+static const uint8_t dc_chroma_bits[16] = { 0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0 };
+static const uint8_t dc_vals[12] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+
+static const uint8_t ac_luma_bits[16] = { 0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d };
+static const uint8_t ac_luma_vals[162] = {
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+    0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+    0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+    0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+    0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+    0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+    0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+    0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+    0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa,
+};
+
+static const uint8_t ac_chroma_bits[16] = { 0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77 };
+static const uint8_t ac_chroma_vals[162] = {
+    0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+    0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+    0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+    0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+    0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+    0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+    0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+    0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+    0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+    0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa,
+};
+
+// AAN DCT 的行/列缩放因子(已含 sqrt(8))
+static const float aan_scale[8] = {
+    1.0f * 2.828427125f, 1.387039845f * 2.828427125f, 1.306562965f * 2.828427125f, 1.175875602f * 2.828427125f,
+    1.0f * 2.828427125f, 0.785694958f * 2.828427125f, 0.541196100f * 2.828427125f, 0.275899379f * 2.828427125f,
+};
+
+typedef struct {
+    uint16_t code[256];
+    uint8_t size[256];
+} huff_table_t;
+
+typedef struct {
+    huff_table_t dc_luma;
+    huff_table_t ac_luma;
+    huff_table_t dc_chroma;
+    huff_table_t ac_chroma;
+} huff_set_t;
+
+typedef struct {
+    uint8_t* p;
+    uint8_t* end;
+    uint32_t acc;
+    int nbits;
+    int overflow;
+} bit_writer_t;
+
+static void build_huff(huff_table_t* t, const uint8_t* bits, const uint8_t* vals) {
+    uint16_t code = 0;
+    int k = 0;
+    memset(t, 0, sizeof(*t));
+    for (int len = 1; len <= 16; len++) {
+        for (int i = 0; i < bits[len - 1]; i++) {
+            t->code[vals[k]] = code++;
+            t->size[vals[k]] = (uint8_t)len;
+            k++;
+        }
+        code <<= 1;
+    }
+}
+
+static huff_set_t std_huff_set;
+static pthread_once_t std_huff_once = PTHREAD_ONCE_INIT;
+
+static void std_huff_build(void) {
+    build_huff(&std_huff_set.dc_luma, dc_luma_bits, dc_vals);
+    build_huff(&std_huff_set.ac_luma, ac_luma_bits, ac_luma_vals);
+    build_huff(&std_huff_set.dc_chroma, dc_chroma_bits, dc_vals);
+    build_huff(&std_huff_set.ac_chroma, ac_chroma_bits, ac_chroma_vals);
+}
+
+static const huff_set_t* std_huff(void) {
+    pthread_once(&std_huff_once, std_huff_build);
+    return &std_huff_set;
+}
+
+static void scale_qt(uint8_t* dst, const uint8_t* src, int quality) {
+    int scale = quality < 50 ? 5000 / quality : 200 - quality * 2;
+    for (int i = 0; i < 64; i++) {
+        int v = (src[i] * scale + 50) / 100;
+        dst[i] = (uint8_t)(v < 1 ? 1 : v > 255 ? 255 : v);
+    }
+}
+
+int sw_jpeg_init(sw_jpeg_t* j, int width, int height, int quality) {
+    if (width <= 0 || height <= 0 || width > 65535 || height > 65535) {
+        return -1;
+    }
+    if (quality < 1) {
+        quality = 1;
+    } else if (quality > 100) {
+        quality = 100;
+    }
+    memset(j, 0, sizeof(*j));
+    j->width = width;
+    j->height = height;
+    j->quality = quality;
+    scale_qt(j->qt_luma, std_qt_luma, quality);
+    scale_qt(j->qt_chroma, std_qt_chroma, quality);
+    for (int r = 0; r < 8; r++) {
+        for (int c = 0; c < 8; c++) {
+            int k = r * 8 + c;
+            j->fdtbl_luma[k] = 1.0f / (j->qt_luma[k] * aan_scale[r] * aan_scale[c]);
+            j->fdtbl_chroma[k] = 1.0f / (j->qt_chroma[k] * aan_scale[r] * aan_scale[c]);
+        }
+    }
+    std_huff();
+    return 0;
+}
+
+size_t sw_jpeg_max_size(int width, int height) {
+    size_t mcus = (size_t)((width + 15) / 16) * ((height + 15) / 16);
+    return mcus * 6 * SW_JPEG_BLOCK_MAX_BYTES + SW_JPEG_HEADER_MAX_BYTES;
+}
+
+int sw_jpeg_set_zone(sw_jpeg_t* j, const roi_rect_t* zone, int bg_quality) {
+    uint8_t qt_luma[64];
+    uint8_t qt_chroma[64];
+    roi_rect_t r;
+    j->zone_enabled = 0;
+    if (!zone || bg_quality >= j->quality) {
+        return 0;
+    }
+    r = *zone;
+    if (roi_clip(&r, j->width, j->height) != 0) {
+        return -1;
+    }
+    if (bg_quality < 1) {
+        bg_quality = 1;
+    }
+    j->bg_quality = bg_quality;
+    j->zone_mx0 = r.x & ~15;
+    j->zone_my0 = r.y & ~15;
+    j->zone_mx1 = r.x + r.width;
+    j->zone_my1 = r.y + r.height;
+    scale_qt(qt_luma, std_qt_luma, bg_quality);
+    scale_qt(qt_chroma, std_qt_chroma, bg_quality);
+    for (int r8 = 0; r8 < 8; r8++) {
+        for (int c = 0; c < 8; c++) {
+            int k = r8 * 8 + c;
+            j->bg_fdtbl_luma[k] = 1.0f / (qt_luma[k] * aan_scale[r8] * aan_scale[c]);
+            j->bg_fdtbl_chroma[k] = 1.0f / (qt_chroma[k] * aan_scale[r8] * aan_scale[c]);
+            j->bg_ratio_luma[k] = (float)qt_luma[k] / j->qt_luma[k];
+            j->bg_ratio_chroma[k] = (float)qt_chroma[k] / j->qt_chroma[k];
+        }
+    }
+    // DC 保持原精度，背景只损失纹理，不出现明显的块间亮度台阶
+    j->bg_fdtbl_luma[0] = j->fdtbl_luma[0];
+    j->bg_fdtbl_chroma[0] = j->fdtbl_chroma[0];
+    j->bg_ratio_luma[0] = 1.0f;
+    j->bg_ratio_chroma[0] = 1.0f;
+    j->zone_enabled = 1;
+    return 0;
+}
+
+static inline void emit_byte(bit_writer_t* w, uint8_t c) {
+    if (w->p < w->end) {
+        *w->p++ = c;
+    } else {
+        w->overflow = 1;
+    }
+}
+
+static inline void put_bits(bit_writer_t* w, uint32_t code, int len) {
+    w->acc = (w->acc << len) | (code & ((1u << len) - 1));
+    w->nbits += len;
+    while (w->nbits >= 8) {
+        uint8_t c = (uint8_t)(w->acc >> (w->nbits - 8));
+        emit_byte(w, c);
+        if (c == 0xff) {
+            emit_byte(w, 0);    // 字节填充
+        }
+        w->nbits -= 8;
+    }
+}
+
+static void flush_bits(bit_writer_t* w) {
+    if (w->nbits > 0) {
+        put_bits(w, 0x7f, 8 - w->nbits);   // 用1填充到字节边界
+    }
+}
+
+/**
+ * @brief 一维 AAN 前向 DCT，输入输出步长为 stride
+ */
+static void fdct_1d(float* d, int stride) {
+    float tmp0 = d[0] + d[7 * stride];
+    float tmp7 = d[0] - d[7 * stride];
+    float tmp1 = d[stride] + d[6 * stride];
+    float tmp6 = d[stride] - d[6 * stride];
+    float tmp2 = d[2 * stride] + d[5 * stride];
+    float tmp5 = d[2 * stride] - d[5 * stride];
+    float tmp3 = d[3 * stride] + d[4 * stride];
+    float tmp4 = d[3 * stride] - d[4 * stride];
+
+    // 偶数部分
+    float tmp10 = tmp0 + tmp3;
+    float tmp13 = tmp0 - tmp3;
+    float tmp11 = tmp1 + tmp2;
+    float tmp12 = tmp1 - tmp2;
+    d[0] = tmp10 + tmp11;
+    d[4 * stride] = tmp10 - tmp11;
+    float z1 = (tmp12 + tmp13) * 0.707106781f;
+    d[2 * stride] = tmp13 + z1;
+    d[6 * stride] = tmp13 - z1;
+
+    // 奇数部分
+    tmp10 = tmp4 + tmp5;
+    tmp11 = tmp5 + tmp6;
+    tmp12 = tmp6 + tmp7;
+    float z5 = (tmp10 - tmp12) * 0.382683433f;
+    float z2 = tmp10 * 0.541196100f + z5;
+    float z4 = tmp12 * 1.306562965f + z5;
+    float z3 = tmp11 * 0.707106781f;
+    float z11 = tmp7 + z3;
+    float z13 = tmp7 - z3;
+    d[5 * stride] = z13 + z2;
+    d[3 * stride] = z13 - z2;
+    d[stride] = z11 + z4;
+    d[7 * stride] = z11 - z4;
+}
+
+static inline void put_value(bit_writer_t* w, const huff_table_t* t, int symbol_hi, int v) {
+    int a = v < 0 ? -v : v;
+    int n = a ? 32 - __builtin_clz((unsigned)a) : 0;
+    int sym = symbol_hi | n;
+    put_bits(w, t->code[sym], t->size[sym]);
+    if (n) {
+        put_bits(w, (uint32_t)(v < 0 ? v - 1 : v), n);
+    }
+}
+
+/**
+ * @brief 熵编码一个已量化的块
+ * @param q 量化值，zigzag 顺序
+ * @param last 最后一个非零系数的 zigzag 序号
+ * @return 本块的 DC 量化值
+ */
+static int put_block(bit_writer_t* w, const int* q, int last, int dc_prev,
+                     const huff_table_t* dc, const huff_table_t* ac) {
+    put_value(w, dc, 0, q[0] - dc_prev);
+    int run = 0;
+    for (int i = 1; i <= last; i++) {
+        if (q[i] == 0) {
+            run++;
+            continue;
+        }
+        while (run >= 16) {
+            put_bits(w, ac->code[0xf0], ac->size[0xf0]);   // ZRL
+            run -= 16;
+        }
+        put_value(w, ac, run << 4, q[i]);
+        run = 0;
+    }
+    if (last < 63) {
+        put_bits(w, ac->code[0x00], ac->size[0x00]);       // EOB
+    }
+    return q[0];
+}
+
+/**
+ * @brief DCT、量化并熵编码一个 8x8 块
+ * @param blk 电平平移后的像素，自然顺序，会被原地改写
+ * @param ratio 非NULL时先按 fdtbl 粗量化，再乘以该比例换算到文件中的量化表
+ * @return 本块的 DC 量化值
+ */
+static int encode_block(bit_writer_t* w, float* blk, const float* fdtbl, const float* ratio, int dc_prev,
+                        const huff_table_t* dc, const huff_table_t* ac) {
+    int q[64];
+    for (int r = 0; r < 8; r++) {
+        fdct_1d(blk + r * 8, 1);
+    }
+    for (int c = 0; c < 8; c++) {
+        fdct_1d(blk + c, 8);
+    }
+    int last = 0;
+    for (int i = 0; i < 64; i++) {
+        int k = sw_jpeg_zigzag_natural[i];
+        float v = blk[k] * fdtbl[k];
+        q[i] = (int)(v < 0 ? v - 0.5f : v + 0.5f);
+        if (ratio && q[i]) {
+            v = q[i] * ratio[k];
+            q[i] = (int)(v < 0 ? v - 0.5f : v + 0.5f);
+        }
+        if (q[i]) {
+            last = i;
+        }
+    }
+    return put_block(w, q, last, dc_prev, dc, ac);
+}
+
+void sw_jpeg_load_mcu(const sw_jpeg_t* j, const uint8_t* y, int y_stride, const uint8_t* uv, int uv_stride,
+                      int mx, int my, float yb[4][64], float cb[64], float cr[64]) {
+    int edge = mx + 16 > j->width || my + 16 > j->height;
+    for (int b = 0; b < 4; b++) {
+        int bx = mx + (b & 1) * 8;
+        int by = my + (b >> 1) * 8;
+        for (int r = 0; r < 8; r++) {
+            int sy = by + r;
+            if (edge && sy >= j->height) {
+                sy = j->height - 1;
+            }
+            const uint8_t* row = y + (size_t)sy * y_stride;
+            for (int c = 0; c < 8; c++) {
+                int sx = bx + c;
+                if (edge && sx >= j->width) {
+                    sx = j->width - 1;
+                }
+                yb[b][r * 8 + c] = (float)row[sx] - 128.0f;
+            }
+        }
+    }
+    int cw = (j->width + 1) / 2;
+    int ch = (j->height + 1) / 2;
+    for (int r = 0; r < 8; r++) {
+        int sy = my / 2 + r;
+        if (sy >= ch) {
+            sy = ch - 1;
+        }
+        const uint8_t* row = uv + (size_t)sy * uv_stride;
+        for (int c = 0; c < 8; c++) {
+            int sx = mx / 2 + c;
+            if (sx >= cw) {
+                sx = cw - 1;
+            }
+            cb[r * 8 + c] = (float)row[sx * 2] - 128.0f;
+            cr[r * 8 + c] = (float)row[sx * 2 + 1] - 128.0f;
+        }
+    }
+}
+
+static void put_marker(bit_writer_t* w, uint8_t marker, int length) {
+    emit_byte(w, 0xff);
+    emit_byte(w, marker);
+    if (length >= 0) {
+        emit_byte(w, (uint8_t)(length >> 8));
+        emit_byte(w, (uint8_t)length);
+    }
+}
+
+static void put_dht(bit_writer_t* w, uint8_t cls_id, const uint8_t* bits, const uint8_t* vals) {
+    int n = 0;
+    emit_byte(w, cls_id);
+    for (int i = 0; i < 16; i++) {
+        emit_byte(w, bits[i]);
+        n += bits[i];
+    }
+    for (int i = 0; i < n; i++) {
+        emit_byte(w, vals[i]);
+    }
+}
+
+static void write_headers(const sw_jpeg_t* j, bit_writer_t* w) {
+    static const uint8_t jfif[14] = { 'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0 };
+    put_marker(w, 0xd8, -1);                            // SOI
+    put_marker(w, 0xe0, 16);                            // APP0
+    for (int i = 0; i < 14; i++) {
+        emit_byte(w, jfif[i]);
+    }
+    put_marker(w, 0xdb, 2 + 2 * 65);                    // DQT，表内按 zigzag 顺序
+    emit_byte(w, 0);
+    for (int i = 0; i < 64; i++) {
+        emit_byte(w, j->qt_luma[sw_jpeg_zigzag_natural[i]]);
+    }
+    emit_byte(w, 1);
+    for (int i = 0; i < 64; i++) {
+        emit_byte(w, j->qt_chroma[sw_jpeg_zigzag_natural[i]]);
+    }
+    put_marker(w, 0xc0, 17);                            // SOF0
+    emit_byte(w, 8);
+    emit_byte(w, (uint8_t)(j->height >> 8));
+    emit_byte(w, (uint8_t)j->height);
+    emit_byte(w, (uint8_t)(j->width >> 8));
+    emit_byte(w, (uint8_t)j->width);
+    emit_byte(w, 3);
+    emit_byte(w, 1); emit_byte(w, 0x22); emit_byte(w, 0);
+    emit_byte(w, 2); emit_byte(w, 0x11); emit_byte(w, 1);
+    emit_byte(w, 3); emit_byte(w, 0x11); emit_byte(w, 1);
+    put_marker(w, 0xc4, 2 + (17 + 12) * 2 + (17 + 162) * 2);   // DHT
+    put_dht(w, 0x00, dc_luma_bits, dc_vals);
+    put_dht(w, 0x10, ac_luma_bits, ac_luma_vals);
+    put_dht(w, 0x01, dc_chroma_bits, dc_vals);
+    put_dht(w, 0x11, ac_chroma_bits, ac_chroma_vals);
+    put_marker(w, 0xda, 12);                            // SOS
+    emit_byte(w, 3);
+    emit_byte(w, 1); emit_byte(w, 0x00);
+    emit_byte(w, 2); emit_byte(w, 0x11);
+    emit_byte(w, 3); emit_byte(w, 0x11);
+    emit_byte(w, 0);
+    emit_byte(w, 63);
+    emit_byte(w, 0);
+}
+
+size_t sw_jpeg_encode_nv12(const sw_jpeg_t* j, const uint8_t* y, int y_stride,
+                           const uint8_t* uv, int uv_stride, uint8_t* out, size_t capacity) {
+    return sw_jpeg_encode_nv12_bands(j, y, y_stride, uv, uv_stride, out, capacity, 0, NULL, NULL);
+}
+
+size_t sw_jpeg_encode_nv12_bands(const sw_jpeg_t* j, const uint8_t* y, int y_stride,
+                                 const uint8_t* uv, int uv_stride, uint8_t* out, size_t capacity,
+                                 int band_rows, sw_jpeg_band_fn fn, void* arg) {
+    const huff_set_t* h = std_huff();
+    uint8_t* sent = out;
+    int rows = 0;
+    if (band_rows < 1) {
+        band_rows = 1;
+    }
+    bit_writer_t w = { out, out + capacity, 0, 0, 0 };
+    float yb[4][64];
+    float cb[64];
+    float cr[64];
+    int dc_y = 0;
+    int dc_cb = 0;
+    int dc_cr = 0;
+
+    write_headers(j, &w);
+    for (int my = 0; my < j->height && !w.overflow; my += 16) {
+        for (int mx = 0; mx < j->width; mx += 16) {
+            sw_jpeg_load_mcu(j, y, y_stride, uv, uv_stride, mx, my, yb, cb, cr);
+            int bg = j->zone_enabled && (mx < j->zone_mx0 || mx >= j->zone_mx1 ||
+                                         my < j->zone_my0 || my >= j->zone_my1);
+            const float* fl = bg ? j->bg_fdtbl_luma : j->fdtbl_luma;
+            const float* fc = bg ? j->bg_fdtbl_chroma : j->fdtbl_chroma;
+            const float* rl = bg ? j->bg_ratio_luma : NULL;
+            const float* rc = bg ? j->bg_ratio_chroma : NULL;
+            for (int b = 0; b < 4; b++) {
+                dc_y = encode_block(&w, yb[b], fl, rl, dc_y, &h->dc_luma, &h->ac_luma);
+            }
+            dc_cb = encode_block(&w, cb, fc, rc, dc_cb, &h->dc_chroma, &h->ac_chroma);
+            dc_cr = encode_block(&w, cr, fc, rc, dc_cr, &h->dc_chroma, &h->ac_chroma);
+        }
+        // 不足一字节的位还留在累加器里，已写出的字节(含填充的 0x00)不会再改
+        if (fn && ++rows % band_rows == 0 && w.p > sent && !w.overflow) {
+            fn(arg, sent, (size_t)(w.p - sent), 0);
+            sent = w.p;
+        }
+    }
+    flush_bits(&w);
+    put_marker(&w, 0xd9, -1);                           // EOI
+    if (w.overflow) {
+        return 0;
+    }
+    if (fn) {
+        fn(arg, sent, (size_t)(w.p - sent), 1);
+    }
+    return (size_t)(w.p - out);
+}
+
+size_t sw_jpeg_encode_coefs(const sw_jpeg_t* j, const int16_t* const coef[3], uint8_t* out, size_t capacity) {
+    const huff_set_t* h = std_huff();
+    bit_writer_t w = { out, out + capacity, 0, 0, 0 };
+    int mcux = (j->width + 15) / 16;
+    int mcuy = (j->height + 15) / 16;
+    int dc[3] = { 0, 0, 0 };
+    int q[64];
+
+    write_headers(j, &w);
+    for (int my = 0; my < mcuy && !w.overflow; my++) {
+        for (int mx = 0; mx < mcux; mx++) {
+            for (int b = 0; b < 6; b++) {
+                // 4 个 Y 块按 MCU 内的行序，随后 Cb、Cr
+                int ci = b < 4 ? 0 : b - 3;
+                size_t idx = b < 4 ? (size_t)(my * 2 + (b >> 1)) * (mcux * 2) + mx * 2 + (b & 1)
+                                   : (size_t)my * mcux + mx;
+                const int16_t* blk = coef[ci] + idx * 64;
+                int last = 0;
+                for (int i = 0; i < 64; i++) {
+                    q[i] = blk[i];
+                    if (q[i]) {
+                        last = i;
+                    }
+                }
+                dc[ci] = put_block(&w, q, last, dc[ci], ci ? &h->dc_chroma : &h->dc_luma,
+                                   ci ? &h->ac_chroma : &h->ac_luma);
+            }
+        }
+    }
+    flush_bits(&w);
+    put_marker(&w, 0xd9, -1);                           // EOI
+    return w.overflow ? 0 : (size_t)(w.p - out);
+}
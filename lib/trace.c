@@ -0,0 +1,238 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include "trace.h"
+
+typedef struct {
+    _Atomic uint64_t head;          // 已写入的事件总数，只由所属线程递增
+    int tid;
+    char name[16];
+    trace_record_t rec[TRACE_RING_SIZE];
+} trace_ring_t;
+
+_Atomic int g_trace_enabled;
+
+static trace_ring_t* _Atomic rings[TRACE_MAX_THREADS];
+static _Atomic int n_rings;
+static __thread trace_ring_t* tls_ring;
+static __thread int tls_no_ring;    // 线程数超过上限，本线程不再记录
+static __thread uint64_t tls_frame;
+
+static const char* event_names[TRACE_EVENT_MAX] = {
+    "dqbuf",
+    "qbuf",
+    "copy",
+    "encode_put_frame",
+    "encode_get_packet",
+    "video_encode",
+    "write_submit",
+    "write",
+    "fsync",
+};
+
+// 各事件 arg 的含义，NULL 不导出
+static const char* arg_names[TRACE_EVENT_MAX] = {
+    "sequence",
+    "index",
+    NULL,
+    NULL,
+    "bytes",
+    "bytes",
+    "bytes",
+    "bytes",
+    NULL,
+};
+
+static struct {
+    pthread_t thread;
+    _Atomic int running;
+    char path[256];
+} exporter;
+
+static trace_ring_t* trace_register(void) {
+    int slot = atomic_fetch_add(&n_rings, 1);
+    if (slot >= TRACE_MAX_THREADS) {
+        return NULL;
+    }
+    trace_ring_t* r = calloc(1, sizeof(*r));
+    if (!r) {
+        return NULL;
+    }
+    r->tid = (int)syscall(SYS_gettid);
+    pthread_getname_np(pthread_self(), r->name, sizeof(r->name));
+    atomic_store_explicit(&rings[slot], r, memory_order_release);
+    return r;
+}
+
+void trace_emit(trace_event_t event, uint64_t frame, uint64_t ts_ns, uint64_t end_ns, uint32_t arg) {
+    trace_ring_t* r = tls_ring;
+    if (!r) {
+        if (tls_no_ring || !(r = trace_register())) {
+            tls_no_ring = 1;
+            return;
+        }
+        tls_ring = r;
+    }
+    uint64_t h = atomic_load_explicit(&r->head, memory_order_relaxed);
+    trace_record_t* e = &r->rec[h & (TRACE_RING_SIZE - 1)];
+    e->ts_ns = ts_ns;
+    e->frame = frame;
+    e->dur_ns = end_ns - ts_ns > UINT32_MAX ? UINT32_MAX : (uint32_t)(end_ns - ts_ns);
+    e->arg = arg;
+    e->event = (uint16_t)event;
+    atomic_store_explicit(&r->head, h + 1, memory_order_release);
+}
+
+void trace_set_frame(uint64_t frame) {
+    tls_frame = frame;
+}
+
+uint64_t trace_current_frame(void) {
+    return tls_frame;
+}
+
+/**
+ * @brief 复制一个线程的环：先读 head 再复制，复制后再读一次 head，
+ *        期间可能被覆盖的最旧部分丢弃，写线程全程不受影响
+ * @return 有效事件数，从 out[0] 开始按时间顺序存放
+ */
+static size_t ring_snapshot(trace_ring_t* r, trace_record_t* out) {
+    uint64_t h1 = atomic_load_explicit(&r->head, memory_order_acquire);
+    uint64_t start = h1 > TRACE_RING_SIZE ? h1 - TRACE_RING_SIZE : 0;
+    for (uint64_t i = start; i < h1; i++) {
+        out[i - start] = r->rec[i & (TRACE_RING_SIZE - 1)];
+    }
+    atomic_thread_fence(memory_order_acquire);
+    uint64_t h2 = atomic_load_explicit(&r->head, memory_order_relaxed);
+    // 序号 <= h2 - SIZE 的槽位已被(或正在被)新事件覆盖
+    uint64_t valid = h2 >= TRACE_RING_SIZE ? h2 - TRACE_RING_SIZE + 1 : 0;
+    if (valid <= start) {
+        return (size_t)(h1 - start);
+    }
+    if (valid >= h1) {
+        return 0;
+    }
+    memmove(out, out + (valid - start), sizeof(*out) * (size_t)(h1 - valid));
+    return (size_t)(h1 - valid);
+}
+
+int trace_export(const char* path) {
+    char tmp[300];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE* fp = fopen(tmp, "w");
+    trace_record_t* buf = malloc(sizeof(trace_record_t) * TRACE_RING_SIZE);
+    if (!fp || !buf) {
+        perror("无法导出跟踪");
+        if (fp) {
+            fclose(fp);
+        }
+        free(buf);
+        return -1;
+    }
+    int pid = (int)getpid();
+    int total = 0;
+    int count = atomic_load(&n_rings);
+    if (count > TRACE_MAX_THREADS) {
+        count = TRACE_MAX_THREADS;
+    }
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(fp, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"mipi\"}}", pid);
+    for (int i = 0; i < count; i++) {
+        trace_ring_t* r = atomic_load_explicit(&rings[i], memory_order_acquire);
+        if (!r) {
+            continue;
+        }
+        fprintf(fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                pid, r->tid, r->name[0] ? r->name : "thread");
+        size_t n = ring_snapshot(r, buf);
+        for (size_t k = 0; k < n; k++) {
+            const trace_record_t* e = &buf[k];
+            if (e->event >= TRACE_EVENT_MAX) {
+                continue;
+            }
+            // Chrome trace 的时间单位是微秒，保留纳秒精度
+            if (e->dur_ns) {
+                fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"frame\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,",
+                        event_names[e->event], e->ts_ns / 1000.0, e->dur_ns / 1000.0);
+            } else {
+                fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"frame\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,",
+                        event_names[e->event], e->ts_ns / 1000.0);
+            }
+            fprintf(fp, "\"pid\":%d,\"tid\":%d,\"args\":{\"frame\":%llu", pid, r->tid,
+                    (unsigned long long)e->frame);
+            if (arg_names[e->event]) {
+                fprintf(fp, ",\"%s\":%u", arg_names[e->event], e->arg);
+            }
+            fprintf(fp, "}}");
+            total++;
+        }
+    }
+    fprintf(fp, "\n]}\n");
+    free(buf);
+    if (fclose(fp) != 0 || rename(tmp, path) != 0) {
+        perror("无法导出跟踪");
+        unlink(tmp);
+        return -1;
+    }
+    return total;
+}
+
+static void* trace_thread(void* arg) {
+    (void)arg;
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGUSR1);
+    pthread_setname_np(pthread_self(), "mipi_trace");
+    for (;;) {
+        int sig;
+        if (sigwait(&set, &sig) != 0) {
+            continue;
+        }
+        if (!atomic_load(&exporter.running)) {
+            break;
+        }
+        int n = trace_export(exporter.path);
+        if (n >= 0) {
+            printf("   跟踪已导出: %s, %d个事件\n", exporter.path, n);
+        }
+    }
+    return NULL;
+}
+
+int trace_start(const char* path) {
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGUSR1);
+    // 之后创建的线程都继承该屏蔽，SIGUSR1 只由导出线程 sigwait 取走
+    if (pthread_sigmask(SIG_BLOCK, &set, NULL) != 0) {
+        perror("无法屏蔽SIGUSR1");
+        return -1;
+    }
+    snprintf(exporter.path, sizeof(exporter.path), "%s", path);
+    atomic_store(&exporter.running, 1);
+    if (pthread_create(&exporter.thread, NULL, trace_thread, NULL) != 0) {
+        printf("   跟踪导出线程创建失败\n");
+        return -1;
+    }
+    atomic_store(&g_trace_enabled, 1);
+    return 0;
+}
+
+void trace_stop(void) {
+    if (!atomic_load(&exporter.running)) {
+        return;
+    }
+    atomic_store(&g_trace_enabled, 0);
+    atomic_store(&exporter.running, 0);
+    pthread_kill(exporter.thread, SIGUSR1);
+    pthread_join(exporter.thread, NULL);
+    int n = trace_export(exporter.path);
+    if (n >= 0) {
+        printf("   跟踪已导出: %s, %d个事件\n", exporter.path, n);
+    }
+}
@@ -0,0 +1,540 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "video_encoder.h"
+#include "metrics.h"
+#include "mem_arena.h"
+
+static const char* const codec_names[] = { "h264", "h265" };
+static const char* const rc_names[] = { "cbr", "vbr", "avbr", "fixqp" };
+
+int video_cfg_parse(const char* spec, video_cfg_t* cfg) {
+    char buf[64];
+    char* save = NULL;
+    snprintf(buf, sizeof(buf), "%s", spec);
+
+    char* tok = strtok_r(buf, ":", &save);
+    if (!tok) {
+        return -1;
+    }
+    if (strcmp(tok, "h264") == 0 || strcmp(tok, "avc") == 0) {
+        cfg->codec = VIDEO_CODEC_H264;
+    } else if (strcmp(tok, "h265") == 0 || strcmp(tok, "hevc") == 0) {
+        cfg->codec = VIDEO_CODEC_H265;
+    } else {
+        return -1;
+    }
+    if ((tok = strtok_r(NULL, ":", &save)) != NULL) {
+        size_t i;
+        for (i = 0; i < sizeof(rc_names) / sizeof(rc_names[0]); i++) {
+            if (strcmp(tok, rc_names[i]) == 0) {
+                break;
+            }
+        }
+        if (i == sizeof(rc_names) / sizeof(rc_names[0])) {
+            return -1;
+        }
+        cfg->rc = (video_rc_t)i;
+    }
+    // 其余字段依次为码率、GOP、帧率；FIXQP 时码率位置给出的是 QP
+    int* fields[] = { cfg->rc == VIDEO_RC_FIXQP ? &cfg->qp : &cfg->bitrate_kbps, &cfg->gop, &cfg->fps };
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        if ((tok = strtok_r(NULL, ":", &save)) == NULL) {
+            break;
+        }
+        char* end;
+        long val = strtol(tok, &end, 10);
+        if (*end != '\0' || val <= 0) {
+            return -1;
+        }
+        *fields[i] = (int)val;
+    }
+    if (cfg->qp > 51) {
+        cfg->qp = 51;
+    }
+    return 0;
+}
+
+const char* video_codec_ext(video_codec_t codec) {
+    return codec_names[codec == VIDEO_CODEC_H265];
+}
+
+size_t video_cfg_packet_slot(const video_cfg_t* cfg) {
+    size_t slot = (size_t)cfg->bitrate_kbps * 1000 / 8 / (cfg->fps > 0 ? cfg->fps : 1) * VIDEO_PACKET_SLOT_FRAMES;
+    return slot > VIDEO_PACKET_SLOT_MIN ? slot : VIDEO_PACKET_SLOT_MIN;
+}
+
+void video_encoder_set_stream(video_encoder_t* v, enc_chunk_fn fn, void* arg) {
+    v->chunk_fn = fn;
+    v->chunk_arg = arg;
+}
+
+#if MIPI_WITH_MPP
+
+static const MppEncRcMode rc_modes[] = {
+    MPP_ENC_RC_MODE_CBR, MPP_ENC_RC_MODE_VBR, MPP_ENC_RC_MODE_AVBR, MPP_ENC_RC_MODE_FIXQP,
+};
+
+/**
+ * @brief 写入码率控制相关配置，取值参考 MPP 自带的 mpi_enc_test
+ */
+static void video_cfg_rc(MppEncCfg cfg, const video_cfg_t* c) {
+    int bps = c->bitrate_kbps * 1000;
+    mpp_enc_cfg_set_s32(cfg, "rc:mode", rc_modes[c->rc]);
+    mpp_enc_cfg_set_s32(cfg, "rc:fps_in_flex", 0);
+    mpp_enc_cfg_set_s32(cfg, "rc:fps_in_num", c->fps);
+    mpp_enc_cfg_set_s32(cfg, "rc:fps_in_denom", 1);
+    mpp_enc_cfg_set_s32(cfg, "rc:fps_out_flex", 0);
+    mpp_enc_cfg_set_s32(cfg, "rc:fps_out_num", c->fps);
+    mpp_enc_cfg_set_s32(cfg, "rc:fps_out_denom", 1);
+    mpp_enc_cfg_set_s32(cfg, "rc:gop", c->gop);
+
+    if (c->rc == VIDEO_RC_FIXQP) {
+        mpp_enc_cfg_set_s32(cfg, "rc:qp_init", c->qp);
+        mpp_enc_cfg_set_s32(cfg, "rc:qp_max", c->qp);
+        mpp_enc_cfg_set_s32(cfg, "rc:qp_min", c->qp);
+        mpp_enc_cfg_set_s32(cfg, "rc:qp_max_i", c->qp);
+        mpp_enc_cfg_set_s32(cfg, "rc:qp_min_i", c->qp);
+        mpp_enc_cfg_set_s32(cfg, "rc:qp_ip", 0);
+        return;
+    }
+    mpp_enc_cfg_set_s32(cfg, "rc:bps_target", bps);
+    // CBR 允许 ±1/16 波动；VBR/AVBR 上限同 CBR，下限放宽到 1/16，静止画面可以省码率
+    mpp_enc_cfg_set_s32(cfg, "rc:bps_max", bps / 16 * 17);
+    mpp_enc_cfg_set_s32(cfg, "rc:bps_min", c->rc == VIDEO_RC_CBR ? bps / 16 * 15 : bps / 16);
+    mpp_enc_cfg_set_s32(cfg, "rc:qp_init", c->qp);
+    mpp_enc_cfg_set_s32(cfg, "rc:qp_max", 51);
+    mpp_enc_cfg_set_s32(cfg, "rc:qp_min", 10);
+    mpp_enc_cfg_set_s32(cfg, "rc:qp_max_i", 51);
+    mpp_enc_cfg_set_s32(cfg, "rc:qp_min_i", 10);
+    mpp_enc_cfg_set_s32(cfg, "rc:qp_ip", 2);
+}
+
+/**
+ * @brief 低延迟分片：每片 slice_rows 行 CTU(H.264 为 16x16 宏块，H.265 按 32x32 计)，
+ *        每片编完就从 encode_get_packet 输出，不等整帧
+ */
+static void video_cfg_split(MppEncCfg cfg, const video_cfg_t* c, int width) {
+    if (c->slice_rows <= 0) {
+        return;
+    }
+    int ctu = c->codec == VIDEO_CODEC_H265 ? 32 : 16;
+    mpp_enc_cfg_set_s32(cfg, "split:mode", MPP_ENC_SPLIT_BY_CTU);
+    mpp_enc_cfg_set_s32(cfg, "split:arg", (width + ctu - 1) / ctu * c->slice_rows);
+    mpp_enc_cfg_set_s32(cfg, "split:out", MPP_ENC_SPLIT_OUT_LOWDELAY);
+}
+
+int video_encoder_init(video_encoder_t* v, int width, int height, const video_cfg_t* cfg) {
+    MPP_RET ret;
+    memset(v, 0, sizeof(*v));
+    v->cfg_v = *cfg;
+    v->width = width;
+    v->height = height;
+    // 跨度与 JPEG 编码器的输入缓冲一致，两者才能编码同一个缓冲
+    v->hor_stride = width;
+    v->ver_stride = height;
+    v->frame_size = (size_t)width * height * 3 / 2;
+    MppCodingType coding = cfg->codec == VIDEO_CODEC_H265 ? MPP_VIDEO_CodingHEVC : MPP_VIDEO_CodingAVC;
+
+    ret = mpp_create(&v->ctx, &v->mpi);
+    if (ret != MPP_OK) {
+        printf("   录像编码器创建失败: %d\n", ret);
+        return -1;
+    }
+    ret = mpp_init(v->ctx, MPP_CTX_ENC, coding);
+    if (ret != MPP_OK) {
+        printf("   录像编码器初始化失败(%s): %d\n", video_codec_ext(cfg->codec), ret);
+        goto fail;
+    }
+    ret = mpp_enc_cfg_init(&v->cfg);
+    if (ret != MPP_OK) {
+        printf("   ❌ 录像编码配置初始化失败: %d\n", ret);
+        goto fail;
+    }
+    v->mpi->control(v->ctx, MPP_ENC_GET_CFG, v->cfg);
+    mpp_enc_cfg_set_s32(v->cfg, "prep:width", width);
+    mpp_enc_cfg_set_s32(v->cfg, "prep:height", height);
+    mpp_enc_cfg_set_s32(v->cfg, "prep:hor_stride", v->hor_stride);
+    mpp_enc_cfg_set_s32(v->cfg, "prep:ver_stride", v->ver_stride);
+    mpp_enc_cfg_set_s32(v->cfg, "prep:format", MPP_FMT_YUV420SP);
+    video_cfg_rc(v->cfg, cfg);
+    mpp_enc_cfg_set_s32(v->cfg, "codec:type", coding);
+    if (cfg->codec == VIDEO_CODEC_H264) {
+        mpp_enc_cfg_set_s32(v->cfg, "h264:profile", 100);   // High
+        mpp_enc_cfg_set_s32(v->cfg, "h264:level", 40);
+        mpp_enc_cfg_set_s32(v->cfg, "h264:cabac_en", 1);
+        mpp_enc_cfg_set_s32(v->cfg, "h264:cabac_idc", 0);
+        mpp_enc_cfg_set_s32(v->cfg, "h264:trans8x8", 1);
+    }
+    video_cfg_split(v->cfg, cfg, width);
+    ret = v->mpi->control(v->ctx, MPP_ENC_SET_CFG, v->cfg);
+    if (ret != MPP_OK) {
+        printf("   ❌ 录像编码器配置失败: %d\n", ret);
+        goto fail;
+    }
+    // 每个 IDR 前都输出 SPS/PPS，分段文件各自可以独立解码
+    MppEncHeaderMode header_mode = MPP_ENC_HEADER_MODE_EACH_IDR;
+    v->mpi->control(v->ctx, MPP_ENC_SET_HEADER_MODE, &header_mode);
+    RK_S64 timeout = VIDEO_ENCODER_OUTPUT_TIMEOUT_MS;
+    v->mpi->control(v->ctx, MPP_SET_OUTPUT_TIMEOUT, &timeout);
+    if (cfg->slice_rows > 0) {
+        // 各片分别释放，整帧拼在这里交给分段写线程；压缩后不会超过原始帧
+        v->slices_capacity = v->frame_size;
+        v->slices = mem_map_default(v->slices_capacity);
+        if (!v->slices) {
+            goto fail;
+        }
+    }
+
+    printf("   ✅ 录像编码器就绪: %s %s %dkbps GOP%d %dfps\n", video_codec_ext(cfg->codec),
+           rc_names[cfg->rc], cfg->bitrate_kbps, cfg->gop, cfg->fps);
+    return 0;
+
+fail:
+    video_encoder_deinit(v);
+    return -1;
+}
+
+/**
+ * @brief 低延迟模式取一帧：逐片取包，每片交给回调并拼进整帧缓冲，直到 EOI 片。
+ *        不支持分片的编码器输出的是不带分片标记的整帧，同样按最后一片处理
+ */
+static MPP_RET video_get_slices(video_encoder_t* v, video_packet_t* out) {
+    size_t n = 0;
+    int eoi = 0;
+    out->keyframe = 0;
+    while (!eoi) {
+        MppPacket pkt = NULL;
+        MPP_RET ret = v->mpi->encode_get_packet(v->ctx, &pkt);
+        if (ret != MPP_OK || !pkt) {
+            return ret != MPP_OK ? ret : MPP_NOK;
+        }
+        const uint8_t* data = mpp_packet_get_pos(pkt);
+        size_t len = mpp_packet_get_length(pkt);
+        eoi = !mpp_packet_is_partition(pkt) || mpp_packet_is_eoi(pkt);
+        if (n == 0) {
+            RK_S32 intra = 0;
+            mpp_meta_get_s32(mpp_packet_get_meta(pkt), KEY_OUTPUT_INTRA, &intra);
+            out->keyframe = intra != 0;
+        }
+        if (v->chunk_fn) {
+            v->chunk_fn(v->chunk_arg, data, len, eoi);
+        }
+        if (n + len <= v->slices_capacity) {
+            memcpy(v->slices + n, data, len);
+        }
+        n += len;
+        mpp_packet_deinit(&pkt);
+    }
+    if (n > v->slices_capacity) {
+        printf("   录像分片合计%zu字节超出整帧缓冲\n", n);
+        return MPP_NOK;
+    }
+    out->data = v->slices;
+    out->length = n;
+    return MPP_OK;
+}
+
+int video_encoder_encode_buffer(video_encoder_t* v, MppBuffer input, uint64_t pts_us, video_packet_t* out) {
+    MppFrame frame = NULL;
+    MPP_RET ret;
+
+    if (v->packet) {
+        mpp_packet_deinit(&v->packet);
+    }
+    ret = mpp_frame_init(&frame);
+    if (ret != MPP_OK) {
+        return -1;
+    }
+    mpp_frame_set_buffer(frame, input);
+    mpp_frame_set_width(frame, v->width);
+    mpp_frame_set_height(frame, v->height);
+    mpp_frame_set_hor_stride(frame, v->hor_stride);
+    mpp_frame_set_ver_stride(frame, v->ver_stride);
+    mpp_frame_set_offset_x(frame, v->crop_x);
+    mpp_frame_set_offset_y(frame, v->crop_y);
+    mpp_frame_set_fmt(frame, MPP_FMT_YUV420SP);
+    mpp_frame_set_pts(frame, (RK_S64)pts_us);
+    mpp_frame_set_eos(frame, 0);
+
+    ret = v->mpi->encode_put_frame(v->ctx, frame);
+    mpp_frame_deinit(&frame);
+    if (ret == MPP_OK && v->slices) {
+        ret = video_get_slices(v, out);
+    } else if (ret == MPP_OK) {
+        ret = v->mpi->encode_get_packet(v->ctx, &v->packet);
+    }
+    if (ret == MPP_ERR_TIMEOUT) {
+        printf("   录像编码超时(%dms)，复位编码器\n", VIDEO_ENCODER_OUTPUT_TIMEOUT_MS);
+        video_encoder_reset(v);
+        return -1;
+    }
+    if (ret != MPP_OK || (!v->slices && !v->packet)) {
+        printf("   录像编码失败: %d\n", ret);
+        return -1;
+    }
+
+    if (!v->slices) {
+        RK_S32 intra = 0;
+        mpp_meta_get_s32(mpp_packet_get_meta(v->packet), KEY_OUTPUT_INTRA, &intra);
+        out->data = mpp_packet_get_pos(v->packet);
+        out->length = mpp_packet_get_length(v->packet);
+        out->keyframe = intra != 0;
+        if (v->chunk_fn) {
+            v->chunk_fn(v->chunk_arg, out->data, out->length, 1);
+        }
+    }
+    v->frames++;
+    v->bytes += out->length;
+    v->keyframes += out->keyframe;
+    return 0;
+}
+
+int video_encoder_encode(video_encoder_t* v, const uint8_t* nv12, uint64_t pts_us, video_packet_t* out) {
+    if (!v->frame_buf) {
+        // 只有拷贝路径才需要自己的输入缓冲，主程序直接编码共享的输入缓冲
+        if (mpp_buffer_group_get_internal(&v->group, MPP_BUFFER_TYPE_ION) != MPP_OK ||
+            mpp_buffer_get(v->group, &v->frame_buf, v->frame_size) != MPP_OK) {
+            printf("   录像输入缓冲分配失败\n");
+            return -1;
+        }
+    }
+    mpp_buffer_sync_begin(v->frame_buf);
+    memcpy(mpp_buffer_get_ptr(v->frame_buf), nv12, v->frame_size);
+    mpp_buffer_sync_end(v->frame_buf);
+    return video_encoder_encode_buffer(v, v->frame_buf, pts_us, out);
+}
+
+int video_encoder_set_crop(video_encoder_t* v, const roi_rect_t* roi) {
+    roi_rect_t r = { 0, 0, v->hor_stride, v->ver_stride };
+    if (roi) {
+        r = *roi;
+        if (roi_clip(&r, v->hor_stride, v->ver_stride) != 0) {
+            printf("   录像裁剪区域超出图像范围\n");
+            return -1;
+        }
+    }
+    mpp_enc_cfg_set_s32(v->cfg, "prep:width", r.width);
+    mpp_enc_cfg_set_s32(v->cfg, "prep:height", r.height);
+    video_cfg_split(v->cfg, &v->cfg_v, r.width);
+    MPP_RET ret = v->mpi->control(v->ctx, MPP_ENC_SET_CFG, v->cfg);
+    if (ret != MPP_OK) {
+        printf("   ❌ 录像裁剪配置失败: %d\n", ret);
+        return -1;
+    }
+    v->crop_x = r.x;
+    v->crop_y = r.y;
+    v->width = r.width;
+    v->height = r.height;
+    // 分辨率变化后必须从新的参数集开始
+    video_encoder_request_idr(v);
+    return 0;
+}
+
+int video_encoder_set_size(video_encoder_t* v, int width, int height) {
+    if (width <= 0 || height <= 0 || (size_t)width * height * 3 / 2 > v->frame_size) {
+        printf("   录像 %dx%d 超出初始帧大小\n", width, height);
+        return -1;
+    }
+    mpp_enc_cfg_set_s32(v->cfg, "prep:width", width);
+    mpp_enc_cfg_set_s32(v->cfg, "prep:height", height);
+    mpp_enc_cfg_set_s32(v->cfg, "prep:hor_stride", width);
+    mpp_enc_cfg_set_s32(v->cfg, "prep:ver_stride", height);
+    video_cfg_split(v->cfg, &v->cfg_v, width);
+    MPP_RET ret = v->mpi->control(v->ctx, MPP_ENC_SET_CFG, v->cfg);
+    if (ret != MPP_OK) {
+        printf("   ❌ 录像尺寸配置失败: %d\n", ret);
+        return -1;
+    }
+    v->hor_stride = width;
+    v->ver_stride = height;
+    v->width = width;
+    v->height = height;
+    v->crop_x = 0;
+    v->crop_y = 0;
+    video_encoder_request_idr(v);
+    return 0;
+}
+
+int video_encoder_reset(video_encoder_t* v) {
+    uint64_t t0 = metrics_now_us();
+    MPP_RET ret = v->mpi->reset(v->ctx);
+    if (ret == MPP_OK) {
+        ret = v->mpi->control(v->ctx, MPP_ENC_SET_CFG, v->cfg);
+    }
+    metrics_count(METRIC_ENCODER_RESETS, 1);
+    metrics_observe_us(METRIC_STAGE_RECOVERY, metrics_now_us() - t0);
+    if (ret != MPP_OK) {
+        printf("   录像编码器复位失败: %d\n", ret);
+        return -1;
+    }
+    // 复位丢掉了参考帧，下一帧必须是 IDR
+    v->mpi->control(v->ctx, MPP_ENC_SET_IDR_FRAME, NULL);
+    return 0;
+}
+
+void video_encoder_request_idr(video_encoder_t* v) {
+    v->mpi->control(v->ctx, MPP_ENC_SET_IDR_FRAME, NULL);
+}
+
+void video_encoder_deinit(video_encoder_t* v) {
+    if (v->packet) {
+        mpp_packet_deinit(&v->packet);
+    }
+    if (v->slices) {
+        mem_unmap_default(v->slices, v->slices_capacity);
+        v->slices = NULL;
+    }
+    if (v->frame_buf) {
+        mpp_buffer_put(v->frame_buf);
+        v->frame_buf = NULL;
+    }
+    if (v->group) {
+        mpp_buffer_group_put(v->group);
+        v->group = NULL;
+    }
+    if (v->cfg) {
+        mpp_enc_cfg_deinit(v->cfg);
+        v->cfg = NULL;
+    }
+    if (v->ctx) {
+        mpp_destroy(v->ctx);
+        v->ctx = NULL;
+    }
+}
+
+#else
+/* ---------- 桩编码器 ---------- */
+
+/**
+ * @brief 写一个 NAL：起始码 + NAL 头 + 填充负载。负载字节最高位恒为1，不会出现伪起始码
+ */
+static size_t stub_nal(uint8_t* p, video_codec_t codec, int type, size_t payload, uint32_t seed) {
+    size_t n = 0;
+    p[n++] = 0;
+    p[n++] = 0;
+    p[n++] = 0;
+    p[n++] = 1;
+    if (codec == VIDEO_CODEC_H265) {
+        p[n++] = (uint8_t)(type << 1);
+        p[n++] = 1;
+    } else {
+        p[n++] = (uint8_t)(0x60 | type);
+    }
+    for (size_t i = 0; i < payload; i++) {
+        seed = seed * 1103515245u + 12345u;
+        p[n++] = (uint8_t)(0x80 | (seed >> 24));
+    }
+    return n;
+}
+
+int video_encoder_init(video_encoder_t* v, int width, int height, const video_cfg_t* cfg) {
+    memset(v, 0, sizeof(*v));
+    v->cfg_v = *cfg;
+    v->width = width;
+    v->height = height;
+    v->hor_stride = width;
+    v->ver_stride = height;
+    v->frame_size = (size_t)width * height * 3 / 2;
+    v->out_capacity = v->frame_size + 256;
+    v->out = mem_map_default(v->out_capacity);
+    if (!v->out) {
+        return -1;
+    }
+    printf("   录像桩编码器: %s %s %dkbps GOP%d %dfps(不压缩，仅生成 NAL 结构)\n",
+           video_codec_ext(cfg->codec), rc_names[cfg->rc], cfg->bitrate_kbps, cfg->gop, cfg->fps);
+    return 0;
+}
+
+int video_encoder_encode(video_encoder_t* v, const uint8_t* nv12, uint64_t pts_us, video_packet_t* out) {
+    const video_cfg_t* c = &v->cfg_v;
+    int key = v->frames % (uint64_t)c->gop == 0 || v->keyframes == 0 || v->force_idr;
+    (void)pts_us;
+
+    // 每帧大小按码率分配，关键帧是普通帧的 4 倍；FIXQP 时 QP 每增加 6 大小减半
+    size_t per_frame = c->rc == VIDEO_RC_FIXQP ? ((size_t)v->width * v->height * 3 / 2) >> (c->qp / 6)
+                                               : (size_t)c->bitrate_kbps * 125 / (size_t)c->fps;
+    size_t payload = key ? per_frame * 4 * c->gop / (c->gop + 3) : per_frame * c->gop / (c->gop + 3);
+    if (payload + 64 > v->out_capacity) {
+        payload = v->out_capacity - 64;
+    }
+    uint32_t seed = (uint32_t)v->frames;
+    for (size_t i = 0; i < v->frame_size; i += 4093) {
+        seed = seed * 31 + nv12[i];
+    }
+
+    size_t n = 0;
+    if (key && c->codec == VIDEO_CODEC_H265) {
+        n += stub_nal(v->out + n, c->codec, 32, 8, seed);   // VPS
+        n += stub_nal(v->out + n, c->codec, 33, 16, seed);  // SPS
+        n += stub_nal(v->out + n, c->codec, 34, 4, seed);   // PPS
+        n += stub_nal(v->out + n, c->codec, 19, payload, seed);
+    } else if (key) {
+        n += stub_nal(v->out + n, c->codec, 7, 16, seed);
+        n += stub_nal(v->out + n, c->codec, 8, 4, seed);
+        n += stub_nal(v->out + n, c->codec, 5, payload, seed);
+    } else {
+        n += stub_nal(v->out + n, c->codec, 1, payload, seed);
+    }
+    out->data = v->out;
+    out->length = n;
+    out->keyframe = key;
+    if (v->chunk_fn) {
+        v->chunk_fn(v->chunk_arg, out->data, out->length, 1);
+    }
+    v->force_idr = 0;
+    v->frames++;
+    v->bytes += n;
+    v->keyframes += key;
+    return 0;
+}
+
+int video_encoder_set_crop(video_encoder_t* v, const roi_rect_t* roi) {
+    roi_rect_t r = { 0, 0, v->hor_stride, v->ver_stride };
+    if (roi) {
+        r = *roi;
+        if (roi_clip(&r, v->hor_stride, v->ver_stride) != 0) {
+            printf("   录像裁剪区域超出图像范围\n");
+            return -1;
+        }
+    }
+    v->crop_x = r.x;
+    v->crop_y = r.y;
+    v->width = r.width;
+    v->height = r.height;
+    v->force_idr = 1;
+    return 0;
+}
+
+int video_encoder_set_size(video_encoder_t* v, int width, int height) {
+    if (width <= 0 || height <= 0 || (size_t)width * height * 3 / 2 > v->frame_size) {
+        printf("   录像 %dx%d 超出初始帧大小\n", width, height);
+        return -1;
+    }
+    v->hor_stride = width;
+    v->ver_stride = height;
+    v->width = width;
+    v->height = height;
+    v->crop_x = 0;
+    v->crop_y = 0;
+    v->force_idr = 1;
+    return 0;
+}
+
+int video_encoder_reset(video_encoder_t* v) {
+    metrics_count(METRIC_ENCODER_RESETS, 1);
+    v->force_idr = 1;
+    return 0;
+}
+
+void video_encoder_request_idr(video_encoder_t* v) {
+    v->force_idr = 1;
+}
+
+void video_encoder_deinit(video_encoder_t* v) {
+    mem_unmap_default(v->out, v->out_capacity);
+    v->out = NULL;
+}
+
+#endif
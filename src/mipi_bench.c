@@ -0,0 +1,1288 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/utsname.h>
+#include <linux/videodev2.h>
+#include "enc_backend.h"
+#include "sw_jpeg.h"
+#include "metrics.h"
+#include "raw_record.h"
+#include "enc_packet.h"
+#include "segment_writer.h"
+#include "trace.h"
+#include "frame_stats.h"
+#include "mem_arena.h"
+#include "stream_out.h"
+#include "jpeg_xform.h"
+#include "shm_ring.h"
+#if MIPI_WITH_MPP
+#include "mpp_encoder.h"
+#endif
+
+/*
+ * 基准测试：NV12 拷贝(含 MPP 缓冲 cache 同步、拷贝同时做图像统计)、格式转换、JPEG 编码、写盘吞吐、端到端流水线、
+ * 跟踪点开销、帧内存分配方式、低延迟分块输出、共享内存环发布/读取和 JPEG 压缩域旋转/裁剪。
+ * 输入为固定种子生成的合成帧，或原始录制(-i xxx.idx)中的前几帧，同一输入每次结果可比。
+ * 结果以 JSON 输出，-c 与之前保存的结果比较，中位数变慢超过阈值时返回非零。
+ * 库函数的过程日志改写到 stderr，stdout 上只有 JSON。
+ */
+
+#ifndef MIPI_BENCH_VERSION
+#define MIPI_BENCH_VERSION  "dev"
+#endif
+#ifndef MIPI_BENCH_BUILD_TYPE
+#define MIPI_BENCH_BUILD_TYPE   "unknown"
+#endif
+
+#define BENCH_FRAMES        8       // 轮流使用的输入帧数，避免全部命中 cache
+#define BENCH_MAX_RESULTS   32
+#define BENCH_BUF_ALIGN     65536   // 输入帧缓冲对齐，足够覆盖原始录制的槽位对齐
+#define BENCH_TRACE_BATCH   1000    // 跟踪点单次太短，每个样本计一批
+#define BENCH_ALLOC_BATCH   64      // 每个样本模拟一帧内的分配次数
+#define BENCH_ALLOC_MAX     4096    // 单次分配的最大字节数，也是对象池的对象大小
+#define BENCH_STREAM_LINK_MBPS  100     // 分块输出测试中模拟的转发链路带宽
+#define BENCH_STREAM_TIMEOUT_US 2000000 // 等消费者收齐一帧的上限
+#define BENCH_SHM_SLOTS     4       // 共享内存环槽位数，与 mipi_main 的 NV12 环相同
+
+typedef struct {
+    const char* name;
+    uint64_t count;
+    double min_us;
+    double median_us;
+    double p90_us;
+    double mean_us;
+    double throughput;              // 按 unit 计
+    const char* unit;               // "MB/s" 或 "fps"
+    double bytes_per_frame;         // 编码输出大小，0 不输出
+    int has_allocs;                 // 是否输出 heap_allocs_per_frame
+    double heap_allocs_per_frame;   // 稳定运行时每帧退回堆分配的次数，应为0
+} bench_result_t;
+
+typedef struct {
+    // 配置
+    int width;
+    int height;
+    int quality;
+    int iterations;
+    int warmup;
+    const char* backend;
+    const char* input;              // 原始录制索引，NULL 为合成帧
+    const char* tmp_dir;
+    int huge_pages;
+    double link_mbps;               // 分块输出测试模拟的链路带宽
+    size_t frame_size;
+    size_t buf_size;
+    // 输入帧
+    uint8_t* frames[BENCH_FRAMES];
+    int n_frames;
+    // 结果
+    bench_result_t results[BENCH_MAX_RESULTS];
+    int n_results;
+    uint64_t* samples;
+} bench_t;
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * @brief 由 n 次单次耗时生成一条结果
+ * @param bytes 每次处理的字节数，用于计算 MB/s；0 时按次数计 fps
+ */
+static bench_result_t* bench_record(bench_t* bt, const char* name, const uint64_t* us, uint64_t n, double bytes) {
+    bench_result_t* r = &bt->results[bt->n_results++];
+    double* v = malloc(sizeof(double) * (n ? n : 1));
+    double sum = 0;
+    memset(r, 0, sizeof(*r));
+    r->name = name;
+    r->count = n;
+    if (!v || n == 0) {
+        free(v);
+        return r;
+    }
+    for (uint64_t i = 0; i < n; i++) {
+        v[i] = (double)us[i];
+        sum += v[i];
+    }
+    qsort(v, n, sizeof(double), cmp_double);
+    r->min_us = v[0];
+    r->median_us = n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+    r->p90_us = v[(n * 9) / 10 < n ? (n * 9) / 10 : n - 1];
+    r->mean_us = sum / n;
+    if (bytes > 0) {
+        r->unit = "MB/s";
+        r->throughput = r->median_us > 0 ? bytes / r->median_us : 0;  // 字节/us 即 MB/s
+    } else {
+        r->unit = "fps";
+        r->throughput = r->median_us > 0 ? 1e6 / r->median_us : 0;
+    }
+    free(v);
+    return r;
+}
+
+/**
+ * @brief 固定种子生成带渐变、噪声和移动色块的 NV12 帧，每帧内容不同
+ */
+static void bench_fill_frame(uint8_t* dst, int width, int height, int index) {
+    uint32_t seed = 12345u + (uint32_t)index * 7919u;
+    int bx = (index * 97) % (width > 256 ? width - 256 : 1);
+    int by = (index * 53) % (height > 256 ? height - 256 : 1);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            seed = seed * 1103515245u + 12345u;
+            int v = (x + y + index * 4) / 8 + ((seed >> 24) & 15);
+            if (x >= bx && x < bx + 256 && y >= by && y < by + 256) {
+                v = ((x ^ y) & 32) ? 220 : 40;
+            }
+            dst[(size_t)y * width + x] = (uint8_t)v;
+        }
+    }
+    uint8_t* uv = dst + (size_t)width * height;
+    for (int y = 0; y < height / 2; y++) {
+        for (int x = 0; x < width; x++) {
+            uv[(size_t)y * width + x] = (uint8_t)(128 + (((x / 2 + y + index * 8) / 16) & 31) - 16);
+        }
+    }
+}
+
+static int bench_load_frames(bench_t* bt) {
+    raw_reader_t reader;
+    int have_reader = 0;
+    if (bt->input) {
+        char base[4096];
+        size_t len = strlen(bt->input);
+        snprintf(base, sizeof(base), "%.*s",
+                 (int)(len > 4 && strcmp(bt->input + len - 4, ".idx") == 0 ? len - 4 : len), bt->input);
+        if (raw_reader_open(&reader, base) != 0) {
+            return -1;
+        }
+        have_reader = 1;
+        bt->width = (int)reader.header.width;
+        bt->height = (int)reader.header.height;
+        if (reader.header.frame_size != (uint32_t)bt->width * bt->height * 3 / 2 || reader.count == 0) {
+            printf("录制不是 NV12 或为空: %s\n", bt->input);
+            raw_reader_close(&reader);
+            return -1;
+        }
+    }
+    bt->frame_size = (size_t)bt->width * bt->height * 3 / 2;
+    bt->buf_size = (bt->frame_size + BENCH_BUF_ALIGN - 1) & ~(size_t)(BENCH_BUF_ALIGN - 1);
+    bt->n_frames = BENCH_FRAMES;
+    for (int i = 0; i < BENCH_FRAMES; i++) {
+        bt->frames[i] = aligned_alloc(RAW_RECORD_ALIGN, bt->buf_size);
+        if (!bt->frames[i]) {
+            printf("测试帧分配失败\n");
+            if (have_reader) {
+                raw_reader_close(&reader);
+            }
+            return -1;
+        }
+        memset(bt->frames[i] + bt->frame_size, 0, bt->buf_size - bt->frame_size);
+        if (have_reader) {
+            const uint8_t* src = raw_reader_frame(&reader, (uint64_t)i % reader.count);
+            if (!src) {
+                raw_reader_close(&reader);
+                return -1;
+            }
+            memcpy(bt->frames[i], src, bt->frame_size);
+        } else {
+            bench_fill_frame(bt->frames[i], bt->width, bt->height, i);
+        }
+    }
+    if (have_reader) {
+        raw_reader_close(&reader);
+    }
+    return 0;
+}
+
+/**
+ * @brief 采集帧拷贝到编码输入缓冲(非零拷贝模式下每帧都要做)
+ */
+static void bench_copy(bench_t* bt) {
+    uint8_t* dst = aligned_alloc(RAW_RECORD_ALIGN, bt->buf_size);
+    if (!dst) {
+        return;
+    }
+    int total = bt->warmup + bt->iterations;
+    for (int i = 0; i < total; i++) {
+        uint64_t t0 = metrics_now_us();
+        memcpy(dst, bt->frames[i % bt->n_frames], bt->frame_size);
+        uint64_t t1 = metrics_now_us();
+        if (i >= bt->warmup) {
+            bt->samples[i - bt->warmup] = t1 - t0;
+        }
+    }
+    bench_record(bt, "copy", bt->samples, (uint64_t)bt->iterations, (double)bt->frame_size);
+
+    // 图像统计：与拷贝融合为一遍，对照先拷贝再单独读一遍
+    frame_stats_t st;
+    for (int i = 0; i < total; i++) {
+        uint64_t t0 = metrics_now_us();
+        frame_stats_copy(dst, bt->frames[i % bt->n_frames], bt->width, bt->height, bt->frame_size, &st);
+        uint64_t t1 = metrics_now_us();
+        if (i >= bt->warmup) {
+            bt->samples[i - bt->warmup] = t1 - t0;
+        }
+    }
+    bench_record(bt, "copy_stats_fused", bt->samples, (uint64_t)bt->iterations, (double)bt->frame_size);
+    for (int i = 0; i < total; i++) {
+        uint64_t t0 = metrics_now_us();
+        memcpy(dst, bt->frames[i % bt->n_frames], bt->frame_size);
+        frame_stats_scan(bt->frames[i % bt->n_frames], bt->width, bt->height, &st);
+        uint64_t t1 = metrics_now_us();
+        if (i >= bt->warmup) {
+            bt->samples[i - bt->warmup] = t1 - t0;
+        }
+    }
+    bench_record(bt, "copy_then_stats", bt->samples, (uint64_t)bt->iterations, (double)bt->frame_size);
+    free(dst);
+
+#if MIPI_WITH_MPP
+    // 与 mipi_text 相同的路径：拷贝到 MPP 缓冲并做 cache 同步
+    static const mpp_heap_t heap = MPP_HEAP_DEFAULT;
+    mpp_encoder_t enc;
+    if (mpp_encoder_init(&enc, bt->width, bt->height, bt->quality, &heap) != 0) {
+        return;
+    }
+    for (int i = 0; i < total; i++) {
+        uint64_t t0 = metrics_now_us();
+        mpp_encoder_load_frame(&enc, bt->frames[i % bt->n_frames], bt->frame_size);
+        uint64_t t1 = metrics_now_us();
+        if (i >= bt->warmup) {
+            bt->samples[i - bt->warmup] = t1 - t0;
+        }
+    }
+    bench_record(bt, "copy_mpp_sync", bt->samples, (uint64_t)bt->iterations, (double)bt->frame_size);
+    mpp_encoder_deinit(&enc);
+#endif
+}
+
+/**
+ * @brief NV12 到 JPEG 输入块的格式转换(去交织、电平平移)，软件编码的第一阶段
+ */
+static void bench_convert(bench_t* bt) {
+    sw_jpeg_t j;
+    float yb[4][64], cb[64], cr[64];
+    volatile float sink = 0;
+    if (sw_jpeg_init(&j, bt->width, bt->height, bt->quality) != 0) {
+        return;
+    }
+    int total = bt->warmup + bt->iterations;
+    for (int i = 0; i < total; i++) {
+        const uint8_t* f = bt->frames[i % bt->n_frames];
+        uint64_t t0 = metrics_now_us();
+        for (int my = 0; my < bt->height; my += 16) {
+            for (int mx = 0; mx < bt->width; mx += 16) {
+                sw_jpeg_load_mcu(&j, f, bt->width, f + (size_t)bt->width * bt->height, bt->width,
+                                 mx, my, yb, cb, cr);
+                sink += yb[3][63] + cb[0] + cr[63];
+            }
+        }
+        uint64_t t1 = metrics_now_us();
+        if (i >= bt->warmup) {
+            bt->samples[i - bt->warmup] = t1 - t0;
+        }
+    }
+    (void)sink;
+    bench_record(bt, "convert_nv12_blocks", bt->samples, (uint64_t)bt->iterations, (double)bt->frame_size);
+}
+
+/**
+ * @brief 整帧 JPEG 编码
+ * @return 平均每帧编码输出字节数，失败返回0
+ */
+static size_t bench_jpeg(bench_t* bt) {
+    enc_backend_t b;
+    uint64_t bytes = 0;
+    if (enc_backend_open(&b, bt->backend, bt->width, bt->height, bt->quality) != 0) {
+        return 0;
+    }
+    int total = bt->warmup + bt->iterations;
+    for (int i = 0; i < total; i++) {
+        size_t len = 0;
+        uint64_t t0 = metrics_now_us();
+        const uint8_t* out = enc_backend_encode(&b, bt->frames[i % bt->n_frames], &len);
+        uint64_t t1 = metrics_now_us();
+        if (!out) {
+            enc_backend_close(&b);
+            return 0;
+        }
+        if (i >= bt->warmup) {
+            bt->samples[i - bt->warmup] = t1 - t0;
+            bytes += len;
+        }
+    }
+    enc_backend_close(&b);
+    bench_result_t* r = bench_record(bt, "jpeg_encode", bt->samples, (uint64_t)bt->iterations, 0);
+    r->bytes_per_frame = (double)bytes / bt->iterations;
+    return (size_t)(r->bytes_per_frame + 0.5);
+}
+
+/**
+ * @brief 删除写盘测试产生的分段文件
+ */
+static void bench_unlink_segments(const char* prefix, unsigned int count, const char* ext) {
+    char path[320];
+    for (unsigned int i = 0; i <= count; i++) {
+        snprintf(path, sizeof(path), "%s_%05u.%s", prefix, i, ext);
+        unlink(path);
+    }
+}
+
+/**
+ * @brief 写盘吞吐：编码包经分段写线程顺序写入，NV12 原始帧经 O_DIRECT 录制线程写入。
+ *        每条结果只有一个样本(整个批次的总耗时)，吞吐含最终落盘
+ */
+static void bench_writer(bench_t* bt, size_t packet_size) {
+    char prefix[256];
+    segment_writer_t w;
+    int n = bt->iterations * 4;
+    if (packet_size == 0) {
+        packet_size = bt->frame_size / 8;
+    }
+
+    snprintf(prefix, sizeof(prefix), "%s/mipi_bench_%d", bt->tmp_dir, (int)getpid());
+    if (segment_writer_start(&w, prefix, "mjpeg", 3600, NULL) == 0) {
+        uint64_t t0 = metrics_now_us();
+        for (int i = 0; i < n; i++) {
+            enc_packet_t* pkt = enc_packet_alloc_copy(bt->frames[i % bt->n_frames], packet_size);
+            if (!pkt) {
+                break;
+            }
+            pkt->seq = (uint64_t)i;
+            pkt->timestamp_us = (uint64_t)i * 33333;
+            pkt->flags = ENC_PACKET_FLAG_KEY;   // JPEG 每帧都能独立解码
+            segment_writer_submit_wait(&w, pkt);
+        }
+        segment_writer_stop(&w);
+        uint64_t us = metrics_now_us() - t0;
+        bench_result_t* r = bench_record(bt, "writer_packets", &us, 1, (double)packet_size * n);
+        r->bytes_per_frame = (double)packet_size;
+        bench_unlink_segments(prefix, w.index, "mjpeg");
+    }
+
+    raw_record_t rec;
+    unsigned int inflight = BENCH_FRAMES - 2;
+    unsigned int free_idx[BENCH_FRAMES];
+    unsigned int n_free = 0, index;
+    for (unsigned int i = 0; i < BENCH_FRAMES; i++) {
+        free_idx[n_free++] = i;
+    }
+    if (raw_record_open(&rec, prefix, bt->width, bt->height, V4L2_PIX_FMT_NV12, bt->frame_size,
+                        bt->buf_size, (uint64_t)n, inflight) != 0) {
+        return;
+    }
+    uint64_t t0 = metrics_now_us();
+    for (int i = 0; i < n;) {
+        while (raw_record_reap(&rec, &index)) {
+            free_idx[n_free++] = index;
+        }
+        if (BENCH_FRAMES - n_free >= inflight) {
+            // 与采集线程相同，不超过写线程可持有的缓冲数，不触发录制的丢帧
+            usleep(100);
+            continue;
+        }
+        index = free_idx[--n_free];
+        if (raw_record_submit(&rec, index, bt->frames[index], (uint64_t)i, (uint64_t)i * 33333) != 0) {
+            free_idx[n_free++] = index;
+            usleep(100);
+            continue;
+        }
+        i++;
+    }
+    raw_record_close(&rec);
+    while (raw_record_reap(&rec, &index)) {
+    }
+    uint64_t us = metrics_now_us() - t0;
+    bench_record(bt, rec.direct ? "writer_raw_direct" : "writer_raw_buffered", &us, 1, (double)bt->frame_size * n);
+    char path[320];
+    snprintf(path, sizeof(path), "%s.nv12", prefix);
+    unlink(path);
+    snprintf(path, sizeof(path), "%s.idx", prefix);
+    unlink(path);
+}
+
+/**
+ * @brief 跟踪点开销：一个区间事件(trace_begin/trace_end)，未启用与启用各测一次。
+ *        每个样本是 BENCH_TRACE_BATCH 个事件的耗时，即中位数(us)除以1000为单个事件的耗时
+ */
+static void bench_trace(bench_t* bt) {
+    static const char* names[2] = { "trace_span_x1000_disabled", "trace_span_x1000_enabled" };
+    int total = bt->warmup + bt->iterations;
+    for (int enabled = 0; enabled < 2; enabled++) {
+        // 不启动导出线程，只打开开关，事件写入本线程的环
+        atomic_store(&g_trace_enabled, enabled);
+        for (int i = 0; i < total; i++) {
+            uint64_t t0 = metrics_now_us();
+            for (int k = 0; k < BENCH_TRACE_BATCH; k++) {
+                uint64_t tt = trace_begin();
+                trace_end(TRACE_COPY, (uint64_t)k, tt, 0);
+            }
+            uint64_t t1 = metrics_now_us();
+            if (i >= bt->warmup) {
+                bt->samples[i - bt->warmup] = t1 - t0;
+            }
+        }
+        bench_record(bt, names[enabled], bt->samples, (uint64_t)bt->iterations, 0);
+    }
+    atomic_store(&g_trace_enabled, 0);
+}
+
+/**
+ * @brief 帧内临时分配：每个样本是一帧内 BENCH_ALLOC_BATCH 次不同大小的分配及释放，
+ *        比较 malloc/free、定长对象池和单帧分配区(整帧一次复位)
+ */
+static void bench_alloc(bench_t* bt) {
+    static const char* names[3] = { "alloc_x64_malloc", "alloc_x64_pool", "alloc_x64_arena" };
+    void* ptrs[BENCH_ALLOC_BATCH];
+    size_t sizes[BENCH_ALLOC_BATCH];
+    mem_pool_t pool;
+    mem_arena_t arena;
+    if (mem_pool_init(&pool, BENCH_ALLOC_MAX, BENCH_ALLOC_BATCH, bt->huge_pages) != 0) {
+        return;
+    }
+    if (mem_arena_init(&arena, (size_t)BENCH_ALLOC_BATCH * BENCH_ALLOC_MAX, bt->huge_pages) != 0) {
+        mem_pool_destroy(&pool);
+        return;
+    }
+    for (int k = 0; k < BENCH_ALLOC_BATCH; k++) {
+        sizes[k] = 64 + (size_t)(k * 977) % (BENCH_ALLOC_MAX - 64);
+    }
+    int total = bt->warmup + bt->iterations;
+    for (int kind = 0; kind < 3; kind++) {
+        for (int i = 0; i < total; i++) {
+            uint64_t t0 = metrics_now_us();
+            for (int k = 0; k < BENCH_ALLOC_BATCH; k++) {
+                ptrs[k] = kind == 0 ? malloc(sizes[k]) : kind == 1 ? mem_pool_get(&pool)
+                                                                   : mem_arena_alloc(&arena, sizes[k]);
+                // 写一个字节，免得分配被优化掉
+                *(volatile uint8_t*)ptrs[k] = (uint8_t)k;
+            }
+            if (kind == 0) {
+                for (int k = 0; k < BENCH_ALLOC_BATCH; k++) {
+                    free(ptrs[k]);
+                }
+            } else if (kind == 1) {
+                for (int k = 0; k < BENCH_ALLOC_BATCH; k++) {
+                    mem_pool_put(&pool, ptrs[k]);
+                }
+            } else {
+                mem_arena_reset(&arena);
+            }
+            uint64_t t1 = metrics_now_us();
+            if (i >= bt->warmup) {
+                bt->samples[i - bt->warmup] = t1 - t0;
+            }
+        }
+        bench_record(bt, names[kind], bt->samples, (uint64_t)bt->iterations, 0);
+    }
+    mem_arena_destroy(&arena);
+    mem_pool_destroy(&pool);
+}
+
+/**
+ * @brief 端到端：取帧 -> 拷贝到编码输入 -> 编码 -> 编码包 -> 写线程，与 mipi_text 的单线程流水线一致。
+ *        单帧耗时从取帧到提交写线程为止；吞吐按全部帧写完落盘计
+ */
+static void bench_pipeline(bench_t* bt) {
+    char prefix[256];
+    enc_backend_t b;
+    segment_writer_t w;
+    uint8_t* input = aligned_alloc(RAW_RECORD_ALIGN, bt->buf_size);
+    if (!input || enc_backend_open(&b, bt->backend, bt->width, bt->height, bt->quality) != 0) {
+        free(input);
+        return;
+    }
+    snprintf(prefix, sizeof(prefix), "%s/mipi_bench_pipe_%d", bt->tmp_dir, (int)getpid());
+    // 与 mipi_text 相同：编码包来自定长包池
+    mem_pool_t packets;
+    if (enc_packet_pool_init(&packets, bt->frame_size / 4, SEGMENT_WRITER_DEPTH + 4, bt->huge_pages) != 0 ||
+        segment_writer_start(&w, prefix, "mjpeg", 3600, NULL) != 0) {
+        mem_pool_destroy(&packets);
+        enc_backend_close(&b);
+        free(input);
+        return;
+    }
+    uint64_t bytes = 0;
+    uint64_t heap_allocs = 0;
+    int total = bt->warmup + bt->iterations;
+    uint64_t t_start = 0;
+    for (int i = 0; i < total; i++) {
+        if (i == bt->warmup) {
+            t_start = metrics_now_us();
+            heap_allocs = atomic_load(&g_metrics.counters[METRIC_HEAP_ALLOCS]);
+        }
+        size_t len = 0;
+        uint64_t t0 = metrics_now_us();
+        memcpy(input, bt->frames[i % bt->n_frames], bt->frame_size);
+        const uint8_t* out = enc_backend_encode(&b, input, &len);
+        enc_packet_t* pkt = out ? enc_packet_alloc_pool(&packets, out, len) : NULL;
+        if (!pkt) {
+            break;
+        }
+        pkt->seq = (uint64_t)i;
+        pkt->timestamp_us = t0;
+        pkt->flags = ENC_PACKET_FLAG_KEY;
+        segment_writer_submit_wait(&w, pkt);
+        uint64_t t1 = metrics_now_us();
+        if (i >= bt->warmup) {
+            bt->samples[i - bt->warmup] = t1 - t0;
+            bytes += len;
+        }
+    }
+    heap_allocs = atomic_load(&g_metrics.counters[METRIC_HEAP_ALLOCS]) - heap_allocs;
+    segment_writer_stop(&w);
+    uint64_t wall = metrics_now_us() - t_start;
+    bench_result_t* r = bench_record(bt, "pipeline_e2e", bt->samples, (uint64_t)bt->iterations, 0);
+    // 吞吐按整批计，包含写线程排空与落盘
+    r->throughput = wall > 0 ? bt->iterations * 1e6 / wall : 0;
+    r->bytes_per_frame = (double)bytes / bt->iterations;
+    r->has_allocs = 1;
+    r->heap_allocs_per_frame = (double)heap_allocs / bt->iterations;
+    bench_unlink_segments(prefix, w.index, "mjpeg");
+    mem_pool_destroy(&packets);
+    enc_backend_close(&b);
+    free(input);
+}
+
+// 分块输出的消费者：按帧重组，记录每帧首块、末块到达本地和经模拟链路转发完的时间
+typedef struct {
+    int fd;
+    double link_mbps;
+    uint8_t* buf;                   // 最近一帧重组后的数据
+    uint8_t* chunk;                 // 收一块用
+    size_t capacity;
+    size_t length;                  // 本帧已收到的字节数
+    size_t frame_length;            // 最近收齐的一帧的字节数
+    int broken;                     // 最近一帧的块不连续
+    uint64_t first_us;              // 相对采集时间
+    uint64_t last_us;
+    uint64_t link_us;
+    _Atomic int64_t done_seq;       // 收齐的最后一帧，-1 表示还没有
+} bench_consumer_t;
+
+static void* bench_consumer_thread(void* arg) {
+    bench_consumer_t* c = arg;
+    stream_out_hdr_t hdr;
+    uint64_t link_free = 0;
+    while (stream_out_read(c->fd, &hdr, c->chunk, c->capacity) == 0) {
+        uint64_t now = metrics_now_us();
+        if (hdr.flags & STREAM_OUT_FLAG_FIRST) {
+            // 每帧开始时链路空闲，只看本帧自身的排队；不完整的上一帧直接丢弃
+            c->first_us = now - hdr.timestamp_us;
+            c->length = 0;
+            c->broken = 0;
+            link_free = now;
+        }
+        c->broken |= hdr.offset != c->length || hdr.offset + hdr.length > c->capacity;
+        if (!c->broken) {
+            memcpy(c->buf + hdr.offset, c->chunk, hdr.length);
+        }
+        // 按链路带宽串行转发：本块到达且前面的块发完后才开始发
+        link_free = (link_free > now ? link_free : now) + (uint64_t)(hdr.length * 8.0 / c->link_mbps);
+        c->length += hdr.length;
+        if (hdr.flags & STREAM_OUT_FLAG_LAST) {
+            c->last_us = now - hdr.timestamp_us;
+            c->link_us = link_free - hdr.timestamp_us;
+            c->frame_length = c->length;
+            atomic_store_explicit(&c->done_seq, (int64_t)hdr.seq, memory_order_release);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief 低延迟分块输出：编码器把码流推给本地套接字上的消费者线程，比较整包编完再发和按 MCU 带边编边发。
+ *        首块/末块为消费者收到本帧第一块/最后一块的时间，链路为再经 -L 带宽的转发链路发完的时间，均从取帧算起
+ */
+static void bench_stream(bench_t* bt) {
+    static const char* names[2][3] = {
+        { "stream_whole_first", "stream_whole_last", "stream_whole_link" },
+        { "stream_bands_first", "stream_bands_last", "stream_bands_link" },
+    };
+    char path[256];
+    enc_backend_t b;
+    bench_consumer_t c;
+    pthread_t thread;
+    uint8_t* input = aligned_alloc(RAW_RECORD_ALIGN, bt->buf_size);
+    uint64_t* samples = calloc((size_t)bt->iterations * 3, sizeof(uint64_t));
+    memset(&c, 0, sizeof(c));
+    c.fd = -1;
+    c.link_mbps = bt->link_mbps;
+    c.capacity = bt->frame_size;
+    c.buf = malloc(c.capacity);
+    c.chunk = malloc(c.capacity);
+    atomic_init(&c.done_seq, -1);
+    snprintf(path, sizeof(path), "%s/mipi_bench_stream_%d.sock", bt->tmp_dir, (int)getpid());
+    if (!input || !samples || !c.buf || !c.chunk || enc_backend_open(&b, bt->backend, bt->width, bt->height, bt->quality) != 0) {
+        goto out;
+    }
+    if (stream_out_start(path, STREAM_KIND_JPEG) != 0 || (c.fd = stream_out_connect(path)) < 0 ||
+        pthread_create(&thread, NULL, bench_consumer_thread, &c) != 0) {
+        enc_backend_close(&b);
+        goto out;
+    }
+
+    int total = bt->warmup + bt->iterations;
+    int mismatched = 0;
+    for (int mode = 0; mode < 2; mode++) {
+        uint64_t n = 0;
+        uint64_t bytes = 0;
+        enc_backend_set_stream(&b, mode ? stream_out_chunk : NULL, NULL, STREAM_OUT_BAND_ROWS);
+        for (int i = 0; i < total; i++) {
+            int64_t seq = (int64_t)mode * total + i;
+            size_t len = 0;
+            uint64_t t0 = metrics_now_us();
+            memcpy(input, bt->frames[i % bt->n_frames], bt->frame_size);
+            stream_out_begin((uint64_t)seq, t0);
+            const uint8_t* out = enc_backend_encode(&b, input, &len);
+            if (!out) {
+                break;
+            }
+            if (!mode) {
+                stream_out_chunk(NULL, out, len, 1);
+            }
+            // 发送缓冲装不下的残块在这里补发
+            while (atomic_load_explicit(&c.done_seq, memory_order_acquire) != seq &&
+                   metrics_now_us() - t0 < BENCH_STREAM_TIMEOUT_US) {
+                stream_out_flush();
+                sched_yield();
+            }
+            if (atomic_load_explicit(&c.done_seq, memory_order_acquire) != seq) {
+                printf("   第%d帧没有收齐，丢弃\n", i);
+                continue;
+            }
+            // 按块重组的结果必须与编码器的整包逐字节相同
+            mismatched += c.broken || c.frame_length != len || memcmp(c.buf, out, len) != 0;
+            if (i >= bt->warmup) {
+                samples[n] = c.first_us;
+                samples[bt->iterations + n] = c.last_us;
+                samples[bt->iterations * 2 + n] = c.link_us;
+                bytes += len;
+                n++;
+            }
+        }
+        for (int k = 0; k < 3; k++) {
+            bench_result_t* r = bench_record(bt, names[mode][k], samples + (size_t)bt->iterations * k, n, 0);
+            r->bytes_per_frame = n ? (double)bytes / n : 0;
+        }
+    }
+    if (mismatched) {
+        printf("   分块重组有%d帧与整包不一致\n", mismatched);
+    }
+    stream_out_stop();
+    pthread_join(thread, NULL);
+    enc_backend_close(&b);
+out:
+    if (c.fd >= 0) {
+        close(c.fd);
+    }
+    stream_out_stop();
+    free(c.buf);
+    free(c.chunk);
+    free(samples);
+    free(input);
+}
+
+// 共享内存环的读线程
+typedef struct {
+    const bench_t* bt;
+    shm_ring_reader_t reader;
+    atomic_int stop;            // 写端已发布完
+    uint64_t first_seq;         // 从这个序号开始记录样本(跳过预热)
+    uint64_t read;              // 校验通过的帧
+    uint64_t overwritten;       // 用完后 shm_ring_view_valid 判定被覆盖的帧
+    uint64_t torn;              // view_valid 认为完整、内容却不对的帧，应为0
+    uint64_t* samples;          // 提交到读端校验完的耗时
+    uint64_t n_samples;
+} bench_shm_reader_t;
+
+/**
+ * @brief 校验一个槽位：前 8 字节是写端盖上的帧序号，其余与对应输入帧相同
+ */
+static int bench_shm_check(const bench_t* bt, const shm_ring_view_t* v) {
+    uint64_t stamp;
+    if (v->length != bt->frame_size) {
+        return 0;
+    }
+    memcpy(&stamp, v->data, sizeof(stamp));
+    return stamp == v->seq &&
+           memcmp((const uint8_t*)v->data + sizeof(stamp), bt->frames[v->seq % bt->n_frames] + sizeof(stamp),
+                  bt->frame_size - sizeof(stamp)) == 0;
+}
+
+static void* bench_shm_reader_thread(void* arg) {
+    bench_shm_reader_t* r = arg;
+    shm_ring_view_t v;
+    for (;;) {
+        // 先看停止标志再读：写端停下后读不到新帧才算读完
+        int stop = atomic_load_explicit(&r->stop, memory_order_acquire);
+        if (!shm_ring_read(&r->reader, &v, NULL)) {
+            if (stop) {
+                break;
+            }
+            sched_yield();
+            continue;
+        }
+        int ok = bench_shm_check(r->bt, &v);
+        if (!shm_ring_view_valid(&r->reader, &v)) {
+            r->overwritten++;
+        } else if (!ok) {
+            r->torn++;
+        } else {
+            r->read++;
+            if (v.seq >= r->first_seq) {
+                r->samples[r->n_samples++] = metrics_now_us() - v.timestamp_us;
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief 写端发布一帧：整帧拷进槽位，前 8 字节改成帧序号
+ */
+static int bench_shm_publish(const bench_t* bt, shm_ring_t* ring, uint64_t seq) {
+    uint8_t* dst = shm_ring_reserve(ring);
+    memcpy(dst, bt->frames[seq % bt->n_frames], bt->frame_size);
+    memcpy(dst, &seq, sizeof(seq));
+    return shm_ring_commit(ring, SHM_RING_NV12, (uint32_t)bt->frame_size, (uint32_t)bt->width,
+                           (uint32_t)bt->height, metrics_now_us());
+}
+
+/**
+ * @brief 读端单线程走一遍协议：落后超过一圈、超长帧被拒绝
+ * @return 与预期不一致的项数
+ */
+static int bench_shm_protocol(const bench_t* bt, shm_ring_t* ring) {
+    shm_ring_reader_t reader;
+    shm_ring_view_t v;
+    uint64_t lost = 0;
+    uint64_t next;
+    int errors = 0;
+    int fd = dup(ring->fd);
+    if (fd < 0 || shm_ring_attach(&reader, fd) != 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return 1;
+    }
+    // 写端绕两圈多，读端只能拿到最后一圈，其余都计入 lost
+    uint64_t base = atomic_load(&ring->hdr->head);
+    uint64_t n = BENCH_SHM_SLOTS * 2 + 1;
+    for (uint64_t i = 0; i < n; i++) {
+        bench_shm_publish(bt, ring, base + i);
+    }
+    next = base + n - BENCH_SHM_SLOTS;
+    while (shm_ring_read(&reader, &v, &lost)) {
+        if (v.seq != next || !bench_shm_check(bt, &v) || !shm_ring_view_valid(&reader, &v)) {
+            printf("   共享内存环绕圈后读到帧%llu，应为%llu\n", (unsigned long long)v.seq, (unsigned long long)next);
+            errors++;
+        }
+        next = v.seq + 1;
+    }
+    if (next != base + n || reader.lost != n - BENCH_SHM_SLOTS) {
+        printf("   共享内存环绕圈后读到帧%llu之前，丢失%llu帧，应为%llu\n", (unsigned long long)next,
+               (unsigned long long)reader.lost, (unsigned long long)(n - BENCH_SHM_SLOTS));
+        errors++;
+    }
+    // 超长帧不发布：head 不动，读端看不到，之后的帧照常
+    uint64_t head = atomic_load(&ring->hdr->head);
+    if (shm_ring_publish(ring, SHM_RING_NV12, bt->frames[0], (size_t)ring->hdr->slot_size + 1, 0, 0, 0) == 0) {
+        errors++;
+    }
+    shm_ring_reserve(ring);
+    if (shm_ring_commit(ring, SHM_RING_NV12, ring->hdr->slot_size + 1, 0, 0, 0) == 0) {
+        errors++;
+    }
+    if (atomic_load(&ring->hdr->head) != head || shm_ring_read(&reader, &v, NULL)) {
+        printf("   超过槽位大小的帧被发布了\n");
+        errors++;
+    }
+    bench_shm_publish(bt, ring, head);
+    if (!shm_ring_read(&reader, &v, &lost) || v.seq != head || lost != 0 || !bench_shm_check(bt, &v)) {
+        printf("   拒绝超长帧后的下一帧没有读到\n");
+        errors++;
+    }
+    shm_ring_detach(&reader);
+    return errors;
+}
+
+/**
+ * @brief 共享内存环：写线程每帧整帧拷入 NV12 环并发布(写端从不等待)，读线程同时读取并逐字节校验。
+ *        先单线程检查绕圈丢帧计数和超长帧拒绝，再测发布吞吐和提交到读端校验完的延迟；
+ *        读到、丢失、被覆盖的帧数之和必须等于发布数
+ */
+static void bench_shm(bench_t* bt) {
+    shm_ring_t ring;
+    bench_shm_reader_t r;
+    pthread_t thread;
+    int total = bt->warmup + bt->iterations;
+    uint64_t* samples = calloc((size_t)bt->iterations, sizeof(uint64_t));
+    memset(&r, 0, sizeof(r));
+    r.bt = bt;
+    r.samples = calloc((size_t)total, sizeof(uint64_t));
+    if (!samples || !r.samples || shm_ring_create(&ring, "mipi_bench", BENCH_SHM_SLOTS, (uint32_t)bt->frame_size) != 0) {
+        free(samples);
+        free(r.samples);
+        return;
+    }
+    int errors = bench_shm_protocol(bt, &ring);
+    if (errors) {
+        printf("   共享内存环协议检查有%d项不符\n", errors);
+    }
+
+    int fd = dup(ring.fd);
+    if (fd < 0 || shm_ring_attach(&r.reader, fd) != 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        shm_ring_destroy(&ring);
+        free(samples);
+        free(r.samples);
+        return;
+    }
+    uint64_t base = atomic_load(&ring.hdr->head);
+    r.first_seq = base + (uint64_t)bt->warmup;
+    atomic_init(&r.stop, 0);
+    if (pthread_create(&thread, NULL, bench_shm_reader_thread, &r) != 0) {
+        shm_ring_detach(&r.reader);
+        shm_ring_destroy(&ring);
+        free(samples);
+        free(r.samples);
+        return;
+    }
+    uint64_t n = 0;
+    for (int i = 0; i < total; i++) {
+        uint64_t t0 = metrics_now_us();
+        bench_shm_publish(bt, &ring, base + (uint64_t)i);
+        if (i >= bt->warmup) {
+            samples[n++] = metrics_now_us() - t0;
+        }
+    }
+    atomic_store_explicit(&r.stop, 1, memory_order_release);
+    pthread_join(thread, NULL);
+
+    bench_record(bt, "shm_publish", samples, n, (double)bt->frame_size);
+    bench_record(bt, "shm_read_latency", r.samples, r.n_samples, 0);
+    if (r.read + r.reader.lost + r.overwritten + r.torn != (uint64_t)total || r.torn) {
+        printf("   共享内存环发布%d帧，读到%llu、丢失%llu、被覆盖%llu、内容不符%llu\n", total,
+               (unsigned long long)r.read, (unsigned long long)r.reader.lost,
+               (unsigned long long)r.overwritten, (unsigned long long)r.torn);
+    }
+    shm_ring_detach(&r.reader);
+    shm_ring_destroy(&ring);
+    free(samples);
+    free(r.samples);
+}
+
+/**
+ * @brief 像素域顺时针旋转 90 度：取 y/uv 平面的前 height 行(行跨度 width)，输出 height x width 的连续 NV12
+ */
+static void bench_rotate_nv12(const uint8_t* y, const uint8_t* uv, int width, int height, uint8_t* dst) {
+    uint8_t* duv = dst + (size_t)width * height;
+    for (int oy = 0; oy < width; oy++) {
+        uint8_t* row = dst + (size_t)oy * height;
+        for (int ox = 0; ox < height; ox++) {
+            row[ox] = y[(size_t)(height - 1 - ox) * width + oy];
+        }
+    }
+    for (int oy = 0; oy < width / 2; oy++) {
+        uint8_t* row = duv + (size_t)oy * height;
+        for (int ox = 0; ox < height / 2; ox++) {
+            const uint8_t* p = uv + (size_t)(height / 2 - 1 - ox) * width + oy * 2;
+            row[ox * 2] = p[0];
+            row[ox * 2 + 1] = p[1];
+        }
+    }
+}
+
+/**
+ * @brief 两帧 NV12 的最大和平均绝对差
+ */
+static void bench_diff(const uint8_t* a, const uint8_t* b, size_t n, int* max_diff, double* mean_diff) {
+    uint64_t sum = 0;
+    *max_diff = 0;
+    for (size_t i = 0; i < n; i++) {
+        int d = a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
+        sum += (uint64_t)d;
+        *max_diff = d > *max_diff ? d : *max_diff;
+    }
+    *mean_diff = n ? (double)sum / n : 0;
+}
+
+/**
+ * @brief 压缩域变换：对编码好的 JPEG 做旋转和裁剪，只重排 DCT 系数(jpeg_xform)，
+ *        与完整解码、旋转像素、再编码(xform_rot90_reencode)比较，都从同一张 JPEG 开始计时。
+ *        另把两种结果解码后与原图解码再旋转的像素比较：系数变换只有 IDCT 舍入误差，再编码有二次压缩损失
+ */
+static void bench_xform(bench_t* bt) {
+    enum { CASES = 3 };
+    static const char* names[CASES] = { "xform_rot90", "xform_rot180", "xform_crop" };
+    char specs[CASES][64] = { "rot90", "rot180", "" };
+    uint8_t* jpegs[BENCH_FRAMES] = { NULL };
+    size_t lens[BENCH_FRAMES];
+    int rows = bt->height & ~15;            // 旋转 90 度时裁掉不满一个 MCU 的底边
+    size_t rot_size = (size_t)bt->width * rows * 3 / 2;
+    uint8_t* rot = malloc(rot_size);
+    uint8_t* ref = malloc(rot_size);
+    jpeg_xform_t x;
+    jpeg_xform_t dec;
+    jpeg_xform_cfg_t cfg;
+    enc_backend_t b;
+    int total = bt->warmup + bt->iterations;
+
+    snprintf(specs[2], sizeof(specs[2]), "none:%d,%d,%d,%d", bt->width / 4, bt->height / 4, bt->width / 2,
+             bt->height / 2);
+    jpeg_xform_parse("none", &cfg);
+    jpeg_xform_init(&dec, &cfg);
+    if (!rot || !ref || rows < 16 || enc_backend_open(&b, bt->backend, bt->width, bt->height, bt->quality) != 0) {
+        goto out;
+    }
+    for (int i = 0; i < bt->n_frames; i++) {
+        const uint8_t* out = enc_backend_encode(&b, bt->frames[i], &lens[i]);
+        jpegs[i] = out ? malloc(lens[i]) : NULL;
+        if (!jpegs[i]) {
+            enc_backend_close(&b);
+            goto out;
+        }
+        memcpy(jpegs[i], out, lens[i]);
+    }
+    enc_backend_close(&b);
+
+    // 参照：原图解码后在像素域旋转
+    int w = 0;
+    int h = 0;
+    const uint8_t* nv12 = jpeg_xform_decode(&dec, jpegs[0], lens[0], &w, &h);
+    if (!nv12) {
+        goto out;
+    }
+    bench_rotate_nv12(nv12, nv12 + (size_t)w * h, w, rows, ref);
+
+    for (int c = 0; c < CASES; c++) {
+        uint64_t bytes = 0;
+        jpeg_xform_parse(specs[c], &cfg);
+        jpeg_xform_init(&x, &cfg);
+        for (int i = 0; i < total; i++) {
+            size_t len = 0;
+            uint64_t t0 = metrics_now_us();
+            const uint8_t* out = jpeg_xform_apply(&x, jpegs[i % bt->n_frames], lens[i % bt->n_frames], &len);
+            uint64_t t1 = metrics_now_us();
+            if (!out) {
+                break;
+            }
+            if (i >= bt->warmup) {
+                bt->samples[i - bt->warmup] = t1 - t0;
+                bytes += len;
+            }
+        }
+        bench_result_t* r = bench_record(bt, names[c], bt->samples, (uint64_t)bt->iterations, 0);
+        r->bytes_per_frame = (double)bytes / bt->iterations;
+        if (c == 0) {
+            size_t len = 0;
+            int max_diff;
+            double mean_diff;
+            const uint8_t* out = jpeg_xform_apply(&x, jpegs[0], lens[0], &len);
+            nv12 = out ? jpeg_xform_decode(&dec, out, len, &w, &h) : NULL;
+            if (nv12 && w == rows && h == bt->width) {
+                bench_diff(nv12, ref, rot_size, &max_diff, &mean_diff);
+                fprintf(stderr, "   系数域旋转90度: 与解码后旋转像素相比最大偏差%d，平均%.3f\n", max_diff, mean_diff);
+            }
+        }
+        jpeg_xform_deinit(&x);
+    }
+
+    // 基线：完整解码、旋转像素、按同样质量再编码
+    if (enc_backend_open(&b, bt->backend, rows, bt->width, bt->quality) != 0) {
+        goto out;
+    }
+    uint64_t n = 0;
+    uint64_t bytes = 0;
+    for (int i = 0; i < total; i++) {
+        size_t len = 0;
+        uint64_t t0 = metrics_now_us();
+        nv12 = jpeg_xform_decode(&dec, jpegs[i % bt->n_frames], lens[i % bt->n_frames], &w, &h);
+        if (!nv12) {
+            break;
+        }
+        bench_rotate_nv12(nv12, nv12 + (size_t)w * h, w, rows, rot);
+        const uint8_t* out = enc_backend_encode(&b, rot, &len);
+        uint64_t t1 = metrics_now_us();
+        if (!out) {
+            break;
+        }
+        if (i >= bt->warmup) {
+            bt->samples[n++] = t1 - t0;
+            bytes += len;
+        }
+        if (i == 0 && (nv12 = jpeg_xform_decode(&dec, out, len, &w, &h)) != NULL) {
+            int max_diff;
+            double mean_diff;
+            bench_diff(nv12, ref, rot_size, &max_diff, &mean_diff);
+            fprintf(stderr, "   解码旋转再编码: 与解码后旋转像素相比最大偏差%d，平均%.3f\n", max_diff, mean_diff);
+        }
+    }
+    enc_backend_close(&b);
+    bench_result_t* r = bench_record(bt, "xform_rot90_reencode", bt->samples, n, 0);
+    r->bytes_per_frame = n ? (double)bytes / n : 0;
+out:
+    for (int i = 0; i < bt->n_frames; i++) {
+        free(jpegs[i]);
+    }
+    jpeg_xform_deinit(&dec);
+    free(rot);
+    free(ref);
+}
+
+static void json_result(FILE* fp, const bench_result_t* r, int last) {
+    fprintf(fp, "    {\"name\": \"%s\", \"count\": %llu, \"min_us\": %.1f, \"median_us\": %.1f, "
+            "\"p90_us\": %.1f, \"mean_us\": %.1f, \"throughput\": %.2f, \"unit\": \"%s\"",
+            r->name, (unsigned long long)r->count, r->min_us, r->median_us, r->p90_us, r->mean_us,
+            r->throughput, r->unit ? r->unit : "");
+    if (r->bytes_per_frame > 0) {
+        fprintf(fp, ", \"bytes_per_frame\": %.0f", r->bytes_per_frame);
+    }
+    if (r->has_allocs) {
+        fprintf(fp, ", \"heap_allocs_per_frame\": %.2f", r->heap_allocs_per_frame);
+    }
+    fprintf(fp, "}%s\n", last ? "" : ",");
+}
+
+/**
+ * @brief 输出 JSON：版本与构建信息、主机、配置和各项结果
+ */
+static void bench_json(const bench_t* bt, FILE* fp) {
+    struct utsname un;
+    char cpu_model[128] = "unknown";
+    FILE* ci = fopen("/proc/cpuinfo", "r");
+    if (ci) {
+        char line[256];
+        while (fgets(line, sizeof(line), ci)) {
+            char* colon = strchr(line, ':');
+            if (colon && (strncmp(line, "model name", 10) == 0 || strncmp(line, "Hardware", 8) == 0)) {
+                snprintf(cpu_model, sizeof(cpu_model), "%s", colon + 2);
+                cpu_model[strcspn(cpu_model, "\n\"\\")] = '\0';
+                break;
+            }
+        }
+        fclose(ci);
+    }
+    if (uname(&un) != 0) {
+        strcpy(un.machine, "unknown");
+    }
+    fprintf(fp, "{\n");
+    fprintf(fp, "  \"schema\": 1,\n");
+    fprintf(fp, "  \"version\": \"%s\",\n", MIPI_BENCH_VERSION);
+    fprintf(fp, "  \"build\": {\"type\": \"%s\", \"mpp\": %d, \"compiler\": \"%s\", \"frame_stats\": \"%s\"},\n",
+            MIPI_BENCH_BUILD_TYPE, MIPI_WITH_MPP, __VERSION__, frame_stats_impl());
+    fprintf(fp, "  \"host\": {\"machine\": \"%s\", \"cpu\": \"%s\", \"cpus\": %ld},\n",
+            un.machine, cpu_model, sysconf(_SC_NPROCESSORS_ONLN));
+    fprintf(fp, "  \"config\": {\"width\": %d, \"height\": %d, \"quality\": %d, \"iterations\": %d, "
+            "\"warmup\": %d, \"backend\": \"%s\", \"input\": \"%s\", \"huge_pages\": %d},\n",
+            bt->width, bt->height, bt->quality, bt->iterations, bt->warmup, bt->backend,
+            bt->input ? bt->input : "synthetic", bt->huge_pages);
+    fprintf(fp, "  \"results\": [\n");
+    for (int i = 0; i < bt->n_results; i++) {
+        json_result(fp, &bt->results[i], i == bt->n_results - 1);
+    }
+    fprintf(fp, "  ]\n}\n");
+}
+
+/**
+ * @brief 与之前保存的 JSON 比较各项中位数
+ * @param threshold 允许变慢的百分比
+ * @return 没有退化返回0，有退化返回1，基线无法读取返回-1
+ */
+static int bench_compare(const bench_t* bt, const char* path, double threshold) {
+    FILE* fp = fopen(path, "r");
+    if (!fp) {
+        printf("无法读取基线: %s (%s)\n", path, strerror(errno));
+        return -1;
+    }
+    static char text[65536];
+    size_t n = fread(text, 1, sizeof(text) - 1, fp);
+    fclose(fp);
+    text[n] = '\0';
+
+    int regressed = 0;
+    printf("   %-22s %12s %12s %8s\n", "项目", "基线us", "本次us", "变化");
+    for (int i = 0; i < bt->n_results; i++) {
+        const bench_result_t* r = &bt->results[i];
+        char key[64];
+        snprintf(key, sizeof(key), "\"name\": \"%s\"", r->name);
+        const char* p = strstr(text, key);
+        const char* m = p ? strstr(p, "\"median_us\":") : NULL;
+        if (!m) {
+            printf("   %-22s %12s %12.1f\n", r->name, "-", r->median_us);
+            continue;
+        }
+        double base = strtod(m + strlen("\"median_us\":"), NULL);
+        double change = base > 0 ? (r->median_us - base) * 100.0 / base : 0;
+        int bad = change > threshold;
+        regressed |= bad;
+        printf("   %-22s %12.1f %12.1f %+7.1f%%%s\n", r->name, base, r->median_us, change, bad ? " 退化" : "");
+    }
+    return regressed;
+}
+
+static void usage(const char* prog) {
+    printf("用法: %s [选项]\n", prog);
+    printf("  -w <宽> -h <高>  合成帧尺寸(默认1920x1080)\n");
+    printf("  -q <质量>        JPEG质量(默认80)\n");
+    printf("  -n <次数>        每项计时次数(默认50)，写盘测试写 4 倍帧数\n");
+    printf("  -W <次数>        每项预热次数(默认5)\n");
+    printf("  -b <后端>        编码后端: %s(默认sw)\n", enc_backend_names());
+    printf("  -i <xxx.idx>     用原始录制的前%d帧代替合成帧\n", BENCH_FRAMES);
+    printf("  -t <目录>        写盘测试目录(默认/tmp)，测完删除\n");
+    printf("  -s <项目,...>    只运行指定项目: copy,convert,jpeg,writer,pipeline,trace,alloc,stream,shm,xform\n");
+    printf("  -G               分配区、包池和软件缓冲使用 2MB 大页\n");
+    printf("  -L <Mbps>        分块输出测试模拟的转发链路带宽(默认%d)\n", BENCH_STREAM_LINK_MBPS);
+    printf("  -o <文件>        JSON写入文件(默认stdout)\n");
+    printf("  -c <基线.json>   与基线比较中位数，变慢超过阈值时返回1\n");
+    printf("  -T <百分比>      比较阈值(默认10)\n");
+}
+
+static int suite_enabled(const char* list, const char* name) {
+    if (!list) {
+        return 1;
+    }
+    size_t len = strlen(name);
+    for (const char* p = list; (p = strstr(p, name)) != NULL; p += len) {
+        if ((p == list || p[-1] == ',') && (p[len] == ',' || p[len] == '\0')) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief 主函数
+ */
+int main(int argc, char* argv[]) {
+    static bench_t bt;
+    const char* suites = NULL;
+    const char* out_path = NULL;
+    const char* baseline = NULL;
+    double threshold = 10.0;
+
+    bt.width = 1920;
+    bt.height = 1080;
+    bt.quality = 80;
+    bt.iterations = 50;
+    bt.warmup = 5;
+    bt.backend = "sw";
+    bt.tmp_dir = "/tmp";
+    bt.link_mbps = BENCH_STREAM_LINK_MBPS;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "w:h:q:n:W:b:i:t:s:o:c:T:GL:H")) != -1) {
+        switch (opt) {
+            case 'w': bt.width = atoi(optarg); break;
+            case 'h': bt.height = atoi(optarg); break;
+            case 'q': bt.quality = atoi(optarg); break;
+            case 'n': bt.iterations = atoi(optarg); break;
+            case 'W': bt.warmup = atoi(optarg); break;
+            case 'b': bt.backend = optarg; break;
+            case 'i': bt.input = optarg; break;
+            case 't': bt.tmp_dir = optarg; break;
+            case 's': suites = optarg; break;
+            case 'o': out_path = optarg; break;
+            case 'c': baseline = optarg; break;
+            case 'T': threshold = atof(optarg); break;
+            case 'G': bt.huge_pages = 1; break;
+            case 'L': bt.link_mbps = atof(optarg); break;
+            default:
+                usage(argv[0]);
+                return opt == 'H' ? 0 : -1;
+        }
+    }
+    if (bt.width < 16 || bt.height < 16 || (bt.width & 1) || (bt.height & 1) || bt.iterations < 1 ||
+        bt.warmup < 0 || bt.link_mbps <= 0) {
+        printf("参数无效\n");
+        return -1;
+    }
+
+    // stdout 只留给 JSON，库函数的打印改到 stderr
+    fflush(stdout);
+    int json_fd = dup(STDOUT_FILENO);
+    FILE* json = json_fd >= 0 ? fdopen(json_fd, "w") : NULL;
+    if (!json || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+        perror("无法重定向标准输出");
+        return -1;
+    }
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    mem_set_huge(bt.huge_pages);
+
+    if (bench_load_frames(&bt) != 0) {
+        return -1;
+    }
+    bt.samples = calloc((size_t)bt.iterations, sizeof(uint64_t));
+    if (!bt.samples) {
+        return -1;
+    }
+    fprintf(stderr, "   基准测试: %dx%d, q=%d, %d次(预热%d), 输入%s\n", bt.width, bt.height, bt.quality,
+            bt.iterations, bt.warmup, bt.input ? bt.input : "合成帧");
+
+    size_t packet_size = 0;
+    if (suite_enabled(suites, "copy")) {
+        bench_copy(&bt);
+    }
+    if (suite_enabled(suites, "convert")) {
+        bench_convert(&bt);
+    }
+    if (suite_enabled(suites, "jpeg")) {
+        packet_size = bench_jpeg(&bt);
+    }
+    if (suite_enabled(suites, "writer")) {
+        bench_writer(&bt, packet_size);
+    }
+    if (suite_enabled(suites, "pipeline")) {
+        bench_pipeline(&bt);
+    }
+    if (suite_enabled(suites, "trace")) {
+        bench_trace(&bt);
+    }
+    if (suite_enabled(suites, "alloc")) {
+        bench_alloc(&bt);
+    }
+    if (suite_enabled(suites, "stream")) {
+        bench_stream(&bt);
+    }
+    if (suite_enabled(suites, "shm")) {
+        bench_shm(&bt);
+    }
+    if (suite_enabled(suites, "xform")) {
+        bench_xform(&bt);
+    }
+
+    if (out_path) {
+        FILE* fp = fopen(out_path, "w");
+        if (!fp) {
+            printf("无法写入结果: %s (%s)\n", out_path, strerror(errno));
+            return -1;
+        }
+        bench_json(&bt, fp);
+        fclose(fp);
+    } else {
+        bench_json(&bt, json);
+    }
+    fflush(json);
+
+    int ret = 0;
+    if (baseline) {
+        ret = bench_compare(&bt, baseline, threshold);
+    }
+    for (int i = 0; i < bt.n_frames; i++) {
+        free(bt.frames[i]);
+    }
+    free(bt.samples);
+    return ret < 0 ? -1 : ret;
+}
@@ -1,236 +1,993 @@
+#define _GNU_SOURCE
+#include <getopt.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 #include "camera_init.h"
+#include "metrics.h"
+#include "shm_ring.h"
+#include "http_preview.h"
+#include "packet_pool.h"
+#include "frame_writer.h"
+#include "mpp_encoder.h"
+#include "mpp_heap.h"
+#include "rt_sched.h"
+#include "startup.h"
+#include "raw_record.h"
+#include "video_encoder.h"
+#include "segment_writer.h"
+#include "frame_rate.h"
+#include "trace.h"
+#include "stall_watchdog.h"
+#include "control.h"
+#include "frame_stats.h"
+#include "mem_arena.h"
+#include "stream_out.h"
+#include "jpeg_xform.h"
 
+// 采集编码流水线
+typedef struct {
+    camera_t cam;
+    int cam_ready;
+    mpp_encoder_t enc;
+    packet_pool_t* pool;
+    shm_ring_t rings[2];    // [0] NV12帧, [1] JPEG包
+    int rings_enabled;
+    int preview_enabled;
+    // 配置
+    const char* camera_device;
+    int width;
+    int height;
+    uint32_t pixelformat;
+    unsigned int cam_buffers;
+    mpp_heap_t heap;
+    size_t pool_base_size;
+    int import_mode;
+    int encoder_ret;        // 并行初始化线程的结果
+    // 录像：每帧编码 H.264/H.265，JPEG 只作为间隔抓拍
+    int video_enabled;
+    video_cfg_t video_cfg;
+    video_encoder_t video;
+    segment_writer_t seg;
+    int snapshot_interval;  // 每多少帧出一张 JPEG
+    const roi_rect_t* crop; // 只编码该区域，NULL 为整帧；指向 crop_rect
+    roi_rect_t crop_rect;
+    frame_rate_t rate;      // 输出帧率控制
+    uint64_t busy_us;       // 上一帧从 DQBUF 返回到处理完成的耗时
+    stall_watchdog_t watchdog;  // 采集停顿时原地重启采集流
+    frame_stats_t stats;    // 当前帧的图像统计，随编码包一起发布
+    int stats_import;       // 零拷贝模式下单独读一遍 Y 平面做统计
+    int huge_pages;         // 包池和软件缓冲尝试使用大页
+    mem_pool_t video_packets;   // 录像包，流水线线程取、分段写线程还
+    int stream_enabled;     // 低延迟码流输出：录像时逐片推录像码流，否则整包推 JPEG
+    int xform_enabled;      // JPEG 输出前在压缩域旋转/翻转/裁剪
+    jpeg_xform_t xform;
+} pipeline_t;
+
+static void usage(const char* prog) {
+    printf("用法: %s [选项]\n", prog);
+    printf("  -n <帧数>        连续采集编码的帧数(默认1)\n");
+    printf("  -o <文件>        JPEG输出文件(默认capture.jpg，每帧覆盖)\n");
+    printf("  -M <文件>        周期性写入Prometheus指标文本(建议位于tmpfs)\n");
+    printf("  -S <套接字>      在UNIX套接字上提供Prometheus指标\n");
+    printf("  -I <毫秒>        指标刷新周期(默认1000)\n");
+    printf("  -R <套接字>      将NV12帧和JPEG发布到共享内存环，fd经此套接字分发\n");
+    printf("  -P <端口>        在127.0.0.1上启动MJPEG预览服务\n");
+    printf("  -K <KB>          包缓冲池最小级别大小(默认整帧的1/8)\n");
+    printf("  -b <数量>        V4L2采集缓冲区数量(默认%d，最多%d)\n", CAMERA_DEFAULT_BUFFERS, CAMERA_MAX_BUFFERS);
+    printf("  -H <类型>        编码输入缓冲类型 ion|drm|dma_heap|normal[:cached|:uncached](默认ion)\n");
+    printf("  -B <次数>        不打开摄像头，测试各缓冲类型的写带宽和编码耗时后退出\n");
+    printf("  -D               零拷贝：摄像头直接写入MPP缓冲(DMABUF导入，不支持时USERPTR)\n");
+    printf("  -G               录像包池和软件缓冲使用 2MB 大页(MAP_HUGETLB，失败退回透明大页)\n");
+    printf("  -A               零拷贝模式下也统计亮度直方图和清晰度(多读一遍Y平面)；拷贝模式总是在拷贝时统计\n");
+    printf("  -C <cpu[:优先级]> 采集编码线程绑核，给出优先级时使用SCHED_FIFO\n");
+    printf("  -W <cpu[:优先级]> 写文件线程绑核与优先级\n");
+    printf("  -L               启动时mlockall并预取所有帧缓冲，避免运行中缺页\n");
+    printf("  -F               快速启动：MPP初始化与摄像头初始化并行，关闭过程日志\n");
+    printf("  -q               关闭摄像头初始化和每帧的过程日志\n");
+    printf("  -d <套接字>      常驻模式：保持摄像头和编码器就绪，每个连接发送\"capture\"返回一张JPEG\n");
+    printf("  -r <前缀>        原始录制：不编码，NV12帧写入<前缀>.nv12，索引写入<前缀>.idx\n");
+    printf("  -V <参数>        连续录像 h264|h265[:cbr|vbr|avbr|fixqp[:码率kbps[:GOP[:帧率]]]]\n");
+    printf("  -s <前缀>        录像分段文件前缀(默认video)，输出 <前缀>_00000.h264 ...\n");
+    printf("  -g <秒>          录像每段时长(默认60)，在到时后的第一个关键帧处切分\n");
+    printf("  -c <x,y,宽,高>   只编码该区域：MPP 按偏移读取整帧缓冲，不拷贝；NV12 共享内存环仍发布整帧\n");
+    printf("  -f <帧率>[:auto[:最低]] 输出帧率：驱动支持时用 S_PARM 降低传感器帧率，否则 DQBUF 后抽帧；\n");
+    printf("                   auto 在编码或写盘积压时自动降低帧率\n");
+    printf("  -J <帧>          录像时每隔多少帧输出一张JPEG抓拍(默认等于帧率，即每秒一张)\n");
+    printf("  -X <套接字>      控制套接字，运行中修改参数: quality <1-99> | crop <x,y,宽,高>|off | size <宽>x<高> | status\n");
+    printf("  -Y <套接字>      低延迟码流输出：编码数据分块推给套接字上的消费者，不等整包写完；\n");
+    printf("                   录像时按%d行宏块分片逐片输出录像码流，否则输出每帧JPEG\n", STREAM_OUT_BAND_ROWS);
+    printf("  -t <变换>[:x,y,宽,高] JPEG输出前在压缩域变换 rot90|rot180|rot270|hflip|vflip|none，\n");
+    printf("                   可同时按 MCU 裁剪(编码输出的坐标)；只重排 DCT 系数，不重新编码\n");
+    printf("  -T <文件>        记录每帧各阶段事件，收到SIGUSR1和退出时导出Chrome trace JSON\n");
+    printf("  -w <毫秒>[:次数] 采集停顿超过该时长(默认%d，至少%d个帧间隔)时原地重启采集流，\n",
+           STALL_WATCHDOG_DEFAULT_MS, STALL_WATCHDOG_INTERVALS);
+    printf("                   连续失败次数上限默认%d；0 关闭，超时后退出\n", STALL_WATCHDOG_DEFAULT_ATTEMPTS);
+}
 
 /**
- * @brief 主函数
+ * @brief 初始化编码器和输出包缓冲池，可在独立线程中与摄像头初始化并行
  */
-int main() {
-    camera_t cam;
-    void* yuv_data;
-    MppCtx ctx;
-    MppApi *mpi;
-    MppBufferGroup group;
-    MppEncCfg cfg;
-    MPP_RET ret;
-
-    const char* camera_device = "/dev/video11";
-    const char* output_file = "capture.jpg";
-    int width = 1920;
-    int height = 1080;
-    uint32_t pixelformat = V4L2_PIX_FMT_NV12;  // NV12格式
-    
-    printf("=== RK3562摄像头YUV数据采集与MPP Buffer处理示例 ===\n");
-    
-    // 1. 初始化摄像头
-    if (camera_init(&cam, camera_device, width, height, pixelformat) != 0) {
+static int pipeline_init_encoder(pipeline_t* pl) {
+    uint64_t t0 = metrics_now_us();
+    if (mpp_encoder_init(&pl->enc, pl->width, pl->height, JPEG_QUALITY, &pl->heap) != 0) {
+        printf("   MPP编码器初始化失败\n");
+        return -1;
+    }
+    if (pl->crop) {
+        if (mpp_encoder_set_crop(&pl->enc, pl->crop) != 0) {
+            return -1;
+        }
+        printf("   编码区域: %dx%d+%d+%d, 占整帧像素%.1f%%\n", pl->enc.width, pl->enc.height,
+               pl->enc.crop_x, pl->enc.crop_y, 100.0 * pl->enc.width * pl->enc.height / (pl->width * pl->height));
+    }
+    uint64_t t1 = metrics_now_us();
+    startup_phase("mpp_encoder_init", t0, t1);
+
+    pl->pool = malloc(sizeof(*pl->pool));
+    if (!pl->pool || packet_pool_init(pl->pool, MPP_BUFFER_TYPE_ION, pl->pool_base_size, buffer_size) != 0) {
+        printf("   包缓冲池初始化失败\n");
+        free(pl->pool);
+        pl->pool = NULL;
+        return -1;
+    }
+    uint64_t t2 = metrics_now_us();
+    startup_phase("packet_pool_init", t1, t2);
+
+    if (pl->video_enabled) {
+        if (video_encoder_init(&pl->video, pl->width, pl->height, &pl->video_cfg) != 0 ||
+            (pl->crop && video_encoder_set_crop(&pl->video, pl->crop) != 0)) {
+            return -1;
+        }
+        if (pl->video_cfg.slice_rows > 0) {
+            // 每片编完就推给低延迟输出的消费者
+            video_encoder_set_stream(&pl->video, stream_out_chunk, NULL);
+        }
+        // 每个在写队列里的包一个对象，另留几个给正在编码和正在写的包
+        if (enc_packet_pool_init(&pl->video_packets, video_cfg_packet_slot(&pl->video_cfg),
+                                 SEGMENT_WRITER_DEPTH + 4, pl->huge_pages) != 0) {
+            return -1;
+        }
+        startup_phase("video_encoder_init", t2, metrics_now_us());
+    }
+    return 0;
+}
+
+/**
+ * @brief 当前分辨率下一帧 NV12 的字节数
+ */
+static size_t pipeline_frame_bytes(const pipeline_t* pl) {
+    return (size_t)pl->width * pl->height * 3 / 2;
+}
+
+/**
+ * @brief 修改编码区域，JPEG 与录像同时生效
+ * @param roi 区域，NULL 恢复整帧
+ */
+static int pipeline_set_crop(pipeline_t* pl, const roi_rect_t* roi) {
+    if (mpp_encoder_set_crop(&pl->enc, roi) != 0) {
+        return -1;
+    }
+    if (pl->video_enabled && video_encoder_set_crop(&pl->video, roi) != 0) {
+        return -1;
+    }
+    if (roi) {
+        pl->crop_rect = *roi;
+        pl->crop = &pl->crop_rect;
+    } else {
+        pl->crop = NULL;
+    }
+    return 0;
+}
+
+/**
+ * @brief 运行中切换分辨率：摄像头重新设置格式，编码器沿用已分配的输入缓冲和包缓冲池，
+ *        共享内存环的槽位按启动时的整帧分配，所以新的帧不能比启动时大。
+ *        拷贝、统计和编码器都按行跨度等于宽度处理，驱动给出带填充的行跨度时拒绝。失败时恢复原分辨率
+ */
+static int pipeline_set_size(pipeline_t* pl, int width, int height) {
+    if ((size_t)width * height * 3 / 2 > YUV_SIZE) {
+        printf("   %dx%d 超过启动时的帧大小，需要重新启动\n", width, height);
+        return -1;
+    }
+    if (camera_set_format(&pl->cam, width, height) != 0) {
+        return -1;
+    }
+    // 驱动可能把尺寸调整到 ISP 支持的值
+    int w = (int)pl->cam.fmt.fmt.pix_mp.width;
+    int h = (int)pl->cam.fmt.fmt.pix_mp.height;
+    int stride = (int)pl->cam.fmt.fmt.pix_mp.plane_fmt[0].bytesperline;
+    if (stride != w) {
+        printf("   %dx%d 的行跨度为%d字节，不等于宽度，请换用 16/64 对齐的宽度\n", w, h, stride);
+    }
+    if (stride != w || (size_t)w * h * 3 / 2 > YUV_SIZE || mpp_encoder_set_size(&pl->enc, w, h) != 0 ||
+        (pl->video_enabled && video_encoder_set_size(&pl->video, w, h) != 0)) {
+        camera_set_format(&pl->cam, pl->width, pl->height);
+        mpp_encoder_set_size(&pl->enc, pl->width, pl->height);
+        if (pl->video_enabled) {
+            video_encoder_set_size(&pl->video, pl->width, pl->height);
+        }
+        pipeline_set_crop(pl, pl->crop);
+        return -1;
+    }
+    pl->width = w;
+    pl->height = h;
+    pl->crop = NULL;
+    return 0;
+}
+
+/**
+ * @brief 执行控制命令，在两帧之间由流水线线程调用
+ */
+static void pipeline_control(void* arg, const control_cmd_t* cmd, char* reply, size_t cap) {
+    pipeline_t* pl = arg;
+    uint64_t t0 = metrics_now_us();
+    int ret = 0;
+    switch (cmd->op) {
+        case CONTROL_QUALITY: ret = mpp_encoder_set_quality(&pl->enc, cmd->quality); break;
+        case CONTROL_CROP: ret = pipeline_set_crop(pl, cmd->has_crop ? &cmd->crop : NULL); break;
+        case CONTROL_SIZE: ret = pipeline_set_size(pl, cmd->width, cmd->height); break;
+        case CONTROL_STATUS: break;
+    }
+    uint64_t us = metrics_now_us() - t0;
+    int n = snprintf(reply, cap, "%s quality=%d size=%dx%d encode=%dx%d+%d+%d", ret == 0 ? "ok" : "error",
+                     pl->enc.quality, pl->width, pl->height, pl->enc.width, pl->enc.height,
+                     pl->enc.crop_x, pl->enc.crop_y);
+    if (cmd->op != CONTROL_STATUS && n > 0 && (size_t)n < cap) {
+        snprintf(reply + n, cap - (size_t)n, " apply_ms=%.1f", us / 1000.0);
+    }
+}
+
+/**
+ * @brief 取一帧需要保留的图像：按帧率控制抽掉的帧在拷贝和编码前直接归还驱动
+ * @return 成功返回图像数据，失败返回NULL
+ */
+static void* pipeline_capture(pipeline_t* pl, int timeout_ms) {
+    camera_t* cam = &pl->cam;
+    for (;;) {
+        int wait_ms = stall_watchdog_timeout_ms(&pl->watchdog, pl->rate.period_us, timeout_ms);
+        void* yuv_data = capture_yuv_frame(cam, wait_ms);
+        if (!yuv_data) {
+            // 停顿时原地重启采集流，MPP 会话和各缓冲池保持不动；重启失败的也计入次数，下一轮再试
+            if (stall_watchdog_stalled(&pl->watchdog, metrics_now_us())) {
+                camera_restart(cam);
+                continue;
+            }
+            return NULL;
+        }
+        stall_watchdog_frame(&pl->watchdog, metrics_now_us(), pl->rate.period_us);
+        uint64_t ts = (uint64_t)cam->buf.timestamp.tv_sec * 1000000 + (uint64_t)cam->buf.timestamp.tv_usec;
+        if (frame_rate_keep(&pl->rate, ts)) {
+            return yuv_data;
+        }
+        requeue_buffer(cam);
+    }
+}
+
+/**
+ * @brief 队列占用率，用作帧率自适应的负载
+ */
+static float queue_fill(uint32_t head, uint32_t tail, uint32_t depth) {
+    return depth ? (float)(head - tail) / depth : 0;
+}
+
+/**
+ * @brief 原始录制：采集缓冲直接交给录制线程写盘，写完后才归还驱动，全程无拷贝无编码
+ * @param pl 流水线
+ * @param base 输出文件前缀
+ * @param frame_count 录制帧数(同时决定预分配大小)
+ * @return 成功返回0，失败返回-1
+ */
+static int pipeline_record(pipeline_t* pl, const char* base, int frame_count) {
+    camera_t* cam = &pl->cam;
+    raw_record_t rec;
+    unsigned int index;
+    // 至少留两个缓冲在驱动手里，否则写盘慢时驱动无处可写
+    unsigned int inflight = cam->n_buffers > 2 ? cam->n_buffers - 2 : 1;
+
+    if (raw_record_open(&rec, base, pl->width, pl->height, pl->pixelformat, YUV_SIZE,
+                        cam->buf_lengths[0], (uint64_t)frame_count, inflight) != 0) {
+        return -1;
+    }
+    for (int n = 0; n < frame_count; n++) {
+        trace_set_frame((uint64_t)n);
+        while (raw_record_reap(&rec, &index)) {
+            camera_requeue_index(cam, index);
+        }
+        metrics_rusage_mark_t mark;
+        metrics_rusage_mark(&mark);
+        uint64_t t0 = metrics_now_us();
+        void* yuv_data = pipeline_capture(pl, 5000);
+        if (!yuv_data) {
+            perror("YUV数据捕获失败!\n\n");
+            break;
+        }
+        metrics_observe_us(METRIC_STAGE_CAPTURE, metrics_now_us() - t0);
+        metrics_rusage_stage(METRIC_STAGE_CAPTURE, &mark);
+        uint64_t ts = (uint64_t)cam->buf.timestamp.tv_sec * 1000000 + (uint64_t)cam->buf.timestamp.tv_usec;
+        if (raw_record_submit(&rec, cam->buf.index, yuv_data, cam->buf.sequence, ts) != 0) {
+            requeue_buffer(cam);
+        }
+        frame_rate_load(&pl->rate, metrics_now_us(),
+                        queue_fill(atomic_load(&rec.head), atomic_load(&rec.done_tail), rec.max_inflight));
+    }
+    raw_record_close(&rec);
+    while (raw_record_reap(&rec, &index)) {
+        camera_requeue_index(cam, index);
+    }
+    return 0;
+}
+
+static void* encoder_init_thread(void* arg) {
+    pipeline_t* pl = arg;
+    pl->encoder_ret = pipeline_init_encoder(pl);
+    return NULL;
+}
+
+/**
+ * @brief 初始化摄像头并开始采集；导入模式下需要编码器已初始化
+ */
+static int pipeline_init_camera(pipeline_t* pl) {
+    uint64_t t0 = metrics_now_us();
+    if (pl->import_mode) {
+        camera_import_buf_t import_bufs[CAMERA_MAX_BUFFERS];
+        if (pl->cam_buffers < 2 || pl->cam_buffers > CAMERA_MAX_BUFFERS) {
+            pl->cam_buffers = CAMERA_DEFAULT_BUFFERS;
+        }
+        if (mpp_encoder_alloc_import(&pl->enc, pl->cam_buffers, pl->enc.frame_size, import_bufs) != 0 ||
+            camera_init_import(&pl->cam, pl->camera_device, pl->width, pl->height, pl->pixelformat,
+                               import_bufs, pl->cam_buffers) != 0) {
+            perror("摄像头初始化失败!\n\n");
+            return -1;
+        }
+    } else if (camera_init(&pl->cam, pl->camera_device, pl->width, pl->height, pl->pixelformat,
+                           pl->cam_buffers) != 0) {
         perror("摄像头初始化失败!\n\n");
         return -1;
     }
-    
-    // 2. 开始采集
-    if (camera_start_capture(&cam) != 0) {
+    pl->cam_ready = 1;
+    if (pl->rate.target_fps > 0) {
+        // 自适应模式下传感器按上限运行，降速部分由抽帧完成(流启动后通常不能再改帧间隔)
+        frame_rate_start(&pl->rate, camera_set_fps(&pl->cam, pl->rate.target_fps));
+    }
+    uint64_t t1 = metrics_now_us();
+    startup_phase("camera_init", t0, t1);
+
+    if (camera_start_capture(&pl->cam) != 0) {
         perror("摄像头采集启动失败!\n\n");
-        close(cam.fd);
         return -1;
     }
-    
-    // 3. 捕获一帧YUV数据
-    yuv_data = capture_yuv_frame(&cam, 5000);  // 5秒超时
+    startup_phase("camera_start_capture", t1, metrics_now_us());
+    return 0;
+}
+
+/**
+ * @brief 把本帧的图像统计写入指标
+ */
+static void pipeline_publish_stats(const frame_stats_t* st) {
+    if (!st->valid) {
+        return;
+    }
+    metrics_gauge_set(METRIC_FRAME_LUMA_MEAN, (int64_t)(st->luma_mean + 0.5f));
+    metrics_gauge_set(METRIC_FRAME_LUMA_CLIPPED,
+                      (int64_t)(frame_stats_fraction_above(st, 256 - 256 / FRAME_STATS_BINS) * 1000.0f + 0.5f));
+    metrics_gauge_set(METRIC_FRAME_SHARPNESS, (int64_t)(st->sharpness * 100.0f + 0.5f));
+}
+
+/**
+ * @brief 把当前输入缓冲编码进录像，交给分段写线程
+ */
+static void pipeline_video(pipeline_t* pl, uint64_t seq, uint64_t timestamp_us) {
+    metrics_rusage_mark_t mark;
+    video_packet_t vp;
+    metrics_rusage_mark(&mark);
+    uint64_t t0 = metrics_now_us();
+    if (segment_writer_want_key(&pl->seg)) {
+        // 写线程丢过包，尽快出 IDR 缩短断档
+        video_encoder_request_idr(&pl->video);
+    }
+    uint64_t tt = trace_begin();
+    int ret = video_encoder_encode_buffer(&pl->video, pl->enc.input, timestamp_us, &vp);
+    trace_end(TRACE_VIDEO_ENCODE, seq, tt, ret == 0 ? (uint32_t)vp.length : 0);
+    metrics_observe_us(METRIC_STAGE_VIDEO_ENCODE, metrics_now_us() - t0);
+    metrics_rusage_stage(METRIC_STAGE_VIDEO_ENCODE, &mark);
+    if (ret != 0) {
+        metrics_drop(METRIC_DROP_ENCODE_ERROR);
+        return;
+    }
+    enc_packet_t* pkt = enc_packet_alloc_pool(&pl->video_packets, vp.data, vp.length);
+    if (!pkt) {
+        metrics_drop(METRIC_DROP_WRITER_FULL);
+        return;
+    }
+    pkt->seq = seq;
+    pkt->timestamp_us = timestamp_us;
+    pkt->flags = vp.keyframe ? ENC_PACKET_FLAG_KEY : 0;
+    pkt->stats = pl->stats;
+    segment_writer_submit(&pl->seg, pkt);
+}
+
+/**
+ * @brief 在压缩域旋转/裁剪编码包，结果写回同一个包缓冲
+ * @return 成功返回0，变换失败或结果放不下时保留原图并返回-1
+ */
+static int pipeline_xform(pipeline_t* pl, enc_packet_t* pkt) {
+    uint64_t t0 = metrics_now_us();
+    size_t len = 0;
+    const uint8_t* out = jpeg_xform_apply(&pl->xform, pkt->data, pkt->length, &len);
+    if (!out) {
+        return -1;
+    }
+    if (len > packet_pool_capacity(pkt)) {
+        printf("   变换后的JPEG(%zu字节)超出包缓冲，输出原图\n", len);
+        return -1;
+    }
+    memcpy(pkt->data, out, len);
+    pkt->length = len;
+    metrics_observe_us(METRIC_STAGE_XFORM, metrics_now_us() - t0);
+    return 0;
+}
+
+/**
+ * @brief 采集并编码一帧，发布到共享内存环和预览
+ * @param pl 流水线
+ * @param seq 帧序号
+ * @param eos 是否最后一帧
+ * @param out 输出：编码包(调用者持有一个引用)，编码失败时为NULL
+ * @return 成功返回0，采集失败返回-1
+ */
+static int pipeline_frame(pipeline_t* pl, uint64_t seq, int eos, enc_packet_t** out) {
+    camera_t* cam = &pl->cam;
+    metrics_rusage_mark_t mark;
+    *out = NULL;
+
+    trace_set_frame(seq);
+    metrics_rusage_mark(&mark);
+    uint64_t t0 = metrics_now_us();
+    void* yuv_data = pipeline_capture(pl, 5000);  // 5秒超时
     if (!yuv_data) {
         perror("YUV数据捕获失败!\n\n");
-        close(cam.fd);
-        return -1;
-    }
-    // 初始化MPP JPEG编码器
-    ret = mpp_create(&ctx, &mpi);
-    if (ret != MPP_OK) {
-        printf("   MPP创建失败: %d\n", ret);
-    }else{
-        printf("   MPP创建成功!   \n");
-    }
-    
-    ret = mpp_init(ctx, MPP_CTX_ENC, MPP_VIDEO_CodingMJPEG);
-    if (ret != MPP_OK) {
-        printf("   MPP初始化失败: %d\n", ret);
-        mpp_destroy(ctx);
-
-    }else{
-        printf("   MPP初始化成功!   \n");
-    }
-    // 配置编码参数
-    mpp_enc_cfg_init(&cfg);
-    ret = mpp_enc_cfg_init(&cfg);
-    if (ret != MPP_OK) {
-        printf("   ❌ 编码配置初始化失败: %d\n", ret);
-        mpp_destroy(ctx);
-
-    }
-    ret = mpi->control(ctx, MPP_ENC_GET_CFG, cfg);
-    mpp_enc_cfg_set_s32(cfg, "prep:width", width1);
-    mpp_enc_cfg_set_s32(cfg, "prep:height", height1);
-    mpp_enc_cfg_set_s32(cfg, "prep:hor_stride",width1);
-    mpp_enc_cfg_set_s32(cfg, "prep:ver_stride",height1);
-    mpp_enc_cfg_set_s32(cfg, "prep:format", MPP_FMT_YUV420SP);  // NV12格式
-    mpp_enc_cfg_set_s32(cfg, "jpeg:q_factor", JPEG_QUALITY);    // JPEG质量
-    mpp_enc_cfg_set_s32(cfg, "jpeg:qf_max", 99);    
-    mpp_enc_cfg_set_s32(cfg, "jpeg:qf_min", 1);      
-    mpp_enc_cfg_set_s32(cfg, "rc:mode", MPP_ENC_RC_MODE_FIXQP); 
-    ret = mpi->control(ctx, MPP_ENC_SET_CFG, cfg);
-    if (ret) {
-        printf("   ❌ 编码器配置失败: %d\n", ret);
-        mpp_enc_cfg_deinit(cfg);
-        mpp_destroy(ctx);
-
-    }
-    printf("   ✅ 编码器配置成功!\n");
-    // 创建MPP内存池
-    ret = mpp_buffer_group_get_internal(&group, MPP_BUFFER_TYPE_ION);
-    if (ret != MPP_OK) {
-        printf("   MPP内存池创建失败: %d\n", ret);
-        mpp_destroy(ctx);
-
-    }else{
-        printf("   MPP内存池创建成功！\n");
-    }
-
-    ret =mpp_buffer_group_limit_config(group,buffer_size,2);
-    if (ret!=MPP_OK){
-        printf("   MPP内存池限制失败，请重试！\n");
-
-    }else{
-        printf("   MPP内存池限制成功！\n");
-    }
-    //开始处理摄像头图像
-    printf("   ==处理摄像头图像IMAGE...==\n" );
-    MppBuffer buffer = NULL;
-    MppBuffer buffer2 =NULL;
-    MppPacket packet =NULL;
-    MppFrame  frame =NULL;
-    // 给帧分配MPP缓冲区
-    ret = mpp_buffer_get(group, &buffer, buffer_size);
-    if (ret != MPP_OK || !buffer) {
-        printf("   MPP缓冲区分配失败");
-        printf("   问题是：ret=%d,buffer=%p",ret,buffer);
-    }else{
-        printf("   MPP帧缓冲区分配成功!\n");
-    }
-    // 给packet分配缓冲区
-    ret = mpp_buffer_get(group,&buffer2,buffer_size);
-    if (ret != MPP_OK || !buffer2) {
-        printf("   MPP_packet缓冲区分配失败\n");
-        printf("   问题是：ret=%d,buffer2=%p",ret,buffer2);
-    }else{
-        printf("   MPP_packet缓冲区分配成功!\n");
-    }
-    void* mpp_ptr = mpp_buffer_get_ptr(buffer);
-    if (!mpp_ptr) {
-        printf("   无法获取MPP缓冲区指针\n");
-        mpp_buffer_put(buffer);
-    }else{
-        printf("   成功获取MPP缓冲区指针\n");
-        printf("   mpp_ptr的地址为：%p\n",mpp_ptr);
-    }
-    void *mpp_ptr2=mpp_buffer_get_ptr(buffer2);
-    if (!mpp_ptr2) {
-        printf("   无法获取MPP缓冲区指针\n");
-        mpp_buffer_put(buffer);
-    }else{
-        printf("   成功获取MPP缓冲区指针\n");
-        printf("   mpp_ptr2的地址为：%p\n",mpp_ptr2);
-    }
-
-    printf("   ===读取YUV数据!===\n");
-
-    mpp_buffer_sync_begin(buffer);
-    memcpy(mpp_ptr, yuv_data, YUV_SIZE);
-    printf("   已成功将yuv数据放进MPPbuffer!\n");
-    mpp_buffer_sync_end(buffer);
-    // 准备MPP帧
-    mpp_frame_init(&frame);
-    mpp_frame_set_buffer(frame, buffer);
-    mpp_frame_set_width(frame, width1);
-    mpp_frame_set_height(frame, height1);
-    mpp_frame_set_hor_stride(frame, height1);
-    mpp_frame_set_ver_stride(frame,width1);
-    mpp_frame_set_fmt(frame, MPP_FMT_YUV420SP);
-    mpp_frame_set_eos(frame, 1);  // 设置结束标志
-    printf("   准备MPP帧成功！\n");
-    MppMeta meta = mpp_frame_get_meta(frame);
-    ret=mpp_packet_init_with_buffer(&packet, buffer2);
-    if (ret != MPP_OK) {
-        printf("   ❌ 包初始化失败: %d\n", ret);
-        mpp_frame_deinit(&frame);
-        mpp_buffer_put(buffer);
-        mpp_buffer_put(buffer2);
-    }
-    mpp_meta_set_packet(meta, KEY_OUTPUT_PACKET, packet);
-    mpp_packet_set_length(packet, 0);
-    // JPEG编码
-    //ret=mpi->encode(ctx,frame,packet);//目前暂未开发
-    printf("   准备进行帧提取！\n");
-    ret=mpi->encode_put_frame(ctx, frame);
-    if (ret != MPP_OK) {
-        printf("   获取帧失败: %d \n", ret);
-        mpp_buffer_put(buffer);
-        mpp_frame_deinit(&frame);
-    }else{
-        printf("   获取帧成功！\n\n");
-        
-    }
-    printf("   准备进行包提取！\n");
-    ret=mpi->encode_get_packet(ctx,packet);
-    if (ret != MPP_OK) {
-        printf("   获取包失败: %d \n", ret);
-        mpp_buffer_put(buffer);
-        mpp_frame_deinit(&frame);
-    }else{
-        printf("   获取包成功！\n\n");
-        
-    }
-    void* jpeg_data = mpp_packet_get_data(packet);
-    printf("   packet指针的位置在：%p\n",jpeg_data);
-    size_t jpeg_size = mpp_packet_get_length(packet);
-    printf("   此次JPEG图像大小为：%ld\n",jpeg_size);
-    ret=write_data_to_file(output_file, jpeg_data, jpeg_size);
-    // 保存JPEG文件
-    if (!ret) {
-        printf("   ✅ 保存成功\n\n\n");
+        return -1;
+    }
+    uint64_t t1 = metrics_now_us();
+    size_t frame_bytes = pipeline_frame_bytes(pl);
+    pl->busy_us = 0;
+    metrics_observe_us(METRIC_STAGE_CAPTURE, t1 - t0);
+    metrics_rusage_stage(METRIC_STAGE_CAPTURE, &mark);
+    if (pl->stream_enabled) {
+        stream_out_begin(seq, t0);
+    }
+    if (pl->rings_enabled) {
+        if (pl->import_mode) {
+            // 摄像头 DMA 刚写入，CPU 读之前作废 cache
+            mpp_heap_sync_read_begin(pl->enc.import_bufs[cam->buf.index], 0, frame_bytes);
+        }
+        shm_ring_publish(&pl->rings[0], SHM_RING_NV12, yuv_data, frame_bytes, pl->width, pl->height, t0);
+        if (pl->import_mode) {
+            mpp_heap_sync_read_end(pl->enc.import_bufs[cam->buf.index], 0, frame_bytes);
+        }
+    }
+
+    uint64_t tt = trace_begin();
+    if (pl->import_mode) {
+        pl->stats.valid = 0;
+        if (pl->stats_import) {
+            MppBuffer buf = pl->enc.import_bufs[cam->buf.index];
+            mpp_heap_sync_read_begin(buf, 0, frame_bytes);
+            frame_stats_scan(yuv_data, pl->width, pl->height, &pl->stats);
+            mpp_heap_sync_read_end(buf, 0, frame_bytes);
+        }
+        // 直接编码摄像头写入的缓冲，编码完成后才能归还
+        mpp_encoder_use_import(&pl->enc, cam->buf.index);
+        trace_end(TRACE_COPY, seq, tt, 0);
     } else {
-        printf("   ❌❌ 保存失败\n\n");
+        // 拷贝的同一遍里统计，不再单独读一遍帧
+        mpp_encoder_load_frame_stats(&pl->enc, yuv_data, frame_bytes, &pl->stats);
+        trace_end(TRACE_COPY, seq, tt, 0);
+        // 数据已拷贝，立即归还采集缓冲区给驱动
+        requeue_buffer(cam);
     }
-    // 清理映射内存资源
-    if (yuv_data != NULL && yuv_data != MAP_FAILED) {
-    if (munmap(yuv_data, YUV_SIZE) == -1) {
-        perror("munmap 失败");
+    uint64_t t2 = metrics_now_us();
+    metrics_observe_us(METRIC_STAGE_COPY, t2 - t1);
+    metrics_rusage_stage(METRIC_STAGE_COPY, &mark);
+    pipeline_publish_stats(&pl->stats);
+
+    if (pl->video_enabled) {
+        // 录像与 JPEG 编码同一个输入缓冲
+        pipeline_video(pl, seq, t0);
+        t2 = metrics_now_us();
+        if (seq % (uint64_t)pl->snapshot_interval != 0 && !eos) {
+            if (pl->import_mode) {
+                requeue_buffer(cam);
+            }
+            pl->busy_us = t2 - t1;
+            return 0;
+        }
+    }
+
+    // JPEG编码，输出直接落在池中的缓冲里，后续各消费者共享同一份
+    enc_packet_t* pkt = mpp_encoder_encode_packet(&pl->enc, pl->pool, eos);
+    uint64_t t3 = metrics_now_us();
+    metrics_observe_us(METRIC_STAGE_ENCODE, t3 - t2);
+    metrics_rusage_stage(METRIC_STAGE_ENCODE, &mark);
+    if (pl->import_mode) {
+        requeue_buffer(cam);
+    }
+    pl->busy_us = t3 - t1;
+    if (seq == 0) {
+        startup_phase("first_capture", t0, t1);
+        startup_phase("first_encode", t2, t3);
+    }
+    if (!pkt) {
+        return 0;
+    }
+    pkt->seq = seq;
+    pkt->timestamp_us = t0;
+    pkt->stats = pl->stats;
+    int jpeg_width = pl->enc.width;
+    int jpeg_height = pl->enc.height;
+    if (pl->xform_enabled && pipeline_xform(pl, pkt) == 0) {
+        jpeg_width = pl->xform.width;
+        jpeg_height = pl->xform.height;
+    }
+    metrics_count(METRIC_FRAMES_ENCODED, 1);
+    if (pkt->stats.valid) {
+        printf("   第%llu帧JPEG图像大小为：%zu，平均亮度%.1f，清晰度%.2f\n", (unsigned long long)seq, pkt->length,
+               pkt->stats.luma_mean, pkt->stats.sharpness);
     } else {
-        printf("YUV 数据映射内存释放成功\n");
+        printf("   第%llu帧JPEG图像大小为：%zu\n", (unsigned long long)seq, pkt->length);
     }
+
+    if (pl->stream_enabled && !pl->video_enabled) {
+        // MPP JPEG 编码器没有分片输出，整包作为一块尽早推出
+        stream_out_chunk(NULL, pkt->data, pkt->length, 1);
     }
-    mpp_packet_deinit(&packet);
-    mpp_frame_deinit(&frame);
-    mpp_buffer_put(buffer);
-    mpp_buffer_put(buffer2);
-    // 清理MPP资源
-    ret=mpp_enc_cfg_deinit(cfg);
-    if (ret!=MPP_OK)
-    {
-        printf("   编码配置释放失败\n");
-    }else{
-        printf("   编码配置释放成功！\n");
-    }
-    ret=mpp_buffer_group_put(group);
-    if (ret!=MPP_OK)
-    {
-        printf("   缓冲组释放失败\n");
-    }else{
-        printf("   缓冲组释放成功！\n");
-    }
-    ret=mpp_destroy(ctx);
-    if (ret!=MPP_OK)
-    {
-        printf("   MPP释放失败\n");
-    }else{
-        printf("   MPP释放成功！\n");
+    if (pl->rings_enabled) {
+        shm_ring_publish(&pl->rings[1], SHM_RING_JPEG, pkt->data, pkt->length, jpeg_width, jpeg_height, t0);
+    }
+    if (pl->preview_enabled) {
+        http_preview_publish(pkt);
+    }
+
+    metrics_gauge_set(METRIC_MPP_GROUP_USED_BYTES, (int64_t)mpp_buffer_group_usage(pl->enc.group));
+    metrics_gauge_set(METRIC_MPP_GROUP_UNUSED, mpp_buffer_group_unused(pl->enc.group));
+    *out = pkt;
+    return 0;
+}
 
+static int send_all(int fd, const void* data, size_t len) {
+    const char* p = data;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
     }
+    return 0;
+}
+
+/**
+ * @brief 常驻模式：摄像头保持采集，收到 "capture" 时丢弃旧帧、编码一张新帧返回，
+ *        收到 "quit" 时退出；返回的数据就是 JPEG 本身，失败时不返回任何数据
+ */
+static int pipeline_daemon(pipeline_t* pl, frame_writer_t* writer, const char* path) {
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        printf("   常驻套接字路径过长: %s\n", path);
+        return -1;
+    }
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0) {
+        perror("无法创建常驻套接字");
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    unlink(path);
+    if (bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(listen_fd, 4) < 0) {
+        perror("无法监听常驻套接字");
+        close(listen_fd);
+        return -1;
+    }
+    printf("   常驻模式就绪: %s\n", path);
+
+    uint64_t seq = 0;
+    for (;;) {
+        char cmd[64];
+        int cfd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (cfd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("常驻套接字accept失败");
+            break;
+        }
+        ssize_t n = recv(cfd, cmd, sizeof(cmd) - 1, 0);
+        cmd[n > 0 ? n : 0] = '\0';
+        cmd[strcspn(cmd, "\r\n")] = '\0';
+        if (strcmp(cmd, "quit") == 0) {
+            close(cfd);
+            break;
+        }
+        control_cmd_t ctl_cmd;
+        if (control_parse(cmd, &ctl_cmd) == 0) {
+            // 常驻模式下控制命令直接发到常驻套接字
+            char reply[CONTROL_REPLY_MAX + 1];
+            pipeline_control(pl, &ctl_cmd, reply, CONTROL_REPLY_MAX);
+            printf("   控制命令: %s -> %s\n", cmd, reply);
+            strcat(reply, "\n");
+            send_all(cfd, reply, strlen(reply));
+        } else if (strcmp(cmd, "capture") == 0) {
+            uint64_t t0 = metrics_now_us();
+            int stale = camera_flush(&pl->cam);
+            if (stale > 0) {
+                // 空闲期间驱动一直在出帧，停顿从此刻算起
+                stall_watchdog_frame(&pl->watchdog, metrics_now_us(), pl->rate.period_us);
+            }
+            enc_packet_t* pkt = NULL;
+            if (pipeline_frame(pl, seq++, 0, &pkt) == 0 && pkt) {
+                send_all(cfd, pkt->data, pkt->length);
+                printf("   请求完成: %.1fms(丢弃旧帧%d)\n", (metrics_now_us() - t0) / 1000.0, stale);
+                frame_writer_submit(writer, pkt);
+            }
+        }
+        close(cfd);
+    }
+    close(listen_fd);
+    unlink(path);
+    return 0;
+}
+
+/**
+ * @brief 上报一帧的负载：处理耗时占帧间隔的比例与写队列占用率取最大
+ */
+static void pipeline_adapt(pipeline_t* pl, frame_writer_t* writer) {
+    uint64_t interval = frame_rate_interval_us(&pl->rate);
+    float load = interval ? (float)pl->busy_us / interval : 0;
+    float fill = queue_fill(atomic_load(&writer->head), atomic_load(&writer->tail), FRAME_WRITER_DEPTH);
+    if (fill > load) {
+        load = fill;
+    }
+    if (pl->video_enabled) {
+        fill = queue_fill(atomic_load(&pl->seg.head), atomic_load(&pl->seg.tail), SEGMENT_WRITER_DEPTH);
+        if (fill > load) {
+            load = fill;
+        }
+    }
+    frame_rate_load(&pl->rate, metrics_now_us(), load);
+}
+
+/**
+ * @brief 退出时打印帧路径内存使用：堆分配次数在稳定运行后应不再增长
+ */
+static void pipeline_mem_report(const pipeline_t* pl) {
+    printf("   帧内存: 堆分配%llu次", (unsigned long long)atomic_load(&g_metrics.counters[METRIC_HEAP_ALLOCS]));
+    if (pl->video_packets.base) {
+        printf(", 录像包池%u个x%zuKB(%s)最多同时借出%d个", pl->video_packets.count,
+               pl->video_packets.obj_size / 1024, mem_backing_name(pl->video_packets.backing),
+               atomic_load(&pl->video_packets.in_use_hwm));
+    }
+    printf("\n");
+}
+
+/**
+ * @brief 主函数
+ */
+int main(int argc, char* argv[]) {
+    static pipeline_t pl;
+    frame_writer_t writer;
+    uint64_t t_start = metrics_now_us();
+
+    const char* output_file = "capture.jpg";
+    const char* metrics_file = NULL;
+    const char* metrics_socket = NULL;
+    int metrics_interval_ms = 1000;
+    const char* ring_socket = NULL;
+    http_preview_cfg_t preview_cfg = { 0 };
+    int bench_iterations = 0;
+    rt_sched_t capture_sched = RT_SCHED_NONE;
+    rt_sched_t writer_sched = RT_SCHED_NONE;
+    int lock_memory = 0;
+    int fast_start = 0;
+    int quiet = 0;
+    const char* daemon_socket = NULL;
+    const char* record_base = NULL;
+    const char* video_prefix = "video";
+    const char* trace_file = NULL;
+    const char* control_socket = NULL;
+    const char* stream_socket = NULL;
+    jpeg_xform_cfg_t xform_cfg;
+    int segment_sec = 60;
+    static const video_cfg_t default_video = VIDEO_CFG_DEFAULT;
+    int frame_count = 1;
+    static const mpp_heap_t default_heap = MPP_HEAP_DEFAULT;
+    static const stall_watchdog_t default_watchdog = STALL_WATCHDOG_INIT;
+
+    pl.camera_device = "/dev/video11";
+    pl.width = 1920;
+    pl.height = 1080;
+    pl.pixelformat = V4L2_PIX_FMT_NV12;  // NV12格式
+    pl.cam_buffers = CAMERA_DEFAULT_BUFFERS;
+    pl.heap = default_heap;
+    pl.video_cfg = default_video;
+    pl.watchdog = default_watchdog;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:o:M:S:I:R:P:K:b:H:B:DAGC:W:LFqd:r:V:s:g:J:c:f:T:t:w:X:Y:h")) != -1) {
+        switch (opt) {
+            case 'n': frame_count = atoi(optarg); break;
+            case 'o': output_file = optarg; break;
+            case 'M': metrics_file = optarg; break;
+            case 'S': metrics_socket = optarg; break;
+            case 'I': metrics_interval_ms = atoi(optarg); break;
+            case 'R': ring_socket = optarg; break;
+            case 'P': preview_cfg.port = atoi(optarg); break;
+            case 'K': pl.pool_base_size = (size_t)atoi(optarg) * 1024; break;
+            case 'b': pl.cam_buffers = (unsigned int)atoi(optarg); break;
+            case 'H':
+                if (mpp_heap_parse(optarg, &pl.heap) != 0) {
+                    printf("无法识别的缓冲类型: %s\n", optarg);
+                    return -1;
+                }
+                break;
+            case 'B': bench_iterations = atoi(optarg); break;
+            case 'D': pl.import_mode = 1; break;
+            case 'A': pl.stats_import = 1; break;
+            case 'G': pl.huge_pages = 1; break;
+            case 'C':
+            case 'W':
+                if (rt_sched_parse(optarg, opt == 'C' ? &capture_sched : &writer_sched) != 0) {
+                    printf("无法识别的线程配置: %s\n", optarg);
+                    return -1;
+                }
+                break;
+            case 'L': lock_memory = 1; break;
+            case 'F': fast_start = 1; quiet = 1; break;
+            case 'q': quiet = 1; break;
+            case 'd': daemon_socket = optarg; break;
+            case 'r': record_base = optarg; break;
+            case 'V':
+                if (video_cfg_parse(optarg, &pl.video_cfg) != 0) {
+                    printf("无法识别的录像参数: %s\n", optarg);
+                    return -1;
+                }
+                pl.video_enabled = 1;
+                break;
+            case 's': video_prefix = optarg; break;
+            case 'g': segment_sec = atoi(optarg); break;
+            case 'J': pl.snapshot_interval = atoi(optarg); break;
+            case 'c':
+                if (roi_parse(optarg, &pl.crop_rect) != 0) {
+                    printf("无法识别的区域: %s\n", optarg);
+                    return -1;
+                }
+                pl.crop = &pl.crop_rect;
+                break;
+            case 'f':
+                if (frame_rate_parse(optarg, &pl.rate) != 0) {
+                    printf("无法识别的帧率参数: %s\n", optarg);
+                    return -1;
+                }
+                break;
+            case 'T': trace_file = optarg; break;
+            case 't':
+                if (jpeg_xform_parse(optarg, &xform_cfg) != 0) {
+                    printf("无法识别的变换: %s\n", optarg);
+                    return -1;
+                }
+                jpeg_xform_init(&pl.xform, &xform_cfg);
+                pl.xform_enabled = 1;
+                break;
+            case 'X': control_socket = optarg; break;
+            case 'Y': stream_socket = optarg; break;
+            case 'w':
+                if (stall_watchdog_parse(optarg, &pl.watchdog) != 0) {
+                    printf("无法识别的看门狗参数: %s\n", optarg);
+                    return -1;
+                }
+                break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : -1;
+        }
+    }
+    if (frame_count < 1) {
+        frame_count = 1;
+    }
+    if (record_base) {
+        // 录制线程异步持有采集缓冲，导入模式下这些缓冲还要给编码器用
+        pl.import_mode = 0;
+    }
+    if (control_socket && (daemon_socket || record_base)) {
+        printf("常驻模式下控制命令直接发到常驻套接字，原始录制不编码，忽略 -X\n");
+        control_socket = NULL;
+    }
+    if (pl.video_enabled && (daemon_socket || record_base)) {
+        printf("常驻模式和原始录制下不支持录像，忽略 -V\n");
+        pl.video_enabled = 0;
+    }
+    if (stream_socket && (daemon_socket || record_base)) {
+        printf("常驻模式和原始录制下不支持低延迟码流输出，忽略 -Y\n");
+        stream_socket = NULL;
+    }
+    if (stream_socket && pl.video_enabled) {
+        pl.video_cfg.slice_rows = STREAM_OUT_BAND_ROWS;
+    }
+    if (daemon_socket) {
+        // 常驻模式按请求取帧，不做帧率控制
+        pl.rate.target_fps = 0;
+    }
+    if (pl.rate.target_fps > 0) {
+        // 录像码率按实际输出帧率分配
+        pl.video_cfg.fps = pl.rate.target_fps;
+    }
+    if (pl.snapshot_interval < 1) {
+        pl.snapshot_interval = pl.video_cfg.fps;
+    }
+    camera_set_verbose(!quiet);
+    mem_set_huge(pl.huge_pages);
+    // 必须在创建任何线程之前，之后的线程都继承 SIGUSR1 屏蔽
+    if (trace_file && trace_start(trace_file) != 0) {
+        printf("   帧事件跟踪启动失败，继续运行\n");
+    }
+
+    printf("=== RK3562摄像头YUV数据采集与MPP Buffer处理示例 ===\n");
+
+    if (bench_iterations > 0) {
+        return mpp_heap_bench(width1, height1, JPEG_QUALITY, bench_iterations);
+    }
+
+    // 之后的所有映射(MPP缓冲、V4L2缓冲、线程栈)都会被锁定
+    if (lock_memory && rt_sched_lock_memory() != 0) {
+        printf("   内存锁定失败，继续运行(检查 ulimit -l)\n");
+    }
+    startup_phase("process_start", t_start, metrics_now_us());
+
+    // 1. 初始化MPP编码器与摄像头。快速启动时两者并行：
+    //    MPP 上下文、配置和缓冲组分配与 V4L2 格式协商、REQBUFS、STREAMON 互不依赖；
+    //    导入模式下摄像头缓冲由编码器分配，只能串行
+    int ret;
+    if (fast_start && !pl.import_mode) {
+        pthread_t init_thread;
+        if (pthread_create(&init_thread, NULL, encoder_init_thread, &pl) != 0) {
+            pl.encoder_ret = pipeline_init_encoder(&pl);
+            ret = pl.encoder_ret == 0 ? pipeline_init_camera(&pl) : -1;
+        } else {
+            ret = pipeline_init_camera(&pl);
+            pthread_join(init_thread, NULL);
+            if (pl.encoder_ret != 0) {
+                ret = -1;
+            }
+        }
+    } else {
+        ret = pipeline_init_encoder(&pl);
+        if (ret == 0) {
+            ret = pipeline_init_camera(&pl);
+        }
+    }
+    if (ret != 0 || frame_writer_start(&writer, output_file, &writer_sched) != 0) {
+        if (pl.cam_ready) {
+            camera_close(&pl.cam);
+        }
+        if (pl.pool) {
+            packet_pool_deinit(pl.pool);
+            free(pl.pool);
+        }
+        video_encoder_deinit(&pl.video);
+        mem_pool_destroy(&pl.video_packets);
+        mpp_encoder_deinit(&pl.enc);
+        return -1;
+    }
+    if (pl.video_enabled && segment_writer_start(&pl.seg, video_prefix, video_codec_ext(pl.video_cfg.codec),
+                                                 segment_sec, &writer_sched) != 0) {
+        printf("   录像写线程启动失败，只输出JPEG\n");
+        pl.video_enabled = 0;
+    }
+
+    if (metrics_start(metrics_file, metrics_socket, metrics_interval_ms) != 0) {
+        printf("   指标导出启动失败，继续运行\n");
+    }
+
+    if (ring_socket) {
+        if (shm_ring_create(&pl.rings[0], "mipi_nv12", 4, YUV_SIZE) == 0 &&
+            shm_ring_create(&pl.rings[1], "mipi_jpeg", 8, YUV_SIZE / 2) == 0 &&
+            shm_ring_server_start(ring_socket, pl.rings, 2) == 0) {
+            pl.rings_enabled = 1;
+        } else {
+            printf("   共享内存环启动失败，继续运行\n");
+        }
+    }
+
+    if (preview_cfg.port > 0) {
+        pl.preview_enabled = http_preview_start(&preview_cfg) == 0;
+    }
+    if (control_socket && control_start(control_socket) != 0) {
+        printf("   控制套接字启动失败，继续运行\n");
+    }
+    if (stream_socket) {
+        stream_kind_t kind = !pl.video_enabled ? STREAM_KIND_JPEG
+                             : pl.video_cfg.codec == VIDEO_CODEC_H265 ? STREAM_KIND_H265 : STREAM_KIND_H264;
+        pl.stream_enabled = stream_out_start(stream_socket, kind) == 0;
+        if (!pl.stream_enabled) {
+            printf("   低延迟码流输出启动失败，继续运行\n");
+        }
+    }
+
+    if (lock_memory) {
+        for (unsigned int i = 0; i < pl.cam.n_buffers; i++) {
+            rt_sched_prefault(pl.cam.buffers[i], pl.cam.buf_lengths[i], 0);
+        }
+        rt_sched_prefault(pl.enc.frame_ptr, pl.enc.frame_size, 1);
+        rt_sched_prefault_stack(256 * 1024);
+    }
+    rt_sched_apply("mipi_capture", &capture_sched);
+
+    // 2. 逐帧采集、编码；写文件在独立线程完成
+    printf("   ==处理摄像头图像IMAGE...==\n" );
+    uint64_t t_first_submit = 0;
+    if (daemon_socket) {
+        startup_report();
+        pipeline_daemon(&pl, &writer, daemon_socket);
+    } else if (record_base) {
+        pipeline_record(&pl, record_base, frame_count);
+    } else {
+        for (int n = 0; n < frame_count; n++) {
+            enc_packet_t* pkt;
+            if (pipeline_frame(&pl, (uint64_t)n, n == frame_count - 1, &pkt) != 0) {
+                break;
+            }
+            if (pkt) {
+                if (t_first_submit == 0) {
+                    t_first_submit = metrics_now_us();
+                }
+                frame_writer_submit(&writer, pkt);  // 转交本线程的引用
+            }
+            pipeline_adapt(&pl, &writer);
+            control_poll(pipeline_control, &pl);
+        }
+    }
+
+    control_stop();
+    stream_out_stop();
+    frame_writer_stop(&writer);
+    if (pl.video_enabled) {
+        segment_writer_stop(&pl.seg);
+    }
+    trace_stop();
+    if (t_first_submit && atomic_load(&writer.first_write_us)) {
+        startup_phase("first_jpeg_written", t_first_submit, atomic_load(&writer.first_write_us));
+        startup_report();
+    }
+    if (pl.preview_enabled) {
+        http_preview_stop();
+    }
+    metrics_stop();
+    if (pl.rings_enabled) {
+        shm_ring_server_stop();
+        shm_ring_destroy(&pl.rings[0]);
+        shm_ring_destroy(&pl.rings[1]);
+    }
+
+    // 清理映射内存资源
+    frame_rate_report(&pl.rate);
+    stall_watchdog_report(&pl.watchdog);
+    pipeline_mem_report(&pl);
+    mem_pool_destroy(&pl.video_packets);
+    camera_report(&pl.cam);
+    camera_close(&pl.cam);
+    printf("YUV 数据映射内存释放成功\n");
+    // 清理MPP资源
+    packet_pool_report(pl.pool);
+    packet_pool_deinit(pl.pool);
+    free(pl.pool);
+    video_encoder_deinit(&pl.video);
+    mpp_encoder_deinit(&pl.enc);
+    jpeg_xform_deinit(&pl.xform);
+    printf("   MPP资源释放完成！\n");
+    return 0;
 }
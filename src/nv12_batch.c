@@ -0,0 +1,646 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "enc_backend.h"
+#include "metrics.h"
+#include "raw_record.h"
+#include "video_encoder.h"
+#include "segment_writer.h"
+#include "mem_arena.h"
+#include "jpeg_xform.h"
+
+/*
+ * NV12 原始数据离线批量转 JPEG。
+ * 输入为目录(按文件名排序，每个文件含整数帧)、若干拼接的原始文件或原始录制的 .idx 索引，全部 mmap；
+ * 工作线程各持一个编码会话，按原子计数领取帧。
+ * 输出为目录下按帧号命名的文件，或按帧顺序拼接的单个 MJPEG 文件；
+ * 另可同时把全部帧按顺序编码为分段的 H.264/H.265 码流(不启用 MPP 时为桩编码器)。
+ * JPEG 可在编码后于压缩域旋转、翻转和裁剪(-t)，不重新编码。
+ */
+
+#define BATCH_MAX_WORKERS   64
+
+typedef struct {
+    const uint8_t* map;
+    size_t size;
+    raw_reader_t* raw;          // 原始录制，帧位置由索引给出
+} input_file_t;
+
+typedef struct {
+    enc_packet_t* pkt;          // 编码结果，编码失败时为NULL
+    int done;
+} reorder_slot_t;
+
+typedef struct {
+    // 配置
+    int width;
+    int height;
+    int quality;
+    const char* backend;
+    const roi_rect_t* crop;     // 只编码该区域，NULL 为整帧
+    const roi_rect_t* zone;     // 质量分区，NULL 不分区
+    int bg_quality;
+    const jpeg_xform_cfg_t* xform;  // 编码后在压缩域变换，NULL 不变换
+    const char* out_dir;
+    int out_fd;                 // 顺序输出文件，<0 表示按帧号写目录
+    size_t frame_size;
+    int huge_pages;             // 软件缓冲和录像包池尝试使用大页
+    // 输入
+    input_file_t* files;
+    int n_files;
+    const uint8_t** frames;     // 帧号 -> 映射地址
+    uint64_t n_frames;
+    // 调度
+    _Atomic uint64_t next;
+    _Atomic uint64_t failed;
+    int live;                   // 仍在运行的工作线程，受 lock 保护；为0时主线程不再等待未完成的帧
+    // 顺序输出的重排窗口
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    reorder_slot_t* window;
+    uint64_t window_size;
+    mem_pool_t window_packets;  // 窗口中结果的拷贝，工作线程取、主线程写出后归还
+    uint64_t written;
+} batch_t;
+
+typedef struct {
+    batch_t* b;
+    pthread_t thread;
+    int id;
+    uint64_t frames;
+    uint64_t encode_us;
+    uint64_t xform_us;
+    uint64_t bytes;
+    int ok;
+} worker_t;
+
+// 顺序录像编码，与 JPEG 工作线程并行
+typedef struct {
+    batch_t* b;
+    video_cfg_t cfg;
+    const char* prefix;
+    int segment_sec;
+    pthread_t thread;
+    uint64_t frames;
+    uint64_t encode_us;
+    uint64_t bytes;
+    int ok;
+} video_job_t;
+
+static void usage(const char* prog) {
+    printf("用法: %s [选项] <目录|原始文件|录制索引.idx>...\n", prog);
+    printf("  -w <宽>          图像宽度(默认1920)\n");
+    printf("  -h <高>          图像高度(默认1080)\n");
+    printf("  -q <质量>        JPEG质量(默认80)\n");
+    printf("  -j <线程数>      工作线程数(默认CPU核数)\n");
+    printf("  -e <后端>        编码后端: %s(默认sw)\n", enc_backend_names());
+    printf("  -o <目录>        按帧号输出 frame_XXXXXXXX.jpg\n");
+    printf("  -O <文件>        按帧顺序拼接输出为单个 MJPEG 文件\n");
+    printf("  -V <参数>        同时编码录像 h264|h265[:cbr|vbr|avbr|fixqp[:码率kbps[:GOP[:帧率]]]]\n");
+    printf("  -s <前缀>        录像分段文件前缀(默认video)，输出 <前缀>_00000.h264 ...\n");
+    printf("  -g <秒>          录像每段时长(默认60)\n");
+    printf("  -c <x,y,宽,高>   只编码该区域(JPEG 和录像)\n");
+    printf("  -Z <x,y,宽,高:质量> 质量分区(仅sw后端)：区域内保持 -q 质量，区域外按给定质量压缩\n");
+    printf("  -t <变换>[:x,y,宽,高] 编码后在压缩域变换 rot90|rot180|rot270|hflip|vflip|none，可同时按 MCU 裁剪\n");
+    printf("  -G               软件编码输出缓冲、顺序输出包池和录像包池使用 2MB 大页\n");
+}
+
+static int write_all(int fd, const void* data, size_t len) {
+    const uint8_t* p = data;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int add_file(batch_t* b, const char* path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        printf("无法打开输入: %s (%s)\n", path, strerror(errno));
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)b->frame_size) {
+        printf("跳过不足一帧的文件: %s\n", path);
+        close(fd);
+        return 0;
+    }
+    void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        printf("无法映射输入: %s (%s)\n", path, strerror(errno));
+        return -1;
+    }
+    madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+    input_file_t* files = realloc(b->files, sizeof(*files) * (size_t)(b->n_files + 1));
+    if (!files) {
+        munmap(map, (size_t)st.st_size);
+        return -1;
+    }
+    b->files = files;
+    b->files[b->n_files].map = map;
+    b->files[b->n_files].size = (size_t)st.st_size;
+    b->files[b->n_files].raw = NULL;
+    b->n_files++;
+    return 0;
+}
+
+static int add_record(batch_t* b, const char* path) {
+    char base[4096];
+    snprintf(base, sizeof(base), "%.*s", (int)(strlen(path) - 4), path);
+    raw_reader_t* raw = calloc(1, sizeof(*raw));
+    if (!raw || raw_reader_open(raw, base) != 0) {
+        free(raw);
+        return -1;
+    }
+    if (raw->header.frame_size != b->frame_size) {
+        printf("录制帧大小不符: %s 为%ux%u\n", path, raw->header.width, raw->header.height);
+        raw_reader_close(raw);
+        free(raw);
+        return -1;
+    }
+    input_file_t* files = realloc(b->files, sizeof(*files) * (size_t)(b->n_files + 1));
+    if (!files) {
+        raw_reader_close(raw);
+        free(raw);
+        return -1;
+    }
+    b->files = files;
+    b->files[b->n_files].map = raw->data;
+    b->files[b->n_files].size = raw->data_size;
+    b->files[b->n_files].raw = raw;
+    b->n_files++;
+    return 0;
+}
+
+static int add_input(batch_t* b, const char* path) {
+    struct stat st;
+    size_t len = strlen(path);
+    if (len > 4 && strcmp(path + len - 4, ".idx") == 0) {
+        return add_record(b, path);
+    }
+    if (stat(path, &st) != 0) {
+        printf("输入不存在: %s\n", path);
+        return -1;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        return add_file(b, path);
+    }
+    struct dirent** names;
+    int n = scandir(path, &names, NULL, alphasort);
+    if (n < 0) {
+        printf("无法读取目录: %s\n", path);
+        return -1;
+    }
+    int ret = 0;
+    for (int i = 0; i < n; i++) {
+        char full[4096];
+        struct stat fst;
+        snprintf(full, sizeof(full), "%s/%s", path, names[i]->d_name);
+        if (ret == 0 && names[i]->d_name[0] != '.' && stat(full, &fst) == 0 && S_ISREG(fst.st_mode)) {
+            ret = add_file(b, full);
+        }
+        free(names[i]);
+    }
+    free(names);
+    return ret;
+}
+
+/**
+ * @brief 建立全局帧号到映射地址的表；原始录制按索引取帧，跳过越界的条目
+ */
+static int index_frames(batch_t* b) {
+    uint64_t total = 0;
+    for (int i = 0; i < b->n_files; i++) {
+        total += b->files[i].raw ? b->files[i].raw->count : b->files[i].size / b->frame_size;
+    }
+    b->frames = malloc(sizeof(*b->frames) * (total ? total : 1));
+    if (!b->frames) {
+        return -1;
+    }
+    uint64_t k = 0;
+    for (int i = 0; i < b->n_files; i++) {
+        const input_file_t* f = &b->files[i];
+        if (f->raw) {
+            for (size_t n = 0; n < f->raw->count; n++) {
+                if (f->raw->entries[n].offset + b->frame_size <= f->size) {
+                    b->frames[k++] = raw_reader_frame(f->raw, n);
+                }
+            }
+            continue;
+        }
+        for (size_t off = 0; off + b->frame_size <= f->size; off += b->frame_size) {
+            b->frames[k++] = f->map + off;
+        }
+    }
+    b->n_frames = k;
+    return 0;
+}
+
+static void emit_frame(batch_t* b, uint64_t idx, const uint8_t* jpeg, size_t len) {
+    if (b->out_fd < 0) {
+        if (!b->out_dir) {
+            return;
+        }
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/frame_%08llu.jpg", b->out_dir, (unsigned long long)idx);
+        int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0 || write_all(fd, jpeg, len) != 0) {
+            printf("写入失败: %s (%s)\n", path, strerror(errno));
+            atomic_fetch_add(&b->failed, 1);
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+        return;
+    }
+
+    // 顺序输出：拷贝到包池放入重排窗口，由主线程按帧号写出
+    enc_packet_t* pkt = jpeg ? enc_packet_alloc_pool(&b->window_packets, jpeg, len) : NULL;
+    pthread_mutex_lock(&b->lock);
+    reorder_slot_t* slot = &b->window[idx % b->window_size];
+    slot->pkt = pkt;
+    slot->done = 1;
+    pthread_cond_broadcast(&b->cond);
+    pthread_mutex_unlock(&b->lock);
+}
+
+/**
+ * @brief 工作线程退出(含初始化失败)，唤醒等待重排窗口的主线程
+ */
+static void worker_exit(batch_t* b) {
+    pthread_mutex_lock(&b->lock);
+    b->live--;
+    pthread_cond_broadcast(&b->cond);
+    pthread_mutex_unlock(&b->lock);
+}
+
+static void* worker_thread(void* arg) {
+    worker_t* w = arg;
+    batch_t* b = w->b;
+    enc_backend_t enc;
+    jpeg_xform_t xf;
+    if (b->xform) {
+        jpeg_xform_init(&xf, b->xform);
+    }
+    if (enc_backend_open(&enc, b->backend, b->width, b->height, b->quality) != 0) {
+        printf("工作线程%d: 编码后端%s初始化失败\n", w->id, b->backend);
+        worker_exit(b);
+        return NULL;
+    }
+    if ((b->crop && enc_backend_set_crop(&enc, b->crop) != 0) ||
+        (b->zone && enc_backend_set_zone(&enc, b->zone, b->bg_quality) != 0)) {
+        printf("工作线程%d: 裁剪或质量分区设置失败\n", w->id);
+        enc_backend_close(&enc);
+        worker_exit(b);
+        return NULL;
+    }
+    w->ok = 1;
+    for (;;) {
+        uint64_t idx = atomic_fetch_add(&b->next, 1);
+        if (idx >= b->n_frames) {
+            break;
+        }
+        if (b->out_fd >= 0) {
+            // 领先写出位置太多时等待，限制重排窗口占用的内存
+            pthread_mutex_lock(&b->lock);
+            while (idx >= b->written + b->window_size) {
+                pthread_cond_wait(&b->cond, &b->lock);
+            }
+            pthread_mutex_unlock(&b->lock);
+        }
+        const uint8_t* src = b->frames[idx];
+        size_t len = 0;
+        uint64_t t0 = metrics_now_us();
+        const uint8_t* jpeg = enc_backend_encode(&enc, src, &len);
+        uint64_t t1 = metrics_now_us();
+        w->encode_us += t1 - t0;
+        if (jpeg && b->xform) {
+            jpeg = jpeg_xform_apply(&xf, jpeg, len, &len);
+            w->xform_us += metrics_now_us() - t1;
+        }
+        if (!jpeg) {
+            printf("第%llu帧编码失败\n", (unsigned long long)idx);
+            atomic_fetch_add(&b->failed, 1);
+        } else {
+            w->frames++;
+            w->bytes += len;
+        }
+        emit_frame(b, idx, jpeg, len);
+    }
+    enc_backend_close(&enc);
+    if (b->xform) {
+        jpeg_xform_deinit(&xf);
+    }
+    worker_exit(b);
+    return NULL;
+}
+
+static void* video_thread(void* arg) {
+    video_job_t* job = arg;
+    batch_t* b = job->b;
+    video_encoder_t v;
+    segment_writer_t seg;
+    mem_pool_t packets;
+    if (video_encoder_init(&v, b->width, b->height, &job->cfg) != 0) {
+        printf("录像编码器初始化失败\n");
+        return NULL;
+    }
+    if (enc_packet_pool_init(&packets, video_cfg_packet_slot(&job->cfg), SEGMENT_WRITER_DEPTH + 4,
+                             b->huge_pages) != 0) {
+        video_encoder_deinit(&v);
+        return NULL;
+    }
+    if (b->crop && video_encoder_set_crop(&v, b->crop) != 0) {
+        mem_pool_destroy(&packets);
+        video_encoder_deinit(&v);
+        return NULL;
+    }
+    if (segment_writer_start(&seg, job->prefix, video_codec_ext(job->cfg.codec), job->segment_sec, NULL) != 0) {
+        mem_pool_destroy(&packets);
+        video_encoder_deinit(&v);
+        return NULL;
+    }
+    job->ok = 1;
+    for (uint64_t idx = 0; idx < b->n_frames; idx++) {
+        video_packet_t vp;
+        uint64_t t0 = metrics_now_us();
+        uint64_t pts = idx * 1000000 / (uint64_t)job->cfg.fps;
+        int ret = video_encoder_encode(&v, b->frames[idx], pts, &vp);
+        job->encode_us += metrics_now_us() - t0;
+        if (ret != 0) {
+            printf("第%llu帧录像编码失败\n", (unsigned long long)idx);
+            atomic_fetch_add(&b->failed, 1);
+            continue;
+        }
+        enc_packet_t* pkt = enc_packet_alloc_pool(&packets, vp.data, vp.length);
+        if (!pkt) {
+            atomic_fetch_add(&b->failed, 1);
+            continue;
+        }
+        pkt->seq = idx;
+        pkt->timestamp_us = pts;
+        pkt->flags = vp.keyframe ? ENC_PACKET_FLAG_KEY : 0;
+        job->frames++;
+        job->bytes += vp.length;
+        segment_writer_submit_wait(&seg, pkt);
+    }
+    segment_writer_stop(&seg);
+    mem_pool_destroy(&packets);
+    video_encoder_deinit(&v);
+    return NULL;
+}
+
+/**
+ * @brief 主线程按帧号顺序写出重排窗口中的结果；工作线程全部退出后还缺的帧不再等待
+ */
+static void write_in_order(batch_t* b) {
+    pthread_mutex_lock(&b->lock);
+    while (b->written < b->n_frames) {
+        reorder_slot_t* slot = &b->window[b->written % b->window_size];
+        if (!slot->done) {
+            if (b->live == 0) {
+                break;
+            }
+            pthread_cond_wait(&b->cond, &b->lock);
+            continue;
+        }
+        enc_packet_t* pkt = slot->pkt;
+        slot->pkt = NULL;
+        slot->done = 0;
+        b->written++;
+        pthread_cond_broadcast(&b->cond);
+        pthread_mutex_unlock(&b->lock);
+        if (pkt && write_all(b->out_fd, pkt->data, pkt->length) != 0) {
+            printf("写入失败: %s\n", strerror(errno));
+            atomic_fetch_add(&b->failed, 1);
+        }
+        enc_packet_unref(pkt);
+        pthread_mutex_lock(&b->lock);
+    }
+    pthread_mutex_unlock(&b->lock);
+}
+
+int main(int argc, char* argv[]) {
+    static batch_t b;
+    static worker_t workers[BATCH_MAX_WORKERS];
+    const char* out_file = NULL;
+    static video_job_t video = { .cfg = VIDEO_CFG_DEFAULT, .prefix = "video", .segment_sec = 60 };
+    int video_enabled = 0;
+    static roi_rect_t crop;
+    static roi_rect_t zone;
+    static jpeg_xform_cfg_t xform;
+    long n_workers = sysconf(_SC_NPROCESSORS_ONLN);
+
+    b.width = 1920;
+    b.height = 1080;
+    b.quality = 80;
+    b.backend = "sw";
+    b.out_fd = -1;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "w:h:q:j:e:o:O:V:s:g:c:Z:t:G")) != -1) {
+        switch (opt) {
+            case 'w': b.width = atoi(optarg); break;
+            case 'h': b.height = atoi(optarg); break;
+            case 'q': b.quality = atoi(optarg); break;
+            case 'j': n_workers = atol(optarg); break;
+            case 'e': b.backend = optarg; break;
+            case 'G': b.huge_pages = 1; break;
+            case 'o': b.out_dir = optarg; break;
+            case 'O': out_file = optarg; break;
+            case 'V':
+                if (video_cfg_parse(optarg, &video.cfg) != 0) {
+                    printf("无法识别的录像参数: %s\n", optarg);
+                    return -1;
+                }
+                video_enabled = 1;
+                break;
+            case 's': video.prefix = optarg; break;
+            case 'g': video.segment_sec = atoi(optarg); break;
+            case 'c':
+                if (roi_parse(optarg, &crop) != 0) {
+                    printf("无法识别的区域: %s\n", optarg);
+                    return -1;
+                }
+                b.crop = &crop;
+                break;
+            case 't':
+                if (jpeg_xform_parse(optarg, &xform) != 0) {
+                    printf("无法识别的变换: %s\n", optarg);
+                    return -1;
+                }
+                b.xform = &xform;
+                break;
+            case 'Z': {
+                char spec[64];
+                snprintf(spec, sizeof(spec), "%s", optarg);
+                char* q = strchr(spec, ':');
+                if (q) {
+                    *q++ = '\0';
+                }
+                if (!q || roi_parse(spec, &zone) != 0 || (b.bg_quality = atoi(q)) <= 0) {
+                    printf("无法识别的质量分区: %s\n", optarg);
+                    return -1;
+                }
+                b.zone = &zone;
+                break;
+            }
+            default:
+                usage(argv[0]);
+                return -1;
+        }
+    }
+    if (optind >= argc || b.width <= 0 || b.height <= 0) {
+        usage(argv[0]);
+        return -1;
+    }
+    if (n_workers < 1) {
+        n_workers = 1;
+    } else if (n_workers > BATCH_MAX_WORKERS) {
+        n_workers = BATCH_MAX_WORKERS;
+    }
+    b.frame_size = (size_t)b.width * b.height * 3 / 2;
+    mem_set_huge(b.huge_pages);
+
+    for (int i = optind; i < argc; i++) {
+        if (add_input(&b, argv[i]) != 0) {
+            return -1;
+        }
+    }
+    if (index_frames(&b) != 0 || b.n_frames == 0) {
+        printf("没有可处理的帧\n");
+        return -1;
+    }
+    if (out_file) {
+        b.out_fd = open(out_file, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (b.out_fd < 0) {
+            printf("无法创建输出: %s (%s)\n", out_file, strerror(errno));
+            return -1;
+        }
+        b.window_size = (uint64_t)n_workers * 4;
+        b.window = calloc(b.window_size, sizeof(reorder_slot_t));
+        // 窗口里最多 window_size 帧；对象为原始帧的 1/4(与 mipi_bench 端到端的包池相同)，
+        // 质量很高或噪声很多的帧超出时个别退回堆分配并计数
+        if (!b.window || enc_packet_pool_init(&b.window_packets, b.frame_size / 4, (uint32_t)b.window_size,
+                                              b.huge_pages) != 0) {
+            return -1;
+        }
+    } else if (b.out_dir) {
+        mkdir(b.out_dir, 0755);
+    }
+    pthread_mutex_init(&b.lock, NULL);
+    pthread_cond_init(&b.cond, NULL);
+
+    printf("输入: %d个文件, %llu帧 %dx%d; 后端 %s, %ld个工作线程\n", b.n_files,
+           (unsigned long long)b.n_frames, b.width, b.height, b.backend, n_workers);
+    // 只要求录像时不做 JPEG
+    if (video_enabled && !out_file && !b.out_dir) {
+        n_workers = 0;
+    }
+    uint64_t t0 = metrics_now_us();
+    int video_started = 0;
+    if (video_enabled) {
+        video.b = &b;
+        video_started = pthread_create(&video.thread, NULL, video_thread, &video) == 0;
+    }
+    int started = 0;
+    for (int i = 0; i < n_workers; i++) {
+        workers[i].b = &b;
+        workers[i].id = i;
+        pthread_mutex_lock(&b.lock);
+        b.live++;
+        pthread_mutex_unlock(&b.lock);
+        if (pthread_create(&workers[i].thread, NULL, worker_thread, &workers[i]) == 0) {
+            started++;
+        } else {
+            worker_exit(&b);
+            break;
+        }
+    }
+    if (b.out_fd >= 0 && started > 0) {
+        write_in_order(&b);
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+    if (video_started) {
+        pthread_join(video.thread, NULL);
+    }
+    uint64_t elapsed = metrics_now_us() - t0;
+
+    uint64_t frames = 0;
+    int sessions = 0;
+    for (int i = 0; i < started; i++) {
+        if (workers[i].ok) {
+            sessions++;
+        }
+        frames += workers[i].frames;
+        if (workers[i].frames) {
+            printf("   线程%2d: %llu帧, 平均编码 %.2fms", i, (unsigned long long)workers[i].frames,
+                   workers[i].encode_us / 1000.0 / workers[i].frames);
+            if (b.xform) {
+                printf(", 压缩域%s %.2fms", jpeg_xform_op_name(b.xform->op),
+                       workers[i].xform_us / 1000.0 / workers[i].frames);
+            }
+            printf("\n");
+        }
+    }
+    double secs = elapsed / 1e6;
+    if (n_workers > 0) {
+        printf("完成: %llu/%llu帧, 失败%llu, 用时%.2fs, %.1f帧/s, 输入%.1fMB/s (%d个编码会话)\n",
+               (unsigned long long)frames, (unsigned long long)b.n_frames,
+               (unsigned long long)atomic_load(&b.failed), secs, secs > 0 ? frames / secs : 0.0,
+               secs > 0 ? frames * (double)b.frame_size / secs / 1e6 : 0.0, sessions);
+        uint64_t bytes = 0;
+        for (int i = 0; i < started; i++) {
+            bytes += workers[i].bytes;
+        }
+        if (frames) {
+            printf("JPEG: 平均每帧 %.1fKB, 共%.2fMB\n", bytes / 1024.0 / frames, bytes / 1e6);
+        }
+    }
+    if (video.frames) {
+        // 平均码率按录像帧率折算，与 JPEG 每帧大小直接可比
+        double video_secs = (double)video.frames / video.cfg.fps;
+        printf("录像: %llu帧, 平均编码 %.2fms, %.2fMB, 平均码率 %.0fkbps\n", (unsigned long long)video.frames,
+               video.encode_us / 1000.0 / video.frames, video.bytes / 1e6, video.bytes * 8 / video_secs / 1000);
+    }
+
+    if (b.out_fd >= 0) {
+        close(b.out_fd);
+    }
+    for (int i = 0; i < b.n_files; i++) {
+        if (b.files[i].raw) {
+            raw_reader_close(b.files[i].raw);
+            free(b.files[i].raw);
+        } else {
+            munmap((void*)b.files[i].map, b.files[i].size);
+        }
+    }
+    free(b.files);
+    free(b.frames);
+    free(b.window);
+    mem_pool_destroy(&b.window_packets);
+    int jpeg_ok = n_workers == 0 || (sessions > 0 && frames == b.n_frames);
+    int video_ok = !video_enabled || (video.ok && video.frames == b.n_frames);
+    return jpeg_ok && video_ok ? 0 : -1;
+}